@@ -0,0 +1,321 @@
+/* build-aux/config.h.  Generated from config.h.in by configure.  */
+/* build-aux/config.h.in.  Generated from configure.ac by autoheader.  */
+
+/* load libX11 dynamically */
+#define DYN_X11 1
+
+/* parsing of .desktop files */
+#define ENABLE_DESKTOP_FILES 1
+
+/* enables extended keys (arrows etc.) */
+#define ENABLE_EXTENDED_KEYS 1
+
+/* executing commands remotely */
+#define ENABLE_REMOTE_CMDS 1
+
+/* alloca.h header is available. */
+#define HAVE_ALLOCA_H 1
+
+/* A_ITALIC attribute is available. */
+#define HAVE_A_ITALIC_DECL 1
+
+/* timespec is good. */
+#define HAVE_CONSISTENT_TIMESPEC 1
+
+/* Define to 1 if you have the declaration of 'MAGIC_MIME_TYPE', and to 0 if
+   you don't. */
+#define HAVE_DECL_MAGIC_MIME_TYPE 1
+
+/* Define to 1 if you have the declaration of '_PC_CASE_SENSITIVE', and to 0
+   if you don't. */
+#define HAVE_DECL__PC_CASE_SENSITIVE 0
+
+/* extended curses colors are present */
+#define HAVE_EXTENDED_COLORS 1
+
+/* fdatasync() is available. */
+#define HAVE_FDATASYNC 1
+
+/* Define if file program present */
+#define HAVE_FILE_PROG 1
+
+/* Define to 1 if fseeko (and ftello) are declared in stdio.h. */
+#define HAVE_FSEEKO 1
+
+/* Define to 1 if you have the 'futimens' function. */
+#define HAVE_FUTIMENS 1
+
+/* getmntinfo() function is available. */
+/* #undef HAVE_GETMNTINFO */
+
+/* use glib2 to determine mime type */
+/* #undef HAVE_GLIB */
+
+/* inotify is available */
+#define HAVE_INOTIFY 1
+
+/* Define to 1 if you have the <inttypes.h> header file. */
+#define HAVE_INTTYPES_H 1
+
+/* Define to 1 if you have the `magic' library (-lmagic). */
+#define HAVE_LIBMAGIC 1
+
+/* Define to 1 if you have the <linux/binfmts.h> header file. */
+#define HAVE_LINUX_BINFMTS_H 1
+
+/* malloc.h header is available. */
+#define HAVE_MALLOC_H 1
+
+/* MAX_ARG_STRLEN is available. */
+#define HAVE_MAX_ARG_STRLEN 1
+
+/* Define to 1 if you have the <minix/config.h> header file. */
+/* #undef HAVE_MINIX_CONFIG_H */
+
+/* Define to 1 if you have the <mntent.h> header file. */
+#define HAVE_MNTENT_H 1
+
+/* Have PTHREAD_PRIO_INHERIT. */
+#define HAVE_PTHREAD_PRIO_INHERIT 1
+
+/* Define to 1 if you have the 'random' function. */
+#define HAVE_RANDOM 1
+
+/* Define to 1 if you have the 'reallocarray' function. */
+#define HAVE_REALLOCARRAY 1
+
+/* set_escdelay() function is available. */
+#define HAVE_SET_ESCDELAY_FUNC 1
+
+/* Define to 1 if you have the 'srandom' function. */
+#define HAVE_SRANDOM 1
+
+/* Define to 1 if you have the <stdint.h> header file. */
+#define HAVE_STDINT_H 1
+
+/* Define to 1 if you have the <stdio.h> header file. */
+#define HAVE_STDIO_H 1
+
+/* Define to 1 if you have the <stdlib.h> header file. */
+#define HAVE_STDLIB_H 1
+
+/* strcasestr() is available. */
+#define HAVE_STRCASESTR 1
+
+/* Define to 1 if you have the <strings.h> header file. */
+#define HAVE_STRINGS_H 1
+
+/* Define to 1 if you have the <string.h> header file. */
+#define HAVE_STRING_H 1
+
+/* Define to 1 if 'd_type' is a member of 'struct dirent'. */
+#define HAVE_STRUCT_DIRENT_D_TYPE 1
+
+/* Define to 1 if 'st_mtim' is a member of 'struct stat'. */
+#define HAVE_STRUCT_STAT_ST_MTIM 1
+
+/* strverscmp() function is available. */
+#define HAVE_STRVERSCMP_FUNC 1
+
+/* Define to 1 if you have the <sys/param.h> header file. */
+#define HAVE_SYS_PARAM_H 1
+
+/* Define to 1 if you have the <sys/stat.h> header file. */
+#define HAVE_SYS_STAT_H 1
+
+/* Define to 1 if you have the <sys/sysmacros.h> header file. */
+#define HAVE_SYS_SYSMACROS_H 1
+
+/* Define to 1 if you have the <sys/types.h> header file. */
+#define HAVE_SYS_TYPES_H 1
+
+/* Define to 1 if you have the <sys/user.h> header file. */
+#define HAVE_SYS_USER_H 1
+
+/* Define to 1 if you have the <unistd.h> header file. */
+#define HAVE_UNISTD_H 1
+
+/* Define to 1 if you have the <wchar.h> header file. */
+#define HAVE_WCHAR_H 1
+
+/* wcwidth() function is available. */
+#define HAVE_WCWIDTH 1
+
+/* use X11 to determine terminal emulator title */
+#define HAVE_X11 1
+
+/* extended file attributes are available */
+#define HAVE_XATTRS 1
+
+/* Name of package */
+#define PACKAGE "vifm"
+
+/* Define to the address where bug reports for this package should be sent. */
+#define PACKAGE_BUGREPORT "xaizek@posteo.net"
+
+/* Data directory of the package. */
+#define PACKAGE_DATA_DIR "/usr/local/share/vifm"
+
+/* Define to the full name of this package. */
+#define PACKAGE_NAME "vifm"
+
+/* Source directory of the package. */
+#define PACKAGE_SOURCE_DIR "/root/repo"
+
+/* Define to the full name and version of this package. */
+#define PACKAGE_STRING "vifm 0.15"
+
+/* Configuration directory of the package. */
+#define PACKAGE_SYSCONF_DIR "/usr/local/etc/vifm"
+
+/* Define to the one symbol short name of this package. */
+#define PACKAGE_TARNAME "vifm"
+
+/* Define to the home page for this package. */
+#define PACKAGE_URL "https://vifm.info"
+
+/* Define to the version of this package. */
+#define PACKAGE_VERSION "0.15"
+
+/* Define to necessary symbol if this constant uses a non-standard name on
+   your system. */
+/* #undef PTHREAD_CREATE_JOINABLE */
+
+/* Define to 1 if all of the C89 standard headers exist (not just the ones
+   required in a freestanding environment). This macro is provided for
+   backward compatibility; new code need not use it. */
+#define STDC_HEADERS 1
+
+/* -n option is available for cp and mv */
+#define SUPPORT_NO_CLOBBER 1
+
+/* --reflink=auto option is available for cp */
+#define SUPPORT_REFLINK_AUTO 1
+
+/* Enable extensions on AIX, Interix, z/OS.  */
+#ifndef _ALL_SOURCE
+# define _ALL_SOURCE 1
+#endif
+/* Enable general extensions on macOS.  */
+#ifndef _DARWIN_C_SOURCE
+# define _DARWIN_C_SOURCE 1
+#endif
+/* Enable general extensions on Solaris.  */
+#ifndef __EXTENSIONS__
+# define __EXTENSIONS__ 1
+#endif
+/* Enable GNU extensions on systems that have them.  */
+#ifndef _GNU_SOURCE
+# define _GNU_SOURCE 1
+#endif
+/* Enable X/Open compliant socket functions that do not require linking
+   with -lxnet on HP-UX 11.11.  */
+#ifndef _HPUX_ALT_XOPEN_SOCKET_API
+# define _HPUX_ALT_XOPEN_SOCKET_API 1
+#endif
+/* Identify the host operating system as Minix.
+   This macro does not affect the system headers' behavior.
+   A future release of Autoconf may stop defining this macro.  */
+#ifndef _MINIX
+/* # undef _MINIX */
+#endif
+/* Enable general extensions on NetBSD.
+   Enable NetBSD compatibility extensions on Minix.  */
+#ifndef _NETBSD_SOURCE
+# define _NETBSD_SOURCE 1
+#endif
+/* Enable OpenBSD compatibility extensions on NetBSD.
+   Oddly enough, this does nothing on OpenBSD.  */
+#ifndef _OPENBSD_SOURCE
+# define _OPENBSD_SOURCE 1
+#endif
+/* Define to 1 if needed for POSIX-compatible behavior.  */
+#ifndef _POSIX_SOURCE
+/* # undef _POSIX_SOURCE */
+#endif
+/* Define to 2 if needed for POSIX-compatible behavior.  */
+#ifndef _POSIX_1_SOURCE
+/* # undef _POSIX_1_SOURCE */
+#endif
+/* Enable POSIX-compatible threading on Solaris.  */
+#ifndef _POSIX_PTHREAD_SEMANTICS
+# define _POSIX_PTHREAD_SEMANTICS 1
+#endif
+/* Enable extensions specified by ISO/IEC TS 18661-5:2014.  */
+#ifndef __STDC_WANT_IEC_60559_ATTRIBS_EXT__
+# define __STDC_WANT_IEC_60559_ATTRIBS_EXT__ 1
+#endif
+/* Enable extensions specified by ISO/IEC TS 18661-1:2014.  */
+#ifndef __STDC_WANT_IEC_60559_BFP_EXT__
+# define __STDC_WANT_IEC_60559_BFP_EXT__ 1
+#endif
+/* Enable extensions specified by ISO/IEC TS 18661-2:2015.  */
+#ifndef __STDC_WANT_IEC_60559_DFP_EXT__
+# define __STDC_WANT_IEC_60559_DFP_EXT__ 1
+#endif
+/* Enable extensions specified by C23 Annex F.  */
+#ifndef __STDC_WANT_IEC_60559_EXT__
+# define __STDC_WANT_IEC_60559_EXT__ 1
+#endif
+/* Enable extensions specified by ISO/IEC TS 18661-4:2015.  */
+#ifndef __STDC_WANT_IEC_60559_FUNCS_EXT__
+# define __STDC_WANT_IEC_60559_FUNCS_EXT__ 1
+#endif
+/* Enable extensions specified by C23 Annex H and ISO/IEC TS 18661-3:2015.  */
+#ifndef __STDC_WANT_IEC_60559_TYPES_EXT__
+# define __STDC_WANT_IEC_60559_TYPES_EXT__ 1
+#endif
+/* Enable extensions specified by ISO/IEC TR 24731-2:2010.  */
+#ifndef __STDC_WANT_LIB_EXT2__
+# define __STDC_WANT_LIB_EXT2__ 1
+#endif
+/* Enable extensions specified by ISO/IEC 24747:2009.  */
+#ifndef __STDC_WANT_MATH_SPEC_FUNCS__
+# define __STDC_WANT_MATH_SPEC_FUNCS__ 1
+#endif
+/* Enable extensions on HP NonStop.  */
+#ifndef _TANDEM_SOURCE
+# define _TANDEM_SOURCE 1
+#endif
+/* Enable X/Open extensions.  Define to 500 only if necessary
+   to make mbstate_t available.  */
+#ifndef _XOPEN_SOURCE
+/* # undef _XOPEN_SOURCE */
+#endif
+
+
+/* Make it so that utf8proc does not think it is a library. */
+#define UTF8PROC_STATIC 1
+
+/* Version number of package */
+#define VERSION "0.15"
+
+/* Program version as a comparable integer. */
+#define VERSION_NUM 1500
+
+/* Define to 1 to embed compilation date into executable. */
+#define WITH_BUILD_TIMESTAMP 1
+
+/* Enable extensions in header files on OS X. */
+#define _DARWIN_C_SOURCE 1
+
+/* Enable large file processing on 32-bit systems. */
+#define _FILE_OFFSET_BITS 64
+
+/* Define to 1 if necessary to make fseeko visible. */
+/* #undef _LARGEFILE_SOURCE */
+
+/* Define to 1 on platforms where this makes off_t a 64-bit type. */
+/* #undef _LARGE_FILES */
+
+/* Number of bits in time_t, on hosts where this is settable. */
+/* #undef _TIME_BITS */
+
+/* Define to 1 to enable wide functions of ncurses in some environments. */
+#define _XOPEN_SOURCE_EXTENDED 1
+
+/* Define to 1 on platforms where this makes time_t a 64-bit type. */
+/* #undef __MINGW_USE_VC2005_COMPAT */
+
+/* Define to 'long int' if <sys/types.h> does not define. */
+/* #undef off_t */
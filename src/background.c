@@ -75,6 +75,13 @@
  *
  * Operations are displayed on designated job bar.
  *
+ * Tasks and operations are queued and then executed by a bounded pool of
+ * worker threads.  Operations are picked before tasks, but neither of them can
+ * occupy all of the workers, so that long operations don't starve tasks and
+ * the other way round.  Number of jobs that work with the same device at the
+ * same time is limited as well to reduce contention for it.  Queued jobs are
+ * listed in :jobs menu along with running ones.
+ *
  * On non-Windows systems background thread reads data from error streams of
  * external applications, which are then displayed by main thread.  This thread
  * maintains its own list of jobs (via err_next field), which is added to by
@@ -104,15 +111,39 @@
 #define NO_JOB_ID INVALID_HANDLE_VALUE
 #endif
 
-/* Structure with passed to background_task_bootstrap() so it can perform
- * correct initialization/cleanup. */
-typedef struct
+/* Maximum number of worker threads that execute tasks and operations. */
+enum { MAX_WORKERS = 4 };
+
+/* Maximum number of workers that can be busy with jobs of the same priority.
+ * The rest is reserved for jobs of other priorities. */
+enum { MAX_WORKERS_PER_PRIORITY = MAX_WORKERS - 1 };
+
+/* Maximum number of tasks and operations that work with the same device
+ * simultaneously. */
+enum { MAX_JOBS_PER_DEVICE = 2 };
+
+/* Priorities of queued jobs from the highest to the lowest. */
+typedef enum
+{
+	QP_OPERATION, /* Operations requested by the user. */
+	QP_TASK,      /* Auxiliary tasks. */
+	QP_COUNT      /* Number of priorities. */
+}
+QueuePriority;
+
+/* Task or operation that waits for a worker thread or is being executed by
+ * it. */
+typedef struct queued_job_t
 {
-	bg_task_func func; /* Function to execute in a background thread. */
-	void *args;        /* Argument to pass. */
-	bg_job_t *job;     /* Job identifier that corresponds to the task. */
+	bg_task_func func;         /* Function to execute in a background thread. */
+	void *args;                /* Argument to pass. */
+	bg_job_t *job;             /* Job that corresponds to the task. */
+	QueuePriority priority;    /* Queue of this task. */
+	int has_dev;               /* Whether dev field is set. */
+	dev_t dev;                 /* Device the task works with. */
+	struct queued_job_t *next; /* Next element of the queue. */
 }
-background_task_args;
+queued_job_t;
 
 static void set_jobcount_var(int count);
 static void show_job_errors(bg_job_t *job);
@@ -137,7 +168,11 @@ static void place_on_job_bar(bg_job_t *job);
 static void get_off_job_bar(bg_job_t *job);
 static bg_job_t * add_background_job(pid_t pid, const char cmd[],
 		uintptr_t err, uintptr_t data, BgJobType type, int with_bg_op);
-static void * background_task_bootstrap(void *arg);
+static int enqueue_job(queued_job_t *qjob);
+static void * worker_thread(void *arg);
+static queued_job_t * pick_queued_job(void);
+static int device_has_room(const queued_job_t *qjob);
+static void run_queued_job(queued_job_t *qjob);
 static int update_job_status(bg_job_t *job);
 static void mark_job_finished(bg_job_t *job, int exit_code);
 static void maybe_wake_error_thread(void);
@@ -160,6 +195,21 @@ static pthread_cond_t new_err_jobs_cond = PTHREAD_COND_INITIALIZER;
 /* Thread-local storage for bg_job_t associated with active thread. */
 static pthread_key_t current_job;
 
+/* Mutex to protect state of the pool of worker threads. */
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+/* Conditional variable to signal changes in queues or running jobs. */
+static pthread_cond_t pool_cond = PTHREAD_COND_INITIALIZER;
+/* Queues of jobs waiting for a worker thread by priority. */
+static queued_job_t *queue_heads[QP_COUNT], *queue_tails[QP_COUNT];
+/* Jobs that are being executed by worker threads. */
+static queued_job_t *running_jobs[MAX_WORKERS];
+/* Number of running jobs of each priority. */
+static int nrunning[QP_COUNT];
+/* Number of queued jobs. */
+static int nqueued;
+/* Number of worker threads and how many of them are waiting for a job. */
+static int nworkers, nidle_workers;
+
 int
 bg_init(void)
 {
@@ -1411,52 +1461,254 @@ no_redirects:
 
 int
 bg_execute(const char descr[], const char op_descr[], int total, int important,
-		bg_task_func task_func, void *args)
+		const char path[], bg_task_func task_func, void *args)
 {
-	pthread_t id;
-	int ret;
-
-	background_task_args *const task_args = malloc(sizeof(*task_args));
-	if(task_args == NULL)
+	bg_job_t *job = bg_execute_job(descr, op_descr, total, important, path,
+			task_func, args);
+	if(job == NULL)
 	{
 		return 1;
 	}
 
-	task_args->func = task_func;
-	task_args->args = args;
-	task_args->job = add_background_job(WRONG_PID, descr, (uintptr_t)NO_JOB_ID,
+	bg_job_decref(job);
+	return 0;
+}
+
+bg_job_t *
+bg_execute_job(const char descr[], const char op_descr[], int total,
+		int important, const char path[], bg_task_func task_func, void *args)
+{
+	queued_job_t *const qjob = malloc(sizeof(*qjob));
+	if(qjob == NULL)
+	{
+		return NULL;
+	}
+
+	qjob->func = task_func;
+	qjob->args = args;
+	qjob->priority = (important ? QP_OPERATION : QP_TASK);
+	qjob->next = NULL;
+
+	struct stat st;
+	qjob->has_dev = (path != NULL && os_stat(path, &st) == 0);
+	qjob->dev = (qjob->has_dev ? st.st_dev : 0);
+
+	qjob->job = add_background_job(WRONG_PID, descr, (uintptr_t)NO_JOB_ID,
 			(uintptr_t)NO_JOB_ID, important ? BJT_OPERATION : BJT_TASK, 1);
+	if(qjob->job == NULL)
+	{
+		free(qjob);
+		return NULL;
+	}
+
+	bg_job_t *const job = qjob->job;
+	replace_string(&job->bg_op.descr, op_descr);
+	job->bg_op.total = total;
+	job->queued = 1;
 
-	if(task_args->job == NULL)
+	if(job->type == BJT_OPERATION)
+	{
+		place_on_job_bar(job);
+	}
+
+	/* The use belongs to the caller. */
+	bg_job_incref(job);
+
+	if(enqueue_job(qjob) != 0)
+	{
+		/* Mark job as finished with error. */
+		if(pthread_spin_lock(&job->status_lock) == 0)
+		{
+			job->queued = 0;
+			job->running = 0;
+			job->exit_code = 1;
+			(void)pthread_spin_unlock(&job->status_lock);
+		}
+
+		bg_job_decref(job);
+		free(qjob);
+		return NULL;
+	}
+
+	return job;
+}
+
+/* Puts the job in a queue starting a new worker thread if needed.  Returns zero
+ * on success, otherwise non-zero is returned. */
+static int
+enqueue_job(queued_job_t *qjob)
+{
+	if(pthread_mutex_lock(&pool_lock) != 0)
 	{
-		free(task_args);
 		return 1;
 	}
 
-	replace_string(&task_args->job->bg_op.descr, op_descr);
-	task_args->job->bg_op.total = total;
+	/* Idle workers might not have woken up yet to pick up jobs queued before,
+	 * hence comparison with the number of queued jobs. */
+	if(nqueued >= nidle_workers && nworkers < MAX_WORKERS)
+	{
+		pthread_t id;
+		if(pthread_create(&id, NULL, &worker_thread, NULL) == 0)
+		{
+			++nworkers;
+		}
+		else if(nworkers == 0)
+		{
+			/* Nobody would ever execute the job. */
+			(void)pthread_mutex_unlock(&pool_lock);
+			return 1;
+		}
+	}
 
-	if(task_args->job->type == BJT_OPERATION)
+	const QueuePriority priority = qjob->priority;
+	if(queue_tails[priority] == NULL)
 	{
-		place_on_job_bar(task_args->job);
+		queue_heads[priority] = qjob;
 	}
+	else
+	{
+		queue_tails[priority]->next = qjob;
+	}
+	queue_tails[priority] = qjob;
+	++nqueued;
 
-	ret = 0;
-	if(pthread_create(&id, NULL, &background_task_bootstrap, task_args) != 0)
+	(void)pthread_cond_broadcast(&pool_cond);
+	(void)pthread_mutex_unlock(&pool_lock);
+	return 0;
+}
+
+/* Entry point of a worker thread, which executes queued jobs one by one.
+ * Returns result for this thread. */
+static void *
+worker_thread(void *arg)
+{
+	(void)pthread_detach(pthread_self());
+	block_all_thread_signals();
+
+	if(pthread_mutex_lock(&pool_lock) != 0)
 	{
-		/* Mark job as finished with error. */
-		if(pthread_spin_lock(&task_args->job->status_lock) == 0)
+		return NULL;
+	}
+
+	while(1)
+	{
+		queued_job_t *const qjob = pick_queued_job();
+		if(qjob == NULL)
 		{
-			task_args->job->running = 0;
-			task_args->job->exit_code = 1;
-			(void)pthread_spin_unlock(&task_args->job->status_lock);
+			++nidle_workers;
+			(void)pthread_cond_wait(&pool_cond, &pool_lock);
+			--nidle_workers;
+			continue;
 		}
 
-		free(task_args);
-		ret = 1;
+		int slot = 0;
+		while(running_jobs[slot] != NULL)
+		{
+			++slot;
+		}
+		running_jobs[slot] = qjob;
+		++nrunning[qjob->priority];
+
+		(void)pthread_mutex_unlock(&pool_lock);
+		run_queued_job(qjob);
+		(void)pthread_mutex_lock(&pool_lock);
+
+		running_jobs[slot] = NULL;
+		--nrunning[qjob->priority];
+		free(qjob);
+
+		/* Jobs waiting for the device might be able to run now. */
+		(void)pthread_cond_broadcast(&pool_cond);
 	}
 
-	return ret;
+	return NULL;
+}
+
+/* Removes the first job that can be run right now from the queues.  Must be
+ * called with pool_lock held.  Returns the job or NULL. */
+static queued_job_t *
+pick_queued_job(void)
+{
+	QueuePriority priority;
+	for(priority = 0; priority < QP_COUNT; ++priority)
+	{
+		if(nrunning[priority] >= MAX_WORKERS_PER_PRIORITY)
+		{
+			continue;
+		}
+
+		queued_job_t *prev = NULL;
+		queued_job_t *qjob;
+		for(qjob = queue_heads[priority]; qjob != NULL; qjob = qjob->next)
+		{
+			if(device_has_room(qjob))
+			{
+				if(prev == NULL)
+				{
+					queue_heads[priority] = qjob->next;
+				}
+				else
+				{
+					prev->next = qjob->next;
+				}
+				if(queue_tails[priority] == qjob)
+				{
+					queue_tails[priority] = prev;
+				}
+				qjob->next = NULL;
+				--nqueued;
+				return qjob;
+			}
+			prev = qjob;
+		}
+	}
+
+	return NULL;
+}
+
+/* Checks whether one more job can work with the device of the job.  Must be
+ * called with pool_lock held.  Returns non-zero if so, otherwise zero is
+ * returned. */
+static int
+device_has_room(const queued_job_t *qjob)
+{
+	if(!qjob->has_dev)
+	{
+		return 1;
+	}
+
+	int count = 0;
+	int i;
+	for(i = 0; i < MAX_WORKERS; ++i)
+	{
+		const queued_job_t *const running = running_jobs[i];
+		count += (running != NULL && running->has_dev && running->dev == qjob->dev);
+	}
+	return (count < MAX_JOBS_PER_DEVICE);
+}
+
+/* Executes the job in current thread and marks it as finished. */
+static void
+run_queued_job(queued_job_t *qjob)
+{
+	bg_job_t *const job = qjob->job;
+
+	if(pthread_spin_lock(&job->status_lock) == 0)
+	{
+		job->queued = 0;
+		(void)pthread_spin_unlock(&job->status_lock);
+	}
+
+	if(pthread_setspecific(current_job, job) == 0)
+	{
+		qjob->func(&job->bg_op, qjob->args);
+		(void)pthread_setspecific(current_job, NULL);
+		mark_job_finished(job, /*exit_code=*/0);
+	}
+	else
+	{
+		mark_job_finished(job, /*exit_code=*/1);
+	}
 }
 
 /* Makes the job appear on the job bar. */
@@ -1520,6 +1772,7 @@ add_background_job(pid_t pid, const char cmd[], uintptr_t err, uintptr_t data,
 	}
 
 	new->running = 1;
+	new->queued = 0;
 	new->erroring = 0;
 	new->use_count = 0;
 	new->exit_code = -1;
@@ -1582,32 +1835,6 @@ free_new:
 	return NULL;
 }
 
-/* pthreads entry point for a new background task.  Performs correct
- * startup/exit with related updates of internal data structures.  Returns
- * result for this thread. */
-static void *
-background_task_bootstrap(void *arg)
-{
-	background_task_args *const task_args = arg;
-
-	(void)pthread_detach(pthread_self());
-	block_all_thread_signals();
-
-	if(pthread_setspecific(current_job, task_args->job) == 0)
-	{
-		task_args->func(&task_args->job->bg_op, task_args->args);
-		mark_job_finished(task_args->job, /*exit_code=*/0);
-	}
-	else
-	{
-		mark_job_finished(task_args->job, /*exit_code=*/1);
-	}
-
-	free(task_args);
-
-	return NULL;
-}
-
 int
 bg_has_active_jobs(int important_only)
 {
@@ -1713,6 +1940,18 @@ bg_job_is_running(bg_job_t *job)
 	return (running && update_job_status(job));
 }
 
+int
+bg_job_is_queued(bg_job_t *job)
+{
+	if(pthread_spin_lock(&job->status_lock) != 0)
+	{
+		return 0;
+	}
+	int queued = job->queued;
+	(void)pthread_spin_unlock(&job->status_lock);
+	return queued;
+}
+
 int
 bg_job_was_killed(bg_job_t *job)
 {
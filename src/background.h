@@ -97,6 +97,7 @@ typedef struct bg_job_t
 	/* The lock is meant to guard state-related fields. */
 	pthread_spinlock_t status_lock;
 	int running;   /* Whether this job is still running. */
+	int queued;    /* Whether this job waits for a worker thread to run it. */
 	int erroring;  /* Whether error thread still handles this job. */
 	int use_count; /* Count of uses of this job entry. */
 	int exit_code; /* Exit code of external command. */
@@ -175,10 +176,19 @@ pid_t bg_run_and_capture(char cmd[], int user_sh, FILE *in, FILE **out,
  * job bar if needed. */
 void bg_check(int show_errors);
 
-/* Starts new background task, which is run in a separate thread.  Returns zero
- * on success, otherwise non-zero is returned. */
+/* Starts new background task, which is run by one of worker threads once
+ * there is one available for it.  Important tasks are run before others.  path
+ * can be NULL, otherwise it specifies location the task works with to limit
+ * number of tasks that use the same device at the same time.  Returns zero on
+ * success, otherwise non-zero is returned. */
 int bg_execute(const char descr[], const char op_descr[], int total,
-		int important, bg_task_func task_func, void *args);
+		int important, const char path[], bg_task_func task_func, void *args);
+
+/* Same as bg_execute(), but provides access to the job.  Upon creation the job
+ * has one extra use, which needs to be decremented for it to be freed.  Returns
+ * the job or NULL on error. */
+bg_job_t * bg_execute_job(const char descr[], const char op_descr[], int total,
+		int important, const char path[], bg_task_func task_func, void *args);
 
 /* Checks whether there are any internal jobs (important_only is non-zero) or
  * jobs or tasks (important_only is zero) running in background.  External
@@ -203,6 +213,10 @@ void bg_job_terminate(bg_job_t *job);
  * zero is returned. */
 int bg_job_is_running(bg_job_t *job);
 
+/* Checks whether the job waits in a queue and isn't running yet.  Returns
+ * non-zero if so, otherwise zero is returned. */
+int bg_job_is_queued(bg_job_t *job);
+
 /* Checks whether the job was killed.  Returns non-zero if so, otherwise zero is
  * returned. */
 int bg_job_was_killed(bg_job_t *job);
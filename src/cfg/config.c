@@ -24,6 +24,8 @@
 #define MYVIFMRC_EV "MYVIFMRC"
 #define TRASH "Trash"
 #define LOG "log"
+#define PREVIEW_CACHE "previews"
+#define MIME_CACHE "mimetypes"
 #define VIFMRC "vifmrc"
 
 #ifndef __APPLE__
@@ -226,6 +228,8 @@ cfg_init(void)
 	cfg.view_dir_size = VDS_SIZE;
 
 	cfg.log_file[0] = '\0';
+	cfg.preview_cache_dir[0] = '\0';
+	cfg.mime_cache_file[0] = '\0';
 
 	cfg_set_shell(env_get_def("SHELL", DEFAULT_SHELL_CMD));
 	cfg.shell_cmd_flag = strdup((curr_stats.shell_type == ST_CMD) ? "/C" : "-c");
@@ -608,6 +612,10 @@ store_config_paths(const char data_dir[])
 	free(trash_base);
 
 	snprintf(cfg.log_file, sizeof(cfg.log_file), "%s/" LOG, base);
+	snprintf(cfg.preview_cache_dir, sizeof(cfg.preview_cache_dir),
+			"%s/" PREVIEW_CACHE, base);
+	snprintf(cfg.mime_cache_file, sizeof(cfg.mime_cache_file),
+			"%s/" MIME_CACHE, base);
 
 	char *fuse_home = format_str("%s/fuse/", base);
 	(void)cfg_set_fuse_home(fuse_home);
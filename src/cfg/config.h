@@ -192,6 +192,10 @@ typedef struct config_t
 	/* This one should be set using trash_set_specs() function. */
 	char trash_dir[PATH_MAX + 64];
 	char log_file[PATH_MAX + 8];
+	char preview_cache_dir[PATH_MAX + 16]; /* Where output of viewers is stored
+	                                          when 'previewoptions' enable it. */
+	char mime_cache_file[PATH_MAX + 16]; /* Where detected mime-types are
+	                                        stored. */
 	char *vi_command;
 	int vi_cmd_bg;
 	char *vi_x_command;
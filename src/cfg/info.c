@@ -290,9 +290,40 @@ static void set_session(const char new_session[]);
 static void write_session_file(void);
 static void store_file(const char path[], filemon_t *mon, int vinfo);
 static void get_session_dir(char buf[], size_t buf_size);
-
-/* Monitor to check for changes of vifminfo file. */
-static filemon_t vifminfo_mon;
+static void get_info_paths(char info_file[], size_t info_file_len,
+		char journal_file[], size_t journal_file_len);
+static JSON_Value * read_info_state(const char info_file[],
+		const char journal_file[], int *journal_len);
+static int replay_journal(JSON_Object *state, const char info_file[],
+		const char journal_file[]);
+static int get_file_stamp(const char path[], int with_mtime, char buf[],
+		size_t buf_len);
+static void apply_delta(JSON_Object *state, const JSON_Object *delta);
+static JSON_Value * make_delta(const JSON_Object *old, const JSON_Object *new);
+static int append_to_journal(const char info_file[], const char journal_file[],
+		const JSON_Value *delta);
+static void compact_info_file(const char info_file[],
+		const char journal_file[], int vinfo);
+static int info_files_unchanged(const char info_file[],
+		const char journal_file[]);
+static void remember_disk_state(JSON_Value *state, const char info_file[],
+		const char journal_file[], int journal_len);
+
+/* First line of the journal of vifminfo.json starts with this string. */
+#define JOURNAL_ID "vifminfo-journal 1"
+
+/* Journal is merged into vifminfo.json once it has this many entries. */
+enum { MAX_JOURNAL_LEN = 32 };
+
+/* Stamps of vifminfo.json and its journal to check them for changes.  Empty
+ * string means that there was no such file. */
+static char info_stamp[128];
+static char journal_stamp[128];
+/* Number of entries in the journal. */
+static int journal_len;
+/* State stored on disk as of the last time this instance has read or written
+ * it (vifminfo.json with its journal applied).  NULL if unknown. */
+static JSON_Value *disk_state;
 /* Monitor to check for changes of file that backs current session. */
 static filemon_t session_mon;
 /* Callback to be invoked when active session has changed.  Can be NULL. */
@@ -313,10 +344,13 @@ void
 state_load(int reread)
 {
 	char info_file[PATH_MAX + 16];
-	snprintf(info_file, sizeof(info_file), "%s/vifminfo.json", cfg.config_dir);
+	char journal_file[PATH_MAX + 32];
+	get_info_paths(info_file, sizeof(info_file), journal_file,
+			sizeof(journal_file));
 
+	int len;
 	char *locale = drop_locale();
-	JSON_Value *state = json_parse_file(info_file);
+	JSON_Value *state = read_info_state(info_file, journal_file, &len);
 	restore_locale(locale);
 
 	if(state == NULL)
@@ -325,17 +359,20 @@ state_load(int reread)
 		snprintf(legacy_info_file, sizeof(legacy_info_file), "%s/vifminfo",
 				cfg.config_dir);
 		state = read_legacy_info_file(legacy_info_file);
+		if(state == NULL)
+		{
+			return;
+		}
+
+		load_state(json_object(state), reread);
+		json_value_free(state);
 	}
-	if(state == NULL)
+	else
 	{
-		return;
+		load_state(json_object(state), reread);
+		remember_disk_state(state, info_file, journal_file, len);
 	}
 
-	load_state(json_object(state), reread);
-	json_value_free(state);
-
-	(void)filemon_from_file(info_file, FMT_MODIFIED, &vifminfo_mon);
-
 	dir_stack_freeze();
 }
 
@@ -1286,14 +1323,333 @@ set_manual_filter(view_t *view, const char value[])
 	view->manual_filter = matcher;
 }
 
-/* Writes vifminfo file updating it with state of the current instance. */
+/* Writes vifminfo file updating it with state of the current instance.  If
+ * nobody else has touched the file since this instance has read or written it,
+ * only parts of the state that have changed are appended to its journal. */
 TSTATIC void
 write_info_file(void)
 {
 	char info_file[PATH_MAX + 16];
-	snprintf(info_file, sizeof(info_file), "%s/vifminfo.json", cfg.config_dir);
+	char journal_file[PATH_MAX + 32];
+	get_info_paths(info_file, sizeof(info_file), journal_file,
+			sizeof(journal_file));
+
+	char *locale = drop_locale();
+
+	if(disk_state != NULL && journal_len < MAX_JOURNAL_LEN &&
+			info_files_unchanged(info_file, journal_file))
+	{
+		JSON_Value *current = serialize_state(cfg.vifm_info);
+		JSON_Value *delta = make_delta(json_object(disk_state),
+				json_object(current));
+		json_value_free(current);
+
+		int done = (json_object_get_count(json_object(delta)) == 0);
+		if(!done && append_to_journal(info_file, journal_file, delta) == 0)
+		{
+			apply_delta(json_object(disk_state), json_object(delta));
+			++journal_len;
+			done = 1;
+		}
+		json_value_free(delta);
+
+		if(done)
+		{
+			restore_locale(locale);
+			return;
+		}
+	}
+
+	compact_info_file(info_file, journal_file, cfg.vifm_info);
+	restore_locale(locale);
+}
+
+/* Forms paths to vifminfo.json and its journal. */
+static void
+get_info_paths(char info_file[], size_t info_file_len, char journal_file[],
+		size_t journal_file_len)
+{
+	snprintf(info_file, info_file_len, "%s/vifminfo.json", cfg.config_dir);
+	snprintf(journal_file, journal_file_len, "%s/vifminfo.journal",
+			cfg.config_dir);
+}
+
+/* Reads vifminfo.json and applies its journal to it.  *journal_len is set to
+ * the number of applied journal entries or to -1 if there is no usable journal
+ * if journal_len isn't NULL.  Returns the state or NULL on error. */
+static JSON_Value *
+read_info_state(const char info_file[], const char journal_file[],
+		int *journal_len)
+{
+	JSON_Value *state = json_parse_file(info_file);
+	if(state == NULL)
+	{
+		return NULL;
+	}
+
+	const int len = replay_journal(json_object(state), info_file, journal_file);
+	if(journal_len != NULL)
+	{
+		*journal_len = len;
+	}
+	return state;
+}
+
+/* Applies entries of the journal to the state.  Journal that was started for a
+ * different version of vifminfo.json is ignored.  Returns number of applied
+ * entries or -1 if journal is missing or is ignored. */
+static int
+replay_journal(JSON_Object *state, const char info_file[],
+		const char journal_file[])
+{
+	int nlines;
+	char **lines = read_file_of_lines(journal_file, &nlines);
+	if(lines == NULL)
+	{
+		return -1;
+	}
+
+	char stamp[128];
+	if(nlines == 0 || get_file_stamp(info_file, 0, stamp, sizeof(stamp)) != 0 ||
+			!starts_with_lit(lines[0], JOURNAL_ID " ") ||
+			strcmp(lines[0] + sizeof(JOURNAL_ID), stamp) != 0)
+	{
+		free_string_array(lines, nlines);
+		return -1;
+	}
+
+	int i, len = 0;
+	for(i = 1; i < nlines; ++i)
+	{
+		JSON_Value *delta = json_parse_string(lines[i]);
+		if(json_value_get_type(delta) == JSONObject)
+		{
+			apply_delta(state, json_object(delta));
+			++len;
+		}
+		json_value_free(delta);
+	}
+
+	free_string_array(lines, nlines);
+	return len;
+}
+
+/* Formats a string that changes whenever the file is replaced or its size
+ * changes and optionally when it's modified in any way.  Journal starts with a
+ * stamp of vifminfo.json it belongs to, which doesn't include modification time
+ * to survive touching the file.  Returns zero on success, otherwise non-zero is
+ * returned and buf is made empty. */
+static int
+get_file_stamp(const char path[], int with_mtime, char buf[], size_t buf_len)
+{
+	struct stat st;
+	if(os_stat(path, &st) != 0)
+	{
+		buf[0] = '\0';
+		return 1;
+	}
+
+	const int len = snprintf(buf, buf_len, "%llu %llu %llu",
+			(unsigned long long)st.st_dev, (unsigned long long)st.st_ino,
+			(unsigned long long)st.st_size);
+
+	if(with_mtime && len >= 0 && (size_t)len < buf_len)
+	{
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+		const long nsec = st.st_mtim.tv_nsec;
+#else
+		const long nsec = 0;
+#endif
+		snprintf(buf + len, buf_len - len, " %lld.%09ld", (long long)st.st_mtime,
+				nsec);
+	}
+	return 0;
+}
+
+/* Replaces top-level values of the state with those of the delta, null values
+ * of the delta remove corresponding values. */
+static void
+apply_delta(JSON_Object *state, const JSON_Object *delta)
+{
+	int i, n;
+	for(i = 0, n = json_object_get_count(delta); i < n; ++i)
+	{
+		const char *name = json_object_get_name(delta, i);
+		JSON_Value *value = json_object_get_value_at(delta, i);
+		if(json_value_get_type(value) == JSONNull)
+		{
+			(void)json_object_remove(state, name);
+		}
+		else
+		{
+			json_object_set_value(state, name, json_value_deep_copy(value));
+		}
+	}
+}
 
-	store_file(info_file, &vifminfo_mon, cfg.vifm_info);
+/* Computes difference between top-level values of two states.  Returns delta
+ * that turns old into new when passed to apply_delta(). */
+static JSON_Value *
+make_delta(const JSON_Object *old, const JSON_Object *new)
+{
+	JSON_Value *delta_value = json_value_init_object();
+	JSON_Object *delta = json_object(delta_value);
+
+	int i, n;
+	for(i = 0, n = json_object_get_count(new); i < n; ++i)
+	{
+		const char *name = json_object_get_name(new, i);
+		JSON_Value *value = json_object_get_value_at(new, i);
+		if(!json_value_equals(json_object_get_value(old, name), value))
+		{
+			json_object_set_value(delta, name, json_value_deep_copy(value));
+		}
+	}
+
+	for(i = 0, n = json_object_get_count(old); i < n; ++i)
+	{
+		const char *name = json_object_get_name(old, i);
+		if(!json_object_has_value(new, name))
+		{
+			json_object_set_value(delta, name, json_value_init_null());
+		}
+	}
+
+	return delta_value;
+}
+
+/* Appends an entry to the journal creating it if necessary.  Returns zero on
+ * success, otherwise non-zero is returned. */
+static int
+append_to_journal(const char info_file[], const char journal_file[],
+		const JSON_Value *delta)
+{
+	char stamp[128];
+	if(get_file_stamp(info_file, 0, stamp, sizeof(stamp)) != 0)
+	{
+		return 1;
+	}
+
+	char *const serialized = json_serialize_to_string(delta);
+	if(serialized == NULL)
+	{
+		return 1;
+	}
+
+	const int new_journal = (journal_stamp[0] == '\0');
+	char *const entry = new_journal
+	                  ? format_str("%s %s\n%s\n", JOURNAL_ID, stamp, serialized)
+	                  : format_str("%s\n", serialized);
+	json_free_serialized_string(serialized);
+	if(entry == NULL)
+	{
+		return 1;
+	}
+
+	FILE *const fp = os_fopen(journal_file, new_journal ? "wb" : "ab");
+	if(fp == NULL)
+	{
+		free(entry);
+		return 1;
+	}
+
+	/* Write the entry at once to not interleave with appends of other
+	 * instances. */
+	setvbuf(fp, NULL, _IONBF, 0);
+	const size_t len = strlen(entry);
+	const int failed = (fwrite(entry, 1, len, fp) != len);
+	free(entry);
+
+	if(fclose(fp) != 0 || failed)
+	{
+		LOG_ERROR_MSG("Error appending to: %s", journal_file);
+		return 1;
+	}
+
+	(void)get_file_stamp(journal_file, 1, journal_stamp, sizeof(journal_stamp));
+	return 0;
+}
+
+/* Writes vifminfo.json anew merging in state stored by other instances if it
+ * was changed since this instance has seen it and removes the journal. */
+static void
+compact_info_file(const char info_file[], const char journal_file[],
+		int vinfo)
+{
+	char tmp_file[PATH_MAX + 64];
+	snprintf(tmp_file, sizeof(tmp_file), "%s_%u", info_file, get_pid());
+
+	if(os_access(info_file, R_OK) == 0 && copy_file(info_file, tmp_file) != 0)
+	{
+		return;
+	}
+
+	JSON_Value *current = serialize_state(vinfo);
+	if(!info_files_unchanged(info_file, journal_file))
+	{
+		JSON_Value *admixture = read_info_state(info_file, journal_file, NULL);
+		if(admixture != NULL)
+		{
+			merge_states(vinfo, 0, json_object(current), json_object(admixture));
+			json_value_free(admixture);
+		}
+	}
+
+	if(json_serialize_to_file(current, tmp_file) == JSONError)
+	{
+		LOG_ERROR_MSG("Error storing state to: %s", tmp_file);
+		(void)remove(tmp_file);
+		json_value_free(current);
+		return;
+	}
+
+	if(rename_file(tmp_file, info_file) != 0)
+	{
+		LOG_ERROR_MSG("Can't replace \"%s\" file with updated temporary",
+				info_file);
+		(void)remove(tmp_file);
+		json_value_free(current);
+		return;
+	}
+
+	(void)remove(journal_file);
+	remember_disk_state(current, info_file, journal_file, -1);
+}
+
+/* Checks whether vifminfo.json and its journal are the same as the last time
+ * this instance has read or written them.  Returns non-zero if so, otherwise
+ * zero is returned. */
+static int
+info_files_unchanged(const char info_file[], const char journal_file[])
+{
+	char stamp[128];
+	(void)get_file_stamp(info_file, 1, stamp, sizeof(stamp));
+	if(stamp[0] == '\0' || strcmp(stamp, info_stamp) != 0)
+	{
+		return 0;
+	}
+
+	(void)get_file_stamp(journal_file, 1, stamp, sizeof(stamp));
+	return (strcmp(stamp, journal_stamp) == 0);
+}
+
+/* Remembers state that is stored on disk along with stamps of the files.  len
+ * is the number of journal entries or -1 if journal isn't usable.  Takes
+ * ownership of the state. */
+static void
+remember_disk_state(JSON_Value *state, const char info_file[],
+		const char journal_file[], int len)
+{
+	json_value_free(disk_state);
+	disk_state = state;
+	journal_len = (len < 0 ? 0 : len);
+
+	(void)get_file_stamp(info_file, 1, info_stamp, sizeof(info_stamp));
+	journal_stamp[0] = '\0';
+	if(len >= 0)
+	{
+		(void)get_file_stamp(journal_file, 1, journal_stamp, sizeof(journal_stamp));
+	}
 }
 
 /* Copies the src file to the dst location.  Returns zero on success. */
@@ -2224,15 +2580,15 @@ store_history(JSON_Object *root, const char node[], const hist_t *hist)
 	for(i = hist->size - 1; i >= 0; i--)
 	{
 		JSON_Object *entry = append_object(entries);
-		set_str(entry, "text", hist->items[i].text);
+		set_str(entry, "text", hist_get(hist, i)->text);
 
-		if(hist->items[i].timestamp == (time_t)-1)
+		if(hist_get(hist, i)->timestamp == (time_t)-1)
 		{
 			set_double(entry, "ts", ts);
 		}
 		else
 		{
-			set_double(entry, "ts", hist->items[i].timestamp);
+			set_double(entry, "ts", hist_get(hist, i)->timestamp);
 		}
 	}
 }
@@ -2982,16 +3338,18 @@ sessions_load(const char name[])
 	}
 
 	char info_file[PATH_MAX + 16];
-	snprintf(info_file, sizeof(info_file), "%s/vifminfo.json", cfg.config_dir);
-	JSON_Value *common = json_parse_file(info_file);
+	char journal_file[PATH_MAX + 32];
+	get_info_paths(info_file, sizeof(info_file), journal_file,
+			sizeof(journal_file));
+
+	int len;
+	JSON_Value *common = read_info_state(info_file, journal_file, &len);
 	restore_locale(locale);
 
 	if(common != NULL)
 	{
 		merge_states(FULL_VINFO, 1, json_object(session), json_object(common));
-		json_value_free(common);
-
-		(void)filemon_from_file(info_file, FMT_MODIFIED, &vifminfo_mon);
+		remember_disk_state(common, info_file, journal_file, len);
 	}
 
 	load_state(json_object(session), 0);
@@ -35,10 +35,11 @@
 #include <assert.h> /* assert() */
 #include <ctype.h> /* isdigit() isspace() */
 #include <stddef.h> /* NULL size_t */
-#include <stdlib.h> /* free() */
+#include <stdlib.h> /* calloc() free() */
 #include <stdio.h> /* snprintf() */
-#include <string.h> /* memcpy() strdup() strlen() strncasecmp() strncmp()
-                       strrchr() */
+#include <string.h> /* memcpy() strcmp() strdup() strlen() strncasecmp()
+                       strncmp() strrchr() */
+#include <time.h> /* time() */
 
 #include "cfg/config.h"
 #include "cfg/info.h"
@@ -62,7 +63,9 @@
 #include "ui/colors.h"
 #include "ui/statusbar.h"
 #include "ui/tabs.h"
+#include "utils/darray.h"
 #include "utils/env.h"
+#include "utils/filemon.h"
 #include "utils/fs.h"
 #include "utils/macros.h"
 #include "utils/matchers.h"
@@ -94,6 +97,29 @@ typedef struct
 }
 completion_data_t;
 
+/* Maximum total number of entries in cached directory listings.  Larger
+ * listings aren't cached at all. */
+enum { MAX_CACHED_ENTRIES = 50000 };
+
+/* Cached entry of a directory. */
+typedef struct
+{
+	char *name;         /* Name of the file. */
+	unsigned char type; /* Type of the file (DT_*). */
+}
+listing_entry_t;
+
+/* Cached list of files of a directory. */
+typedef struct
+{
+	char *path;                 /* Canonical path to the directory. */
+	filemon_t mon;              /* State of the directory when it was listed. */
+	listing_entry_t *entries;   /* Files sorted by their names. */
+	DA_INSTANCE_FIELD(entries); /* Declarations to enable use of DA_* on
+	                               entries. */
+}
+dir_listing_t;
+
 static int non_path_completion(completion_data_t *data);
 static int path_completion(completion_data_t *data);
 static int earg_num(int argc, const char cmdline[]);
@@ -124,14 +150,32 @@ static void complete_from_string_list(const char str[], const char *items[][2],
 static void complete_command_name(const char beginning[]);
 static int filename_completion_in_dir(const char path[], const char str[],
 		CompletionType type);
-static void filename_completion_internal(DIR *dir, const char dir_path[],
+static void filename_completion_internal(const dir_listing_t *listing,
 		const char filename[], CompletionType type);
-static int is_dirent_targets_exec(const struct dirent *d);
+static dir_listing_t * get_dir_listing(const char dir[], const char cwd[],
+		int *cached);
+static dir_listing_t * read_dir_listing(const char path[]);
+static int listing_entry_cmp(const void *a, const void *b);
+static int is_recently_changed(const char path[]);
+static void drop_dir_listing(int idx);
+static void free_dir_listing(dir_listing_t *listing);
+static void find_candidates(const dir_listing_t *listing, const char prefix[],
+		size_t prefix_len, size_t *begin, size_t *end);
+static int entry_targets_dir(const listing_entry_t *entry);
+static int is_file_exec(const char name[]);
 #ifdef _WIN32
 static void complete_with_shared(const char *server, const char *file);
 #endif
 static int file_matches(const char fname[], const char prefix[],
 		size_t prefix_len);
+static int path_matching_is_case_sensitive(void);
+
+/* Recently listed directories. */
+static dir_listing_t *dir_listings[16];
+/* Index of the next element of dir_listings to be replaced. */
+static int next_dir_listing;
+/* Total number of entries in dir_listings. */
+static size_t cached_entry_count;
 
 int
 complete_line(const char cmd_line[], void *extra_arg)
@@ -1280,7 +1324,6 @@ filename_completion(const char str[], CompletionType type,
 		int skip_canonicalization)
 {
 	/* TODO refactor filename_completion(...) function */
-	DIR *dir;
 	char *filename;
 	char *temp;
 	char *cwd;
@@ -1378,67 +1421,71 @@ filename_completion(const char str[], CompletionType type,
 	}
 #endif
 
-	dir = os_opendir(dirname);
-
 	cwd = save_cwd();
 
-	if(dir == NULL || vifm_chdir(dirname) != 0)
+	int cached;
+	dir_listing_t *const listing = get_dir_listing(dirname, cwd, &cached);
+
+	if(listing == NULL || vifm_chdir(dirname) != 0)
 	{
 		vle_compl_add_path_match(filename);
 	}
 	else
 	{
-		filename_completion_internal(dir, dirname, filename, type);
+		filename_completion_internal(listing, filename, type);
 		(void)vifm_chdir(flist_get_dir(curr_view));
 	}
 
-	free(filename);
-	free(dirname);
-
-	if(dir != NULL)
+	if(!cached)
 	{
-		os_closedir(dir);
+		free_dir_listing(listing);
 	}
 
+	free(filename);
+	free(dirname);
+
 	restore_cwd(cwd);
 	return 0;
 }
 
 /* The file completion core of filename_completion(). */
 static void
-filename_completion_internal(DIR *dir, const char dir_path[],
+filename_completion_internal(const dir_listing_t *listing,
 		const char filename[], CompletionType type)
 {
 	/* It's OK to use relative paths here, because filename_completion()
 	 * guarantees that we are in correct directory. */
-	struct dirent *d;
 
 	size_t filename_len = strlen(filename);
-	while((d = os_readdir(dir)) != NULL)
+
+	size_t i, end;
+	find_candidates(listing, filename, filename_len, &i, &end);
+	for(; i < end; ++i)
 	{
+		const listing_entry_t *const entry = &listing->entries[i];
 		int is_dir;
 
-		if(filename[0] == '\0' && d->d_name[0] == '.')
+		if(filename[0] == '\0' && entry->name[0] == '.')
 			continue;
-		if(!file_matches(d->d_name, filename, filename_len))
+		if(!file_matches(entry->name, filename, filename_len))
 			continue;
 
-		is_dir = is_dirent_targets_dir(d->d_name, d);
+		is_dir = entry_targets_dir(entry);
 
 		if(type == CT_DIRONLY && !is_dir)
 			continue;
-		else if(type == CT_EXECONLY && !is_dirent_targets_exec(d))
+		else if(type == CT_EXECONLY && (is_dir || !is_file_exec(entry->name)))
 			continue;
-		else if(type == CT_DIREXEC && !is_dir && !is_dirent_targets_exec(d))
+		else if(type == CT_DIREXEC && !is_dir && !is_file_exec(entry->name))
 			continue;
 
 		if(is_dir && type != CT_ALL_WOS)
 		{
-			vle_compl_put_path_match(format_str("%s/", d->d_name));
+			vle_compl_put_path_match(format_str("%s/", entry->name));
 		}
 		else
 		{
-			vle_compl_add_path_match(d->d_name);
+			vle_compl_add_path_match(entry->name);
 		}
 	}
 
@@ -1449,25 +1496,268 @@ filename_completion_internal(DIR *dir, const char dir_path[],
 	}
 }
 
-/* Uses dentry to check file type.  Returns non-zero for directories,
- * otherwise zero is returned.  Symbolic links are dereferenced. */
+/* Retrieves sorted list of files of a directory reusing previous result if the
+ * directory hasn't changed since then.  Relative dir is resolved against cwd,
+ * which can be NULL.  Sets *cached to zero if the result isn't in the cache and
+ * must be freed by the caller.  Returns the listing or NULL on error. */
+static dir_listing_t *
+get_dir_listing(const char dir[], const char cwd[], int *cached)
+{
+	*cached = 0;
+
+	if(cwd == NULL && !is_path_absolute(dir))
+	{
+		return read_dir_listing(dir);
+	}
+
+	char path[PATH_MAX + 1];
+	to_canonic_path(dir, cwd, path, sizeof(path));
+
+	/* Obtain state of the directory before reading it, so that changes made
+	 * while reading cause rereading next time. */
+	filemon_t mon;
+	(void)filemon_from_file(path, FMT_MODIFIED, &mon);
+
+	int i;
+	for(i = 0; i < (int)ARRAY_LEN(dir_listings); ++i)
+	{
+		dir_listing_t *const listing = dir_listings[i];
+		if(listing != NULL && strcmp(listing->path, path) == 0)
+		{
+			if(filemon_equal(&listing->mon, &mon))
+			{
+				*cached = 1;
+				return listing;
+			}
+
+			drop_dir_listing(i);
+			break;
+		}
+	}
+
+	dir_listing_t *const listing = read_dir_listing(path);
+	if(listing == NULL || !filemon_is_set(&mon) || is_recently_changed(path))
+	{
+		return listing;
+	}
+
+	const size_t count = DA_SIZE(listing->entries);
+	if(count > MAX_CACHED_ENTRIES)
+	{
+		return listing;
+	}
+
+	listing->mon = mon;
+
+	/* Make room for the listing by dropping older ones. */
+	drop_dir_listing(next_dir_listing);
+	for(i = 1; i < (int)ARRAY_LEN(dir_listings) &&
+			cached_entry_count + count > MAX_CACHED_ENTRIES; ++i)
+	{
+		drop_dir_listing((next_dir_listing + i)%ARRAY_LEN(dir_listings));
+	}
+
+	dir_listings[next_dir_listing] = listing;
+	cached_entry_count += count;
+	next_dir_listing = (next_dir_listing + 1)%ARRAY_LEN(dir_listings);
+
+	*cached = 1;
+	return listing;
+}
+
+/* Lists files of a directory.  Returns the listing or NULL on error. */
+static dir_listing_t *
+read_dir_listing(const char path[])
+{
+	DIR *const dir = os_opendir(path);
+	if(dir == NULL)
+	{
+		return NULL;
+	}
+
+	dir_listing_t *const listing = calloc(1, sizeof(*listing));
+	if(listing == NULL || (listing->path = strdup(path)) == NULL)
+	{
+		free(listing);
+		os_closedir(dir);
+		return NULL;
+	}
+
+	struct dirent *d;
+	while((d = os_readdir(dir)) != NULL)
+	{
+		listing_entry_t *const entry = DA_EXTEND(listing->entries);
+		if(entry == NULL || (entry->name = strdup(d->d_name)) == NULL)
+		{
+			free_dir_listing(listing);
+			os_closedir(dir);
+			return NULL;
+		}
+
+#if defined(HAVE_STRUCT_DIRENT_D_TYPE) && HAVE_STRUCT_DIRENT_D_TYPE
+		entry->type = d->d_type;
+#else
+		/* Querying type here is costly, so it's done only for matching files. */
+		entry->type = DT_UNKNOWN;
+#endif
+
+		DA_COMMIT(listing->entries);
+	}
+	os_closedir(dir);
+
+	safe_qsort(listing->entries, DA_SIZE(listing->entries),
+			sizeof(*listing->entries), &listing_entry_cmp);
+	return listing;
+}
+
+/* qsort() comparison criterion implementation.  Returns standard < 0, = 0,
+ * > 0. */
+static int
+listing_entry_cmp(const void *a, const void *b)
+{
+	const listing_entry_t *const entry_a = a;
+	const listing_entry_t *const entry_b = b;
+	return strcmp(entry_a->name, entry_b->name);
+}
+
+/* Checks whether directory was changed so recently that its next change might
+ * leave modification time intact on file systems with coarse timestamps.
+ * Returns non-zero if so, otherwise zero is returned. */
+static int
+is_recently_changed(const char path[])
+{
+	struct stat st;
+	return os_stat(path, &st) != 0 || time(NULL) - st.st_mtime < 2;
+}
+
+/* Removes listing from the cache by its index. */
+static void
+drop_dir_listing(int idx)
+{
+	dir_listing_t *const listing = dir_listings[idx];
+	if(listing != NULL)
+	{
+		cached_entry_count -= DA_SIZE(listing->entries);
+		free_dir_listing(listing);
+		dir_listings[idx] = NULL;
+	}
+}
+
+/* Frees listing of a directory.  The parameter can be NULL. */
+static void
+free_dir_listing(dir_listing_t *listing)
+{
+	if(listing == NULL)
+	{
+		return;
+	}
+
+	size_t i;
+	for(i = 0U; i < DA_SIZE(listing->entries); ++i)
+	{
+		free(listing->entries[i].name);
+	}
+	DA_REMOVE_ALL(listing->entries);
+
+	free(listing->path);
+	free(listing);
+}
+
+/* Finds range of entries of the listing that might match the prefix.  The range
+ * covers all entries unless matching is case sensitive. */
+static void
+find_candidates(const dir_listing_t *listing, const char prefix[],
+		size_t prefix_len, size_t *begin, size_t *end)
+{
+	*begin = 0U;
+	*end = DA_SIZE(listing->entries);
+
+	if(!path_matching_is_case_sensitive())
+	{
+		return;
+	}
+
+	/* Entries that start with the prefix form a contiguous range. */
+
+	size_t lo = *begin, hi = *end;
+	while(lo < hi)
+	{
+		const size_t mid = lo + (hi - lo)/2U;
+		if(strcmp(listing->entries[mid].name, prefix) < 0)
+		{
+			lo = mid + 1U;
+		}
+		else
+		{
+			hi = mid;
+		}
+	}
+	*begin = lo;
+
+	hi = *end;
+	while(lo < hi)
+	{
+		const size_t mid = lo + (hi - lo)/2U;
+		if(strncmp(listing->entries[mid].name, prefix, prefix_len) == 0)
+		{
+			lo = mid + 1U;
+		}
+		else
+		{
+			hi = mid;
+		}
+	}
+	*end = lo;
+}
+
+/* Checks whether cached entry is a directory or a symbolic link to one.
+ * Returns non-zero if so, otherwise zero is returned. */
 static int
-is_dirent_targets_exec(const struct dirent *d)
+entry_targets_dir(const listing_entry_t *entry)
 {
 	/* It's OK to use relative paths here, because filename_completion()
 	 * guarantees that we are in correct directory. */
+	switch(entry->type)
+	{
+		case DT_DIR:
+			return 1;
 #ifndef _WIN32
-	const unsigned char type = get_dirent_type(d, d->d_name);
-	if(type == DT_DIR)
-		return 0;
-	if(type == DT_LNK && get_symlink_type(d->d_name) != SLT_UNKNOWN)
-		return 0;
-	return os_access(d->d_name, X_OK) == 0;
+		case DT_LNK:
+			return get_symlink_type(entry->name) != SLT_UNKNOWN;
+#endif
+		case DT_UNKNOWN:
+			return is_dir(entry->name);
+
+		default:
+			return 0;
+	}
+}
+
+/* Checks whether file can be executed.  Returns non-zero if so, otherwise zero
+ * is returned. */
+static int
+is_file_exec(const char name[])
+{
+	/* It's OK to use relative paths here, because filename_completion()
+	 * guarantees that we are in correct directory. */
+#ifndef _WIN32
+	return os_access(name, X_OK) == 0;
 #else
-	return is_win_executable(d->d_name);
+	return is_win_executable(name);
 #endif
 }
 
+void
+complete_reset_cache(void)
+{
+	int i;
+	for(i = 0; i < (int)ARRAY_LEN(dir_listings); ++i)
+	{
+		drop_dir_listing(i);
+	}
+	next_dir_listing = 0;
+}
+
 #ifndef _WIN32
 
 void
@@ -1561,6 +1851,9 @@ complete_with_shared(const char *server, const char *file)
 static int
 file_matches(const char fname[], const char prefix[], size_t prefix_len)
 {
+	/* path_matching_is_case_sensitive() needs to be kept in sync with this
+	 * function. */
+
 	int cmp;
 	if(cfg.case_override & CO_PATH_COMPL)
 	{
@@ -1575,5 +1868,22 @@ file_matches(const char fname[], const char prefix[], size_t prefix_len)
 	return (cmp == 0);
 }
 
+/* Checks whether file_matches() compares names byte by byte.  Returns non-zero
+ * if so, otherwise zero is returned. */
+static int
+path_matching_is_case_sensitive(void)
+{
+	if(cfg.case_override & CO_PATH_COMPL)
+	{
+		return !(cfg.case_ignore & CO_PATH_COMPL);
+	}
+
+#ifndef _WIN32
+	return 1;
+#else
+	return 0;
+#endif
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 filetype=c : */
@@ -140,6 +140,10 @@ int filename_completion(const char str[], CompletionType type,
  * happens. */
 void complete_expr(const char str[], const char **start);
 
+/* Frees listings of directories that were cached to speed up completion of
+ * paths. */
+void complete_reset_cache(void);
+
 void complete_user_name(const char *str);
 
 void complete_group_name(const char *str);
@@ -25,14 +25,14 @@
 #include <unistd.h> /* unlink() */
 
 #include <assert.h> /* assert() */
-#include <ctype.h> /* isspace() */
+#include <ctype.h> /* isalpha() isspace() */
 #include <errno.h> /* errno */
 #include <limits.h> /* INT_MAX */
 #include <signal.h>
 #include <stddef.h> /* NULL size_t */
 #include <stdio.h> /* snprintf() */
 #include <stdlib.h> /* free() */
-#include <string.h> /* strcmp() strcpy() strlen() */
+#include <string.h> /* strcmp() strcpy() strdup() strlen() */
 
 #include "cfg/config.h"
 #include "cfg/info.h"
@@ -60,6 +60,7 @@
 #include "utils/fs.h"
 #include "utils/hist.h"
 #include "utils/int_stack.h"
+#include "utils/macros.h"
 #include "utils/path.h"
 #include "utils/str.h"
 #include "utils/string_array.h"
@@ -99,6 +100,17 @@ typedef enum
 }
 IfFrame;
 
+/* Result of breaking a command-line into sub-commands. */
+typedef struct
+{
+	char *cmdline; /* Command-line that was broken. */
+	int for_menu;  /* Whether the command-line is for a menu. */
+	int changes;   /* Value of vle_cmds_changes() at the moment of breaking. */
+	char **cmds;   /* List of sub-commands. */
+	int count;     /* Number of elements in the cmds array. */
+}
+broken_cmdline_t;
+
 static int swap_range(void);
 static int resolve_mark(char mark);
 static char * cmds_expand_macros(const char str[], int for_shell, int *usr1,
@@ -117,6 +129,8 @@ static void session_changed_callback(const char new_session[]);
 static char * pattern_expand_hook(const char pattern[]);
 static int is_implicit_cd(view_t *view, const char cmd[], int cmd_error);
 static int cmd_should_be_processed(int cmd_id);
+static char ** get_broken_cmdline(const char cmdline[], int for_menu);
+static int can_cache_broken_cmdline(char *cmds[], int count);
 TSTATIC char ** break_cmdline(const char cmdline[], int for_menu);
 static int is_out_of_arg(const char cmd[], const char pos[]);
 TSTATIC int line_pos(const char begin[], const char end[], char sep,
@@ -147,6 +161,12 @@ static int keep_view_selection;
  * well as file scope marks (SCOPE_GUARD). */
 static int_stack_t if_levels;
 
+/* Recently broken command-lines.  Autocommands and mappings tend to run the
+ * same command-lines over and over again. */
+static broken_cmdline_t broken_cmdlines[16];
+/* Index of the next element of broken_cmdlines to be replaced. */
+static int next_broken_cmdline;
+
 static int
 swap_range(void)
 {
@@ -238,7 +258,7 @@ prepare_extcmd_file(FILE *fp, const char beginning[], CmdInputType type)
 	fprintf(fp, "%s\n", beginning);
 	for(i = 0; i < hist->size; i++)
 	{
-		fprintf(fp, "%s\n", hist->items[i].text);
+		fprintf(fp, "%s\n", hist_get(hist, i)->text);
 	}
 
 	if(is_cmd)
@@ -848,7 +868,7 @@ int
 cmds_dispatch(const char cmdline[], view_t *view, CmdInputType type)
 {
 	int save_msg = 0;
-	char **cmds = break_cmdline(cmdline, type == CIT_MENU_COMMAND);
+	char **cmds = get_broken_cmdline(cmdline, type == CIT_MENU_COMMAND);
 	char **cmd = cmds;
 
 	while(*cmd != NULL)
@@ -866,6 +886,83 @@ cmds_dispatch(const char cmdline[], view_t *view, CmdInputType type)
 	return save_msg;
 }
 
+/* Breaks command-line into sub-commands reusing results of previous calls when
+ * possible.  Returns NULL-terminated list of sub-commands. */
+static char **
+get_broken_cmdline(const char cmdline[], int for_menu)
+{
+	/* Breaking depends on the set of commands, make sure it's the right one. */
+	if(!for_menu)
+	{
+		vle_cmds_init(1, &cmds_conf);
+	}
+
+	const int changes = vle_cmds_changes();
+
+	int i;
+	for(i = 0; i < (int)ARRAY_LEN(broken_cmdlines); ++i)
+	{
+		const broken_cmdline_t *const entry = &broken_cmdlines[i];
+		if(entry->cmdline != NULL && entry->for_menu == for_menu &&
+				entry->changes == changes && strcmp(entry->cmdline, cmdline) == 0)
+		{
+			/* Return a copy, because running commands can modify the cache. */
+			char **cmds = copy_string_array(entry->cmds, entry->count);
+			(void)put_into_string_array(&cmds, entry->count, NULL);
+			return cmds;
+		}
+	}
+
+	char **cmds = break_cmdline(cmdline, for_menu);
+	const int count = count_strings(cmds);
+	if(!can_cache_broken_cmdline(cmds, count))
+	{
+		return cmds;
+	}
+
+	char *const cmdline_copy = strdup(cmdline);
+	char **const cmds_copy = copy_string_array(cmds, count);
+	if(cmdline_copy == NULL || (cmds_copy == NULL && count != 0))
+	{
+		free(cmdline_copy);
+		free(cmds_copy);
+		return cmds;
+	}
+
+	broken_cmdline_t *const entry = &broken_cmdlines[next_broken_cmdline];
+	next_broken_cmdline = (next_broken_cmdline + 1)%ARRAY_LEN(broken_cmdlines);
+
+	free(entry->cmdline);
+	free_string_array(entry->cmds, entry->count);
+
+	entry->cmdline = cmdline_copy;
+	entry->for_menu = for_menu;
+	entry->changes = changes;
+	entry->cmds = cmds_copy;
+	entry->count = count;
+
+	return cmds;
+}
+
+/* Checks whether result of breaking a command-line depends only on its text
+ * and the set of commands.  Returns non-zero if so, otherwise zero is
+ * returned. */
+static int
+can_cache_broken_cmdline(char *cmds[], int count)
+{
+	int i;
+	for(i = 0; i < count; ++i)
+	{
+		/* Ranges can refer to marks, which affects parsing of the command. */
+		const char *const cmd = skip_to_cmd_name(cmds[i]);
+		if(!isalpha(cmd[0]) && cmd[0] != '!' && cmd[0] != '"' && cmd[0] != '\0')
+		{
+			return 0;
+		}
+	}
+	return 1;
+}
+
 /* Breaks command-line into sub-commands.  Returns NULL-terminated list of
  * sub-commands. */
 TSTATIC char **
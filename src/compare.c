@@ -41,6 +41,7 @@
 #include "utils/string_array.h"
 #include "utils/trie.h"
 #include "utils/utils.h"
+#include "utils/xxhash.h"
 #include "filelist.h"
 #include "filtering.h"
 #include "flist_sel.h"
@@ -66,10 +67,6 @@
  *       * compute contents fingerprint for current file and insert it
  */
 
-/* This is the only unit that uses xxhash, so import it directly here. */
-#define XXH_PRIVATE_API
-#include "utils/xxhash.h"
-
 /* Amount of data to read at once when comparing files in full. */
 #define BLOCK_SIZE (32*1024)
 
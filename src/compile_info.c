@@ -0,0 +1 @@
+const char GIT_INFO[] = "aa9aaead2059";
@@ -18,8 +18,6 @@
 
 #include "autocmds.h"
 
-#include <regex.h> /* regex_t regcomp() regexec() regfree() */
-
 #include <stddef.h> /* size_t */
 #include <stdlib.h> /* free() */
 #include <string.h> /* strcasecmp() strchr() strdup() */
@@ -37,7 +35,6 @@ typedef struct
 {
 	char *event;               /* Name of the event (case is ignored). */
 	char *pattern;             /* Pattern for the path. */
-	regex_t regex;             /* The pattern in compiled form. */
 	char *action;              /* Action to perform via handler. */
 	vle_aucmd_handler handler; /* Handler to invoke on event firing. */
 	int negated;               /* Whether pattern is negated. */
@@ -100,7 +97,6 @@ add_aucmd(const char event[], const char pattern[], int negated,
 {
 	char canonic_path[PATH_MAX + 1];
 	aucmd_info_t *autocmd;
-	char *regexp;
 
 	autocmd = DA_EXTEND(autocmds);
 	if(autocmd == NULL)
@@ -118,18 +114,10 @@ add_aucmd(const char event[], const char pattern[], int negated,
 		pattern = canonic_path;
 	}
 
-	regexp = glob_to_regex(pattern, 1);
-	if(regexp == NULL)
-	{
-		return 1;
-	}
-
-	if(regcomp(&autocmd->regex, regexp, REG_EXTENDED | REG_ICASE) != 0)
+	if(glob_check(pattern) != NULL)
 	{
-		free(regexp);
 		return 1;
 	}
-	free(regexp);
 
 	autocmd->event = strdup(event);
 	autocmd->pattern = strdup(pattern);
@@ -179,14 +167,13 @@ is_pattern_match(const aucmd_info_t *autocmd, const char path[])
 	                       ? get_last_path_component(path)
 	                       : path;
 
-	/* Leading start shouldn't match dot at the first character.  Can't be
-	 * handled by globs->regex translation. */
+	/* Leading star shouldn't match dot at the first character. */
 	if(autocmd->pattern[0] == '*' && part[0] == '.')
 	{
 		return 0;
 	}
 
-	return (regexec(&autocmd->regex, part, 0, NULL, 0) == 0)^autocmd->negated;
+	return glob_matches(autocmd->pattern, part, 1)^autocmd->negated;
 }
 
 void
@@ -226,7 +213,6 @@ free_autocmd_data(aucmd_info_t *autocmd)
 	free(autocmd->event);
 	free(autocmd->pattern);
 	free(autocmd->action);
-	regfree(&autocmd->regex);
 }
 
 void
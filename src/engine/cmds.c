@@ -52,6 +52,9 @@ static const char *RANGE_SEPARATORS = ",;";
 
 static inner_t *inner;
 static cmds_conf_t *cmds_conf;
+/* Number of times list of commands or current instance of the unit has
+ * changed. */
+static int cmds_changes;
 
 static const char * correct_limit(const char cmd[], cmd_info_t *cmd_info);
 static int udf_is_ambiguous(const char name[]);
@@ -114,6 +117,10 @@ vle_cmds_init(int udf, cmds_conf_t *conf)
 	};
 
 	cmds_conf = conf;
+	if(inner != conf->inner || inner == NULL)
+	{
+		++cmds_changes;
+	}
 	inner = conf->inner;
 
 	if(inner == NULL)
@@ -157,6 +164,7 @@ vle_cmds_reset(void)
 
 	inner->head.next = NULL;
 	inner->user_cmd_handler.handler = NULL;
+	++cmds_changes;
 
 	free(inner);
 	inner = NULL;
@@ -434,6 +442,12 @@ parse_tail(cmd_t *cur, const char cmd[], cmd_info_t *cmd_info, int strict_marks)
 	return cmd;
 }
 
+int
+vle_cmds_changes(void)
+{
+	return cmds_changes;
+}
+
 int
 vle_cmds_identify(const char cmd[])
 {
@@ -1098,6 +1112,7 @@ remove_commands(CMD_TYPE type)
 		}
 	}
 	inner->custom_cmd_count = 0;
+	++cmds_changes;
 }
 
 /* Implements :command builtin command mostly provided by this unit. */
@@ -1189,6 +1204,7 @@ vle_cmds_add_user(const char name[], const char body[], const char descr[],
 	init_command_flags(new, inner->user_cmd_handler.flags);
 
 	++inner->custom_cmd_count;
+	++cmds_changes;
 	return 0;
 }
 
@@ -1324,6 +1340,7 @@ insert_cmd(cmd_t *after)
 
 	new->next = after->next;
 	after->next = new;
+	++cmds_changes;
 	return new;
 }
 
@@ -1356,6 +1373,7 @@ vle_cmds_del_user(const char name[])
 	free(cmd);
 
 	inner->custom_cmd_count--;
+	++cmds_changes;
 	return 0;
 }
 
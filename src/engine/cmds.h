@@ -249,6 +249,11 @@ void vle_cmds_clear(void);
  * command handler. */
 int vle_cmds_run(const char cmd[]);
 
+/* Retrieves number that changes every time list of commands or current
+ * instance of the unit changes, which affects how command-lines are parsed.
+ * Returns the number. */
+int vle_cmds_changes(void);
+
 /* Parses command to fetch command and retrieve id associated with it.  Returns
  * the id, -1 on error and USER_CMD_ID for all user defined commands. */
 int vle_cmds_identify(const char cmd[]);
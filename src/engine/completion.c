@@ -220,7 +220,18 @@ group_unique_sort(size_t start_index, size_t len)
 		}
 	}
 
-	safe_qsort(sort_indices, len, sizeof(*sort_indices), &sorter);
+	/* Items often come already sorted (e.g., from cached directory listings), in
+	 * which case they are left as is. */
+	int sorted = 1;
+	for(i = 1; i < len && sorted; ++i)
+	{
+		sorted = (sorter(&sort_indices[i - 1], &sort_indices[i]) < 0);
+	}
+
+	if(!sorted)
+	{
+		safe_qsort(sort_indices, len, sizeof(*sort_indices), &sorter);
+	}
 
 	for(i = 0; i < len; ++i)
 	{
@@ -231,6 +242,12 @@ group_unique_sort(size_t start_index, size_t len)
 	}
 	free(sort_keys);
 
+	if(sorted)
+	{
+		free(sort_indices);
+		goto exit;
+	}
+
 	vle_compl_t *tmp_section = reallocarray(NULL, len, sizeof(*tmp_section));
 	if(tmp_section == NULL)
 	{
@@ -987,7 +987,7 @@ set_hat(opt_t *opt, const char value[])
 static void
 notify_option_update(opt_t *opt, OPT_OP op, optval_t val)
 {
-	*opts_changed = 1;
+	++*opts_changed;
 	opt->handler(op, val);
 }
 
@@ -74,8 +74,8 @@ typedef void (*opt_handler)(OPT_OP op, optval_t val);
 typedef void (*opt_uni_handler)(const char name[], optval_t val,
 		OPT_SCOPE scope);
 
-/* Initializes option module.  opts_changed_flag will be set to true after at
- * least one option will change its value using set_options(...) function.
+/* Initializes option module.  opts_changed_flag is incremented every time an
+ * option changes its value using set_options(...) function.
  * universal_handler can be NULL. */
 void vle_opts_init(int *opts_changed_flag, opt_uni_handler universal_handler);
 
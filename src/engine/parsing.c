@@ -40,6 +40,14 @@
  * If parsing stops before the end of an expression, partial result is still
  * returned as a result for the API client (this way expressions can follow one
  * another on a line and be parsed sequentially).
+ *
+ * Expressions that were parsed completely are also compiled into a sequence of
+ * instructions for a simple stack machine and cached, so that evaluating the
+ * same text again doesn't involve parsing.  Constant subexpressions are folded
+ * during compilation.  Values of environment variables, variables and options
+ * are recorded in the tree as references, which are resolved before each
+ * evaluation of compiled form (just like parsing does it).  If a reference
+ * can't be resolved, the expression is parsed anew to report the error.
  */
 
 #include "parsing.h"
@@ -48,12 +56,15 @@
 #include <ctype.h> /* isalnum() isalpha() tolower() */
 #include <stddef.h> /* NULL size_t */
 #include <stdio.h> /* snprintf() */
-#include <stdlib.h> /* free() */
-#include <string.h> /* strcat() strcmp() strncpy() */
+#include <stdlib.h> /* calloc() free() */
+#include <string.h> /* strcat() strcmp() strdup() strlen() strncpy() */
 #include <wchar.h> /* wchar_t */
 
 #include "../compat/reallocarray.h"
+#include "../utils/darray.h"
+#include "../utils/macros.h"
 #include "../utils/str.h"
+#include "../utils/string_array.h"
 #include "functions.h"
 #include "options.h"
 #include "text_buffer.h"
@@ -107,6 +118,39 @@ typedef enum
 }
 Ops;
 
+/* Types of external values referenced by expressions. */
+typedef enum
+{
+	REF_NONE,   /* Not a reference, but a literal. */
+	REF_ENVVAR, /* Environment variable. */
+	REF_VAR,    /* Variable. */
+	REF_OPT,    /* Option. */
+}
+RefType;
+
+/* Types of instructions of compiled expressions. */
+typedef enum
+{
+	I_PUSH,     /* Pushes value of the slot specified by the argument. */
+	I_NOT,      /* Replaces top value with its logical negation. */
+	I_NEG,      /* Replaces top value with its negated integer value. */
+	I_POS,      /* Replaces top value with its integer value. */
+	I_BOOL,     /* Replaces top value with its boolean value. */
+	I_ADD,      /* Replaces two top values with their sum. */
+	I_SUB,      /* Replaces two top values with their difference. */
+	I_CMP,      /* Replaces two top values with result of comparison, argument
+	               is the token of comparison operator. */
+	I_CONCAT,   /* Replaces top values (their number is the argument) with their
+	               concatenation. */
+	I_CALL,     /* Replaces top values (their number is in nargs) with result of
+	               calling function whose index is the argument. */
+	I_OR_JUMP,  /* Pops top value and if it's true, pushes true and jumps to
+	               instruction specified by the argument. */
+	I_AND_JUMP, /* Pops top value and if it's false, pushes false and jumps to
+	               instruction specified by the argument. */
+}
+InstrType;
+
 /* Information about a single token. */
 typedef struct
 {
@@ -138,9 +182,64 @@ typedef struct expr_t
 	char *func;         /* Function (builtin or user) name for OP_CALL. */
 	int nops;           /* Number of operands. */
 	struct expr_t *ops; /* Operands. */
+
+	RefType ref_type;    /* Where value of the literal came from. */
+	char *ref_name;      /* Name of the referenced value or NULL. */
+	OPT_SCOPE ref_scope; /* Scope of an option for REF_OPT. */
 }
 expr_t;
 
+/* Single instruction of a compiled expression. */
+typedef struct
+{
+	InstrType type; /* Type of the instruction. */
+	int arg;        /* Argument, its meaning depends on the type. */
+	int nargs;      /* Number of arguments of I_CALL. */
+}
+instr_t;
+
+/* External value used by a compiled expression. */
+typedef struct
+{
+	RefType type;    /* Type of the value. */
+	char *name;      /* Name of the value. */
+	OPT_SCOPE scope; /* Scope of an option for REF_OPT. */
+	int slot;        /* Slot that receives the value before evaluation. */
+	int owned;       /* Whether value in the slot should be freed. */
+}
+ref_t;
+
+/* Value on the stack of a compiled expression. */
+typedef struct
+{
+	var_t var; /* The value. */
+	int owned; /* Whether the value should be freed. */
+}
+stack_entry_t;
+
+/* Expression compiled into a sequence of instructions of a stack machine. */
+typedef struct
+{
+	char *text;               /* Source of the expression. */
+	size_t len;               /* Length of the source. */
+	int ends_with_whitespace; /* Value for the field of parsing_result_t. */
+
+	instr_t *code;            /* Instructions. */
+	DA_INSTANCE_FIELD(code);  /* Declarations to enable use of DA_* on code. */
+	var_t *slots;             /* Constants and values of references. */
+	DA_INSTANCE_FIELD(slots); /* Declarations to enable use of DA_* on slots. */
+	ref_t *refs;              /* References to external values. */
+	DA_INSTANCE_FIELD(refs);  /* Declarations to enable use of DA_* on refs. */
+	char **funcs;             /* Names of called functions. */
+	DA_INSTANCE_FIELD(funcs); /* Declarations to enable use of DA_* on funcs. */
+
+	stack_entry_t *stack;     /* Stack of the machine. */
+	int depth;                /* Depth of the stack at the end of the code. */
+	int max_depth;            /* Size of the stack. */
+	int users;                /* Number of evaluations that use the code. */
+}
+compiled_expr_t;
+
 /* Metadata container for static buffer. */
 typedef struct
 {
@@ -152,7 +251,7 @@ sbuffer;
 
 static parsing_result_t parse_from(const char input[],
 		expr_t (*production)(parse_context_t *ctx, const char **in), int strict,
-		int interactive);
+		int interactive, int cache);
 static int eval_expr(parse_context_t *ctx, expr_t *expr);
 static int eval_or_op(parse_context_t *ctx, int nops, expr_t ops[],
 		var_t *result);
@@ -162,8 +261,32 @@ static int eval_call_op(parse_context_t *ctx, const char name[], int nops,
 		expr_t ops[], var_t *result);
 static int compare_variables(TOKENS_TYPE operation, var_t lhs, var_t rhs);
 static var_t eval_concat(parse_context_t *ctx, int nops, expr_t ops[]);
+static int append_value(char buf[], size_t size, size_t *len, var_t value);
 static int add_expr_op(expr_t *expr, const expr_t *arg);
 static void free_expr(const expr_t *expr);
+static compiled_expr_t * find_compiled_expr(const char input[]);
+static int cache_compiled_expr(compiled_expr_t *compiled);
+static void reset_compiled_exprs(void);
+static compiled_expr_t * compile_tree(const char input[], expr_t *expr,
+		int ends_with_whitespace);
+static int compile_expr(compiled_expr_t *compiled, expr_t *expr);
+static int is_constant(const expr_t *expr);
+static int compile_logical_op(compiled_expr_t *compiled, const expr_t *expr);
+static int compile_call_op(compiled_expr_t *compiled, const expr_t *expr);
+static int emit_const(compiled_expr_t *compiled, var_t value);
+static int emit_ref(compiled_expr_t *compiled, const expr_t *expr);
+static int add_slot(compiled_expr_t *compiled, var_t value);
+static int emit(compiled_expr_t *compiled, InstrType type, int arg, int nargs);
+static void free_compiled_expr(compiled_expr_t *compiled);
+static int eval_compiled(compiled_expr_t *compiled, const char input[],
+		int interactive, parsing_result_t *result);
+static int resolve_refs(compiled_expr_t *compiled);
+static int resolve_ref(ref_t *ref, int borrow, var_t *value);
+static void release_refs(compiled_expr_t *compiled);
+static ParsingErrors run_compiled(compiled_expr_t *compiled, int interactive,
+		var_t *value);
+static void replace_top(stack_entry_t *entry, var_t value);
+static void drop_entry(stack_entry_t *entry);
 static expr_t parse_or_expr(parse_context_t *ctx, const char **in);
 static expr_t parse_and_expr(parse_context_t *ctx, const char **in);
 static expr_t parse_comp_expr(parse_context_t *ctx, const char **in);
@@ -181,9 +304,12 @@ static int parse_doubly_quoted_char(parse_context_t *ctx, const char **in,
 		sbuffer *sbuf);
 static int parse_doubly_quoted_notation(parse_context_t *ctx, const char **in,
 		sbuffer *sbuf);
-static var_t eval_envvar(parse_context_t *ctx, const char **in);
-static var_t eval_var(parse_context_t *ctx, const char **in);
-static var_t eval_opt(parse_context_t *ctx, const char **in);
+static var_t eval_envvar(parse_context_t *ctx, const char **in, expr_t *expr);
+static var_t eval_var(parse_context_t *ctx, const char **in, expr_t *expr);
+static var_t eval_opt(parse_context_t *ctx, const char **in, expr_t *expr);
+static var_t get_opt_value(const opt_t *opt);
+static int set_ref(parse_context_t *ctx, expr_t *expr, RefType type,
+		const char name[]);
 static expr_t parse_logical_not(parse_context_t *ctx, const char **in);
 static int parse_sequence(parse_context_t *ctx, const char **in,
 		const char first[], const char other[], size_t buf_len, char buf[]);
@@ -200,6 +326,11 @@ static notation_func notation_fu; /* Can be NULL. */
 /* Empty expression to be returned on errors. */
 static expr_t null_expr;
 
+/* Recently evaluated expressions in compiled form. */
+static compiled_expr_t *compiled_exprs[16];
+/* Index of the next element of compiled_exprs to be replaced. */
+static int next_compiled_expr;
+
 /* Public interface --------------------------------------------------------- */
 
 void
@@ -208,6 +339,8 @@ vle_parser_init(getenv_func getenv_f)
 	getenv_fu = getenv_f;
 	notation_fu = NULL;
 	initialized = 1;
+
+	reset_compiled_exprs();
 }
 
 void
@@ -215,12 +348,31 @@ vle_parser_set_notation(notation_func notation_f)
 {
 	assert(initialized && "Parser must be initialized before configuration.");
 	notation_fu = notation_f;
+
+	/* Compiled strings might contain expanded notation. */
+	reset_compiled_exprs();
 }
 
 parsing_result_t
 vle_parser_eval(const char input[], int interactive)
 {
-	return parse_from(input, &parse_or_expr, /*strict=*/0, interactive);
+	compiled_expr_t *const compiled = find_compiled_expr(input);
+	if(compiled == NULL)
+	{
+		return parse_from(input, &parse_or_expr, /*strict=*/0, interactive,
+				/*cache=*/1);
+	}
+
+	parsing_result_t result;
+	if(eval_compiled(compiled, input, interactive, &result) == 0)
+	{
+		return result;
+	}
+
+	/* The expression is either being evaluated already or refers to something
+	 * that doesn't exist at the moment, parsing will handle both cases. */
+	return parse_from(input, &parse_or_expr, /*strict=*/0, interactive,
+			/*cache=*/0);
 }
 
 parsing_result_t
@@ -228,17 +380,19 @@ vle_parser_eval_call(const char input[])
 {
 	/* Unlike in Vim, don't execute call expression followed by trailing
 	 * characters. */
-	return parse_from(input, &parse_funccall, /*strict=*/1, /*interactive=*/1);
+	return parse_from(input, &parse_funccall, /*strict=*/1, /*interactive=*/1,
+			/*cache=*/0);
 }
 
 /* Performs parsing and evaluation.  Accepts top-level production.  Non-strict
  * parsing means evaluation of an expression followed by trailing characters.
+ * Non-zero cache enables caching of compiled form of complete expressions.
  * Returns structure describing the outcome.  Field value of the result should
  * be freed by the caller. */
 static
 parsing_result_t parse_from(const char input[],
 		expr_t (*production)(parse_context_t *ctx, const char **in),
-		int strict, int interactive)
+		int strict, int interactive, int cache)
 {
 	assert(initialized && "Parser must be initialized before use.");
 
@@ -258,6 +412,28 @@ parsing_result_t parse_from(const char input[],
 
 	result.value = var_error();
 
+	if(cache && ctx.last_token.type == END &&
+			ctx.last_error == PE_NO_ERROR)
+	{
+		compiled_expr_t *const compiled = compile_tree(input, &expr_root,
+				ctx.prev_token.type == WHITESPACE);
+		if(compiled != NULL)
+		{
+			const int cached = cache_compiled_expr(compiled);
+			const int failed = eval_compiled(compiled, input, interactive, &result);
+			if(!cached)
+			{
+				free_compiled_expr(compiled);
+			}
+
+			if(!failed)
+			{
+				free_expr(&expr_root);
+				return result;
+			}
+		}
+	}
+
 	if(ctx.last_token.type != END)
 	{
 		if(result.last_parsed_char > input)
@@ -582,21 +758,50 @@ eval_concat(parse_context_t *ctx, int nops, expr_t ops[])
 
 	for(i = 0; i < nops; ++i)
 	{
-		char *const str_val = var_to_str(ops[i].value);
-		if(str_val == NULL)
+		if(append_value(res, sizeof(res), &res_len, ops[i].value) != 0)
 		{
 			ctx->last_error = PE_INTERNAL;
 			break;
 		}
-
-		copy_str(res + res_len, sizeof(res) - res_len, str_val);
-		res_len += strlen(res + res_len);
-		free(str_val);
 	}
 
 	return (ctx->last_error == PE_NO_ERROR ? var_from_str(res) : var_error());
 }
 
+/* Appends string representation of a value to the buffer truncating it if
+ * necessary.  Returns zero on success, otherwise non-zero is returned. */
+static int
+append_value(char buf[], size_t size, size_t *len, var_t value)
+{
+	char num[32];
+	char *str_val = NULL;
+	const char *str;
+
+	switch(value.type)
+	{
+		case VTYPE_STRING:
+			str = value.value.string;
+			break;
+		case VTYPE_INT:
+			snprintf(num, sizeof(num), "%d", value.value.integer);
+			str = num;
+			break;
+
+		default:
+			str = str_val = var_to_str(value);
+			if(str_val == NULL)
+			{
+				return 1;
+			}
+			break;
+	}
+
+	copy_str(buf + *len, size - *len, str);
+	*len += strlen(buf + *len);
+	free(str_val);
+	return 0;
+}
+
 /* Appends operand to an expression.  Returns zero on success, otherwise
  * non-zero is returned and the *op is freed. */
 static int
@@ -621,6 +826,7 @@ free_expr(const expr_t *expr)
 	int i;
 
 	free(expr->func);
+	free(expr->ref_name);
 	var_free(expr->value);
 
 	for(i = 0; i < expr->nops; ++i)
@@ -630,6 +836,728 @@ free_expr(const expr_t *expr)
 	free(expr->ops);
 }
 
+/* Compiled expressions ----------------------------------------------------- */
+
+/* Looks up compiled form of the expression in the cache.  Returns the
+ * expression or NULL. */
+static compiled_expr_t *
+find_compiled_expr(const char input[])
+{
+	int i;
+	for(i = 0; i < (int)ARRAY_LEN(compiled_exprs); ++i)
+	{
+		compiled_expr_t *const compiled = compiled_exprs[i];
+		if(compiled != NULL && strcmp(compiled->text, input) == 0)
+		{
+			return compiled;
+		}
+	}
+	return NULL;
+}
+
+/* Puts compiled expression into the cache replacing the oldest entry that isn't
+ * being used.  Returns non-zero if the expression was cached, otherwise zero is
+ * returned and the expression should be freed by the caller. */
+static int
+cache_compiled_expr(compiled_expr_t *compiled)
+{
+	int i;
+	for(i = 0; i < (int)ARRAY_LEN(compiled_exprs); ++i)
+	{
+		compiled_expr_t **const entry = &compiled_exprs[next_compiled_expr];
+		next_compiled_expr = (next_compiled_expr + 1)%ARRAY_LEN(compiled_exprs);
+
+		if(*entry != NULL && (*entry)->users != 0)
+		{
+			continue;
+		}
+
+		free_compiled_expr(*entry);
+		*entry = compiled;
+		return 1;
+	}
+	return 0;
+}
+
+/* Empties cache of compiled expressions.  Expressions that are being evaluated
+ * are left in place, they will be replaced eventually. */
+static void
+reset_compiled_exprs(void)
+{
+	int i;
+	for(i = 0; i < (int)ARRAY_LEN(compiled_exprs); ++i)
+	{
+		if(compiled_exprs[i] != NULL && compiled_exprs[i]->users == 0)
+		{
+			free_compiled_expr(compiled_exprs[i]);
+			compiled_exprs[i] = NULL;
+		}
+	}
+}
+
+/* Compiles expression tree folding its constant parts (the tree is updated in
+ * the process).  Returns compiled expression or NULL on error. */
+static compiled_expr_t *
+compile_tree(const char input[], expr_t *expr, int ends_with_whitespace)
+{
+	compiled_expr_t *const compiled = calloc(1, sizeof(*compiled));
+	if(compiled == NULL)
+	{
+		return NULL;
+	}
+
+	compiled->text = strdup(input);
+	compiled->len = strlen(input);
+	compiled->ends_with_whitespace = ends_with_whitespace;
+
+	if(compiled->text == NULL || compile_expr(compiled, expr) != 0)
+	{
+		free_compiled_expr(compiled);
+		return NULL;
+	}
+
+	assert(compiled->depth == 1 && "Compiled code must produce single value.");
+
+	compiled->stack = reallocarray(NULL, compiled->max_depth,
+			sizeof(*compiled->stack));
+	if(compiled->stack == NULL)
+	{
+		free_compiled_expr(compiled);
+		return NULL;
+	}
+
+	return compiled;
+}
+
+/* Emits instructions that leave value of the expression on the top of the
+ * stack.  Returns zero on success, otherwise non-zero is returned. */
+static int
+compile_expr(compiled_expr_t *compiled, expr_t *expr)
+{
+	if(expr->op_type != OP_NONE && is_constant(expr))
+	{
+		/* There is no need to compute the same value on every evaluation. */
+		parse_context_t ctx = { .last_error = PE_NO_ERROR };
+		if(eval_expr(&ctx, expr) != 0)
+		{
+			return 1;
+		}
+	}
+
+	int i;
+	switch(expr->op_type)
+	{
+		case OP_NONE:
+			return (expr->ref_type == REF_NONE)
+			     ? emit_const(compiled, expr->value)
+			     : emit_ref(compiled, expr);
+		case OP_OR:
+		case OP_AND:
+			return compile_logical_op(compiled, expr);
+		case OP_CALL:
+			for(i = 0; i < expr->nops; ++i)
+			{
+				if(compile_expr(compiled, &expr->ops[i]) != 0)
+				{
+					return 1;
+				}
+			}
+			return compile_call_op(compiled, expr);
+	}
+
+	assert(0 && "Unhandled operation type.");
+	return 1;
+}
+
+/* Checks whether value of the expression is always the same.  Returns non-zero
+ * if so, otherwise zero is returned. */
+static int
+is_constant(const expr_t *expr)
+{
+	if(expr->op_type == OP_NONE)
+	{
+		return (expr->ref_type == REF_NONE);
+	}
+
+	/* Functions can return different values on each call. */
+	if(expr->op_type == OP_CALL && isalpha(expr->func[0]))
+	{
+		return 0;
+	}
+
+	int i;
+	for(i = 0; i < expr->nops; ++i)
+	{
+		if(!is_constant(&expr->ops[i]))
+		{
+			return 0;
+		}
+	}
+	return 1;
+}
+
+/* Emits instructions for logical OR or AND, which evaluate their operands
+ * lazily.  Returns zero on success, otherwise non-zero is returned. */
+static int
+compile_logical_op(compiled_expr_t *compiled, const expr_t *expr)
+{
+	const int is_or = (expr->op_type == OP_OR);
+	if(expr->nops == 0)
+	{
+		return emit_const(compiled, is_or ? var_true() : var_false());
+	}
+
+	const InstrType jump = (is_or ? I_OR_JUMP : I_AND_JUMP);
+	const int start = DA_SIZE(compiled->code);
+
+	int i;
+	for(i = 0; i < expr->nops; ++i)
+	{
+		if(i != 0 && emit(compiled, jump, -1, 0) != 0)
+		{
+			return 1;
+		}
+		if(compile_expr(compiled, &expr->ops[i]) != 0)
+		{
+			return 1;
+		}
+	}
+
+	/* Single operand is passed through as is. */
+	if(expr->nops == 1)
+	{
+		return 0;
+	}
+
+	if(emit(compiled, I_BOOL, 0, 0) != 0)
+	{
+		return 1;
+	}
+
+	/* Jumps of nested operations are resolved by now, so the rest of them belong
+	 * to this operation and lead past its end. */
+	const int end = DA_SIZE(compiled->code);
+	for(i = start; i < end; ++i)
+	{
+		instr_t *const instr = &compiled->code[i];
+		if(instr->type == jump && instr->arg == -1)
+		{
+			instr->arg = end;
+		}
+	}
+
+	return 0;
+}
+
+/* Emits instruction for an operator or a function call whose operands are
+ * already on the stack.  Returns zero on success, otherwise non-zero is
+ * returned. */
+static int
+compile_call_op(compiled_expr_t *compiled, const expr_t *expr)
+{
+	static const struct
+	{
+		const char *name;   /* Name of the operator. */
+		TOKENS_TYPE token; /* Corresponding token. */
+	}
+	comparisons[] = {
+		{ "==", EQ }, { "!=", NE },
+		{ "<",  LT }, { "<=", LE },
+		{ ">",  GT }, { ">=", GE },
+	};
+
+	const char *const name = expr->func;
+	assert(name != NULL && "Function must have a name.");
+
+	if(strcmp(name, ".") == 0)
+	{
+		/* Single operand is passed through as is. */
+		return (expr->nops == 1 ? 0 : emit(compiled, I_CONCAT, expr->nops, 0));
+	}
+	if(strcmp(name, "!") == 0)
+	{
+		return emit(compiled, I_NOT, 0, 0);
+	}
+	if(strcmp(name, "-") == 0)
+	{
+		return emit(compiled, expr->nops == 1 ? I_NEG : I_SUB, 0, 0);
+	}
+	if(strcmp(name, "+") == 0)
+	{
+		return emit(compiled, expr->nops == 1 ? I_POS : I_ADD, 0, 0);
+	}
+
+	int i;
+	for(i = 0; i < (int)ARRAY_LEN(comparisons); ++i)
+	{
+		if(strcmp(name, comparisons[i].name) == 0)
+		{
+			return emit(compiled, I_CMP, comparisons[i].token, 0);
+		}
+	}
+
+	char **const func = DA_EXTEND(compiled->funcs);
+	if(func == NULL || (*func = strdup(name)) == NULL)
+	{
+		return 1;
+	}
+	DA_COMMIT(compiled->funcs);
+
+	return emit(compiled, I_CALL, DA_SIZE(compiled->funcs) - 1, expr->nops);
+}
+
+/* Emits instruction that pushes a constant.  Returns zero on success, otherwise
+ * non-zero is returned. */
+static int
+emit_const(compiled_expr_t *compiled, var_t value)
+{
+	const var_t copy = var_clone(value);
+	if(copy.type == VTYPE_STRING && copy.value.string == NULL)
+	{
+		return 1;
+	}
+
+	const int slot = add_slot(compiled, copy);
+	if(slot < 0)
+	{
+		var_free(copy);
+		return 1;
+	}
+
+	return emit(compiled, I_PUSH, slot, 0);
+}
+
+/* Emits instruction that pushes value of a reference.  Returns zero on success,
+ * otherwise non-zero is returned. */
+static int
+emit_ref(compiled_expr_t *compiled, const expr_t *expr)
+{
+	const int slot = add_slot(compiled, var_error());
+	if(slot < 0)
+	{
+		return 1;
+	}
+
+	ref_t *const ref = DA_EXTEND(compiled->refs);
+	if(ref == NULL)
+	{
+		return 1;
+	}
+
+	ref->type = expr->ref_type;
+	ref->name = strdup(expr->ref_name);
+	ref->scope = expr->ref_scope;
+	ref->slot = slot;
+	ref->owned = 0;
+	if(ref->name == NULL)
+	{
+		return 1;
+	}
+	DA_COMMIT(compiled->refs);
+
+	return emit(compiled, I_PUSH, slot, 0);
+}
+
+/* Adds a slot for a value, the value is owned by the compiled expression
+ * afterwards.  Returns index of the slot or -1 on error. */
+static int
+add_slot(compiled_expr_t *compiled, var_t value)
+{
+	var_t *const slot = DA_EXTEND(compiled->slots);
+	if(slot == NULL)
+	{
+		return -1;
+	}
+
+	*slot = value;
+	DA_COMMIT(compiled->slots);
+	return DA_SIZE(compiled->slots) - 1;
+}
+
+/* Appends an instruction keeping track of the stack size.  Returns zero on
+ * success, otherwise non-zero is returned. */
+static int
+emit(compiled_expr_t *compiled, InstrType type, int arg, int nargs)
+{
+	instr_t *const instr = DA_EXTEND(compiled->code);
+	if(instr == NULL)
+	{
+		return 1;
+	}
+
+	instr->type = type;
+	instr->arg = arg;
+	instr->nargs = nargs;
+	DA_COMMIT(compiled->code);
+
+	switch(type)
+	{
+		case I_PUSH:
+			++compiled->depth;
+			break;
+		case I_NOT:
+		case I_NEG:
+		case I_POS:
+		case I_BOOL:
+			break;
+		case I_ADD:
+		case I_SUB:
+		case I_CMP:
+		case I_OR_JUMP:
+		case I_AND_JUMP:
+			--compiled->depth;
+			break;
+		case I_CONCAT:
+			compiled->depth -= arg - 1;
+			break;
+		case I_CALL:
+			compiled->depth -= nargs - 1;
+			break;
+	}
+
+	compiled->max_depth = MAX(compiled->max_depth, compiled->depth);
+	return 0;
+}
+
+/* Frees compiled expression.  The parameter can be NULL. */
+static void
+free_compiled_expr(compiled_expr_t *compiled)
+{
+	if(compiled == NULL)
+	{
+		return;
+	}
+
+	size_t i;
+	for(i = 0; i < DA_SIZE(compiled->slots); ++i)
+	{
+		var_free(compiled->slots[i]);
+	}
+	for(i = 0; i < DA_SIZE(compiled->refs); ++i)
+	{
+		free(compiled->refs[i].name);
+	}
+
+	free(compiled->text);
+	DA_REMOVE_ALL(compiled->code);
+	DA_REMOVE_ALL(compiled->slots);
+	DA_REMOVE_ALL(compiled->refs);
+	free_string_array(compiled->funcs, DA_SIZE(compiled->funcs));
+	free(compiled->stack);
+	free(compiled);
+}
+
+/* Evaluates compiled expression filling in *result in the same way parsing
+ * does it.  Returns zero on success and non-zero if the expression can't be
+ * evaluated in compiled form at the moment. */
+static int
+eval_compiled(compiled_expr_t *compiled, const char input[], int interactive,
+		parsing_result_t *result)
+{
+	/* Nested evaluation of the same expression would need its own stack. */
+	if(compiled->users != 0)
+	{
+		return 1;
+	}
+
+	++compiled->users;
+
+	if(resolve_refs(compiled) != 0)
+	{
+		--compiled->users;
+		return 1;
+	}
+
+	var_t value;
+	const ParsingErrors error = run_compiled(compiled, interactive, &value);
+
+	release_refs(compiled);
+	--compiled->users;
+
+	const char *const end = input + compiled->len;
+	result->value = (error == PE_NO_ERROR ? value : var_error());
+	result->last_parsed_char = end;
+	result->last_position = (error == PE_INVALID_EXPRESSION)
+	                      ? skip_whitespace(input)
+	                      : end;
+	result->ends_with_whitespace = compiled->ends_with_whitespace;
+	result->error = error;
+	return 0;
+}
+
+/* Fills slots of references with their current values.  Returns zero on
+ * success, otherwise non-zero is returned. */
+static int
+resolve_refs(compiled_expr_t *compiled)
+{
+	size_t i;
+
+	for(i = 0; i < DA_SIZE(compiled->funcs); ++i)
+	{
+		if(!function_registered(compiled->funcs[i]))
+		{
+			return 1;
+		}
+	}
+
+	/* Functions can change variables and options, so values can be shared with
+	 * their owners only if there are no function calls. */
+	const int borrow = (DA_SIZE(compiled->funcs) == 0);
+
+	for(i = 0; i < DA_SIZE(compiled->refs); ++i)
+	{
+		ref_t *const ref = &compiled->refs[i];
+		if(resolve_ref(ref, borrow, &compiled->slots[ref->slot]) != 0)
+		{
+			release_refs(compiled);
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+/* Retrieves current value of a reference.  Returns zero on success, otherwise
+ * non-zero is returned. */
+static int
+resolve_ref(ref_t *ref, int borrow, var_t *value)
+{
+	const char *str;
+
+	switch(ref->type)
+	{
+		case REF_ENVVAR:
+			str = getenv_fu(ref->name);
+			break;
+		case REF_VAR:
+			*value = getvar(ref->name);
+			if(value->type == VTYPE_ERROR)
+			{
+				return 1;
+			}
+			if(!borrow)
+			{
+				*value = var_clone(*value);
+			}
+			ref->owned = !borrow;
+			return 0;
+		case REF_OPT:
+			{
+				const opt_t *const opt = vle_opts_find(ref->name, ref->scope);
+				if(opt == NULL)
+				{
+					return 1;
+				}
+				if(!borrow || !ONE_OF(opt->type, OPT_STR, OPT_STRLIST, OPT_CHARSET))
+				{
+					*value = get_opt_value(opt);
+					ref->owned = 1;
+					return 0;
+				}
+				str = opt->val.str_val;
+				break;
+			}
+
+		default:
+			assert(0 && "Unexpected reference type.");
+			return 1;
+	}
+
+	if(borrow)
+	{
+		value->type = VTYPE_STRING;
+		value->value.string = (char *)str;
+	}
+	else
+	{
+		*value = var_from_str(str);
+	}
+	ref->owned = !borrow;
+	return 0;
+}
+
+/* Frees values of references. */
+static void
+release_refs(compiled_expr_t *compiled)
+{
+	size_t i;
+	for(i = 0; i < DA_SIZE(compiled->refs); ++i)
+	{
+		ref_t *const ref = &compiled->refs[i];
+		if(ref->owned)
+		{
+			var_free(compiled->slots[ref->slot]);
+		}
+		compiled->slots[ref->slot] = var_error();
+		ref->owned = 0;
+	}
+}
+
+/* Runs instructions of compiled expression.  Returns PE_NO_ERROR and sets
+ * *value on success, otherwise error code is returned. */
+static ParsingErrors
+run_compiled(compiled_expr_t *compiled, int interactive, var_t *value)
+{
+	stack_entry_t *const stack = compiled->stack;
+	ParsingErrors error = PE_NO_ERROR;
+	size_t pc = 0U;
+	int top = 0;
+	int i;
+
+	while(pc < DA_SIZE(compiled->code) && error == PE_NO_ERROR)
+	{
+		const instr_t *const instr = &compiled->code[pc++];
+		stack_entry_t *const last = (top > 0 ? &stack[top - 1] : NULL);
+
+		switch(instr->type)
+		{
+			case I_PUSH:
+				stack[top].var = compiled->slots[instr->arg];
+				stack[top++].owned = 0;
+				break;
+
+			case I_NOT:
+				replace_top(last, var_from_bool(!var_to_int(last->var)));
+				break;
+			case I_NEG:
+				replace_top(last, var_from_int(-var_to_int(last->var)));
+				break;
+			case I_POS:
+				replace_top(last, var_from_int(var_to_int(last->var)));
+				break;
+			case I_BOOL:
+				/* TODO: replace with var_to_bool() when it's OK to change semantics of
+				 *       strings by themselves. */
+				replace_top(last, var_from_bool(var_to_int(last->var) != 0));
+				break;
+
+			case I_ADD:
+			case I_SUB:
+				{
+					const int a = var_to_int(last[-1].var);
+					const int b = var_to_int(last->var);
+					drop_entry(&stack[--top]);
+					replace_top(&stack[top - 1],
+							var_from_int(instr->type == I_SUB ? a - b : a + b));
+					break;
+				}
+			case I_CMP:
+				{
+					const int res = compare_variables(instr->arg, last[-1].var,
+							last->var);
+					drop_entry(&stack[--top]);
+					replace_top(&stack[top - 1], var_from_bool(res));
+					break;
+				}
+
+			case I_CONCAT:
+				{
+					char res[CMD_LINE_LENGTH_MAX + 1];
+					size_t res_len = 0U;
+					res[0] = '\0';
+
+					const int first = top - instr->arg;
+					for(i = first; i < top && error == PE_NO_ERROR; ++i)
+					{
+						if(append_value(res, sizeof(res), &res_len, stack[i].var) != 0)
+						{
+							error = PE_INTERNAL;
+						}
+					}
+
+					if(error == PE_NO_ERROR)
+					{
+						while(top > first + 1)
+						{
+							drop_entry(&stack[--top]);
+						}
+						replace_top(&stack[first], var_from_str(res));
+					}
+					break;
+				}
+
+			case I_CALL:
+				{
+					const int first = top - instr->nargs;
+
+					call_info_t call_info;
+					function_call_info_init(&call_info, interactive);
+					for(i = first; i < top; ++i)
+					{
+						/* Values owned by the stack are handed over as is. */
+						function_call_info_add_arg(&call_info, stack[i].owned
+								? stack[i].var
+								: var_clone(stack[i].var));
+					}
+					top = first;
+
+					const var_t res = function_call(compiled->funcs[instr->arg],
+							&call_info);
+					function_call_info_free(&call_info);
+
+					if(res.type == VTYPE_ERROR)
+					{
+						error = PE_INVALID_EXPRESSION;
+						break;
+					}
+
+					stack[top].var = res;
+					stack[top++].owned = 1;
+					break;
+				}
+
+			case I_OR_JUMP:
+			case I_AND_JUMP:
+				{
+					/* TODO: replace with var_to_bool() when it's OK to change semantics
+					 *       of strings by themselves. */
+					const int val = (var_to_int(last->var) != 0);
+					drop_entry(&stack[--top]);
+					if(val == (instr->type == I_OR_JUMP))
+					{
+						stack[top].var = var_from_bool(val);
+						stack[top++].owned = 0;
+						pc = instr->arg;
+					}
+					break;
+				}
+		}
+	}
+
+	if(error != PE_NO_ERROR)
+	{
+		while(top > 0)
+		{
+			drop_entry(&stack[--top]);
+		}
+		return error;
+	}
+
+	assert(top == 1 && "Compiled code must produce single value.");
+	*value = (stack[0].owned ? stack[0].var : var_clone(stack[0].var));
+	return PE_NO_ERROR;
+}
+
+/* Replaces value of a stack entry with a new value owned by the entry. */
+static void
+replace_top(stack_entry_t *entry, var_t value)
+{
+	drop_entry(entry);
+	entry->var = value;
+	entry->owned = 1;
+}
+
+/* Frees value of a stack entry if it's owned by the entry. */
+static void
+drop_entry(stack_entry_t *entry)
+{
+	if(entry->owned)
+	{
+		var_free(entry->var);
+		entry->owned = 0;
+	}
+}
+
 /* Input parsing ------------------------------------------------------------ */
 
 /* or_expr ::= and_expr | and_expr '||' or_expr */
@@ -889,11 +1817,11 @@ parse_term(parse_context_t *ctx, const char **in)
 			break;
 		case DOLLAR:
 			get_next(ctx, in);
-			result.value = eval_envvar(ctx, in);
+			result.value = eval_envvar(ctx, in, &result);
 			break;
 		case AMPERSAND:
 			get_next(ctx, in);
-			result.value = eval_opt(ctx, in);
+			result.value = eval_opt(ctx, in, &result);
 			break;
 		case EMARK:
 			get_next(ctx, in);
@@ -922,7 +1850,7 @@ parse_term(parse_context_t *ctx, const char **in)
 			{
 				if(**in == ':')
 				{
-					result.value = eval_var(ctx, in);
+					result.value = eval_var(ctx, in, &result);
 				}
 				else
 				{
@@ -1212,9 +2140,10 @@ parse_doubly_quoted_notation(parse_context_t *ctx, const char **in,
 	return 0;
 }
 
-/* envvar ::= '$' envvarname */
+/* envvar ::= '$' envvarname
+ * Records reference in the *expr. */
 static var_t
-eval_envvar(parse_context_t *ctx, const char **in)
+eval_envvar(parse_context_t *ctx, const char **in, expr_t *expr)
 {
 	char name[VAR_NAME_LENGTH_MAX + 1];
 	if(!parse_sequence(ctx, in, ENV_VAR_NAME_FIRST_CHAR, ENV_VAR_NAME_CHARS,
@@ -1224,12 +2153,18 @@ eval_envvar(parse_context_t *ctx, const char **in)
 		return var_false();
 	}
 
+	if(set_ref(ctx, expr, REF_ENVVAR, name) != 0)
+	{
+		return var_false();
+	}
+
 	return var_from_str(getenv_fu(name));
 }
 
-/* var ::= 'g:' varname | 'v:' varname */
+/* var ::= 'g:' varname | 'v:' varname
+ * Records reference in the *expr. */
 static var_t
-eval_var(parse_context_t *ctx, const char **in)
+eval_var(parse_context_t *ctx, const char **in, expr_t *expr)
 {
 	var_t var_value;
 
@@ -1262,12 +2197,18 @@ eval_var(parse_context_t *ctx, const char **in)
 		return var_false();
 	}
 
+	if(set_ref(ctx, expr, REF_VAR, name) != 0)
+	{
+		return var_false();
+	}
+
 	return var_clone(var_value);
 }
 
-/* envvar ::= '&' [ 'l:' | 'g:' ] optname */
+/* envvar ::= '&' [ 'l:' | 'g:' ] optname
+ * Records reference in the *expr. */
 static var_t
-eval_opt(parse_context_t *ctx, const char **in)
+eval_opt(parse_context_t *ctx, const char **in, expr_t *expr)
 {
 	OPT_SCOPE scope = OPT_ANY;
 	const opt_t *option;
@@ -1295,22 +2236,35 @@ eval_opt(parse_context_t *ctx, const char **in)
 		return var_false();
 	}
 
-	switch(option->type)
+	if(set_ref(ctx, expr, REF_OPT, name) != 0)
+	{
+		return var_false();
+	}
+	expr->ref_scope = scope;
+
+	return get_opt_value(option);
+}
+
+/* Retrieves value of an option.  Returns the value. */
+static var_t
+get_opt_value(const opt_t *opt)
+{
+	switch(opt->type)
 	{
 		case OPT_STR:
 		case OPT_STRLIST:
 		case OPT_CHARSET:
-			return var_from_str(option->val.str_val);
+			return var_from_str(opt->val.str_val);
 
 		case OPT_BOOL:
-			return var_from_bool(option->val.bool_val);
+			return var_from_bool(opt->val.bool_val);
 
 		case OPT_INT:
-			return var_from_int(option->val.int_val);
+			return var_from_int(opt->val.int_val);
 
 		case OPT_ENUM:
 		case OPT_SET:
-			return var_from_str(vle_opt_to_string(option));
+			return var_from_str(vle_opt_to_string(opt));
 
 		default:
 			assert(0 && "Unexpected option type");
@@ -1318,6 +2272,22 @@ eval_opt(parse_context_t *ctx, const char **in)
 	}
 }
 
+/* Marks the expression as a reference to an external value.  Returns zero on
+ * success, otherwise non-zero is returned. */
+static int
+set_ref(parse_context_t *ctx, expr_t *expr, RefType type, const char name[])
+{
+	expr->ref_name = strdup(name);
+	if(expr->ref_name == NULL)
+	{
+		ctx->last_error = PE_INTERNAL;
+		return 1;
+	}
+
+	expr->ref_type = type;
+	return 0;
+}
+
 /* logical_not ::= '!' term */
 static expr_t
 parse_logical_not(parse_context_t *ctx, const char **in)
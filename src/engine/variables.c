@@ -115,6 +115,8 @@ static size_t env_var_count;
 static var_info_t *internal_vars;
 /* Number of internal variables. */
 static size_t internal_var_count;
+/* Number of changes of variables since startup. */
+static int var_changes;
 
 void
 init_variables(void)
@@ -206,6 +208,7 @@ clear_internal_vars(void)
 	internal_var_count = 0U;
 	free(internal_vars);
 	internal_vars = NULL;
+	++var_changes;
 }
 
 void
@@ -234,6 +237,13 @@ clear_envvars(void)
 	env_var_count = 0;
 	free(env_vars);
 	env_vars = NULL;
+	++var_changes;
+}
+
+int
+get_variable_changes(void)
+{
+	return var_changes;
 }
 
 int
@@ -482,6 +492,11 @@ static int
 perform_op(const char name[], VariableType vt, VariableOperation vo, var_t val,
 		const char value[])
 {
+	if(vt == VT_ENVVAR || vt == VT_GVAR)
+	{
+		++var_changes;
+	}
+
 	if(vt == VT_ENVVAR)
 	{
 		/* Update environment variable. */
@@ -804,6 +819,7 @@ unlet_variables(const char cmd[])
 			else
 				free_record(record);
 			env_remove(name);
+			++var_changes;
 		}
 		else if(type == VT_GVAR)
 		{
@@ -819,6 +835,7 @@ unlet_variables(const char cmd[])
 			var_free(var->val);
 			*var = internal_vars[internal_var_count - 1];
 			--internal_var_count;
+			++var_changes;
 		}
 	}
 
@@ -962,6 +979,8 @@ setvar(const char varname[], var_t val)
 		return 1;
 	}
 
+	++var_changes;
+
 	/* Initialize new variable before doing anything else. */
 	new_var.name = strdup(varname);
 	new_var.val = var_clone(val);
@@ -69,6 +69,10 @@ int unlet_variables(const char cmd[]);
  * variable's name.  *start is set to completion insertion position in var. */
 void complete_variables(const char var[], const char **start);
 
+/* Retrieves number of changes of environment, global and builtin variables.
+ * Returns the counter, which only grows. */
+int get_variable_changes(void);
+
 #endif /* VIFM__ENGINE__VARIABLES_H__ */
 
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
@@ -47,6 +47,7 @@
 #include "engine/autocmds.h"
 #include "engine/mode.h"
 #include "int/fuse.h"
+#include "lua/vlua.h"
 #include "modes/dialogs/msg_dialog.h"
 #include "modes/modes.h"
 #include "modes/view.h"
@@ -83,6 +84,7 @@
 #include "opt_handlers.h"
 #include "registers.h"
 #include "running.h"
+#include "search.h"
 #include "sort.h"
 #include "status.h"
 #include "types.h"
@@ -285,6 +287,8 @@ flist_free_view(view_t *view)
 	update_string(&view->local_filter.prev, NULL);
 	free(view->local_filter.poshist);
 	view->local_filter.poshist = NULL;
+	free(view->local_filter.passed);
+	view->local_filter.passed = NULL;
 
 	filter_dispose(&view->local_filter.filter);
 	filter_dispose(&view->auto_filter);
@@ -303,9 +307,13 @@ flist_free_view(view_t *view)
 
 	update_string(&view->last_dir, NULL);
 
+	invalidate_search_index(view);
+
 	flist_free_cache(&view->left_column);
 	flist_free_cache(&view->right_column);
 
+	fview_free_frame(view);
+
 	update_string(&view->last_curr_file, NULL);
 
 	free_string_array(view->saved_selection, view->nsaved_selection);
@@ -1722,6 +1730,13 @@ populate_dir_list_internal(view_t *view, int reload)
 		flist_free_cache(&view->right_column);
 	}
 
+	/* Values of view columns might have been computed for entries that are
+	 * about to be replaced. */
+	if(curr_stats.vlua != NULL)
+	{
+		vlua_viewcolumns_invalidate(curr_stats.vlua);
+	}
+
 	if(flist_custom_active(view))
 	{
 		return populate_custom_view(view, reload);
@@ -2005,9 +2020,11 @@ zap_compare_view(view_t *view, view_t *other, zap_filter filter, void *arg)
 				}
 				continue;
 			}
+			fview_entry_removed(view, entry);
 			replace_string(&entry->name, "");
 			entry->type = FT_UNK;
 			entry->id = other->dir_entry[i].id;
+			fview_entry_added(view, entry);
 		}
 
 		if(i != j)
@@ -2181,6 +2198,10 @@ zap_entries(view_t *view, dir_entry_t *entries, int *count, zap_filter filter,
 		int k;
 		for(k = 0; k < nremoved; ++k)
 		{
+			if(entries == view->dir_entry)
+			{
+				fview_entry_removed(view, &entry[k]);
+			}
 			fentry_free(&entry[k]);
 		}
 
@@ -2210,6 +2231,10 @@ zap_entries(view_t *view, dir_entry_t *entries, int *count, zap_filter filter,
 			entries[j].origin = path;
 			entries[j].owns_origin = 1;
 			entries[j].child_pos = 1;
+			if(entries == view->dir_entry)
+			{
+				fview_entry_added(view, &entries[j]);
+			}
 
 			/* Since we are now adding back one entry, increase parent counts and
 			 * child positions back by one. */
@@ -2574,6 +2599,8 @@ merge_entries(dir_entry_t *new, const dir_entry_t *prev)
 		new->hi_num = prev->hi_num;
 		new->name_dec_num = prev->name_dec_num;
 	}
+
+	new->name_width = prev->name_width;
 }
 
 /* Corrects selected item position in the list.  Returns updated value of the
@@ -3825,20 +3852,23 @@ fentry_rename(view_t *view, dir_entry_t *entry, const char to[])
 {
 	char *const old_name = entry->name;
 
-	/* Rename file in internal structures for correct positioning of cursor
-	 * after reloading, as cursor will be positioned on the file with the same
-	 * name. */
-	entry->name = strdup(to);
-	if(entry->name == NULL)
+	char *const new_name = strdup(to);
+	if(new_name == NULL)
 	{
-		entry->name = old_name;
 		return;
 	}
 
+	/* Rename file in internal structures for correct positioning of cursor
+	 * after reloading, as cursor will be positioned on the file with the same
+	 * name. */
+	fview_entry_removed(view, entry);
+	entry->name = new_name;
+
 	/* Name change can affect name specific highlight and decorations, so reset
 	 * the caches. */
 	entry->hi_num = -1;
 	entry->name_dec_num = -1;
+	fview_entry_added(view, entry);
 
 	/* Update origins of entries which include the one we're renaming. */
 	if(flist_custom_active(view) && fentry_is_dir(entry))
@@ -3861,12 +3891,14 @@ fentry_rename(view_t *view, dir_entry_t *entry, const char to[])
 				char *const new_origin = format_str("%s/%s%s", entry->origin, to,
 						e->origin + root_len);
 				chosp(new_origin);
+				fview_entry_removed(view, e);
 				if(e->owns_origin)
 				{
 					free(e->origin);
 				}
 				e->origin = new_origin;
 				e->owns_origin = 1;
+				fview_entry_added(view, e);
 
 				/* Clone visible child folds. */
 				e->folded = 0;
@@ -29,6 +29,7 @@
 #include "compat/reallocarray.h"
 #include "modes/dialogs/msg_dialog.h"
 #include "utils/matchers.h"
+#include "utils/matchers_index.h"
 #include "utils/str.h"
 #include "utils/string_array.h"
 #include "utils/path.h"
@@ -53,6 +54,8 @@ static int assoc_records_contains(assoc_records_t *assocs, const char command[],
 		const char description[]);
 static void safe_free(char **adr);
 static int is_assoc_record_empty(const assoc_record_t *record);
+static int find_match(const assoc_list_t *assoc_list, const char file[],
+		int from);
 static int mg_match(const matchers_group_t *mg, const char str[]);
 static void mg_free(matchers_group_t *mg);
 
@@ -114,15 +117,11 @@ ft_get_viewers(const char file[])
 	strlist_t viewers = {};
 
 	int i;
-	for(i = 0; i < fileviewers.count; ++i)
+	for(i = find_match(&fileviewers, file, 0); i >= 0;
+			i = find_match(&fileviewers, file, i + 1))
 	{
 		assoc_t *const assoc = &fileviewers.list[i];
 
-		if(!mg_match(&assoc->mg, file))
-		{
-			continue;
-		}
-
 		int j;
 		for(j = 0; j < assoc->records.count; ++j)
 		{
@@ -146,16 +145,12 @@ find_existing_cmd(const assoc_list_t *record_list, const char file[])
 {
 	int i;
 
-	for(i = 0; i < record_list->count; ++i)
+	for(i = find_match(record_list, file, 0); i >= 0;
+			i = find_match(record_list, file, i + 1))
 	{
 		assoc_record_t prog;
 		assoc_t *const assoc = &record_list->list[i];
 
-		if(!mg_match(&assoc->mg, file))
-		{
-			continue;
-		}
-
 		prog = find_existing_cmd_record(&assoc->records);
 		if(!is_assoc_record_empty(&prog))
 		{
@@ -259,13 +254,10 @@ clone_all_matching_records(const char file[], const assoc_list_t *record_list)
 	int i;
 	assoc_records_t result = {};
 
-	for(i = 0; i < record_list->count; ++i)
+	for(i = find_match(record_list, file, 0); i >= 0;
+			i = find_match(record_list, file, i + 1))
 	{
-		assoc_t *const assoc = &record_list->list[i];
-		if(mg_match(&assoc->mg, file))
-		{
-			ft_assoc_record_add_all(&result, &assoc->records);
-		}
+		ft_assoc_record_add_all(&result, &record_list->list[i].records);
 	}
 
 	return result;
@@ -311,6 +303,18 @@ add_assoc(assoc_list_t *assoc_list, assoc_t assoc)
 	assoc_list->list = p;
 	assoc_list->list[assoc_list->count] = assoc;
 	assoc_list->count++;
+
+	if(assoc_list->count == 1)
+	{
+		assoc_list->index = matchers_index_create();
+	}
+	if(assoc_list->index != NULL &&
+			matchers_index_add(assoc_list->index, assoc.mg.list, assoc.mg.count) != 0)
+	{
+		/* Fall back to checking associations one by one. */
+		matchers_index_free(assoc_list->index);
+		assoc_list->index = NULL;
+	}
 	return 1;
 }
 
@@ -431,6 +435,9 @@ reset_list_head(assoc_list_t *assoc_list)
 	free(assoc_list->list);
 	assoc_list->list = NULL;
 	assoc_list->count = 0;
+
+	matchers_index_free(assoc_list->index);
+	assoc_list->index = NULL;
 }
 
 static void
@@ -634,6 +641,27 @@ is_assoc_record_empty(const assoc_record_t *record)
 	return record->command == NULL && record->description == NULL;
 }
 
+/* Finds first association of the list starting at from whose matchers match
+ * the file.  Returns index of the association or -1 if there is none. */
+static int
+find_match(const assoc_list_t *assoc_list, const char file[], int from)
+{
+	if(assoc_list->index != NULL)
+	{
+		return matchers_index_find(assoc_list->index, file, from);
+	}
+
+	int i;
+	for(i = from; i < assoc_list->count; ++i)
+	{
+		if(mg_match(&assoc_list->list[i].mg, file))
+		{
+			return i;
+		}
+	}
+	return -1;
+}
+
 /* Checks whether given string matches.  Returns non-zero if so, otherwise zero
  * is returned. */
 static int
@@ -22,6 +22,7 @@
 
 #define VIFM_PSEUDO_CMD "vifm"
 
+struct matchers_index_t;
 struct matchers_t;
 
 /* Type of file association by its source. */
@@ -78,6 +79,8 @@ typedef struct
 {
 	assoc_t *list;
 	int count;
+	struct matchers_index_t *index; /* Index of the list for lookups or NULL if
+	                                   it's missing. */
 }
 assoc_list_t;
 
@@ -20,7 +20,9 @@
 #include "filtering.h"
 
 #include <assert.h> /* assert() */
-#include <string.h> /* strdup() */
+#include <regex.h> /* REG_ICASE */
+#include <stdlib.h> /* free() */
+#include <string.h> /* strdup() strlen() strncmp() strpbrk() */
 
 #include "cfg/config.h"
 #include "compat/reallocarray.h"
@@ -44,7 +46,10 @@ static int get_unfiltered_pos(const view_t *view, int pos);
 static int load_unfiltered_list(view_t *view);
 static int list_is_incomplete(view_t *view);
 static void store_local_filter_position(view_t *view, int pos);
-static int update_filtering_lists(view_t *view, int add, int clear);
+static int is_refinement(const filter_t *filter, const char old[],
+		int old_cflags, int old_valid);
+static int update_filtering_lists(view_t *view, int add, int clear,
+		int narrow);
 static void reparent_tree_node(dir_entry_t *original, dir_entry_t *filtered);
 static void ensure_filtered_list_not_empty(view_t *view,
 		dir_entry_t *parent_entry);
@@ -71,6 +76,9 @@ filters_view_reset(view_t *view)
 	view->local_filter.saved = NULL;
 	view->local_filter.poshist = NULL;
 	view->local_filter.poshist_len = 0U;
+	view->local_filter.passed = NULL;
+	view->local_filter.passed_count = 0U;
+	view->local_filter.passed_valid = 0;
 }
 
 /* Resets filter to empty state (either initializes or clears it). */
@@ -399,16 +407,55 @@ local_filter_set(view_t *view, const char filter[])
 		store_local_filter_position(view, current_file_pos);
 	}
 
-	result = (filter_change(&view->local_filter.filter, filter,
+	filter_t *const lf_filter = &view->local_filter.filter;
+	char *const old = strdup(lf_filter->raw);
+	const int old_cflags = lf_filter->cflags;
+	const int old_valid = lf_filter->is_regex_valid;
+
+	result = (filter_change(lf_filter, filter,
 			!regexp_should_ignore_case(filter)) ? -1 : 0);
 
-	if(update_filtering_lists(view, 1, 0) != 0 && result == 0)
+	/* Refined filter can't match anything that was filtered out, so only the
+	 * entries that passed the previous filter need to be checked. */
+	const int narrow = view->local_filter.passed_valid && old != NULL
+	                && is_refinement(lf_filter, old, old_cflags, old_valid);
+	free(old);
+
+	if(update_filtering_lists(view, 1, 0, narrow) != 0 && result == 0)
 	{
 		result = 1;
 	}
 	return result;
 }
 
+/* Checks whether the filter is a refinement of its old state, that is its
+ * pattern is the old one with some literal characters appended.  Returns
+ * non-zero if so, otherwise zero is returned. */
+static int
+is_refinement(const filter_t *filter, const char old[], int old_cflags,
+		int old_valid)
+{
+	const size_t len = strlen(old);
+	if(strncmp(filter->raw, old, len) != 0)
+	{
+		return 0;
+	}
+
+	/* Invalid filter matches everything. */
+	if(old_valid && !filter->is_regex_valid)
+	{
+		return 0;
+	}
+
+	/* Case-sensitive matching is stricter than case-insensitive one. */
+	if(!(old_cflags & REG_ICASE) && (filter->cflags & REG_ICASE))
+	{
+		return 0;
+	}
+
+	return (strpbrk(filter->raw + len, "\\^$.|?*+()[]{}") == NULL);
+}
+
 /* Gets position of an item in dir_entry list at position pos in the unfiltered
  * list.  Returns index on success, otherwise -1 is returned. */
 static int
@@ -521,25 +568,37 @@ store_local_filter_position(view_t *view, int pos)
 /* Copies/moves elements of the unfiltered list into dir_entry list.  add
  * parameter controls whether entries matching filter are copied into dir_entry
  * list.  clear parameter controls whether entries not matching filter are
- * cleared in unfiltered list.  Returns zero unless addition is performed in
- * which case can return non-zero when all files got filtered out. */
+ * cleared in unfiltered list.  narrow parameter limits processing to entries
+ * that passed the previous filtering.  Returns zero unless addition is
+ * performed in which case can return non-zero when all files got filtered
+ * out. */
 static int
-update_filtering_lists(view_t *view, int add, int clear)
+update_filtering_lists(view_t *view, int add, int clear, int narrow)
 {
 	/* filters_drop_temporaries() is a similar function. */
 
-	size_t i;
+	struct local_filter_t *const lf = &view->local_filter;
+	const size_t count = (narrow ? lf->passed_count : lf->unfiltered_count);
+	size_t k;
 	size_t list_size = 0U;
 	dir_entry_t *parent_entry = NULL;
 	int parent_added = 0;
 
-	for(i = 0; i < view->local_filter.unfiltered_count; ++i)
+	/* Entries that pass are recorded only while filtering is in progress.
+	 * Failure to allocate just disables narrowing. */
+	int *const passed = (add && !clear)
+	                  ? reallocarray(NULL, count + 1U, sizeof(*passed))
+	                  : NULL;
+	size_t npassed = 0U;
+
+	for(k = 0U; k < count; ++k)
 	{
 		/* FIXME: some very long file names won't be matched against some
 		 * regexps. */
 		char name_with_slash[NAME_MAX + 1 + 1];
 
-		dir_entry_t *const entry = &view->local_filter.unfiltered[i];
+		const size_t i = (narrow ? (size_t)lf->passed[k] : k);
+		dir_entry_t *const entry = &lf->unfiltered[i];
 		const char *name = entry->name;
 
 		if(is_parent_dir(name))
@@ -547,6 +606,10 @@ update_filtering_lists(view_t *view, int add, int clear)
 			if(entry->child_pos == 0)
 			{
 				parent_entry = entry;
+				if(passed != NULL)
+				{
+					passed[npassed++] = i;
+				}
 				if(add && cfg_parent_dir_is_visible(is_root_dir(view->curr_dir)))
 				{
 					(void)add_dir_entry(&view->dir_entry, &list_size, entry);
@@ -587,6 +650,10 @@ update_filtering_lists(view_t *view, int add, int clear)
 					reparent_tree_node(entry, e);
 				}
 			}
+			if(passed != NULL)
+			{
+				passed[npassed++] = i;
+			}
 		}
 		else
 		{
@@ -607,6 +674,12 @@ update_filtering_lists(view_t *view, int add, int clear)
 			fentry_free(parent_entry);
 		}
 	}
+	free(lf->passed);
+	lf->passed = passed;
+	lf->passed_count = npassed;
+	/* Empty list can get a new entry in the unfiltered list below. */
+	lf->passed_valid = (passed != NULL && list_size != 0U);
+
 	if(add)
 	{
 		view->list_rows = list_size;
@@ -785,7 +858,7 @@ local_filter_accept(view_t *view, int update_history)
 		return;
 	}
 
-	update_filtering_lists(view, 0, 1);
+	update_filtering_lists(view, 0, 1, 0);
 
 	local_filter_finish(view);
 
@@ -831,7 +904,7 @@ local_filter_cancel(view_t *view)
 	view->dir_entry = NULL;
 	view->list_rows = 0;
 
-	update_filtering_lists(view, 1, 1);
+	update_filtering_lists(view, 1, 1, 0);
 	local_filter_finish(view);
 }
 
@@ -846,6 +919,11 @@ local_filter_finish(view_t *view)
 	free(view->local_filter.poshist);
 	view->local_filter.poshist = NULL;
 	view->local_filter.poshist_len = 0U;
+
+	free(view->local_filter.passed);
+	view->local_filter.passed = NULL;
+	view->local_filter.passed_count = 0U;
+	view->local_filter.passed_valid = 0;
 }
 
 void
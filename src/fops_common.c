@@ -163,6 +163,8 @@ static int is_file_name_changed(const char old[], const char new[]);
 static int ui_cancellation_hook(void *arg);
 TSTATIC char ** edit_list(struct ext_edit_t *ext_edit, size_t orig_len,
 		char *orig[], int *edited_len, int load_always);
+static ops_t * get_bg_ops(OPS main_op, const char descr[], const char dir[],
+		int force_syscalls);
 TSTATIC progress_data_t * alloc_progress_data(int bg, void *info);
 static long long time_in_ms(void);
 
@@ -1169,9 +1171,28 @@ fops_bg_ops_init(ops_t *ops, bg_op_t *bg_op)
 
 ops_t *
 fops_get_bg_ops(OPS main_op, const char descr[], const char dir[])
+{
+	return get_bg_ops(main_op, descr, dir, /*force_syscalls=*/0);
+}
+
+ops_t *
+fops_get_syscalls_bg_ops(OPS main_op, const char descr[], const char dir[])
+{
+	return get_bg_ops(main_op, descr, dir, /*force_syscalls=*/1);
+}
+
+/* Allocates opt_t structure for a background operation.  Returns pointer to
+ * newly allocated structure. */
+static ops_t *
+get_bg_ops(OPS main_op, const char descr[], const char dir[],
+		int force_syscalls)
 {
 	ops_t *const ops = ops_alloc(main_op, 1, descr, dir, dir, fops_options_prompt,
 			&prompt_msg);
+	if(force_syscalls)
+	{
+		ops->use_system_calls = 1;
+	}
 	if(ops->use_system_calls)
 	{
 		progress_data_t *const pdata = alloc_progress_data(ops->bg, NULL);
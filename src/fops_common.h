@@ -171,6 +171,11 @@ void fops_bg_ops_init(ops_t *ops, bg_op_t *bg_op);
  * newly allocated structure, which should be freed by fops_free_ops(). */
 ops_t * fops_get_bg_ops(OPS main_op, const char descr[], const char dir[]);
 
+/* Same as fops_get_bg_ops(), but the operation always uses system calls
+ * regardless of 'syscalls' option, which makes progress reporting possible. */
+ops_t * fops_get_syscalls_bg_ops(OPS main_op, const char descr[],
+		const char dir[]);
+
 /* Checks whether operation should be carried on.  Returns zero if it was
  * cancelled (via Ctrl-C) or aborted (via error dialog option) by the user. */
 int fops_active(const ops_t *ops);
@@ -267,8 +267,10 @@ fops_replace_entry(ops_t *ops, view_t *src, const dir_entry_t *src_entry,
 					ops, /*force=*/0) == 0 && !dst_exists)
 		{
 			/* Update the destination entry to not be fake. */
+			fview_entry_removed(dst, dst_entry);
 			replace_string(&dst_entry->name, src_entry->name);
 			replace_string(&dst_entry->origin, dst_dir);
+			fview_entry_added(dst, dst_entry);
 		}
 	}
 
@@ -353,8 +355,8 @@ fops_cpmv_bg(view_t *view, char *list[], int nlines, int move, int flags)
 	args->ops = fops_get_bg_ops(move ? OP_MOVE : OP_COPY,
 			move ? "moving" : "copying", args->path);
 
-	if(bg_execute(task_desc, "...", args->sel_list_len, 1, &cpmv_files_in_bg,
-				args) != 0)
+	if(bg_execute(task_desc, "...", args->sel_list_len, 1, args->path,
+				&cpmv_files_in_bg, args) != 0)
 	{
 		fops_free_bg_args(args);
 
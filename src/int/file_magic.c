@@ -27,45 +27,108 @@
 #include <magic.h>
 #endif
 
+#include <sys/stat.h> /* stat */
+
 #include <stddef.h> /* size_t */
 #include <stdlib.h> /* free() malloc() */
-#include <stdio.h> /* popen() */
-#include <string.h> /* strdup() */
+#include <stdio.h> /* FILE fclose() fgets() fprintf() popen() remove()
+                      snprintf() */
+#include <string.h> /* memmove() strchr() strcmp() strdup() */
 
 #include "../cfg/config.h"
 #include "../compat/fs_limits.h"
 #include "../compat/os.h"
+#include "../compat/pthread.h"
+#include "../compat/reallocarray.h"
+#include "../ui/ui.h"
 #include "../utils/filemon.h"
+#include "../utils/fs.h"
 #include "../utils/fsddata.h"
+#include "../utils/hmap.h"
 #include "../utils/path.h"
 #include "../utils/str.h"
+#include "../utils/string_array.h"
 #include "../utils/utils.h"
+#include "../background.h"
 #include "../filetype.h"
 #include "../status.h"
 #include "desktop.h"
 
+/* First line of persistent cache, should be changed along with the format. */
+#define FORMAT_ID "vifm-mime-cache 1"
+
+/* Number of files that are processed by background detection before views are
+ * redrawn to display their types. */
+enum { BATCH_SIZE = 32 };
+
+/* Persistent cache is dropped on loading if it has more entries than this. */
+enum { MAX_PERSISTED = 65536 };
+
 /* Cache entry. */
 typedef struct
 {
-	char *mime;        /* Mime-type. */
+	char mime[128];    /* Mime-type or an empty string if detection failed. */
 	filemon_t filemon; /* Timestamp. */
 }
 cache_data_t;
 
+static int lookup_in_cache(const char path[], char buf[], size_t buf_sz);
+static void update_cache(const char path[], const char mimetype[]);
+static void set_in_memory(const char path[], const char mimetype[],
+		const filemon_t *filemon);
 static fsddata_t * get_cache(void);
-static int lookup_in_cache(fsddata_t *cache, const char path[],
-		filemon_t *filemon, cache_data_t **data);
-static void update_cache(fsddata_t *cache, const char path[],
-		const char mimetype[], filemon_t *filemon, cache_data_t *data);
+static hmap_t * get_persisted(void);
+static void load_persisted(hmap_t *persisted);
+static int add_persisted(hmap_t *persisted, const char stamp[],
+		const char mimetype[]);
+static void persist(const char stamp[], const char mimetype[]);
+static int get_file_stamp(const char path[], char buf[], size_t buf_sz);
+static void schedule_detection(const char path[]);
+static void detect_bg(bg_op_t *bg_op, void *arg);
+static int detect_mimetype(const char filename[], char buf[], size_t buf_sz);
 static int get_gtk_mimetype(const char filename[], char buf[], size_t buf_sz);
 static int get_magic_mimetype(const char filename[], char buf[], size_t buf_sz);
 static int get_file_mimetype(const char filename[], char buf[], size_t buf_sz);
 static assoc_records_t get_handlers(const char mime_type[]);
+TSTATIC void file_magic_reset(void);
 #if !defined(_WIN32) && defined(ENABLE_DESKTOP_FILES)
 static void parse_app_dir(const char directory[], const char mime_type[],
 		assoc_records_t *result);
 #endif
 
+/* Protects both in-memory and persistent caches, which are shared with
+ * background detection. */
+static pthread_mutex_t cache_lock = PTHREAD_MUTEX_INITIALIZER;
+/* In-memory cache of mime-types by paths. */
+static fsddata_t *mime_cache;
+/* Mime-types loaded from persistent cache by file stamps. */
+static hmap_t *persisted_cache;
+/* Storage of values of persisted_cache. */
+static char **persisted_types;
+/* Number of elements in persisted_types. */
+static int npersisted_types;
+
+/* Serializes detection, because libmagic's handle can't be used by multiple
+ * threads at the same time. */
+static pthread_mutex_t detect_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Protects the queue and state of background detection. */
+static pthread_mutex_t queue_lock = PTHREAD_MUTEX_INITIALIZER;
+/* Paths waiting for background detection in order of their addition. */
+static char **queue;
+/* Number of elements in the queue. */
+static int queue_len;
+/* Set of paths that are queued or are being processed to not add them
+ * twice. */
+static hmap_t *queued;
+/* Whether background task that empties the queue is running. */
+static int detecting;
+
+/* Whether detection is postponed instead of being performed synchronously. */
+static int defer_detection;
+/* Whether detection of any type was postponed since deferring was enabled. */
+static int detection_postponed;
+
 assoc_records_t
 get_magic_handlers(const char file[])
 {
@@ -86,37 +149,146 @@ get_mimetype(const char file[], int resolve_symlinks)
 		}
 	}
 
-	fsddata_t *mime_cache = get_cache();
+	if(lookup_in_cache(file, mimetype, sizeof(mimetype)))
+	{
+		return (mimetype[0] == '\0' ? NULL : mimetype);
+	}
 
-	filemon_t filemon;
-	cache_data_t *cache_data = NULL;
-	if(lookup_in_cache(mime_cache, file, &filemon, &cache_data))
+	if(defer_detection)
 	{
-		copy_str(mimetype, sizeof(mimetype), cache_data->mime);
-		return mimetype;
+		schedule_detection(file);
+		detection_postponed = 1;
+		return NULL;
 	}
 
-	if(get_gtk_mimetype(file, mimetype, sizeof(mimetype)) == -1)
+	if(detect_mimetype(file, mimetype, sizeof(mimetype)) != 0)
 	{
-		if(get_magic_mimetype(file, mimetype, sizeof(mimetype)) == -1)
+		return NULL;
+	}
+
+	update_cache(file, mimetype);
+	return mimetype;
+}
+
+void
+mimetype_defer_begin(void)
+{
+	defer_detection = 1;
+	detection_postponed = 0;
+}
+
+int
+mimetype_defer_end(void)
+{
+	defer_detection = 0;
+	return detection_postponed;
+}
+
+/* Looks up mime-type of the path in in-memory cache and then in persistent
+ * one.  Empty string in the buffer means that detection has failed.  Returns
+ * non-zero if an up-to-date entry is found, otherwise zero is returned. */
+static int
+lookup_in_cache(const char path[], char buf[], size_t buf_sz)
+{
+	filemon_t filemon;
+	(void)filemon_from_file(path, FMT_MODIFIED, &filemon);
+
+	int found = 0;
+	void *value;
+
+	pthread_mutex_lock(&cache_lock);
+	if(fsddata_get(get_cache(), path, &value) == 0)
+	{
+		const cache_data_t *const data = value;
+		if(filemon_equal(&filemon, &data->filemon))
 		{
-			if(get_file_mimetype(file, mimetype, sizeof(mimetype)) == -1)
-			{
-				return NULL;
-			}
+			copy_str(buf, buf_sz, data->mime);
+			found = 1;
 		}
 	}
+	pthread_mutex_unlock(&cache_lock);
 
-	update_cache(mime_cache, file, mimetype, &filemon, cache_data);
+	if(found || cfg.mime_cache_file[0] == '\0')
+	{
+		return found;
+	}
 
-	return mimetype;
+	char stamp[128];
+	if(get_file_stamp(path, stamp, sizeof(stamp)) != 0)
+	{
+		return 0;
+	}
+
+	pthread_mutex_lock(&cache_lock);
+	if(hmap_get(get_persisted(), stamp, &value) == 0)
+	{
+		copy_str(buf, buf_sz, value);
+		set_in_memory(path, buf, &filemon);
+		found = 1;
+	}
+	pthread_mutex_unlock(&cache_lock);
+
+	return found;
 }
 
-/* Retrieves mime-type cache, creating it on first call.  Returns the cache. */
+/* Updates caches for the path.  Empty mimetype means failed detection, which
+ * isn't persisted. */
+static void
+update_cache(const char path[], const char mimetype[])
+{
+	filemon_t filemon;
+	(void)filemon_from_file(path, FMT_MODIFIED, &filemon);
+
+	char stamp[128];
+	const int persistent = (mimetype[0] != '\0' &&
+			cfg.mime_cache_file[0] != '\0' &&
+			get_file_stamp(path, stamp, sizeof(stamp)) == 0);
+
+	pthread_mutex_lock(&cache_lock);
+	set_in_memory(path, mimetype, &filemon);
+	if(persistent)
+	{
+		persist(stamp, mimetype);
+	}
+	pthread_mutex_unlock(&cache_lock);
+}
+
+/* Updates entry of in-memory cache.  Must be called with cache_lock held. */
+static void
+set_in_memory(const char path[], const char mimetype[],
+		const filemon_t *filemon)
+{
+	fsddata_t *const cache = get_cache();
+
+	void *value;
+	if(fsddata_get(cache, path, &value) == 0)
+	{
+		/* Simply update cache entry in place. */
+		cache_data_t *const data = value;
+		copy_str(data->mime, sizeof(data->mime), mimetype);
+		data->filemon = *filemon;
+		return;
+	}
+
+	cache_data_t *const data = malloc(sizeof(*data));
+	if(data == NULL)
+	{
+		return;
+	}
+
+	copy_str(data->mime, sizeof(data->mime), mimetype);
+	data->filemon = *filemon;
+	if(fsddata_set(cache, path, data) != 0)
+	{
+		free(data);
+	}
+}
+
+/* Retrieves mime-type cache, creating it on first call.  Must be called with
+ * cache_lock held.  Returns the cache. */
 static fsddata_t *
 get_cache(void)
 {
-	static fsddata_t *mime_cache;
 	if(mime_cache == NULL)
 	{
 		mime_cache = fsddata_create(0, 0);
@@ -124,54 +296,255 @@ get_cache(void)
 	return mime_cache;
 }
 
-/* Looks up cache entry for the specified path.  On success, *filemon is
- * initialized from the file.  Returns non-zero if entry is found, otherwise
- * zero is returned. */
+/* Retrieves contents of persistent cache, loading it on first call.  Must be
+ * called with cache_lock held.  Returns the contents, which can be NULL. */
+static hmap_t *
+get_persisted(void)
+{
+	if(persisted_cache == NULL)
+	{
+		persisted_cache = hmap_create();
+		if(persisted_cache != NULL)
+		{
+			load_persisted(persisted_cache);
+		}
+	}
+	return persisted_cache;
+}
+
+/* Reads persistent cache.  Each entry is a line with file stamp and its
+ * mime-type separated by a tab. */
+static void
+load_persisted(hmap_t *persisted)
+{
+	FILE *const fp = os_fopen(cfg.mime_cache_file, "rb");
+	if(fp == NULL)
+	{
+		return;
+	}
+
+	char line[512];
+	if(fgets(line, sizeof(line), fp) == NULL)
+	{
+		fclose(fp);
+		return;
+	}
+
+	chomp(line);
+	if(strcmp(line, FORMAT_ID) != 0)
+	{
+		fclose(fp);
+		(void)remove(cfg.mime_cache_file);
+		return;
+	}
+
+	while(fgets(line, sizeof(line), fp) != NULL)
+	{
+		chomp(line);
+		char *const tab = strchr(line, '\t');
+		if(tab == NULL || tab[1] == '\0')
+		{
+			continue;
+		}
+		*tab = '\0';
+		add_persisted(persisted, line, tab + 1);
+	}
+	fclose(fp);
+
+	if(hmap_size(persisted) > MAX_PERSISTED)
+	{
+		/* Loaded entries are still used, but the file starts over to not grow
+		 * indefinitely with entries of files that have changed. */
+		(void)remove(cfg.mime_cache_file);
+	}
+}
+
+/* Adds an entry to the in-memory copy of persistent cache unless it's already
+ * there.  Returns non-zero if the entry was added, otherwise zero is
+ * returned. */
 static int
-lookup_in_cache(fsddata_t *cache, const char path[], filemon_t *filemon,
-		cache_data_t **data)
+add_persisted(hmap_t *persisted, const char stamp[], const char mimetype[])
 {
-	void *value = NULL;
-	if(fsddata_get(cache, path, &value) == 0)
+	void *value;
+	if(hmap_get(persisted, stamp, &value) == 0)
 	{
-		*data = value;
+		return 0;
+	}
 
-		(void)filemon_from_file(path, FMT_MODIFIED, filemon);
-		return filemon_equal(filemon, &(*data)->filemon);
+	const int len = add_to_string_array(&persisted_types, npersisted_types,
+			mimetype);
+	if(len == npersisted_types)
+	{
+		return 0;
 	}
-	return 0;
+	npersisted_types = len;
+
+	return (hmap_set(persisted, stamp, persisted_types[len - 1]) == 0);
 }
 
-/* Updates cache for the path. */
+/* Adds an entry to persistent cache unless it's already there.  Must be called
+ * with cache_lock held. */
 static void
-update_cache(fsddata_t *cache, const char path[], const char mimetype[],
-		filemon_t *filemon, cache_data_t *data)
+persist(const char stamp[], const char mimetype[])
 {
-	if(data != NULL)
+	hmap_t *const persisted = get_persisted();
+	if(persisted == NULL || !add_persisted(persisted, stamp, mimetype))
+	{
+		return;
+	}
+
+	const int new_file = !path_exists(cfg.mime_cache_file, DEREF);
+	FILE *const fp = os_fopen(cfg.mime_cache_file, "ab");
+	if(fp == NULL)
 	{
-		/* Simply update cache entry in place. */
-		replace_string(&data->mime, mimetype);
-		data->filemon = *filemon;
 		return;
 	}
 
-	(void)filemon_from_file(path, FMT_MODIFIED, filemon);
+	if(new_file)
+	{
+		fprintf(fp, "%s\n", FORMAT_ID);
+	}
+	/* Single write of the whole line, so that concurrent appends by several
+	 * instances don't interleave. */
+	fprintf(fp, "%s\t%s\n", stamp, mimetype);
+	fclose(fp);
+}
 
-	data = malloc(sizeof(*data));
-	if(data == NULL)
+/* Formats state of a file which identifies its contents.  Returns zero on
+ * success, otherwise non-zero is returned. */
+static int
+get_file_stamp(const char path[], char buf[], size_t buf_sz)
+{
+	struct stat st;
+	if(os_stat(path, &st) != 0)
+	{
+		return 1;
+	}
+
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+	const long nsec = st.st_mtim.tv_nsec;
+#else
+	const long nsec = 0;
+#endif
+
+	snprintf(buf, buf_sz, "%llu %llu %lld.%09ld %llu",
+			(unsigned long long)st.st_dev, (unsigned long long)st.st_ino,
+			(long long)st.st_mtime, nsec, (unsigned long long)st.st_size);
+	return 0;
+}
+
+/* Queues the path for background detection starting a task that processes the
+ * queue if there is none. */
+static void
+schedule_detection(const char path[])
+{
+	pthread_mutex_lock(&queue_lock);
+
+	if(queued == NULL)
+	{
+		queued = hmap_create();
+	}
+
+	void *value;
+	if(queued == NULL || hmap_get(queued, path, &value) == 0)
 	{
+		pthread_mutex_unlock(&queue_lock);
 		return;
 	}
 
-	data->filemon = *filemon;
-	data->mime = strdup(mimetype);
-	if(data->mime == NULL)
+	char **const new_queue = reallocarray(queue, queue_len + 1, sizeof(*queue));
+	char *const copy = strdup(path);
+	if(new_queue == NULL || copy == NULL || hmap_set(queued, path, NULL) != 0)
 	{
-		free(data);
+		queue = (new_queue == NULL ? queue : new_queue);
+		free(copy);
+		pthread_mutex_unlock(&queue_lock);
 		return;
 	}
+	queue = new_queue;
+	queue[queue_len++] = copy;
+
+	if(!detecting)
+	{
+		char dir[PATH_MAX + 1];
+		copy_str(dir, sizeof(dir), path);
+		remove_last_path_component(dir);
+
+		detecting = (bg_execute("Detecting mime-types", "...", BG_UNDEFINED_TOTAL,
+					0, dir, &detect_bg, NULL) == 0);
+	}
+
+	pthread_mutex_unlock(&queue_lock);
+}
+
+/* Entry point of background task that detects types of queued files in
+ * batches. */
+static void
+detect_bg(bg_op_t *bg_op, void *arg)
+{
+	for(;;)
+	{
+		char *batch[BATCH_SIZE];
+		int n = 0;
+
+		pthread_mutex_lock(&queue_lock);
+		if(queue_len == 0 || bg_op_cancelled(bg_op))
+		{
+			int i;
+			for(i = 0; i < queue_len; ++i)
+			{
+				(void)hmap_remove(queued, queue[i]);
+				free(queue[i]);
+			}
+			queue_len = 0;
+			detecting = 0;
+			pthread_mutex_unlock(&queue_lock);
+			break;
+		}
+		while(n < BATCH_SIZE && n < queue_len)
+		{
+			batch[n] = queue[n];
+			++n;
+		}
+		queue_len -= n;
+		memmove(queue, queue + n, sizeof(*queue)*queue_len);
+		pthread_mutex_unlock(&queue_lock);
+
+		int i;
+		for(i = 0; i < n; ++i)
+		{
+			char mimetype[128];
+			if(detect_mimetype(batch[i], mimetype, sizeof(mimetype)) != 0)
+			{
+				/* Remember the failure to not retry detection on every redraw. */
+				mimetype[0] = '\0';
+			}
+			update_cache(batch[i], mimetype);
+
+			pthread_mutex_lock(&queue_lock);
+			(void)hmap_remove(queued, batch[i]);
+			pthread_mutex_unlock(&queue_lock);
+			free(batch[i]);
+		}
+
+		/* Redraw the views unconditionally, because checking their location from
+		 * a background thread will cause a data race. */
+		ui_view_schedule_redraw(&lwin);
+		ui_view_schedule_redraw(&rwin);
+	}
+}
 
-	fsddata_set(cache, path, data);
+/* Detects mime-type of a file by trying all available methods.  Returns zero
+ * on success, otherwise non-zero is returned. */
+static int
+detect_mimetype(const char filename[], char buf[], size_t buf_sz)
+{
+	pthread_mutex_lock(&detect_lock);
+	int error = get_gtk_mimetype(filename, buf, buf_sz) != 0
+	         && get_magic_mimetype(filename, buf, buf_sz) != 0
+	         && get_file_mimetype(filename, buf, buf_sz) != 0;
+	pthread_mutex_unlock(&detect_lock);
+	return error;
 }
 
 static int
@@ -321,5 +694,19 @@ parse_app_dir(const char directory[], const char mime_type[],
 }
 #endif
 
+TSTATIC void
+file_magic_reset(void)
+{
+	pthread_mutex_lock(&cache_lock);
+	fsddata_free(mime_cache);
+	mime_cache = NULL;
+	hmap_free(persisted_cache);
+	persisted_cache = NULL;
+	free_string_array(persisted_types, npersisted_types);
+	persisted_types = NULL;
+	npersisted_types = 0;
+	pthread_mutex_unlock(&cache_lock);
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 filetype=c : */
@@ -19,17 +19,32 @@
 #ifndef VIFM__INT__FILE_MAGIC_H__
 #define VIFM__INT__FILE_MAGIC_H__
 
+#include "../utils/test_helpers.h"
 #include "../filetype.h"
 
 /* Retrieves mime type of the file specified by its path.  The resolve_symlinks
  * argument controls whether mime-type of the link should be that of its target.
- * Returns pointer to a statically allocated buffer. */
+ * Detected types are cached in memory and on disk for reuse by later runs.
+ * Returns pointer to a statically allocated buffer or NULL. */
 const char * get_mimetype(const char file[], int resolve_symlinks);
 
+/* Makes get_mimetype() return NULL for files whose types aren't known yet
+ * instead of detecting them.  They are detected in background and views are
+ * redrawn as their types get known. */
+void mimetype_defer_begin(void);
+
+/* Makes get_mimetype() detect types immediately again.  Returns non-zero if
+ * detection of any type was postponed since mimetype_defer_begin(). */
+int mimetype_defer_end(void);
+
 /* Retrieves system-wide desktop file associations.  Caller shouldn't free
  * anything. */
 assoc_records_t get_magic_handlers(const char file[]);
 
+TSTATIC_DEFS(
+	void file_magic_reset(void);
+)
+
 #endif /* VIFM__INT__FILE_MAGIC_H__ */
 
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
@@ -29,6 +29,10 @@
 #ifndef WIN32_PIPE_READ
 # include <sys/types.h>
 # include <sys/select.h> /* FD_* select() */
+# include <sys/socket.h> /* accept() bind() connect() listen() recv() send()
+                            shutdown() */
+# include <sys/time.h> /* gettimeofday() */
+# include <sys/un.h> /* sockaddr_un */
 #else
 # define O_NONBLOCK 0
 # include <windows.h>
@@ -40,19 +44,24 @@
 # endif
 #endif
 
-#include <sys/stat.h> /* mkfifo() stat() */
+#include <sys/stat.h> /* S_ISREG fstat() mkfifo() stat() */
 #include <dirent.h> /* DIR closedir() opendir() readdir() */
 #include <fcntl.h>
 #include <unistd.h> /* close() open() select() unlink() usleep() */
 
-#include <errno.h> /* EACCES EEXIST EDQUOT ENOSPC ENXIO errno */
+#include <errno.h> /* EACCES EAGAIN EEXIST EDQUOT EINTR ENOENT ENOSPC ENXIO
+                      errno */
 #include <stddef.h> /* NULL size_t ssize_t */
-#include <stdio.h> /* FILE fclose() fdopen() fread() fwrite() */
-#include <stdlib.h> /* free() malloc() snprintf() */
-#include <string.h> /* strcmp() strcpy() strlen() */
+#include <stdint.h> /* uint32_t */
+#include <stdio.h> /* FILE fclose() fdopen() fflush() fprintf() fread() ftell()
+                      fwrite() rewind() */
+#include <stdlib.h> /* free() malloc() realloc() snprintf() */
+#include <string.h> /* memcpy() memmove() strchr() strcmp() strcpy() strlen()
+                      strstr() */
 
 #include "compat/fs_limits.h"
 #include "compat/os.h"
+#include "compat/reallocarray.h"
 #include "engine/text_buffer.h"
 #include "utils/fs.h"
 #include "utils/log.h"
@@ -94,11 +103,34 @@
  *
  * On version mismatch or unknown field name, packet is discarded which is
  * logged.
+ *
+ * Packages are delivered in one of two ways.  Originally, each instance creates
+ * a named pipe and replies to "eval" are sent to the pipe of the sender.  On
+ * systems other than Windows, each instance also listens on a Unix-domain
+ * socket and registers itself in a registry file.  A client keeps a single
+ * connection to the last instance it talked to and sends frames over it:
+ *
+ *     uint32_t size, uint32_t id, size bytes of a package
+ *
+ * Replies are sent back over the same connection with the id of the request,
+ * so several requests can be sent without waiting for replies and the server
+ * processes all frames that have arrived at once.  The pipe is used when the
+ * other instance has no socket (e.g., it's of an older version), which keeps
+ * older instances working in both directions.  Servers are listed from the
+ * registry, but the directory with the pipes is still scanned if there are no
+ * live servers in it.
  */
 
 /* Prefix for names of all pipes to distinguish them from other pipes. */
 #define PREFIX "vifm-ipc-"
 
+/* Suffix that turns name of a pipe into name of a socket. */
+#define SOCK_SUFFIX ".sock"
+
+/* Maximum size of a package sent over a socket.  Peer that announces larger
+ * package is disconnected. */
+#define MAX_FRAME_SIZE (16U*1024U*1024U)
+
 #ifndef WIN32_PIPE_READ
 typedef FILE *read_pipe_t;
 #define NULL_READ_PIPE NULL
@@ -117,6 +149,33 @@ typedef struct
 }
 list_data_t;
 
+/* Connection over a socket along with data received over it. */
+typedef struct
+{
+	int fd;     /* Socket of the connection or -1. */
+	char *buf;  /* Received data. */
+	size_t pos; /* Offset of data that wasn't processed yet. */
+	size_t len; /* Length of data in the buffer. */
+	size_t cap; /* Size of the buffer. */
+}
+conn_t;
+
+/* Header of a frame sent over a socket, it's followed by a package. */
+typedef struct
+{
+	uint32_t size; /* Length of the package. */
+	uint32_t id;   /* Id of request the frame belongs to. */
+}
+frame_hdr_t;
+
+/* Specifies where reply to a package should go. */
+typedef struct
+{
+	int fd;      /* Connection to reply over or -1 to send reply to a pipe. */
+	uint32_t id; /* Id of the request. */
+}
+reply_to_t;
+
 /* Storage of data of an instance. */
 struct ipc_t
 {
@@ -132,25 +191,66 @@ struct ipc_t
 	read_pipe_t pipe_file;
 	/* Holds result of expression evaluation or NULL on evaluation error. */
 	char *eval_result;
+
+#ifndef WIN32_PIPE_READ
+	/* Path to the socket of this instance or empty string. */
+	char sock_path[PATH_MAX + 16];
+	/* Listening socket or -1. */
+	int sock;
+	/* Connections accepted on the socket. */
+	conn_t *conns;
+	/* Number of elements in conns. */
+	int nconns;
+	/* Connection to another instance that is reused by requests. */
+	conn_t peer;
+	/* Name of instance the peer connection goes to or NULL. */
+	char *peer_name;
+	/* Id of the last request sent over the peer connection. */
+	uint32_t last_id;
+#endif
 };
 
 static read_pipe_t create_pipe(const char name[], char path_buf[], size_t len);
 static char * receive_pkg(ipc_t *ipc, int *len);
 static read_pipe_t try_use_pipe(const char path[], int *fatal);
-static void handle_pkg(ipc_t *ipc, const char pkg[], const char *end);
+static void handle_pkg(ipc_t *ipc, const char pkg[], const char *end,
+		const reply_to_t *reply_to);
 static void handle_args(ipc_t *ipc, char ***array, int len);
-static void handle_expr(ipc_t *ipc, const char from[], char *array[], int len);
+static void handle_expr(ipc_t *ipc, const char from[], char *array[], int len,
+		const reply_to_t *reply_to);
+static int send_reply(ipc_t *ipc, const char whom[], const reply_to_t *reply_to,
+		char *data[], const char type[]);
 static void handle_eval_result(ipc_t *ipc, char *array[], int len);
 static int format_and_send(ipc_t *ipc, const char whom[], char *data[],
-		const char type[]);
+		const char type[], int *over_socket);
+static vle_textbuf * format_pkg(ipc_t *ipc, char *data[], const char type[]);
 static int send_pkg(ipc_t *ipc, const char whom[], const char what[],
-		size_t len);
+		size_t len, int *over_socket);
 static char * get_the_only_target(const ipc_t *ipc);
 static char ** list_servers(const ipc_t *ipc, int *len);
 static int add_to_list(const char name[], const void *data, void *param);
 static const char * get_ipc_dir(void);
 #ifndef WIN32_PIPE_READ
 static int pipe_is_in_use(const char path[]);
+static int create_socket(ipc_t *ipc);
+static int check_sockets(ipc_t *ipc);
+static void accept_conns(ipc_t *ipc);
+static int handle_frames(ipc_t *ipc, conn_t *conn);
+static int read_conn(conn_t *conn);
+static int take_frame(conn_t *conn, uint32_t *id, const char **pkg,
+		size_t *len);
+static void close_conn(conn_t *conn);
+static int send_over_socket(ipc_t *ipc, const char whom[], const char what[],
+		size_t len);
+static int send_frame(int fd, uint32_t id, const char what[], size_t len);
+static int send_all(int fd, const void *data, size_t len);
+static char * receive_reply(ipc_t *ipc);
+static int connect_to(const char name[]);
+static int is_alive(const char name[]);
+static int get_sock_path(const char name[], char buf[], size_t len);
+static void registry_update(const char name[], int add);
+static int registry_list(list_data_t *data);
+static FILE * registry_open(int for_writing);
 #endif
 
 /* Current version string. */
@@ -195,6 +295,21 @@ ipc_init(const char name[], ipc_args_cb args_cb, ipc_eval_cb eval_cb)
 		return NULL;
 	}
 
+#ifndef WIN32_PIPE_READ
+	ipc->conns = NULL;
+	ipc->nconns = 0;
+	ipc->peer = (conn_t){ .fd = -1 };
+	ipc->peer_name = NULL;
+	ipc->last_id = 0U;
+
+	/* Pipe still works without a socket, so this isn't an error. */
+	ipc->sock = create_socket(ipc);
+	if(ipc->sock != -1)
+	{
+		registry_update(ipc_get_name(ipc), 1);
+	}
+#endif
+
 	return ipc;
 }
 
@@ -207,6 +322,23 @@ ipc_free(ipc_t *ipc)
 	}
 
 #ifndef WIN32_PIPE_READ
+	if(ipc->sock != -1)
+	{
+		registry_update(ipc_get_name(ipc), 0);
+		close(ipc->sock);
+		unlink(ipc->sock_path);
+	}
+
+	int i;
+	for(i = 0; i < ipc->nconns; ++i)
+	{
+		close_conn(&ipc->conns[i]);
+	}
+	free(ipc->conns);
+
+	close_conn(&ipc->peer);
+	free(ipc->peer_name);
+
 	fclose(ipc->pipe_file);
 	unlink(ipc->pipe_path);
 #else
@@ -226,20 +358,26 @@ ipc_check(ipc_t *ipc)
 {
 	int len;
 	char *pkg;
+	int handled = 0;
 
 	if(ipc->locked)
 	{
 		return 0;
 	}
 
+#ifndef WIN32_PIPE_READ
+	handled = check_sockets(ipc);
+#endif
+
 	pkg = receive_pkg(ipc, &len);
 	if(pkg != NULL)
 	{
-		handle_pkg(ipc, pkg, pkg + len);
+		const reply_to_t reply_to = { .fd = -1 };
+		handle_pkg(ipc, pkg, pkg + len, &reply_to);
 		free(pkg);
-		return 1;
+		handled = 1;
 	}
-	return 0;
+	return (handled != 0);
 }
 
 /* Receives message addressed to this instance.  Returns NULL if there was no
@@ -450,9 +588,11 @@ try_use_pipe(const char path[], int *fatal)
 #endif
 }
 
-/* Parses pkg into array of strings and invokes callback. */
+/* Parses pkg into array of strings and invokes callback.  Replies are sent as
+ * specified by reply_to. */
 static void
-handle_pkg(ipc_t *ipc, const char pkg[], const char *end)
+handle_pkg(ipc_t *ipc, const char pkg[], const char *end,
+		const reply_to_t *reply_to)
 {
 	char **array = NULL;
 	size_t len = 0U;
@@ -507,7 +647,7 @@ handle_pkg(ipc_t *ipc, const char pkg[], const char *end)
 	}
 	else if(strcmp(type, EVAL_TYPE) == 0)
 	{
-		handle_expr(ipc, from, array, len);
+		handle_expr(ipc, from, array, len, reply_to);
 	}
 	else if(strcmp(type, EVAL_RESULT_TYPE) == 0)
 	{
@@ -544,7 +684,8 @@ handle_args(ipc_t *ipc, char ***array, int len)
 
 /* Handles received message with expression to evaluate. */
 static void
-handle_expr(ipc_t *ipc, const char from[], char *array[], int len)
+handle_expr(ipc_t *ipc, const char from[], char *array[], int len,
+		const reply_to_t *reply_to)
 {
 	char *result;
 
@@ -560,7 +701,7 @@ handle_expr(ipc_t *ipc, const char from[], char *array[], int len)
 	if(result == NULL)
 	{
 		char *data[] = { NULL };
-		if(format_and_send(ipc, from, data, EVAL_ERROR_TYPE) != 0)
+		if(send_reply(ipc, from, reply_to, data, EVAL_ERROR_TYPE) != 0)
 		{
 			LOG_ERROR_MSG("Failed to report evaluation failure");
 		}
@@ -568,7 +709,7 @@ handle_expr(ipc_t *ipc, const char from[], char *array[], int len)
 	else
 	{
 		char *data[] = { result, NULL };
-		if(format_and_send(ipc, from, data, EVAL_RESULT_TYPE) != 0)
+		if(send_reply(ipc, from, reply_to, data, EVAL_RESULT_TYPE) != 0)
 		{
 			LOG_ERROR_MSG("Failed to report evaluation result");
 		}
@@ -576,6 +717,39 @@ handle_expr(ipc_t *ipc, const char from[], char *array[], int len)
 	}
 }
 
+/* Sends reply to a request either over connection the request came from or to
+ * the pipe of the sender.  The data array should be NULL terminated.  Returns
+ * zero on success and non-zero otherwise. */
+static int
+send_reply(ipc_t *ipc, const char whom[], const reply_to_t *reply_to,
+		char *data[], const char type[])
+{
+#ifndef WIN32_PIPE_READ
+	if(reply_to->fd != -1)
+	{
+		vle_textbuf *pkg = format_pkg(ipc, data, type);
+		if(pkg == NULL)
+		{
+			return 1;
+		}
+
+		const int ret = send_frame(reply_to->fd, reply_to->id,
+				vle_tb_get_data(pkg), vle_tb_get_len(pkg));
+		vle_tb_free(pkg);
+		if(ret != 0)
+		{
+			/* Part of the frame might have been sent, so the stream can't be used
+			 * anymore.  The connection is closed on next read. */
+			(void)shutdown(reply_to->fd, SHUT_RDWR);
+		}
+		return ret;
+	}
+#endif
+
+	int over_socket;
+	return format_and_send(ipc, whom, data, type, &over_socket);
+}
+
 /* Handles answer about successful evaluation of expression. */
 static void
 handle_eval_result(ipc_t *ipc, char *array[], int len)
@@ -590,7 +764,8 @@ handle_eval_result(ipc_t *ipc, char *array[], int len)
 int
 ipc_send(ipc_t *ipc, const char whom[], char *data[])
 {
-	return format_and_send(ipc, whom, data, ARGS_TYPE);
+	int over_socket;
+	return format_and_send(ipc, whom, data, ARGS_TYPE, &over_socket);
 }
 
 char *
@@ -599,13 +774,21 @@ ipc_eval(ipc_t *ipc, const char whom[], const char expr[])
 	enum { MAX_USEC = 1000000, MAX_REPEATS = 20 };
 	int repeats;
 
+	int over_socket;
 	char *data[] = { (char *)expr, NULL };
-	if(format_and_send(ipc, whom, data, EVAL_TYPE) != 0)
+	if(format_and_send(ipc, whom, data, EVAL_TYPE, &over_socket) != 0)
 	{
 		LOG_ERROR_MSG("Failed to send expression");
 		return NULL;
 	}
 
+#ifndef WIN32_PIPE_READ
+	if(over_socket)
+	{
+		return receive_reply(ipc);
+	}
+#endif
+
 	/* Using sleep is just easier than doing read with timeout due to differences
 	 * between platforms... */
 	repeats = 0;
@@ -623,14 +806,47 @@ ipc_eval(ipc_t *ipc, const char whom[], const char expr[])
 }
 
 /* Formats and sends a message of specified type.  The data array should be NULL
- * terminated.  Returns zero on successful send and non-zero otherwise. */
+ * terminated.  *over_socket is set to non-zero if the message was sent over a
+ * socket.  Returns zero on successful send and non-zero otherwise. */
 static int
-format_and_send(ipc_t *ipc, const char whom[], char *data[], const char type[])
+format_and_send(ipc_t *ipc, const char whom[], char *data[], const char type[],
+		int *over_socket)
+{
+	vle_textbuf *pkg = format_pkg(ipc, data, type);
+	if(pkg == NULL)
+	{
+		return 1;
+	}
+
+	char *name = NULL;
+	if(whom == NULL)
+	{
+		name = get_the_only_target(ipc);
+		if(name == NULL)
+		{
+			vle_tb_free(pkg);
+			return 1;
+		}
+		whom = name;
+	}
+
+	int ret = send_pkg(ipc, whom, vle_tb_get_data(pkg), vle_tb_get_len(pkg),
+			over_socket);
+	vle_tb_free(pkg);
+
+	free(name);
+	return ret;
+}
+
+/* Formats a message of specified type.  The data array should be NULL
+ * terminated.  Returns the message or NULL on error. */
+static vle_textbuf *
+format_pkg(ipc_t *ipc, char *data[], const char type[])
 {
 	vle_textbuf *pkg = vle_tb_create();
 	if(pkg == NULL)
 	{
-		return -1;
+		return NULL;
 	}
 
 	/* Compose "header". */
@@ -645,7 +861,7 @@ format_and_send(ipc_t *ipc, const char whom[], char *data[], const char type[])
 		{
 			vle_tb_free(pkg);
 			LOG_ERROR_MSG("Can't get working directory");
-			return 1;
+			return NULL;
 		}
 		vle_tb_appendf(pkg, "%s%c", cwd, '\0');
 	}
@@ -655,30 +871,18 @@ format_and_send(ipc_t *ipc, const char whom[], char *data[], const char type[])
 		vle_tb_appendf(pkg, "%s%c", *data++, '\0');
 	}
 
-	char *name = NULL;
-	if(whom == NULL)
-	{
-		name = get_the_only_target(ipc);
-		if(name == NULL)
-		{
-			vle_tb_free(pkg);
-			return 1;
-		}
-		whom = name;
-	}
-
-	int ret = send_pkg(ipc, whom, vle_tb_get_data(pkg), vle_tb_get_len(pkg));
-	vle_tb_free(pkg);
-
-	free(name);
-	return ret;
+	return pkg;
 }
 
-/* Performs actual sending of package to another instance.  Returns zero on
+/* Performs actual sending of package to another instance.  Socket is preferred
+ * over a pipe, *over_socket is set to non-zero if it was used.  Returns zero on
  * success and non-zero otherwise. */
 static int
-send_pkg(ipc_t *ipc, const char whom[], const char what[], size_t len)
+send_pkg(ipc_t *ipc, const char whom[], const char what[], size_t len,
+		int *over_socket)
 {
+	*over_socket = 0;
+
 	if(stroscmp(ipc_get_name(ipc), whom) == 0)
 	{
 		LOG_SERROR_MSG(errno, "Won't send IPC message to myself");
@@ -686,6 +890,12 @@ send_pkg(ipc_t *ipc, const char whom[], const char what[], size_t len)
 	}
 
 #ifndef WIN32_PIPE_READ
+	if(send_over_socket(ipc, whom, what, len) == 0)
+	{
+		*over_socket = 1;
+		return 0;
+	}
+
 	char path[PATH_MAX + 1];
 	int fd;
 	FILE *dst;
@@ -787,7 +997,9 @@ list_servers(const ipc_t *ipc, int *len)
 	list_data_t data = { .ipc_dir = get_ipc_dir(), .ipc = ipc };
 
 #ifndef WIN32_PIPE_READ
-	if(enum_dir_content(data.ipc_dir, &add_to_list, &data) != 0)
+	/* Fall back to looking for pipes to find instances of older versions. */
+	if(registry_list(&data) != 0 &&
+			enum_dir_content(data.ipc_dir, &add_to_list, &data) != 0)
 	{
 		*len = 0;
 		return NULL;
@@ -895,6 +1107,581 @@ pipe_is_in_use(const char path[])
 	return 0;
 }
 
+/* Starts listening on a socket next to the pipe of the instance.  Returns the
+ * socket or -1 on error. */
+static int
+create_socket(ipc_t *ipc)
+{
+	struct sockaddr_un addr = { .sun_family = AF_UNIX };
+
+	snprintf(ipc->sock_path, sizeof(ipc->sock_path), "%s" SOCK_SUFFIX,
+			ipc->pipe_path);
+	if(strlen(ipc->sock_path) >= sizeof(addr.sun_path))
+	{
+		ipc->sock_path[0] = '\0';
+		return -1;
+	}
+	strcpy(addr.sun_path, ipc->sock_path);
+
+	const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if(fd == -1)
+	{
+		ipc->sock_path[0] = '\0';
+		return -1;
+	}
+
+	/* The pipe is ours, hence socket with the same name is abandoned. */
+	(void)unlink(ipc->sock_path);
+
+	if(bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+			chmod(ipc->sock_path, 0600) != 0 || listen(fd, 64) != 0 ||
+			fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) != 0)
+	{
+		LOG_SERROR_MSG(errno, "Failed to set up socket: %s", ipc->sock_path);
+		close(fd);
+		(void)unlink(ipc->sock_path);
+		ipc->sock_path[0] = '\0';
+		return -1;
+	}
+
+	return fd;
+}
+
+/* Accepts new connections and processes all complete requests that came over
+ * them.  Returns number of processed requests. */
+static int
+check_sockets(ipc_t *ipc)
+{
+	if(ipc->sock == -1)
+	{
+		return 0;
+	}
+
+	accept_conns(ipc);
+
+	int handled = 0;
+	int i;
+	for(i = 0; i < ipc->nconns; ++i)
+	{
+		conn_t *const conn = &ipc->conns[i];
+		const int closed = read_conn(conn);
+		handled += handle_frames(ipc, conn);
+
+		if(closed)
+		{
+			close_conn(conn);
+			ipc->conns[i--] = ipc->conns[--ipc->nconns];
+		}
+	}
+
+	return handled;
+}
+
+/* Accepts all pending connections. */
+static void
+accept_conns(ipc_t *ipc)
+{
+	int fd;
+	while((fd = accept(ipc->sock, NULL, NULL)) != -1)
+	{
+		conn_t *const conns = reallocarray(ipc->conns, ipc->nconns + 1,
+				sizeof(*conns));
+		if(conns == NULL)
+		{
+			close(fd);
+			continue;
+		}
+		ipc->conns = conns;
+
+		/* A client that doesn't read its replies mustn't be able to block us on
+		 * writing, send_all() waits for a limited time instead. */
+		(void)fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+		ipc->conns[ipc->nconns++] = (conn_t){ .fd = fd };
+	}
+}
+
+/* Processes all complete frames received over the connection.  Returns number
+ * of processed frames. */
+static int
+handle_frames(ipc_t *ipc, conn_t *conn)
+{
+	int handled = 0;
+
+	uint32_t id;
+	const char *pkg;
+	size_t len;
+	while(take_frame(conn, &id, &pkg, &len) == 0)
+	{
+		/* Parsing relies on a trailing zero. */
+		char *const copy = malloc(len + 1U);
+		if(copy == NULL)
+		{
+			continue;
+		}
+		memcpy(copy, pkg, len);
+		copy[len] = '\0';
+
+		const reply_to_t reply_to = { .fd = conn->fd, .id = id };
+		handle_pkg(ipc, copy, copy + len, &reply_to);
+		free(copy);
+		++handled;
+	}
+
+	return handled;
+}
+
+/* Reads data that is available on the connection without waiting.  Returns
+ * non-zero if connection was closed or broke, otherwise zero is returned. */
+static int
+read_conn(conn_t *conn)
+{
+	frame_hdr_t hdr;
+
+	if(conn->pos != 0U)
+	{
+		memmove(conn->buf, conn->buf + conn->pos, conn->len - conn->pos);
+		conn->len -= conn->pos;
+		conn->pos = 0U;
+	}
+
+	while(1)
+	{
+		/* Size of the first frame is checked before reading any further and data
+		 * is left in the socket once the first frame of maximum size fits, this
+		 * way a peer can't make us buffer an unlimited amount of data. */
+		if(conn->len >= sizeof(hdr))
+		{
+			memcpy(&hdr, conn->buf, sizeof(hdr));
+			if(hdr.size > MAX_FRAME_SIZE)
+			{
+				LOG_ERROR_MSG("Dropping IPC peer that sent too large frame");
+				return 1;
+			}
+		}
+		if(conn->len >= sizeof(hdr) + MAX_FRAME_SIZE)
+		{
+			return 0;
+		}
+
+		if(conn->cap - conn->len < 4096U)
+		{
+			const size_t cap = MAX(conn->cap*2U, 8192U);
+			char *const buf = realloc(conn->buf, cap);
+			if(buf == NULL)
+			{
+				return 1;
+			}
+			conn->buf = buf;
+			conn->cap = cap;
+		}
+
+		const ssize_t n = recv(conn->fd, conn->buf + conn->len,
+				conn->cap - conn->len, MSG_DONTWAIT);
+		if(n > 0)
+		{
+			conn->len += n;
+			continue;
+		}
+
+		if(n == -1 && errno == EINTR)
+		{
+			continue;
+		}
+		return !(n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK));
+	}
+}
+
+/* Extracts next complete frame from data received over the connection.  *pkg
+ * points into the buffer of the connection and remains valid until the next
+ * read.  Returns zero on success and non-zero if there is no complete frame. */
+static int
+take_frame(conn_t *conn, uint32_t *id, const char **pkg, size_t *len)
+{
+	frame_hdr_t hdr;
+	const size_t avail = conn->len - conn->pos;
+	if(avail < sizeof(hdr))
+	{
+		return 1;
+	}
+
+	memcpy(&hdr, conn->buf + conn->pos, sizeof(hdr));
+	if(avail - sizeof(hdr) < hdr.size)
+	{
+		return 1;
+	}
+
+	*id = hdr.id;
+	*pkg = conn->buf + conn->pos + sizeof(hdr);
+	*len = hdr.size;
+	conn->pos += sizeof(hdr) + hdr.size;
+	return 0;
+}
+
+/* Closes the connection and frees its resources. */
+static void
+close_conn(conn_t *conn)
+{
+	if(conn->fd != -1)
+	{
+		close(conn->fd);
+	}
+	free(conn->buf);
+	*conn = (conn_t){ .fd = -1 };
+}
+
+/* Sends package over persistent connection to another instance establishing it
+ * if necessary.  Returns zero on success and non-zero otherwise. */
+static int
+send_over_socket(ipc_t *ipc, const char whom[], const char what[], size_t len)
+{
+	int reused = (ipc->peer.fd != -1 && strcmp(ipc->peer_name, whom) == 0);
+
+	while(1)
+	{
+		if(!reused)
+		{
+			close_conn(&ipc->peer);
+
+			const int fd = connect_to(whom);
+			if(fd == -1 || replace_string(&ipc->peer_name, whom) != 0)
+			{
+				if(fd != -1)
+				{
+					close(fd);
+				}
+				return 1;
+			}
+			ipc->peer.fd = fd;
+		}
+
+		if(send_frame(ipc->peer.fd, ++ipc->last_id, what, len) == 0)
+		{
+			return 0;
+		}
+
+		close_conn(&ipc->peer);
+		if(!reused)
+		{
+			return 1;
+		}
+
+		/* The other side might have closed the connection, retry once. */
+		reused = 0;
+	}
+}
+
+/* Sends a frame over a connection.  Returns zero on success and non-zero
+ * otherwise. */
+static int
+send_frame(int fd, uint32_t id, const char what[], size_t len)
+{
+	if(len > MAX_FRAME_SIZE)
+	{
+		return 1;
+	}
+
+	const frame_hdr_t hdr = { .size = len, .id = id };
+	return send_all(fd, &hdr, sizeof(hdr)) != 0
+	    || send_all(fd, what, len) != 0;
+}
+
+/* Writes all the data into the socket.  Non-blocking socket is waited on for
+ * at most a second if it's not ready to accept more data.  Returns zero on
+ * success and non-zero otherwise. */
+static int
+send_all(int fd, const void *data, size_t len)
+{
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+	enum { MAX_WAIT_SEC = 1 };
+
+	const char *p = data;
+	while(len != 0U)
+	{
+		const ssize_t n = send(fd, p, len, MSG_NOSIGNAL);
+		if(n == -1)
+		{
+			if(errno == EINTR)
+			{
+				continue;
+			}
+			if(errno != EAGAIN && errno != EWOULDBLOCK)
+			{
+				return 1;
+			}
+
+			fd_set ready;
+			FD_ZERO(&ready);
+			FD_SET(fd, &ready);
+			struct timeval ts = { .tv_sec = MAX_WAIT_SEC };
+			const int nready = select(fd + 1, NULL, &ready, NULL, &ts);
+			if(nready == 0 || (nready < 0 && errno != EINTR))
+			{
+				LOG_ERROR_MSG("Gave up on writing to unresponsive IPC peer");
+				return 1;
+			}
+			continue;
+		}
+		p += n;
+		len -= n;
+	}
+	return 0;
+}
+
+/* Waits for reply to the last request sent over the peer connection.  Replies
+ * to earlier requests that have timed out are skipped.  Returns result of
+ * evaluation or NULL on error. */
+static char *
+receive_reply(ipc_t *ipc)
+{
+	enum { MAX_USEC = 1000000 };
+
+	struct timeval start;
+	gettimeofday(&start, NULL);
+
+	ipc->eval_result = NULL;
+
+	int closed = 0;
+	while(1)
+	{
+		uint32_t id;
+		const char *pkg;
+		size_t len;
+		while(take_frame(&ipc->peer, &id, &pkg, &len) == 0)
+		{
+			if(id == ipc->last_id)
+			{
+				char *const copy = malloc(len + 1U);
+				if(copy == NULL)
+				{
+					return NULL;
+				}
+				memcpy(copy, pkg, len);
+				copy[len] = '\0';
+
+				const reply_to_t reply_to = { .fd = -1 };
+				handle_pkg(ipc, copy, copy + len, &reply_to);
+				free(copy);
+				return ipc->eval_result;
+			}
+		}
+
+		if(closed)
+		{
+			break;
+		}
+
+		struct timeval now;
+		gettimeofday(&now, NULL);
+		const long elapsed = (now.tv_sec - start.tv_sec)*1000000L
+		                   + (now.tv_usec - start.tv_usec);
+		if(elapsed >= MAX_USEC)
+		{
+			break;
+		}
+
+		fd_set ready;
+		FD_ZERO(&ready);
+		FD_SET(ipc->peer.fd, &ready);
+		struct timeval ts = {
+			.tv_sec = (MAX_USEC - elapsed)/1000000L,
+			.tv_usec = (MAX_USEC - elapsed)%1000000L,
+		};
+		if(select(ipc->peer.fd + 1, &ready, NULL, NULL, &ts) < 0 &&
+				errno != EINTR)
+		{
+			break;
+		}
+
+		/* Reply could have arrived right before the connection was closed, so
+		 * look at the data once more in this case. */
+		closed = read_conn(&ipc->peer);
+	}
+
+	LOG_ERROR_MSG("Timed out on waiting for --remote-expr response");
+	close_conn(&ipc->peer);
+	return NULL;
+}
+
+/* Connects to socket of another instance.  Returns connected socket or -1 on
+ * error. */
+static int
+connect_to(const char name[])
+{
+	struct sockaddr_un addr = { .sun_family = AF_UNIX };
+	if(get_sock_path(name, addr.sun_path, sizeof(addr.sun_path)) != 0)
+	{
+		return -1;
+	}
+
+	const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if(fd == -1)
+	{
+		return -1;
+	}
+
+	if(connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0)
+	{
+		close(fd);
+		return -1;
+	}
+
+	return fd;
+}
+
+/* Checks whether an instance is listening on its socket.  Returns non-zero if
+ * so, otherwise zero is returned. */
+static int
+is_alive(const char name[])
+{
+	const int fd = connect_to(name);
+	if(fd == -1)
+	{
+		return 0;
+	}
+	close(fd);
+	return 1;
+}
+
+/* Formats path to socket of an instance.  Returns zero on success and non-zero
+ * if the name is malformed or the path doesn't fit. */
+static int
+get_sock_path(const char name[], char buf[], size_t len)
+{
+	/* Names come from a file and mustn't point outside of the directory. */
+	if(strchr(name, '/') != NULL || strstr(name, "..") != NULL)
+	{
+		return 1;
+	}
+
+	const int n = snprintf(buf, len, "%s/" PREFIX "%s" SOCK_SUFFIX,
+			get_ipc_dir(), name);
+	return (n < 0 || (size_t)n >= len);
+}
+
+/* Adds name to the registry of servers or removes it from there.  Entries of
+ * instances that are gone are dropped along the way. */
+static void
+registry_update(const char name[], int add)
+{
+	FILE *const fp = registry_open(1);
+	if(fp == NULL)
+	{
+		return;
+	}
+
+	int nnames;
+	char **const names = read_file_lines(fp, &nnames);
+
+	rewind(fp);
+
+	int i;
+	for(i = 0; i < nnames; ++i)
+	{
+		if(strcmp(names[i], name) != 0 && is_alive(names[i]))
+		{
+			fprintf(fp, "%s\n", names[i]);
+		}
+	}
+	free_string_array(names, nnames);
+
+	if(add)
+	{
+		fprintf(fp, "%s\n", name);
+	}
+
+	if(fflush(fp) != 0 || ftruncate(fileno(fp), ftell(fp)) != 0)
+	{
+		LOG_SERROR_MSG(errno, "Failed to update registry of servers");
+	}
+	fclose(fp);
+}
+
+/* Lists live servers from the registry.  Returns zero on success and non-zero
+ * if there is no registry or no live servers in it. */
+static int
+registry_list(list_data_t *data)
+{
+	FILE *const fp = registry_open(0);
+	if(fp == NULL)
+	{
+		return 1;
+	}
+
+	int nnames;
+	char **const names = read_file_lines(fp, &nnames);
+	fclose(fp);
+
+	int i;
+	for(i = 0; i < nnames; ++i)
+	{
+		if(data->ipc != NULL && stroscmp(names[i], ipc_get_name(data->ipc)) == 0)
+		{
+			continue;
+		}
+
+		if(!is_in_string_array(data->lst, data->len, names[i]) &&
+				is_alive(names[i]))
+		{
+			data->len = add_to_string_array(&data->lst, data->len, names[i]);
+		}
+	}
+	free_string_array(names, nnames);
+
+	return (data->len == 0U);
+}
+
+/* Opens and locks registry of servers of the current user.  Returns the file or
+ * NULL on error. */
+static FILE *
+registry_open(int for_writing)
+{
+	char path[PATH_MAX + 1];
+	snprintf(path, sizeof(path), "%s/vifm-ipc.%lu.registry", get_ipc_dir(),
+			(unsigned long)getuid());
+
+	/* The directory is shared, so don't follow symbolic links and don't trust
+	 * files created by someone else. */
+	const int flags = O_NOFOLLOW | O_CLOEXEC;
+	const int fd = for_writing ? open(path, O_RDWR | O_CREAT | flags, 0600)
+	                           : open(path, O_RDONLY | flags);
+	if(fd == -1)
+	{
+		return NULL;
+	}
+
+	struct stat st;
+	if(fstat(fd, &st) != 0 || st.st_uid != getuid() || !S_ISREG(st.st_mode) ||
+			(st.st_mode & 0777) != 0600)
+	{
+		LOG_ERROR_MSG("Ignoring suspicious registry of servers: %s", path);
+		close(fd);
+		return NULL;
+	}
+
+	struct flock lock = {
+		.l_type = (for_writing ? F_WRLCK : F_RDLCK),
+		.l_whence = SEEK_SET,
+	};
+	while(fcntl(fd, F_SETLKW, &lock) != 0)
+	{
+		if(errno != EINTR)
+		{
+			close(fd);
+			return NULL;
+		}
+	}
+
+	FILE *const fp = fdopen(fd, for_writing ? "r+" : "r");
+	if(fp == NULL)
+	{
+		close(fd);
+	}
+	return fp;
+}
+
 #endif
 
 #else
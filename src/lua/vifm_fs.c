@@ -18,14 +18,44 @@
 
 #include "vifm_fs.h"
 
-#include <string.h> /* strcmp() */
+#include <assert.h> /* assert() */
+#include <stdlib.h> /* free() malloc() */
+#include <string.h> /* strcmp() strdup() */
 
 #include "../utils/macros.h"
+#include "../utils/path.h"
+#include "../utils/str.h"
+#include "../background.h"
+#include "../fops_common.h"
 #include "../ops.h"
 #include "lua/lauxlib.h"
 #include "lua/lua.h"
 #include "api.h"
 #include "common.h"
+#include "vlua_cbacks.h"
+#include "vlua_state.h"
+
+/* Data of an asynchronous operation which is shared with a worker thread. */
+typedef struct
+{
+	OPS op;           /* Operation to perform. */
+	char *src;        /* Source path. */
+	char *dst;        /* Destination path or NULL. */
+	ops_t *ops;       /* Operation state. */
+	OpsResult result; /* Result of the operation. */
+}
+fs_task_t;
+
+/* User data of VifmFsOp object. */
+typedef struct
+{
+	bg_job_t *job;     /* Link to the native job. */
+	fs_task_t *task;   /* Task while it's not collected or NULL. */
+	int last_progress; /* Progress which was last reported to Lua. */
+	int succeeded;     /* Whether the operation has succeeded. */
+	char *errors;      /* Errors of finished operation or NULL. */
+}
+vifm_fs_op_t;
 
 static int VLUA_API(fs_cp)(lua_State *lua);
 static int VLUA_API(fs_ln)(lua_State *lua);
@@ -34,10 +64,22 @@ static int VLUA_API(fs_mkfile)(lua_State *lua);
 static int VLUA_API(fs_mv)(lua_State *lua);
 static int VLUA_API(fs_rm)(lua_State *lua);
 static int VLUA_API(fs_rmdir)(lua_State *lua);
+static int VLUA_API(fs_startop)(lua_State *lua);
+static int VLUA_API(vifmfsop_gc)(lua_State *lua);
+static int VLUA_API(vifmfsop_cancel)(lua_State *lua);
+static int VLUA_API(vifmfsop_errors)(lua_State *lua);
+static int VLUA_API(vifmfsop_isrunning)(lua_State *lua);
+static int VLUA_API(vifmfsop_progress)(lua_State *lua);
+static int VLUA_API(vifmfsop_succeeded)(lua_State *lua);
 
 static int cp_mv(lua_State *lua, OPS normal_op, OPS force_op, OPS append_op);
 static int perform_fs_op(lua_State *lua, OPS op, const char src[],
 		const char dst[], ConflictResolutionPolicy crp, void *data);
+static void fs_op_bg(bg_op_t *bg_op, void *arg);
+static void fs_op_exit_cb(bg_job_t *job, void *arg);
+static void fs_op_detached_exit_cb(bg_job_t *job, void *arg);
+static int fs_op_collect(vifm_fs_op_t *fs_op);
+static void fs_task_free(fs_task_t *task);
 
 VLUA_DECLARE_SAFE(fs_cp);
 VLUA_DECLARE_SAFE(fs_ln);
@@ -46,6 +88,13 @@ VLUA_DECLARE_SAFE(fs_mkfile);
 VLUA_DECLARE_SAFE(fs_mv);
 VLUA_DECLARE_SAFE(fs_rm);
 VLUA_DECLARE_SAFE(fs_rmdir);
+VLUA_DECLARE_SAFE(fs_startop);
+VLUA_DECLARE_SAFE(vifmfsop_gc);
+VLUA_DECLARE_SAFE(vifmfsop_cancel);
+VLUA_DECLARE_SAFE(vifmfsop_errors);
+VLUA_DECLARE_SAFE(vifmfsop_isrunning);
+VLUA_DECLARE_SAFE(vifmfsop_progress);
+VLUA_DECLARE_SAFE(vifmfsop_succeeded);
 
 /* Named NULL and non-NULL constants for clarity. */
 static void *const no_dst = NULL;
@@ -61,16 +110,111 @@ static const luaL_Reg vifm_fs_methods[] = {
 	{ "mkfile", VLUA_REF(fs_mkfile) },
 	{ "mv",     VLUA_REF(fs_mv)     },
 	{ "rm",     VLUA_REF(fs_rm)     },
-	{ "rmdir",  VLUA_REF(fs_rmdir)  },
-	{ NULL,     NULL                }
+	{ "rmdir",   VLUA_REF(fs_rmdir)   },
+	{ "startop", VLUA_REF(fs_startop) },
+	{ NULL,      NULL                 }
 };
 
+/* Methods of VifmFsOp type. */
+static const luaL_Reg vifmfsop_methods[] = {
+	{ "__gc",      VLUA_REF(vifmfsop_gc)        },
+	{ "cancel",    VLUA_REF(vifmfsop_cancel)    },
+	{ "errors",    VLUA_REF(vifmfsop_errors)    },
+	{ "isrunning", VLUA_REF(vifmfsop_isrunning) },
+	{ "progress",  VLUA_REF(vifmfsop_progress)  },
+	{ "succeeded", VLUA_REF(vifmfsop_succeeded) },
+	{ NULL,        NULL                         }
+};
+
+/*
+ * Address of this variable serves as a key in Lua table which maps jobs of
+ * VifmFsOp instances onto dictionary with such fields:
+ *  - "obj" - vifm_fs_op_t user data
+ *  - "onprogress" - Lua callback to invoke when progress changes
+ *  - "onexit" - Lua callback to invoke when the operation is done
+ */
+static char fs_ops_key;
+
 void
 vifm_fs_init(lua_State *lua)
 {
+	vlua_cmn_make_metatable(lua, "VifmFsOp");
+	luaL_setfuncs(lua, vifmfsop_methods, 0);
+	lua_pop(lua, 1);
+
+	vlua_state_make_table(vlua_state_get(lua), &fs_ops_key);
+
 	luaL_newlib(lua, vifm_fs_methods);
 }
 
+void
+vifm_fs_finish(lua_State *lua)
+{
+	vlua_state_get_table(vlua_state_get(lua), &fs_ops_key);
+	lua_pushnil(lua);
+	while(lua_next(lua, -2) != 0)
+	{
+		lua_pop(lua, 1);
+
+		bg_job_t *job = lua_touserdata(lua, -1);
+		assert(job != NULL && "List of Lua FS operations includes a bad key!");
+
+		lua_pushvalue(lua, -1);
+		lua_gettable(lua, -3);
+		lua_getfield(lua, -1, "obj");
+		vifm_fs_op_t *fs_op = lua_touserdata(lua, -1);
+		assert(fs_op != NULL && "List of Lua FS operations includes bad element!");
+		lua_pop(lua, 2);
+
+		/* The worker thread might still be using the task, so it's freed once the
+		 * job is over instead of by garbage collector of the state. */
+		bg_job_set_exit_cb(job, &fs_op_detached_exit_cb, fs_op->task);
+		fs_op->task = NULL;
+	}
+
+	lua_pop(lua, 1);
+}
+
+void
+vifm_fs_check(lua_State *lua)
+{
+	vlua_t *vlua = vlua_state_get(lua);
+
+	vlua_state_get_table(vlua, &fs_ops_key);
+	lua_pushnil(lua);
+	while(lua_next(lua, -2) != 0)
+	{
+		if(lua_getfield(lua, -1, "onprogress") != LUA_TFUNCTION)
+		{
+			lua_pop(lua, 2);
+			continue;
+		}
+
+		lua_getfield(lua, -2, "obj");
+		vifm_fs_op_t *fs_op = lua_touserdata(lua, -1);
+
+		int progress = fs_op->last_progress;
+		if(bg_op_lock(&fs_op->job->bg_op))
+		{
+			progress = fs_op->job->bg_op.progress;
+			bg_op_unlock(&fs_op->job->bg_op);
+		}
+
+		if(progress != fs_op->last_progress)
+		{
+			fs_op->last_progress = progress;
+			vlua_cbacks_schedule(vlua, /*argc=*/1);
+			lua_pop(lua, 1);
+		}
+		else
+		{
+			lua_pop(lua, 3);
+		}
+	}
+
+	lua_pop(lua, 1);
+}
+
 /* Member of `vifm.fs` that copies a file/directory. */
 static int
 VLUA_API(fs_cp)(lua_State *lua)
@@ -136,6 +280,373 @@ VLUA_API(fs_rmdir)(lua_State *lua)
 	return perform_fs_op(lua, OP_RMDIR, path, no_dst, CRP_SKIP_ALL, no_data);
 }
 
+/* Member of `vifm.fs` that starts a file operation in background.  Returns
+ * VifmFsOp object. */
+static int
+VLUA_API(fs_startop)(lua_State *lua)
+{
+	vlua_t *vlua = vlua_state_get(lua);
+
+	luaL_checktype(lua, 1, LUA_TTABLE);
+
+	vlua_cmn_check_field(lua, 1, "op", LUA_TSTRING);
+	const char *op_name = lua_tostring(lua, -1);
+
+	vlua_cmn_check_field(lua, 1, "from", LUA_TSTRING);
+	const char *src = lua_tostring(lua, -1);
+
+	const char *dst = NULL;
+	if(vlua_cmn_check_opt_field(lua, 1, "to", LUA_TSTRING))
+	{
+		dst = lua_tostring(lua, -1);
+	}
+
+	const char *on_conflict = "fail";
+	if(vlua_cmn_check_opt_field(lua, 1, "onconflict", LUA_TSTRING))
+	{
+		on_conflict = lua_tostring(lua, -1);
+	}
+
+	const char *descr = "Lua FS operation";
+	if(vlua_cmn_check_opt_field(lua, 1, "description", LUA_TSTRING))
+	{
+		descr = lua_tostring(lua, -1);
+	}
+
+	int with_on_progress =
+		vlua_cmn_check_opt_field(lua, 1, "onprogress", LUA_TFUNCTION);
+	int on_progress_idx = lua_gettop(lua);
+	int with_on_exit = vlua_cmn_check_opt_field(lua, 1, "onexit", LUA_TFUNCTION);
+	int on_exit_idx = lua_gettop(lua);
+
+	OPS normal_op, force_op, append_op;
+	if(strcmp(op_name, "cp") == 0)
+	{
+		normal_op = OP_COPY;
+		force_op = OP_COPYF;
+		append_op = OP_COPYA;
+	}
+	else if(strcmp(op_name, "mv") == 0)
+	{
+		normal_op = OP_MOVE;
+		force_op = OP_MOVEF;
+		append_op = OP_MOVEA;
+	}
+	else if(strcmp(op_name, "rm") == 0)
+	{
+		normal_op = force_op = append_op = OP_REMOVESL;
+	}
+	else
+	{
+		return luaL_error(lua, "Unknown `op` value: %s", op_name);
+	}
+
+	if(normal_op != OP_REMOVESL && dst == NULL)
+	{
+		return luaL_error(lua, "%s", "`to` key is mandatory for this operation");
+	}
+
+	OPS op = normal_op;
+	ConflictResolutionPolicy crp = CRP_SKIP_ALL;
+	if(strcmp(on_conflict, "overwrite") == 0)
+	{
+		op = force_op;
+		crp = CRP_OVERWRITE_ALL;
+	}
+	else if(strcmp(on_conflict, "append-tail") == 0)
+	{
+		op = append_op;
+		crp = CRP_OVERWRITE_ALL;
+	}
+	else if(strcmp(on_conflict, "skip") == 0)
+	{
+		op = force_op;
+	}
+	else if(strcmp(on_conflict, "fail") != 0)
+	{
+		return luaL_error(lua, "Unknown `onconflict` value: %s", on_conflict);
+	}
+
+	fs_task_t *task = malloc(sizeof(*task));
+	if(task == NULL)
+	{
+		return luaL_error(lua, "%s", "Failed to allocate memory");
+	}
+
+	char base_dir[PATH_MAX + 1];
+	copy_str(base_dir, sizeof(base_dir), src);
+	remove_last_path_component(base_dir);
+
+	task->op = op;
+	task->src = strdup(src);
+	task->dst = (dst == NULL ? NULL : strdup(dst));
+	task->ops = fops_get_syscalls_bg_ops(op, descr, base_dir);
+	task->result = OPS_FAILED;
+	if(task->src == NULL || (dst != NULL && task->dst == NULL) ||
+			task->ops == NULL)
+	{
+		fs_task_free(task);
+		return luaL_error(lua, "%s", "Failed to allocate memory");
+	}
+
+	/* Overwrite conflict resolution policy to force desired behaviour. */
+	task->ops->crp = crp;
+
+	bg_job_t *job = bg_execute_job(descr, "...", /*total=*/1, /*important=*/1,
+			src, &fs_op_bg, task);
+	if(job == NULL)
+	{
+		fs_task_free(task);
+		return luaL_error(lua, "%s", "Failed to start an operation");
+	}
+
+	vifm_fs_op_t *data = lua_newuserdatauv(lua, sizeof(*data), 0);
+
+	luaL_getmetatable(lua, "VifmFsOp");
+	lua_setmetatable(lua, -2);
+
+	/* Map job onto a table describing it in Lua. */
+	lua_createtable(lua, /*narr=*/0, /*nrec=*/3);
+	lua_pushvalue(lua, -2);
+	lua_setfield(lua, -2, "obj");
+	if(with_on_progress)
+	{
+		lua_pushvalue(lua, on_progress_idx);
+		lua_setfield(lua, -2, "onprogress");
+	}
+	if(with_on_exit)
+	{
+		lua_pushvalue(lua, on_exit_idx);
+		lua_setfield(lua, -2, "onexit");
+	}
+	vlua_state_get_table(vlua, &fs_ops_key);
+	lua_pushlightuserdata(lua, job);
+	lua_pushvalue(lua, -3);
+	lua_settable(lua, -3);
+	lua_pop(lua, 2);
+
+	bg_job_set_exit_cb(job, &fs_op_exit_cb, vlua);
+
+	data->job = job;
+	data->task = task;
+	data->last_progress = -1;
+	data->succeeded = 0;
+	data->errors = NULL;
+	return 1;
+}
+
+/* Performs the operation in a worker thread. */
+static void
+fs_op_bg(bg_op_t *bg_op, void *arg)
+{
+	fs_task_t *task = arg;
+	fops_bg_ops_init(task->ops, bg_op);
+
+	bg_op_set_descr(bg_op, "estimating...");
+	ops_enqueue(task->ops, task->src, task->dst);
+
+	bg_op_set_descr(bg_op, task->src);
+	/* NULL data makes the operation cancellable. */
+	task->result = perform_operation(task->op, task->ops, NULL, task->src,
+			task->dst);
+	++bg_op->done;
+}
+
+/* Handles finishing of an operation by collecting its results and invoking
+ * Lua callback. */
+static void
+fs_op_exit_cb(bg_job_t *job, void *arg)
+{
+	vlua_t *vlua = arg;
+
+	vlua_state_get_table(vlua, &fs_ops_key);
+	lua_pushlightuserdata(vlua->lua, job);
+	if(lua_gettable(vlua->lua, -2) != LUA_TTABLE)
+	{
+		assert(0 && "Finished operation has no associated Lua data!");
+		lua_pop(vlua->lua, 2);
+		return;
+	}
+
+	lua_getfield(vlua->lua, -1, "obj");
+	vifm_fs_op_t *fs_op = lua_touserdata(vlua->lua, -1);
+	assert(fs_op != NULL && "List of Lua FS operations includes bad element!");
+
+	/* Final progress is reported here because the operation won't be seen by
+	 * vifm_fs_check() anymore. */
+	int progress = fs_op->last_progress;
+	if(bg_op_lock(&job->bg_op))
+	{
+		progress = job->bg_op.progress;
+		bg_op_unlock(&job->bg_op);
+	}
+	if(progress != fs_op->last_progress)
+	{
+		fs_op->last_progress = progress;
+		if(lua_getfield(vlua->lua, -2, "onprogress") == LUA_TFUNCTION)
+		{
+			lua_pushvalue(vlua->lua, -2);
+			vlua_cbacks_schedule(vlua, /*argc=*/1);
+		}
+		else
+		{
+			lua_pop(vlua->lua, 1);
+		}
+	}
+	lua_pop(vlua->lua, 1);
+
+	int with_on_exit = (lua_getfield(vlua->lua, -1, "onexit") == LUA_TFUNCTION);
+
+	lua_getfield(vlua->lua, -2, "obj");
+	(void)fs_op_collect(fs_op);
+
+	/* Remove the table entry we've just used. */
+	lua_pushlightuserdata(vlua->lua, job);
+	lua_pushnil(vlua->lua);
+	lua_settable(vlua->lua, -6);
+
+	if(with_on_exit)
+	{
+		vlua_cbacks_schedule(vlua, /*argc=*/1);
+		lua_pop(vlua->lua, 2);
+	}
+	else
+	{
+		lua_pop(vlua->lua, 4);
+	}
+}
+
+/* Handles finishing of an operation which has outlived its Lua state. */
+static void
+fs_op_detached_exit_cb(bg_job_t *job, void *arg)
+{
+	fs_task_free(arg);
+}
+
+/* Collects results of the operation if it's finished.  Returns non-zero if
+ * results are available. */
+static int
+fs_op_collect(vifm_fs_op_t *fs_op)
+{
+	if(fs_op->task == NULL)
+	{
+		return 1;
+	}
+
+	if(bg_job_is_running(fs_op->job))
+	{
+		return 0;
+	}
+
+	fs_task_t *task = fs_op->task;
+	fs_op->succeeded = (task->result != OPS_FAILED && !task->ops->aborted);
+	fs_op->errors = strdup(task->ops->errors == NULL ? "" : task->ops->errors);
+	fs_task_free(task);
+	fs_op->task = NULL;
+	return 1;
+}
+
+/* Frees task data.  The parameter can be NULL. */
+static void
+fs_task_free(fs_task_t *task)
+{
+	if(task != NULL)
+	{
+		fops_free_ops(task->ops);
+		free(task->src);
+		free(task->dst);
+		free(task);
+	}
+}
+
+/* Method of VifmFsOp that frees associated resources.  Doesn't return
+ * anything. */
+static int
+VLUA_API(vifmfsop_gc)(lua_State *lua)
+{
+	vifm_fs_op_t *fs_op = luaL_checkudata(lua, 1, "VifmFsOp");
+	/* Operation is finished by now because the object is referenced from the
+	 * table of active operations until then. */
+	(void)fs_op_collect(fs_op);
+	free(fs_op->errors);
+	bg_job_decref(fs_op->job);
+	return 0;
+}
+
+/* Method of VifmFsOp that requests cancellation of the operation.  Returns
+ * a boolean which is true if the operation wasn't cancelled before. */
+static int
+VLUA_API(vifmfsop_cancel)(lua_State *lua)
+{
+	vifm_fs_op_t *fs_op = luaL_checkudata(lua, 1, "VifmFsOp");
+	lua_pushboolean(lua, bg_job_cancel(fs_op->job));
+	return 1;
+}
+
+/* Method of VifmFsOp that retrieves errors of the operation.  Returns a string
+ * or nil if the operation is still running. */
+static int
+VLUA_API(vifmfsop_errors)(lua_State *lua)
+{
+	vifm_fs_op_t *fs_op = luaL_checkudata(lua, 1, "VifmFsOp");
+	if(!fs_op_collect(fs_op))
+	{
+		lua_pushnil(lua);
+		return 1;
+	}
+
+	lua_pushstring(lua, fs_op->errors);
+	return 1;
+}
+
+/* Method of VifmFsOp that checks whether the operation is still running.
+ * Returns a boolean. */
+static int
+VLUA_API(vifmfsop_isrunning)(lua_State *lua)
+{
+	vifm_fs_op_t *fs_op = luaL_checkudata(lua, 1, "VifmFsOp");
+	lua_pushboolean(lua, bg_job_is_running(fs_op->job));
+	return 1;
+}
+
+/* Method of VifmFsOp that retrieves progress of the operation.  Returns an
+ * integer. */
+static int
+VLUA_API(vifmfsop_progress)(lua_State *lua)
+{
+	vifm_fs_op_t *fs_op = luaL_checkudata(lua, 1, "VifmFsOp");
+
+	int progress = -1;
+	if(fs_op_collect(fs_op))
+	{
+		progress = (fs_op->succeeded ? 100 : fs_op->last_progress);
+	}
+	else if(bg_op_lock(&fs_op->job->bg_op))
+	{
+		progress = fs_op->job->bg_op.progress;
+		bg_op_unlock(&fs_op->job->bg_op);
+	}
+
+	lua_pushinteger(lua, progress);
+	return 1;
+}
+
+/* Method of VifmFsOp that checks whether the operation has succeeded.  Returns
+ * a boolean or nil if the operation is still running. */
+static int
+VLUA_API(vifmfsop_succeeded)(lua_State *lua)
+{
+	vifm_fs_op_t *fs_op = luaL_checkudata(lua, 1, "VifmFsOp");
+	if(!fs_op_collect(fs_op))
+	{
+		lua_pushnil(lua);
+		return 1;
+	}
+
+	lua_pushboolean(lua, fs_op->succeeded);
+	return 1;
+}
+
 /* Common implementation of file copying/moving.  Returns the number of Lua
  * return values. */
 static int
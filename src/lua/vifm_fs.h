@@ -24,6 +24,13 @@ struct lua_State;
 /* Produces `vifm.fs` table.  Puts the table on the top of the stack. */
 void vifm_fs_init(struct lua_State *lua);
 
+/* Detaches unit from background operations that are still running. */
+void vifm_fs_finish(struct lua_State *lua);
+
+/* Schedules progress callbacks of background operations whose progress has
+ * changed. */
+void vifm_fs_check(struct lua_State *lua);
+
 #endif /* VIFM__LUA__VLUA_FS_H__ */
 
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
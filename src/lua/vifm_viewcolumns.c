@@ -18,14 +18,17 @@
 
 #include "vifm_viewcolumns.h"
 
+#include <stdio.h> /* snprintf() */
 #include <stdlib.h> /* free() */
-#include <string.h> /* strdup() */
+#include <string.h> /* strcmp() strdup() */
 
 #include "../compat/fs_limits.h"
+#include "../compat/reallocarray.h"
 #include "../ui/column_view.h"
 #include "../ui/fileview.h"
 #include "../ui/statusbar.h"
 #include "../ui/ui.h"
+#include "../utils/macros.h"
 #include "../utils/str.h"
 #include "../filelist.h"
 #include "../types.h"
@@ -39,6 +42,18 @@
 static int check_viewcolumn_name(vlua_t *vlua, const char name[]);
 static void lua_viewcolumn_handler(void *data, size_t buf_len, char buf[],
 		const format_info_t *info);
+static int is_first_visible(const column_data_t *cdt);
+static void get_entry_key(const dir_entry_t *entry, int width, size_t key_len,
+		char key[], size_t stamp_len, char stamp[]);
+static int lookup_value(lua_State *lua, const char key[], const char stamp[],
+		int consume, column_data_t *cdt, size_t buf_len, char buf[]);
+static int compute_values(state_ptr_t *p, int batch, view_t *view, int first,
+		int count, dir_entry_t *entry, int width);
+static int call_handler(lua_State *lua);
+static void record_value(lua_State *lua, int store, const dir_entry_t *entry,
+		int width);
+static void store_value(lua_State *lua, column_data_t *cdt, size_t buf_len,
+		char buf[]);
 
 /* Minimal ID for columns added by this view. */
 enum { FIRST_LUA_COLUMN_ID = SK_TOTAL };
@@ -122,6 +137,29 @@ vifm_viewcolumns_is_primary(vlua_t *vlua, int column_id)
 	return is_primary;
 }
 
+void
+vifm_viewcolumns_invalidate(vlua_t *vlua)
+{
+	/* Don't need lua_pcall() to handle errors, because no one should be able to
+	 * mess with internal tables. */
+	vlua_state_get_table(vlua, &viewcolumns_key);
+
+	int id;
+	for(id = FIRST_LUA_COLUMN_ID; id < viewcolumn_next_id; ++id)
+	{
+		if(lua_geti(vlua->lua, -1, id) == LUA_TTABLE)
+		{
+			lua_newtable(vlua->lua);
+			lua_setfield(vlua->lua, -2, "cache");
+			lua_newtable(vlua->lua);
+			lua_setfield(vlua->lua, -2, "pending");
+		}
+		lua_pop(vlua->lua, 1);
+	}
+
+	lua_pop(vlua->lua, 1);
+}
+
 int
 VLUA_API(vifm_addcolumntype)(lua_State *lua)
 {
@@ -142,6 +180,18 @@ VLUA_API(vifm_addcolumntype)(lua_State *lua)
 		is_primary = lua_toboolean(vlua->lua, -1);
 	}
 
+	int cacheable = 0;
+	if(vlua_cmn_check_opt_field(lua, 1, "cacheable", LUA_TBOOLEAN))
+	{
+		cacheable = lua_toboolean(vlua->lua, -1);
+	}
+
+	int batch = 0;
+	if(vlua_cmn_check_opt_field(lua, 1, "batch", LUA_TBOOLEAN))
+	{
+		batch = lua_toboolean(vlua->lua, -1);
+	}
+
 	void *data = vlua_state_store_pointer(vlua, handler);
 	if(data == NULL)
 	{
@@ -150,13 +200,21 @@ VLUA_API(vifm_addcolumntype)(lua_State *lua)
 
 	int column_id = viewcolumn_next_id++;
 	vlua_state_get_table(vlua, &viewcolumns_key); /* viewcolumns table */
-	lua_createtable(lua, /*narr=*/0, /*nrec=*/2); /* viewcolumn table */
+	lua_createtable(lua, /*narr=*/0, /*nrec=*/7); /* viewcolumn table */
 	lua_pushinteger(lua, column_id);
 	lua_setfield(lua, -2, "id");
 	lua_pushstring(lua, name);
 	lua_setfield(lua, -2, "name");
 	lua_pushboolean(lua, is_primary);
 	lua_setfield(lua, -2, "isprimary");
+	lua_pushboolean(lua, cacheable);
+	lua_setfield(lua, -2, "cacheable");
+	lua_pushboolean(lua, batch);
+	lua_setfield(lua, -2, "batch");
+	lua_newtable(lua);
+	lua_setfield(lua, -2, "cache");
+	lua_newtable(lua);
+	lua_setfield(lua, -2, "pending");
 	lua_pushvalue(lua, -1);                       /* viewcolumn table */
 	lua_setfield(lua, -3, name);                  /* viewcolumns[name] */
 	lua_seti(lua, -2, column_id);                 /* viewcolumns[id] */
@@ -210,24 +268,260 @@ lua_viewcolumn_handler(void *data, size_t buf_len, char buf[],
 {
 	state_ptr_t *p = data;
 	lua_State *lua = p->vlua->lua;
-
-	vlua_cmn_from_pointer(lua, p->ptr);
-
-	lua_createtable(lua, /*narr=*/0, /*nrec=*/2);
-
-	lua_pushinteger(lua, info->width);
-	lua_setfield(lua, -2, "width");
-
 	column_data_t *cdt = info->data;
-	dir_entry_t *entry = cdt->entry;
-	vifmentry_new(lua, entry);
-	lua_setfield(lua, -2, "entry");
 
 	/* No match highlighting by default. */
 	cdt->custom_match = 1;
 	cdt->match_from = 0;
 	cdt->match_to = 0;
 
+	vlua_state_get_table(p->vlua, &viewcolumns_key);
+	lua_geti(lua, -1, info->id);
+	lua_getfield(lua, -1, "cacheable");
+	const int cacheable = lua_toboolean(lua, -1);
+	lua_getfield(lua, -2, "batch");
+	const int batch = lua_toboolean(lua, -1);
+	lua_pop(lua, 2);
+
+	if(!cacheable && !batch)
+	{
+		lua_pop(lua, 2);
+
+		vlua_cmn_from_pointer(lua, p->ptr);
+		lua_createtable(lua, /*narr=*/0, /*nrec=*/2);
+		lua_pushinteger(lua, info->width);
+		lua_setfield(lua, -2, "width");
+		vifmentry_new(lua, cdt->entry);
+		lua_setfield(lua, -2, "entry");
+
+		if(call_handler(lua))
+		{
+			copy_str(buf, buf_len, "ERROR");
+			return;
+		}
+
+		store_value(lua, cdt, buf_len, buf);
+		return;
+	}
+
+	/* Values of cacheable columns live until file list is reloaded, values of
+	 * other columns are computed per batch and are used only once. */
+	lua_getfield(lua, -1, cacheable ? "cache" : "pending");
+
+	char key[PATH_MAX + 1];
+	char stamp[128];
+	get_entry_key(cdt->entry, info->width, sizeof(key), key, sizeof(stamp),
+			stamp);
+
+	if(lookup_value(lua, key, stamp, !cacheable, cdt, buf_len, buf))
+	{
+		lua_pop(lua, 3);
+		return;
+	}
+
+	view_t *view = cdt->view;
+	int first = -1;
+	int count = 1;
+	if(batch && is_first_visible(cdt))
+	{
+		if(!cacheable)
+		{
+			/* Start a new batch discarding leftovers of the previous one. */
+			lua_pop(lua, 1);
+			lua_newtable(lua);
+			lua_pushvalue(lua, -1);
+			lua_setfield(lua, -3, "pending");
+		}
+
+		first = view->top_line;
+		count = MIN(view->list_rows - view->top_line, MAX(view->window_cells, 1));
+	}
+
+	if(compute_values(p, batch, view, first, count, cdt->entry, info->width))
+	{
+		copy_str(buf, buf_len, "ERROR");
+	}
+	else if(!lookup_value(lua, key, stamp, !cacheable, cdt, buf_len, buf))
+	{
+		copy_str(buf, buf_len, "NOVALUE");
+	}
+
+	lua_pop(lua, 3);
+}
+
+/* Checks whether the cell is the first one in the visible part of the file
+ * list, which is where drawing of a view starts.  Returns non-zero if so. */
+static int
+is_first_visible(const column_data_t *cdt)
+{
+	const view_t *view = cdt->view;
+	return view != NULL
+	    && cdt->line_pos >= 0
+	    && cdt->line_pos == view->top_line
+	    && cdt->line_pos < view->list_rows
+	    && cdt->entry == &view->dir_entry[cdt->line_pos];
+}
+
+/* Forms key of a cached value of an entry and a stamp which is used to detect
+ * whether the entry has changed since the value was computed. */
+static void
+get_entry_key(const dir_entry_t *entry, int width, size_t key_len, char key[],
+		size_t stamp_len, char stamp[])
+{
+	get_full_path_of(entry, key_len, key);
+	snprintf(stamp, stamp_len, "%d:%llu:%lld:%lld:%llu", width,
+			(unsigned long long)entry->inode, (long long)entry->mtime,
+			(long long)entry->ctime, (unsigned long long)entry->size);
+}
+
+/* Looks up cached value in the table at the top of the stack and applies it.
+ * Consumed values are removed from the table.  Returns non-zero if the value
+ * was found. */
+static int
+lookup_value(lua_State *lua, const char key[], const char stamp[], int consume,
+		column_data_t *cdt, size_t buf_len, char buf[])
+{
+	if(lua_getfield(lua, -1, key) != LUA_TTABLE)
+	{
+		lua_pop(lua, 1);
+		return 0;
+	}
+
+	lua_getfield(lua, -1, "stamp");
+	const int up_to_date = (strcmp(lua_tostring(lua, -1), stamp) == 0);
+	lua_pop(lua, 1);
+	if(!up_to_date)
+	{
+		lua_pop(lua, 1);
+		return 0;
+	}
+
+	lua_getfield(lua, -1, "text");
+	copy_str(buf, buf_len, lua_tostring(lua, -1));
+	lua_getfield(lua, -2, "matchfrom");
+	cdt->match_from = lua_tointeger(lua, -1);
+	lua_getfield(lua, -3, "matchto");
+	cdt->match_to = lua_tointeger(lua, -1);
+	lua_pop(lua, 4);
+
+	if(consume)
+	{
+		lua_pushnil(lua);
+		lua_setfield(lua, -2, key);
+	}
+	return 1;
+}
+
+/* Invokes handler for a range of entries of the view or just for the specified
+ * entry (when first is negative) and records results in the table at the top
+ * of the stack.  Returns non-zero on error. */
+static int
+compute_values(state_ptr_t *p, int batch, view_t *view, int first, int count,
+		dir_entry_t *entry, int width)
+{
+	lua_State *lua = p->vlua->lua;
+	const int store = lua_gettop(lua);
+
+	/* Entries for which the handler is invoked. */
+	dir_entry_t **entries = reallocarray(NULL, count, sizeof(*entries));
+	if(entries == NULL)
+	{
+		return 1;
+	}
+
+	int n = 0;
+	int i;
+	for(i = 0; i < count; ++i)
+	{
+		dir_entry_t *e = (first < 0 ? entry : &view->dir_entry[first + i]);
+
+		char key[PATH_MAX + 1];
+		char stamp[128];
+		get_entry_key(e, width, sizeof(key), key, sizeof(stamp), stamp);
+		lua_getfield(lua, store, key);
+		if(lua_istable(lua, -1) && e != entry)
+		{
+			/* Skip entries that already have a value. */
+			lua_getfield(lua, -1, "stamp");
+			const int up_to_date = (strcmp(lua_tostring(lua, -1), stamp) == 0);
+			lua_pop(lua, 2);
+			if(up_to_date)
+			{
+				continue;
+			}
+		}
+		else
+		{
+			lua_pop(lua, 1);
+		}
+
+		entries[n++] = e;
+	}
+
+	if(!batch)
+	{
+		vlua_cmn_from_pointer(lua, p->ptr);
+		lua_createtable(lua, /*narr=*/0, /*nrec=*/2);
+		lua_pushinteger(lua, width);
+		lua_setfield(lua, -2, "width");
+		vifmentry_new(lua, entries[0]);
+		lua_setfield(lua, -2, "entry");
+
+		if(call_handler(lua))
+		{
+			free(entries);
+			return 1;
+		}
+
+		record_value(lua, store, entries[0], width);
+		lua_pop(lua, 1);
+		free(entries);
+		return 0;
+	}
+
+	vlua_cmn_from_pointer(lua, p->ptr);
+	lua_createtable(lua, /*narr=*/0, /*nrec=*/2);
+	lua_pushinteger(lua, width);
+	lua_setfield(lua, -2, "width");
+	lua_createtable(lua, /*narr=*/n, /*nrec=*/0);
+	for(i = 0; i < n; ++i)
+	{
+		vifmentry_new(lua, entries[i]);
+		lua_seti(lua, -2, i + 1);
+	}
+	lua_setfield(lua, -2, "entries");
+
+	if(call_handler(lua))
+	{
+		free(entries);
+		return 1;
+	}
+
+	const int is_table = lua_istable(lua, -1);
+	for(i = 0; i < n; ++i)
+	{
+		if(is_table)
+		{
+			lua_geti(lua, -1, i + 1);
+		}
+		else
+		{
+			lua_pushnil(lua);
+		}
+		record_value(lua, store, entries[i], width);
+		lua_pop(lua, 1);
+	}
+
+	lua_pop(lua, 1);
+	free(entries);
+	return 0;
+}
+
+/* Calls handler and its argument at the top of the stack.  On success leaves
+ * result on the stack.  Returns non-zero on error, which is reported. */
+static int
+call_handler(lua_State *lua)
+{
 	const int sm_cookie = vlua_state_safe_mode_on(lua);
 	if(lua_pcall(lua, 1, 1, 0) != LUA_OK)
 	{
@@ -235,13 +529,45 @@ lua_viewcolumn_handler(void *data, size_t buf_len, char buf[],
 
 		const char *error = lua_tostring(lua, -1);
 		ui_sb_err(error);
-		copy_str(buf, buf_len, "ERROR");
 		lua_pop(lua, 1);
-		return;
+		return 1;
 	}
 
 	vlua_state_safe_mode_off(lua, sm_cookie);
+	return 0;
+}
+
+/* Records result of a handler at the top of the stack in the table at the
+ * specified index. */
+static void
+record_value(lua_State *lua, int store, const dir_entry_t *entry, int width)
+{
+	char key[PATH_MAX + 1];
+	char stamp[128];
+	get_entry_key(entry, width, sizeof(key), key, sizeof(stamp), stamp);
+
+	char text[1024 + 1];
+	column_data_t cdt = { .match_from = 0, .match_to = 0 };
+	lua_pushvalue(lua, -1);
+	store_value(lua, &cdt, sizeof(text), text);
+
+	lua_createtable(lua, /*narr=*/0, /*nrec=*/4);
+	lua_pushstring(lua, text);
+	lua_setfield(lua, -2, "text");
+	lua_pushinteger(lua, cdt.match_from);
+	lua_setfield(lua, -2, "matchfrom");
+	lua_pushinteger(lua, cdt.match_to);
+	lua_setfield(lua, -2, "matchto");
+	lua_pushstring(lua, stamp);
+	lua_setfield(lua, -2, "stamp");
+	lua_setfield(lua, store, key);
+}
 
+/* Converts result of a handler at the top of the stack into cell's value and
+ * match and pops it. */
+static void
+store_value(lua_State *lua, column_data_t *cdt, size_t buf_len, char buf[])
+{
 	if(!lua_istable(lua, -1))
 	{
 		copy_str(buf, buf_len, "NOVALUE");
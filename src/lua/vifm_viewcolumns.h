@@ -41,6 +41,9 @@ char * vifm_viewcolumns_map_back(struct vlua_t *vlua, int id);
  * otherwise zero is returned. */
 int vifm_viewcolumns_is_primary(struct vlua_t *vlua, int column_id);
 
+/* Drops values of view columns computed so far. */
+void vifm_viewcolumns_invalidate(struct vlua_t *vlua);
+
 /* Member of `vifm` that adds a user-defined view column.  Returns a boolean,
  * which is true on success. */
 int VLUA_API(vifm_addcolumntype)(struct lua_State *lua);
@@ -18,12 +18,24 @@
 
 #include "vifmjob.h"
 
+#ifndef _WIN32
+#include <fcntl.h> /* F_GETFL F_SETFL O_NONBLOCK fcntl() */
+#include <unistd.h> /* read() */
+#else
+#include <windows.h>
+#include <io.h> /* _get_osfhandle() read() */
+#endif
+
 #include <assert.h> /* assert() */
-#include <stdio.h> /* fclose() */
-#include <stdlib.h> /* free() */
-#include <string.h> /* strcmp() */
+#include <errno.h> /* EAGAIN EINTR EWOULDBLOCK errno */
+#include <stddef.h> /* size_t */
+#include <stdint.h> /* SIZE_MAX */
+#include <stdio.h> /* fclose() fileno() */
+#include <stdlib.h> /* free() realloc() */
+#include <string.h> /* memchr() memcpy() strcmp() */
 
 #include "../compat/pthread.h"
+#include "../utils/macros.h"
 #include "../utils/str.h"
 #include "../background.h"
 #include "lua/lauxlib.h"
@@ -48,6 +60,12 @@ typedef struct
 	bg_job_t *job;        /* Link to the native job. */
 	job_stream_t *input;  /* Cached input stream or NULL. */
 	job_stream_t *output; /* Cached output stream or NULL. */
+
+	int streaming;        /* Whether output is passed to "onoutput" handler. */
+	int output_eof;       /* Whether end of output was reached. */
+	size_t output_limit;  /* Max number of bytes to read per check. */
+	char *partial;        /* Incomplete last line of output or NULL. */
+	size_t partial_len;   /* Length of the incomplete line. */
 }
 vifm_job_t;
 
@@ -60,6 +78,11 @@ static int VLUA_API(vifmjob_stdout)(lua_State *lua);
 static int VLUA_API(vifmjob_errors)(lua_State *lua);
 static int VLUA_API(vifmjob_terminate)(lua_State *lua);
 static void job_exit_cb(struct bg_job_t *job, void *arg);
+static void job_read_output(vlua_t *vlua, int entry_idx, size_t limit,
+		int blocking);
+static size_t job_split_output(lua_State *lua, vifm_job_t *vifm_job,
+		const char buf[], size_t len, size_t nlines);
+static void set_nonblocking(FILE *stream, int nonblocking);
 static job_stream_t * job_stream_open(lua_State *lua, bg_job_t *job,
 		FILE *stream);
 static void job_stream_close(lua_State *lua, job_stream_t *js);
@@ -91,7 +114,8 @@ static const luaL_Reg vifmjob_methods[] = {
  * Address of this variable serves as a key in Lua table which maps VifmJob
  * instances onto dictionary with such fields:
  *  - "obj" - vifm_job_t user data
- *  - "on_exit" - Lua callback to invoke when the job is done
+ *  - "onexit" - Lua callback to invoke when the job is done
+ *  - "onoutput" - Lua callback to invoke on new lines of output
  */
 static char jobs_key;
 
@@ -122,6 +146,31 @@ vifmjob_finish(lua_State *lua)
 	lua_pop(lua, 1);
 }
 
+void
+vifmjob_check(lua_State *lua)
+{
+	vlua_t *vlua = vlua_state_get(lua);
+
+	vlua_state_get_table(vlua, &jobs_key);
+	lua_pushnil(lua);
+	while(lua_next(lua, -2) != 0)
+	{
+		lua_getfield(lua, -1, "obj");
+		vifm_job_t *vifm_job = lua_touserdata(lua, -1);
+		lua_pop(lua, 1);
+
+		if(vifm_job->streaming)
+		{
+			job_read_output(vlua, lua_gettop(lua), vifm_job->output_limit,
+					/*blocking=*/0);
+		}
+
+		lua_pop(lua, 1);
+	}
+
+	lua_pop(lua, 1);
+}
+
 int
 VLUA_API(vifmjob_new)(lua_State *lua)
 {
@@ -173,6 +222,25 @@ VLUA_API(vifmjob_new)(lua_State *lua)
 	}
 
 	int with_on_exit = vlua_cmn_check_opt_field(lua, 1, "onexit", LUA_TFUNCTION);
+	int on_exit_idx = lua_gettop(lua);
+	int with_on_output =
+		vlua_cmn_check_opt_field(lua, 1, "onoutput", LUA_TFUNCTION);
+	int on_output_idx = lua_gettop(lua);
+
+	if(with_on_output && !(flags & BJF_CAPTURE_OUT))
+	{
+		return luaL_error(lua, "%s", "`onoutput` requires \"r\" I/O mode");
+	}
+
+	lua_Integer output_limit = 64*1024;
+	if(vlua_cmn_check_opt_field(lua, 1, "outputlimit", LUA_TNUMBER))
+	{
+		output_limit = lua_tointeger(lua, -1);
+		if(output_limit <= 0)
+		{
+			return luaL_error(lua, "%s", "`outputlimit` must be positive");
+		}
+	}
 
 	bg_job_t *job = bg_run_external_job(cmd, flags, descr, pwd);
 	if(job == NULL)
@@ -186,14 +254,20 @@ VLUA_API(vifmjob_new)(lua_State *lua)
 	lua_setmetatable(lua, -2);
 
 	/* Map job onto a table describing it in Lua. */
-	lua_createtable(lua, /*narr=*/0, /*nrec=*/(with_on_exit ? 2 : 1));
+	lua_createtable(lua, /*narr=*/0,
+			/*nrec=*/1 + (with_on_exit ? 1 : 0) + (with_on_output ? 1 : 0));
 	lua_pushvalue(lua, -2);
 	lua_setfield(lua, -2, "obj");
 	if(with_on_exit)
 	{
-		lua_pushvalue(lua, -3);
+		lua_pushvalue(lua, on_exit_idx);
 		lua_setfield(lua, -2, "onexit");
 	}
+	if(with_on_output)
+	{
+		lua_pushvalue(lua, on_output_idx);
+		lua_setfield(lua, -2, "onoutput");
+	}
 	vlua_state_get_table(vlua, &jobs_key);
 	lua_pushlightuserdata(lua, job);
 	lua_pushvalue(lua, -3);
@@ -205,6 +279,17 @@ VLUA_API(vifmjob_new)(lua_State *lua)
 	data->job = job;
 	data->input = NULL;
 	data->output = NULL;
+	data->streaming = with_on_output;
+	data->output_eof = 0;
+	data->output_limit = output_limit;
+	data->partial = NULL;
+	data->partial_len = 0;
+
+	if(with_on_output)
+	{
+		set_nonblocking(job->output, 1);
+	}
+
 	return 1;
 }
 
@@ -224,6 +309,9 @@ job_exit_cb(struct bg_job_t *job, void *arg)
 		return;
 	}
 
+	/* The process is gone, but its output might still be in the pipe. */
+	job_read_output(vlua, lua_gettop(vlua->lua), SIZE_MAX, /*blocking=*/0);
+
 	int with_on_exit = (lua_getfield(vlua->lua, -1, "onexit") == LUA_TFUNCTION);
 
 	lua_getfield(vlua->lua, -2, "obj");
@@ -260,6 +348,170 @@ job_exit_cb(struct bg_job_t *job, void *arg)
 	}
 }
 
+/* Reads output of a streaming job whose entry of jobs table is at entry_idx
+ * and schedules "onoutput" handler with an array of complete lines.  Reads no
+ * more than limit bytes.  Blocking reading continues until end of output. */
+static void
+job_read_output(vlua_t *vlua, int entry_idx, size_t limit, int blocking)
+{
+	lua_State *lua = vlua->lua;
+
+	lua_getfield(lua, entry_idx, "obj");
+	vifm_job_t *vifm_job = lua_touserdata(lua, -1);
+	if(!vifm_job->streaming || vifm_job->output_eof)
+	{
+		lua_pop(lua, 1);
+		return;
+	}
+
+	FILE *const output = vifm_job->job->output;
+	const int fd = fileno(output);
+	if(blocking)
+	{
+		set_nonblocking(output, 0);
+	}
+
+	lua_newtable(lua);
+	size_t nlines = 0;
+
+	char buf[8192];
+	while(limit > 0)
+	{
+		size_t to_read = MIN(sizeof(buf), limit);
+
+#ifdef _WIN32
+		if(!blocking)
+		{
+			/* Simulate asynchronous reading by not reading more than pipe has. */
+			HANDLE hpipe = (HANDLE)_get_osfhandle(fd);
+			DWORD bytes_available = 0;
+			if(!PeekNamedPipe(hpipe, NULL, 0, NULL, &bytes_available, NULL))
+			{
+				vifm_job->output_eof = 1;
+				break;
+			}
+			if(bytes_available == 0)
+			{
+				break;
+			}
+			if(bytes_available < to_read)
+			{
+				to_read = bytes_available;
+			}
+		}
+#endif
+
+		const int len = read(fd, buf, to_read);
+		if(len < 0)
+		{
+			if(errno == EINTR)
+			{
+				continue;
+			}
+			if(errno != EAGAIN && errno != EWOULDBLOCK)
+			{
+				vifm_job->output_eof = 1;
+			}
+			break;
+		}
+		if(len == 0)
+		{
+			vifm_job->output_eof = 1;
+			break;
+		}
+
+		nlines = job_split_output(lua, vifm_job, buf, len, nlines);
+		limit -= len;
+	}
+
+	if(vifm_job->output_eof && vifm_job->partial_len != 0)
+	{
+		lua_pushlstring(lua, vifm_job->partial, vifm_job->partial_len);
+		lua_seti(lua, -2, ++nlines);
+		vifm_job->partial_len = 0;
+	}
+
+	if(nlines == 0)
+	{
+		lua_pop(lua, 2);
+		return;
+	}
+
+	/* Stack: obj, lines. */
+	lua_getfield(lua, entry_idx, "onoutput");
+	lua_rotate(lua, -3, 1);
+	vlua_cbacks_schedule(vlua, /*argc=*/2);
+}
+
+/* Appends complete lines from the buffer to the table at the top of the stack
+ * keeping incomplete last line for later.  Returns updated number of lines in
+ * the table. */
+static size_t
+job_split_output(lua_State *lua, vifm_job_t *vifm_job, const char buf[],
+		size_t len, size_t nlines)
+{
+	const char *const end = buf + len;
+	const char *nl;
+	while((nl = memchr(buf, '\n', end - buf)) != NULL)
+	{
+		if(vifm_job->partial_len == 0)
+		{
+			lua_pushlstring(lua, buf, nl - buf);
+		}
+		else
+		{
+			luaL_Buffer line;
+			luaL_buffinit(lua, &line);
+			luaL_addlstring(&line, vifm_job->partial, vifm_job->partial_len);
+			luaL_addlstring(&line, buf, nl - buf);
+			luaL_pushresult(&line);
+			vifm_job->partial_len = 0;
+		}
+		lua_seti(lua, -2, ++nlines);
+		buf = nl + 1;
+	}
+
+	while(buf != end)
+	{
+		if(vifm_job->partial_len == vifm_job->output_limit)
+		{
+			/* Pass on overly long line in pieces to not accumulate it. */
+			lua_pushlstring(lua, vifm_job->partial, vifm_job->partial_len);
+			lua_seti(lua, -2, ++nlines);
+			vifm_job->partial_len = 0;
+		}
+
+		const size_t tail_len = MIN((size_t)(end - buf),
+				vifm_job->output_limit - vifm_job->partial_len);
+		char *partial = realloc(vifm_job->partial,
+				vifm_job->partial_len + tail_len);
+		if(partial == NULL)
+		{
+			break;
+		}
+
+		memcpy(partial + vifm_job->partial_len, buf, tail_len);
+		vifm_job->partial = partial;
+		vifm_job->partial_len += tail_len;
+		buf += tail_len;
+	}
+
+	return nlines;
+}
+
+/* Toggles non-blocking mode of reading from the stream.  Does nothing on
+ * Windows, where reading is performed with the help of PeekNamedPipe(). */
+static void
+set_nonblocking(FILE *stream, int nonblocking)
+{
+#ifndef _WIN32
+	const int fd = fileno(stream);
+	const int flags = fcntl(fd, F_GETFL, 0);
+	fcntl(fd, F_SETFL,
+			nonblocking ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK));
+#endif
+}
+
 /* Method of VifmJob that frees associated resources.  Doesn't return
  * anything. */
 static int
@@ -267,6 +519,7 @@ VLUA_API(vifmjob_gc)(lua_State *lua)
 {
 	vifm_job_t *vifm_job = luaL_checkudata(lua, 1, "VifmJob");
 	bg_job_decref(vifm_job->job);
+	free(vifm_job->partial);
 
 	if(vifm_job->input != NULL)
 	{
@@ -287,6 +540,20 @@ VLUA_API(vifmjob_wait)(lua_State *lua)
 {
 	vifm_job_t *vifm_job = luaL_checkudata(lua, 1, "VifmJob");
 
+	/* Deliver the rest of output of a streaming job, which also prevents the job
+	 * from being blocked on write. */
+	if(vifm_job->streaming && !vifm_job->output_eof)
+	{
+		vlua_t *vlua = vlua_state_get(lua);
+		vlua_state_get_table(vlua, &jobs_key);
+		lua_pushlightuserdata(lua, vifm_job->job);
+		if(lua_gettable(lua, -2) == LUA_TTABLE)
+		{
+			job_read_output(vlua, lua_gettop(lua), SIZE_MAX, /*blocking=*/1);
+		}
+		lua_pop(lua, 2);
+	}
+
 	/* Close input stream to avoid situation when the job is blocked on read. */
 	if(vifm_job->input != NULL)
 	{
@@ -394,6 +661,10 @@ VLUA_API(vifmjob_stdout)(lua_State *lua)
 	{
 		return luaL_error(lua, "%s", "The job has no output stream");
 	}
+	if(vifm_job->streaming)
+	{
+		return luaL_error(lua, "%s", "Output is consumed by `onoutput` handler");
+	}
 
 	/* We return the same Lua object on every call. */
 	if(vifm_job->output == NULL)
@@ -42,6 +42,7 @@
 #include "vifm.h"
 #include "vifm_cmds.h"
 #include "vifm_events.h"
+#include "vifm_fs.h"
 #include "vifm_handlers.h"
 #include "vifm_viewcolumns.h"
 #include "vifmjob.h"
@@ -94,6 +95,7 @@ vlua_finish(vlua_t *vlua)
 	if(vlua != NULL)
 	{
 		vifmjob_finish(vlua->lua);
+		vifm_fs_finish(vlua->lua);
 		vlua_state_free(vlua);
 	}
 }
@@ -420,6 +422,12 @@ vlua_viewcolumn_is_primary(vlua_t *vlua, int column_id)
 	return vifm_viewcolumns_is_primary(vlua, column_id);
 }
 
+void
+vlua_viewcolumns_invalidate(vlua_t *vlua)
+{
+	vifm_viewcolumns_invalidate(vlua);
+}
+
 int
 vlua_handler_cmd(vlua_t *vlua, const char cmd[])
 {
@@ -488,6 +496,8 @@ vlua_edit_list(vlua_t *vlua, const char handler[], char *entries[],
 void
 vlua_process_callbacks(vlua_t *vlua)
 {
+	vifm_fs_check(vlua->lua);
+	vifmjob_check(vlua->lua);
 	vlua_cbacks_process(vlua);
 }
 
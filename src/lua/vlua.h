@@ -70,6 +70,10 @@ char * vlua_viewcolumn_map_back(vlua_t *vlua, int id);
  * Returns non-zero if so, otherwise zero is returned. */
 int vlua_viewcolumn_is_primary(vlua_t *vlua, int column_id);
 
+/* Drops cached values of view columns.  Should be called when file lists are
+ * reloaded. */
+void vlua_viewcolumns_invalidate(vlua_t *vlua);
+
 /* Handlers. */
 
 /* Checks command for a Lua handler.  Returns non-zero if it's present and zero
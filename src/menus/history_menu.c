@@ -116,7 +116,7 @@ show_history(view_t *view, HistoryType type, hist_t *hist, const char title[])
 	int i;
 	for(i = 0; i < hist->size; ++i)
 	{
-		m.len = add_to_string_array(&m.items, m.len, hist->items[i].text);
+		m.len = add_to_string_array(&m.items, m.len, hist_get(hist, i)->text);
 	}
 
 	return menus_enter(&m, view);
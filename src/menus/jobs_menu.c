@@ -184,6 +184,10 @@ format_job_item(bg_job_t *job)
 		snprintf(info_buf, sizeof(info_buf), "%" PRINTF_ULL,
 				(unsigned long long)job->pid);
 	}
+	else if(bg_job_is_queued(job))
+	{
+		snprintf(info_buf, sizeof(info_buf), "queued");
+	}
 	else if(job->bg_op.total == BG_UNDEFINED_TOTAL)
 	{
 		snprintf(info_buf, sizeof(info_buf), "n/a");
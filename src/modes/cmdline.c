@@ -1024,6 +1024,7 @@ static void
 leave_cmdline_mode(int cancelled)
 {
 	free_line_stats(&input_stat);
+	complete_reset_cache();
 
 	if(is_cmdmode(vle_mode_get()))
 	{
@@ -2145,7 +2146,7 @@ hist_next(line_stats_t *stat, const hist_t *hist, size_t len)
 		int len = stat->hist_search_len;
 		while(--pos >= 0)
 		{
-			wchar_t *const buf = to_wide(hist->items[pos].text);
+			wchar_t *const buf = to_wide(hist_get(hist, pos)->text);
 			if(wcsncmp(stat->line, buf, len) == 0)
 			{
 				free(buf);
@@ -2161,7 +2162,7 @@ hist_next(line_stats_t *stat, const hist_t *hist, size_t len)
 		stat->cmd_pos = pos;
 	}
 
-	(void)replace_input_line(stat, hist->items[stat->cmd_pos].text);
+	(void)replace_input_line(stat, hist_get(hist, stat->cmd_pos)->text);
 
 	update_cmdline(stat);
 
@@ -2644,7 +2645,8 @@ next_dot_completion(void)
 	}
 
 	size_t len;
-	const char *last_entry = curr_stats.cmd_hist.items[input_stat.dot_pos++].text;
+	const char *last_entry =
+			hist_get(&curr_stats.cmd_hist, input_stat.dot_pos++)->text;
 	const char *last_arg_pos = vle_cmds_last_arg(last_entry, 1, &len);
 
 	char *last_arg = format_str("%.*s", (int)len, last_arg_pos);
@@ -3084,7 +3086,7 @@ hist_prev(line_stats_t *stat, const hist_t *hist, size_t len)
 		 * changed. */
 		if(stat->cmd_pos == 0 && hist->size != 1)
 		{
-			wchar_t *const wide_item = to_wide(hist->items[0].text);
+			wchar_t *const wide_item = to_wide(hist_get(hist, 0)->text);
 			if(wcscmp(stat->line, wide_item) == 0)
 			{
 				++stat->cmd_pos;
@@ -3098,7 +3100,7 @@ hist_prev(line_stats_t *stat, const hist_t *hist, size_t len)
 		int len = stat->hist_search_len;
 		while(++pos < hist->size)
 		{
-			wchar_t *const wide_item = to_wide(hist->items[pos].text);
+			wchar_t *const wide_item = to_wide(hist_get(hist, pos)->text);
 			if(wcsncmp(stat->line, wide_item, len) == 0)
 			{
 				free(wide_item);
@@ -3111,7 +3113,7 @@ hist_prev(line_stats_t *stat, const hist_t *hist, size_t len)
 		stat->cmd_pos = pos;
 	}
 
-	(void)replace_input_line(stat, hist->items[stat->cmd_pos].text);
+	(void)replace_input_line(stat, hist_get(hist, stat->cmd_pos)->text);
 
 	update_cmdline(stat);
 
@@ -130,8 +130,9 @@ static void init_view_info(modview_info_t *vi);
 static void free_view_info(modview_info_t *vi);
 static void redraw(void);
 static void calc_vlines(void);
-static void calc_vlines_wrapped(modview_info_t *vi);
-static void calc_vlines_non_wrapped(modview_info_t *vi);
+static void calc_vlines_since(modview_info_t *vi, int from);
+static void calc_vlines_wrapped(modview_info_t *vi, int from);
+static void calc_vlines_non_wrapped(modview_info_t *vi, int from);
 static void draw(void);
 static int get_part(const char line[], int offset, size_t max_len, char part[]);
 static void display_error(const char error_msg[]);
@@ -198,6 +199,8 @@ static void update_with_win(key_info_t *key_info);
 static int is_trying_the_same_file(void);
 static int get_file_to_explore(const view_t *view, char buf[], size_t buf_len);
 static int forward_if_changed(modview_info_t *vi);
+static int forward_appended(modview_info_t *vi);
+static int is_builtin_viewer(const modview_info_t *vi);
 static int scroll_to_bottom(modview_info_t *vi);
 static void reload_view(modview_info_t *vi, int silent);
 static void cleanup(modview_info_t *vi);
@@ -619,26 +622,44 @@ calc_vlines(void)
 		return;
 	}
 
-	vi->width = ui_qv_width(vi->view);
-	vi->wrap = cfg.wrap_quick_view;
+	calc_vlines_since(vi, 0);
+}
+
+/* Recalculates virtual lines of a view starting with the specified real line
+ * assuming that data of lines before it is up to date.  Recalculates all lines
+ * if display options have changed. */
+static void
+calc_vlines_since(modview_info_t *vi, int from)
+{
+	if(ui_qv_width(vi->view) != vi->width || vi->wrap != cfg.wrap_quick_view)
+	{
+		vi->width = ui_qv_width(vi->view);
+		vi->wrap = cfg.wrap_quick_view;
+		from = 0;
+	}
 
 	if(vi->wrap)
 	{
-		calc_vlines_wrapped(vi);
+		calc_vlines_wrapped(vi, from);
 	}
 	else
 	{
-		calc_vlines_non_wrapped(vi);
+		calc_vlines_non_wrapped(vi, from);
 	}
 }
 
 /* Recalculates virtual lines of a view with line wrapping. */
 static void
-calc_vlines_wrapped(modview_info_t *vi)
+calc_vlines_wrapped(modview_info_t *vi, int from)
 {
 	int i;
 	vi->nlinesv = 0;
-	for(i = 0; i < vi->nlines; i++)
+	if(from > 0)
+	{
+		vi->nlinesv = vi->widths[from - 1][0] + 1
+		            + vi->widths[from - 1][1]/vi->width;
+	}
+	for(i = from; i < vi->nlines; i++)
 	{
 		vi->widths[i][0] = vi->nlinesv++;
 		vi->widths[i][1] = utf8_strsw_with_tabs(vi->lines[i], cfg.tab_stop) -
@@ -649,11 +670,11 @@ calc_vlines_wrapped(modview_info_t *vi)
 
 /* Recalculates virtual lines of a view without line wrapping. */
 static void
-calc_vlines_non_wrapped(modview_info_t *vi)
+calc_vlines_non_wrapped(modview_info_t *vi, int from)
 {
 	int i;
 	vi->nlinesv = vi->nlines;
-	for(i = 0; i < vi->nlines; i++)
+	for(i = from; i < vi->nlines; i++)
 	{
 		vi->widths[i][0] = i;
 		vi->widths[i][1] = vi->width;
@@ -1743,11 +1764,68 @@ forward_if_changed(modview_info_t *vi)
 		return 0;
 	}
 
+	const int first_forward = !filemon_is_set(&vi->file_mon);
 	vi->file_mon = mon;
+
+	if(!first_forward && forward_appended(vi))
+	{
+		/* Contents has changed even if position remains the same. */
+		(void)scroll_to_bottom(vi);
+		return 1;
+	}
+
 	reload_view(vi, SILENT);
 	return scroll_to_bottom(vi);
 }
 
+/* Updates view with data appended to the file reusing information about lines
+ * that were there before.  Returns non-zero on success, otherwise zero is
+ * returned. */
+static int
+forward_appended(modview_info_t *vi)
+{
+	if(vi->kind != VK_TEXTUAL || !is_builtin_viewer(vi))
+	{
+		return 0;
+	}
+
+	strlist_t lines;
+	const int intact = vcache_extend(vi->filename, INT_MAX, &lines);
+	if(intact < 0)
+	{
+		return 0;
+	}
+
+	if(lines.nitems != vi->nlines && lines.nitems != 0)
+	{
+		int (*widths)[2] = reallocarray(vi->widths, lines.nitems,
+				sizeof(*widths));
+		if(widths == NULL)
+		{
+			/* Fall back to reloading, which will report the error. */
+			return 0;
+		}
+		vi->widths = widths;
+	}
+
+	vi->lines = lines.items;
+	vi->nlines = lines.nitems;
+	calc_vlines_since(vi, intact);
+	return 1;
+}
+
+/* Checks whether contents of the view is produced by reading the file
+ * directly.  Returns non-zero if so, otherwise zero is returned. */
+static int
+is_builtin_viewer(const modview_info_t *vi)
+{
+	if(vi->curr_viewer == vi->ext_viewer)
+	{
+		return (vi->ext_viewer == NULL);
+	}
+	return (vi->raw || vi->curr_viewer == NULL);
+}
+
 /* Scrolls view to the bottom if there is any room for that.  Returns non-zero
  * if position was changed, otherwise zero is returned. */
 static int
@@ -56,6 +56,8 @@
 #include "status.h"
 #include "trash.h"
 #include "types.h"
+#include "vcache.h"
+#include "vcache_disk.h"
 #include "viewcolumns_parser.h"
 
 /* TODO: provide default primitive type based handlers (see *prg_handler). */
@@ -336,6 +338,8 @@ static const char *navoptions_vals[][2] = {
 
 /* Possible values of 'previewoptions'. */
 static const char *previewoptions_vals[][2] = {
+	{ "cachesize:",        "memory limit of preview cache in KiB" },
+	{ "diskcache:",        "disk limit of persistent preview cache in KiB" },
 	{ "graphicsdelay:",    "delay before drawing graphics" },
 	{ "hardgraphicsclear", "redraw screen to get rid of graphics" },
 	{ "maxtreedepth:",     "how many tree levels to display" },
@@ -987,11 +991,13 @@ options[] = {
 
 static int error;
 
+/* Number of times values of options have changed. */
+static int opt_changes;
+
 void
 init_option_handlers(void)
 {
-	static int opt_changed;
-	vle_opts_init(&opt_changed, &uni_handler);
+	vle_opts_init(&opt_changes, &uni_handler);
 	load_options_defaults();
 	add_options();
 }
@@ -1090,6 +1096,12 @@ init_classify(optval_t *val)
 	}
 }
 
+int
+get_option_changes(void)
+{
+	return opt_changes;
+}
+
 const char *
 classify_to_str(void)
 {
@@ -1272,7 +1284,7 @@ init_navoptions(optval_t *val)
 static void
 init_previewoptions(optval_t *val)
 {
-	static char buf[128];
+	static char buf[160];
 
 	size_t len = 0U;
 	buf[0] = '\0';
@@ -1287,14 +1299,32 @@ init_previewoptions(optval_t *val)
 	}
 	if(cfg.max_tree_depth > 0)
 	{
-		snprintf(buf + len, sizeof(buf) - len, "maxtreedepth:%d,",
+		len += snprintf(buf + len, sizeof(buf) - len, "maxtreedepth:%d,",
 				cfg.max_tree_depth);
 	}
 	if(cfg.graphics_delay != 0)
 	{
-		snprintf(buf + len, sizeof(buf) - len, "graphicsdelay:%d,",
+		len += snprintf(buf + len, sizeof(buf) - len, "graphicsdelay:%d,",
 				cfg.graphics_delay);
 	}
+	const size_t cache_size = vcache_get_stats().max_size;
+	if(cache_size != VCACHE_DEF_MAX_SIZE)
+	{
+		len += snprintf(buf + len, sizeof(buf) - len, "cachesize:%d,",
+				(int)(cache_size/1024U));
+	}
+	const size_t disk_cache_size = vcache_disk_get_max_size();
+	if(disk_cache_size != 0U)
+	{
+		len += snprintf(buf + len, sizeof(buf) - len, "diskcache:%d,",
+				(int)(disk_cache_size/1024U));
+	}
+
+	/* Drop trailing comma. */
+	if(len != 0U)
+	{
+		buf[len - 1U] = '\0';
+	}
 
 	val->str_val = buf;
 }
@@ -2576,10 +2606,44 @@ previewoptions_handler(OPT_OP op, optval_t val)
 	int hard_graphics_clear = 0;
 	int top_tree_stats = 0;
 	int max_tree_depth = 0;
+	int cache_size = VCACHE_DEF_MAX_SIZE/1024U;
+	int disk_cache_size = 0;
 
 	while((part = split_and_get(part, ',', &state)) != NULL)
 	{
-		if(starts_with_lit(part, "graphicsdelay:"))
+		if(starts_with_lit(part, "cachesize:"))
+		{
+			const char *const num = after_first(part, ':');
+			if(!read_int(num, &cache_size))
+			{
+				vle_tb_append_linef(vle_err,
+						"Failed to parse \"cachesize\" value: %s", num);
+				break;
+			}
+			if(cache_size < 0)
+			{
+				vle_tb_append_linef(vle_err,
+						"\"cachesize\" can't be negative, got: %s", num);
+				break;
+			}
+		}
+		else if(starts_with_lit(part, "diskcache:"))
+		{
+			const char *const num = after_first(part, ':');
+			if(!read_int(num, &disk_cache_size))
+			{
+				vle_tb_append_linef(vle_err,
+						"Failed to parse \"diskcache\" value: %s", num);
+				break;
+			}
+			if(disk_cache_size < 0)
+			{
+				vle_tb_append_linef(vle_err,
+						"\"diskcache\" can't be negative, got: %s", num);
+				break;
+			}
+		}
+		else if(starts_with_lit(part, "graphicsdelay:"))
 		{
 			const char *const num = after_first(part, ':');
 			if(!read_int(num, &graphics_delay))
@@ -2638,6 +2702,8 @@ previewoptions_handler(OPT_OP op, optval_t val)
 		cfg.hard_graphics_clear = hard_graphics_clear;
 		cfg.top_tree_stats = top_tree_stats;
 		cfg.max_tree_depth = max_tree_depth;
+		vcache_set_max_size((size_t)cache_size*1024U);
+		vcache_disk_set_max_size((size_t)disk_cache_size*1024U);
 
 		if(need_update)
 		{
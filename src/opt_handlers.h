@@ -64,6 +64,10 @@ void load_history_option(void);
 /* Updates geometry related options. */
 void load_geometry(void);
 
+/* Retrieves number which changes every time value of some option changes.
+ * Returns the number. */
+int get_option_changes(void);
+
 /* Formats string with representation of the 'classify' option value.  Returns
  * NULL on error or pointer, which is valid until the next invocation. */
 const char * classify_to_str(void);
@@ -19,7 +19,9 @@
 
 #include "registers.h"
 
+#include <limits.h>   /* CHAR_BIT */
 #include <stddef.h>   /* NULL size_t */
+#include <stdint.h>   /* intptr_t */
 #include <stdio.h>    /* snprintf() */
 #include <string.h>   /* memmove() */
 #include <stdlib.h>   /* free */
@@ -32,6 +34,7 @@
 #include "modes/dialogs/msg_dialog.h" /* show_error_msgf */
 #include "utils/fs.h"
 #include "utils/gmux.h"
+#include "utils/hmap.h"
 #include "utils/macros.h"
 #include "utils/path.h"
 #include "utils/shmem.h"
@@ -66,10 +69,14 @@ const char valid_registers[] = {
  * uppercase registers (virtual ones) + termination null character. */
 ARRAY_GUARD(valid_registers, NUM_REGISTERS + NUM_LETTER_REGISTERS + 1);
 
+/* Each register needs a bit in dirty_regs. */
+typedef int regs_fit_into_mask[
+	(NUM_REGISTERS <= sizeof(unsigned int)*CHAR_BIT) ? 1 : -1];
+
 /* Describes register contents in a shared memory. */
 typedef struct
 {
-	unsigned int generation; /* Generation of the data. */
+	unsigned int generation; /* Generation at which the register was written. */
 	size_t num_entries;      /* Number of file paths in the register. */
 	size_t offset;           /* Offset of the first path. */
 	size_t length_used;      /* Length currently used. */
@@ -88,7 +95,9 @@ typedef struct
 	 * shared_initial and shared_mmap_bytes. */
 	size_t size_backed;
 
-	unsigned int generation; /* Generation of the data. */
+	/* Generation of the data, which is incremented by every write.  Readers
+	 * check it without locking to skip synchronization if nothing changed. */
+	unsigned int generation;
 	size_t length_area_used; /* Length without metadata. */
 
 	reg_metadata_t reg_metadata[NUM_REGISTERS]; /* BLACKHOLE, DEFAULT, a-z */
@@ -160,21 +169,32 @@ static char *shmem_raw;
 static shared_state_t *shmem;
 /* Last generation number that we've seen. */
 static unsigned int seen_generation;
+/* Generations of registers as of their last import or export. */
+static unsigned int seen_reg_generations[NUM_REGISTERS];
+/* Bit mask of registers that were changed locally since last export. */
+static unsigned int dirty_regs;
 /* Whether we're in debug mode. */
 static int debug_print_to_stdout;
 
 static int find_in_reg(const reg_t *reg, const char file[]);
+static void index_path(reg_t *reg, int pos);
+static void reindex_reg(reg_t *reg);
+static void sort_reg(reg_t *reg);
+static const char * get_index_key(const char path[], char buf[], size_t len);
 static reg_t * reg_from_name(int reg_name);
+static void mark_dirty(const reg_t *reg);
 static void regs_sync_error(const char msg[]);
 static int regs_sync_to_shared_memory_critical(void);
 static int regs_sync_enter_critical_section(void);
-static void regs_sync_rewrite_critical(void);
+static void regs_sync_compact_critical(void);
 static size_t regs_sync_store_register_contents_critical(size_t current_offset,
 	size_t reg_id);
 static size_t regs_sync_store_register_contents_in_place(size_t current_offset,
 	size_t reg_id);
 static int regs_sync_resize_allocation(size_t newsz);
 static void regs_sync_leave_critical_section(void);
+static void regs_sync_import_register_critical(size_t reg_id);
+static unsigned int regs_sync_peek_generation(void);
 TSTATIC int regs_sync_enabled(void);
 TSTATIC void regs_sync_debug_print_memory(void);
 static void regs_sync_debug_print_area(size_t offset, size_t length);
@@ -189,6 +209,8 @@ regs_init(void)
 		registers[i].name = valid_registers[i];
 		registers[i].nfiles = 0;
 		registers[i].files = NULL;
+		registers[i].index = NULL;
+		registers[i].sorted = 1;
 	}
 }
 
@@ -201,7 +223,12 @@ regs_exists(int reg_name)
 const reg_t *
 regs_find(int reg_name)
 {
-	return reg_from_name(reg_name);
+	reg_t *const reg = reg_from_name(reg_name);
+	if(reg != NULL)
+	{
+		sort_reg(reg);
+	}
+	return reg;
 }
 
 int
@@ -218,13 +245,13 @@ regs_append(int reg_name, const char file[])
 		return 1;
 	}
 
-	int pos = find_in_reg(reg, file);
-	if(pos >= 0)
+	if(find_in_reg(reg, file) >= 0)
 	{
 		return 1;
 	}
-	pos = -(pos + 1);
 
+	/* Sorting is postponed till the register is queried, this way adding many
+	 * files doesn't shift contents of the register around each time. */
 	const int nfiles = add_to_string_array(&reg->files, reg->nfiles, file);
 	if(nfiles == reg->nfiles)
 	{
@@ -232,10 +259,12 @@ regs_append(int reg_name, const char file[])
 	}
 	reg->nfiles = nfiles;
 
-	char *file_copy = reg->files[nfiles - 1];
-	memmove(reg->files + pos + 1, reg->files + pos,
-			sizeof(*reg->files)*(nfiles - 1 - pos));
-	reg->files[pos] = file_copy;
+	if(nfiles > 1 && stroscmp(reg->files[nfiles - 2], file) > 0)
+	{
+		reg->sorted = 0;
+	}
+	index_path(reg, nfiles - 1);
+	mark_dirty(reg);
 	return 0;
 }
 
@@ -263,25 +292,31 @@ regs_set(int reg_name, char **files, int nfiles)
 	/* Registers are sorted. */
 	safe_qsort(files, nfiles, sizeof(*files), &strossorter);
 
-	/* And don't contain duplicates. */
+	free_string_array(reg->files, reg->nfiles);
+	reg->files = files;
+	reg->nfiles = 0;
+	reg->sorted = 1;
+	if(reg->index != NULL)
+	{
+		hmap_clear(reg->index);
+	}
+
+	/* And don't contain duplicates, which are dropped while indexing. */
 	int i;
-	int j = 1;
-	for(i = 1; i < nfiles; ++i)
+	for(i = 0; i < nfiles; ++i)
 	{
-		if(stroscmp(files[i - 1], files[i]) == 0)
+		if(reg->nfiles > 0 && stroscmp(files[reg->nfiles - 1], files[i]) == 0)
 		{
 			free(files[i]);
 		}
 		else
 		{
-			files[j++] = files[i];
+			files[reg->nfiles] = files[i];
+			index_path(reg, reg->nfiles++);
 		}
 	}
-	nfiles = j;
 
-	free_string_array(reg->files, reg->nfiles);
-	reg->files = files;
-	reg->nfiles = nfiles;
+	mark_dirty(reg);
 }
 
 void
@@ -292,6 +327,13 @@ regs_reset(void)
 	{
 		regs_clear(*p++);
 	}
+
+	int i;
+	for(i = 0; i < NUM_REGISTERS; ++i)
+	{
+		hmap_free(registers[i].index);
+		registers[i].index = NULL;
+	}
 }
 
 void
@@ -306,6 +348,12 @@ regs_clear(int reg_name)
 	free_string_array(reg->files, reg->nfiles);
 	reg->files = NULL;
 	reg->nfiles = 0;
+	reg->sorted = 1;
+	if(reg->index != NULL)
+	{
+		hmap_clear(reg->index);
+	}
+	mark_dirty(reg);
 }
 
 void
@@ -327,6 +375,8 @@ regs_pack(int reg_name)
 		}
 	}
 	reg->nfiles = j;
+	reindex_reg(reg);
+	mark_dirty(reg);
 }
 
 char **
@@ -345,6 +395,7 @@ regs_list(const char registers[])
 			continue;
 		}
 
+		sort_reg(reg);
 		snprintf(reg_str, sizeof(reg_str), "\"%c", reg->name);
 		len = add_to_string_array(&list, len, reg_str);
 
@@ -362,45 +413,141 @@ regs_list(const char registers[])
 void
 regs_rename_contents(const char old[], const char new[])
 {
+	char key[PATH_MAX + 1];
+
 	int i;
 	for(i = 0; i < NUM_REGISTERS; ++i)
 	{
+		reg_t *const reg = &registers[i];
+
 		/* Registers don't contain duplicates, so updating single element is
 		 * enough. */
-		const int pos = find_in_reg(&registers[i], old);
-		if(pos >= 0)
+		const int pos = find_in_reg(reg, old);
+		if(pos < 0)
+		{
+			continue;
+		}
+
+		mark_dirty(reg);
+
+		if(find_in_reg(reg, new) >= 0)
+		{
+			/* Renaming would produce a duplicate. */
+			update_string(&reg->files[pos], NULL);
+			regs_pack(reg->name);
+			continue;
+		}
+
+		if(replace_string(&reg->files[pos], new) != 0)
+		{
+			continue;
+		}
+
+		(void)hmap_remove(reg->index, get_index_key(old, key, sizeof(key)));
+		index_path(reg, pos);
+
+		if((pos > 0 && stroscmp(reg->files[pos - 1], new) > 0) ||
+				(pos < reg->nfiles - 1 && stroscmp(new, reg->files[pos + 1]) > 0))
 		{
-			(void)replace_string(&registers[i].files[pos], new);
+			reg->sorted = 0;
 		}
 	}
 }
 
-/* Finds position of a file in a register or whereto it should be inserted in
- * its files array.  Returns non-negative number of successful search and
- * negative index offset by one otherwise (0 -> -1, 1 -> -2, etc.). */
+/* Finds position of a file in a register.  Returns the position or -1 if
+ * there is no such file. */
 static int
 find_in_reg(const reg_t *reg, const char file[])
 {
-	int l = 0;
-	int u = reg->nfiles - 1;
-	while(l <= u)
+	char key[PATH_MAX + 1];
+	void *data;
+	if(hmap_get(reg->index, get_index_key(file, key, sizeof(key)), &data) != 0)
 	{
-		const int i = l + (u - l)/2;
-		const int cmp = stroscmp(reg->files[i], file);
-		if(cmp == 0)
-		{
-			return i;
-		}
-		else if(cmp < 0)
+		return -1;
+	}
+
+	/* Index might be outdated if entries were set to NULL and the register
+	 * wasn't packed yet. */
+	const int pos = (intptr_t)data;
+	if(pos >= reg->nfiles || reg->files[pos] == NULL ||
+			stroscmp(reg->files[pos], file) != 0)
+	{
+		return -1;
+	}
+	return pos;
+}
+
+/* Adds path at specified position of the register to its index. */
+static void
+index_path(reg_t *reg, int pos)
+{
+	if(reg->index == NULL)
+	{
+		reg->index = hmap_create();
+		if(reg->index == NULL)
 		{
-			l = i + 1;
+			return;
 		}
-		else
+	}
+
+	char key[PATH_MAX + 1];
+	const char *path = reg->files[pos];
+	(void)hmap_set(reg->index, get_index_key(path, key, sizeof(key)),
+			(void *)(intptr_t)pos);
+}
+
+/* Builds index of the register anew. */
+static void
+reindex_reg(reg_t *reg)
+{
+	if(reg->index != NULL)
+	{
+		hmap_clear(reg->index);
+	}
+
+	int i;
+	for(i = 0; i < reg->nfiles; ++i)
+	{
+		if(reg->files[i] != NULL)
 		{
-			u = i - 1;
+			index_path(reg, i);
 		}
 	}
-	return -l - 1;
+}
+
+/* Sorts list of files of the register if it's not sorted. */
+static void
+sort_reg(reg_t *reg)
+{
+	if(reg->sorted)
+	{
+		return;
+	}
+
+	safe_qsort(reg->files, reg->nfiles, sizeof(*reg->files), &strossorter);
+	reg->sorted = 1;
+
+	/* Keys are already there, so this only updates positions. */
+	int i;
+	for(i = 0; i < reg->nfiles; ++i)
+	{
+		index_path(reg, i);
+	}
+}
+
+/* Computes key of the path in register's index, which accounts for
+ * case-sensitivity of the system.  Returns the key. */
+static const char *
+get_index_key(const char path[], char buf[], size_t len)
+{
+#ifndef _WIN32
+	(void)buf;
+	(void)len;
+	return path;
+#else
+	(void)str_to_lower(path, buf, len);
+	return buf;
+#endif
 }
 
 /* Retrieves register structure by register name.  Returns the structure or NULL
@@ -419,6 +566,14 @@ reg_from_name(int reg_name)
 	return NULL;
 }
 
+/* Remembers that contents of the register need to be exported to shared
+ * memory. */
+static void
+mark_dirty(const reg_t *reg)
+{
+	dirty_regs |= 1U << (reg - registers);
+}
+
 void
 regs_remove_trashed_files(const char trash_dir[])
 {
@@ -468,6 +623,9 @@ regs_update_unnamed(int reg_name)
 	{
 		unnamed->files[i] = strdup(reg->files[i]);
 	}
+	unnamed->sorted = reg->sorted;
+	reindex_reg(unnamed);
+	mark_dirty(unnamed);
 }
 
 void
@@ -486,6 +644,7 @@ regs_suggest(regs_suggest_cb cb, int max_entries_per_reg)
 			continue;
 		}
 
+		sort_reg(reg);
 		i = reg->nfiles - 1;
 
 		reg_name[5] = reg->name;
@@ -511,6 +670,10 @@ regs_sync_enable(const char shared_memory_name[])
 	 * the shared_memory_name may have changed. */
 	regs_sync_disable();
 
+	/* Nothing of this shared memory has been seen yet. */
+	seen_generation = 0;
+	memset(seen_reg_generations, 0, sizeof(seen_reg_generations));
+
 	shmem_gmux = gmux_create(use_name);
 	if(shmem_gmux == NULL)
 	{
@@ -542,10 +705,11 @@ regs_sync_enable(const char shared_memory_name[])
 	/* Initialization of just created shared memory area. */
 	if(shmem_created_by_us(shmem_obj))
 	{
-		seen_generation = shmem->generation;
 		shmem->data_is_consistent = 0;
 		shmem->size_backed = shared_initial;
 
+		/* Export everything we have. */
+		dirty_regs = ~0U;
 		if(!regs_sync_to_shared_memory_critical())
 		{
 			shmem_destroy(shmem_obj);
@@ -588,22 +752,33 @@ regs_sync_disable(void)
 void
 regs_sync_to_shared_memory(void)
 {
+	/* Nothing changed locally, so there is nothing to export. */
+	if(dirty_regs == 0)
+	{
+		return;
+	}
+
 	if(regs_sync_enter_critical_section())
 	{
-		regs_sync_to_shared_memory_critical();
-		regs_sync_leave_critical_section();
+		if(regs_sync_to_shared_memory_critical())
+		{
+			regs_sync_leave_critical_section();
+		}
 	}
 }
 
-/* Puts contents of our registers into shared memory.  Returns 1 on success, 0
- * on failure (cleans up as needed on fail). */
+/* Puts contents of registers that were changed locally into shared memory.
+ * Returns 1 on success, 0 on failure (cleans up as needed on fail). */
 static int
 regs_sync_to_shared_memory_critical(void)
 {
 	shmem->data_is_consistent = 0;
-	seen_generation = ++shmem->generation;
 
-	/* Determine memory requirements for state to be synchronized. */
+	const unsigned int prev_generation = shmem->generation;
+	const unsigned int generation = prev_generation + 1;
+
+	/* Determine memory requirements for state to be synchronized.  Registers
+	 * that weren't changed keep their current size. */
 	size_t new_register_sizes_total = 0;
 	size_t new_register_sizes[NUM_REGISTERS];
 
@@ -612,6 +787,16 @@ regs_sync_to_shared_memory_critical(void)
 
 	for(i = 0; i < NUM_REGISTERS; ++i)
 	{
+		if(!(dirty_regs & (1U << i)))
+		{
+			new_register_sizes[i] = shmem->reg_metadata[i].length_used;
+			new_register_sizes_total += new_register_sizes[i];
+			continue;
+		}
+
+		/* Shared memory holds sorted lists. */
+		sort_reg(&registers[i]);
+
 		new_register_sizes[i] = 0;
 		for(j = 0; j < registers[i].nfiles; ++j)
 		{
@@ -621,11 +806,13 @@ regs_sync_to_shared_memory_critical(void)
 		new_register_sizes_total += new_register_sizes[i];
 	}
 
-	/* Check which registers grow over their currently available space. */
+	/* Check which changed registers grow over their currently available
+	 * space. */
 	size_t size_not_fit_to_existing = 0;
 	for(i = 0; i < NUM_REGISTERS; ++i)
 	{
-		if(new_register_sizes[i] > shmem->reg_metadata[i].length_available)
+		if((dirty_regs & (1U << i)) &&
+				new_register_sizes[i] > shmem->reg_metadata[i].length_available)
 		{
 			size_not_fit_to_existing += new_register_sizes[i];
 		}
@@ -638,18 +825,23 @@ regs_sync_to_shared_memory_critical(void)
 		if(new_register_sizes_total < (halved_size - SHARED_ALL_METADATA_SIZE)
 				&& shmem->size_backed > shared_initial)
 		{
-			/* Halve allocation size. */
+			/* Halve allocation size after moving data out of the way. */
+			regs_sync_compact_critical();
 			if(!regs_sync_resize_allocation(halved_size))
 			{
 				return 0;
 			}
-			regs_sync_rewrite_critical();
 		}
 		else
 		{
 			size_t offset = SHARED_ALL_METADATA_SIZE + shmem->length_area_used;
 			for(i = 0; i < NUM_REGISTERS; ++i)
 			{
+				if(!(dirty_regs & (1U << i)))
+				{
+					continue;
+				}
+
 				if(new_register_sizes[i] >
 						shmem->reg_metadata[i].length_available)
 				{
@@ -680,9 +872,29 @@ regs_sync_to_shared_memory_critical(void)
 			return 0;
 		}
 
-		regs_sync_rewrite_critical();
+		regs_sync_compact_critical();
+	}
+
+	for(i = 0; i < NUM_REGISTERS; ++i)
+	{
+		if(dirty_regs & (1U << i))
+		{
+			shmem->reg_metadata[i].generation = generation;
+			seen_reg_generations[i] = generation;
+		}
+	}
+	dirty_regs = 0;
+
+	/* Changes of others made since our last import must not be skipped. */
+	if(seen_generation == prev_generation)
+	{
+		seen_generation = generation;
 	}
 
+	/* Publish new generation only after all of the data is in place. */
+	__sync_synchronize();
+	shmem->generation = generation;
+
 	return 1;
 }
 
@@ -706,17 +918,52 @@ regs_sync_enter_critical_section(void)
 	return 1;
 }
 
-/* Rewrites shared memory from scratch. */
+/* Moves contents of unchanged registers to the beginning of shared memory
+ * followed by contents of changed ones, which leaves no gaps. */
 static void
-regs_sync_rewrite_critical(void)
+regs_sync_compact_critical(void)
 {
-	/* Assumption: enough space in shared memory. */
-	size_t offset = SHARED_ALL_METADATA_SIZE;
+	int order[NUM_REGISTERS];
+	int n = 0;
 	int i;
+
+	/* Sort unchanged registers by offset, so that moving each of them to a lower
+	 * address doesn't overwrite data of the following ones. */
+	for(i = 0; i < NUM_REGISTERS; ++i)
+	{
+		if(dirty_regs & (1U << i))
+		{
+			continue;
+		}
+
+		int j = n++;
+		while(j > 0 && shmem->reg_metadata[order[j - 1]].offset >
+				shmem->reg_metadata[i].offset)
+		{
+			order[j] = order[j - 1];
+			--j;
+		}
+		order[j] = i;
+	}
+
+	size_t offset = SHARED_ALL_METADATA_SIZE;
+	for(i = 0; i < n; ++i)
+	{
+		reg_metadata_t *const meta = &shmem->reg_metadata[order[i]];
+		memmove(shmem_raw + offset, shmem_raw + meta->offset, meta->length_used);
+		meta->offset = offset;
+		meta->length_available = meta->length_used;
+		offset += meta->length_used;
+	}
+
 	for(i = 0; i < NUM_REGISTERS; ++i)
 	{
-		offset = regs_sync_store_register_contents_critical(offset, i);
+		if(dirty_regs & (1U << i))
+		{
+			offset = regs_sync_store_register_contents_critical(offset, i);
+		}
 	}
+
 	shmem->length_area_used = offset - SHARED_ALL_METADATA_SIZE;
 }
 
@@ -738,7 +985,6 @@ static size_t
 regs_sync_store_register_contents_in_place(size_t current_offset, size_t reg_id)
 {
 	int i;
-	shmem->reg_metadata[reg_id].generation  = seen_generation;
 	shmem->reg_metadata[reg_id].num_entries = registers[reg_id].nfiles;
 	shmem->reg_metadata[reg_id].offset      = current_offset;
 	for(i = 0; i < registers[reg_id].nfiles; ++i)
@@ -782,6 +1028,18 @@ regs_sync_leave_critical_section(void)
 void
 regs_sync_from_shared_memory(void)
 {
+	if(!regs_sync_enabled())
+	{
+		return;
+	}
+
+	/* Most of the time nothing has changed, which doesn't need a lock to
+	 * find out. */
+	if(regs_sync_peek_generation() == seen_generation)
+	{
+		return;
+	}
+
 	if(!regs_sync_enter_critical_section())
 	{
 		return;
@@ -794,23 +1052,9 @@ regs_sync_from_shared_memory(void)
 		int i;
 		for(i = 0; i < NUM_REGISTERS; ++i)
 		{
-			if(shmem->reg_metadata[i].generation != seen_generation)
+			if(shmem->reg_metadata[i].generation != seen_reg_generations[i])
 			{
-				free_string_array(registers[i].files, registers[i].nfiles);
-
-				registers[i].nfiles = shmem->reg_metadata[i].num_entries;
-				registers[i].files = reallocarray(NULL, registers[i].nfiles,
-						sizeof(char *));
-
-				int j;
-				const char *curstrptr = shmem_raw + shmem->reg_metadata[i].offset;
-				for(j = 0; j < registers[i].nfiles; ++j)
-				{
-					size_t curlen = strlen(curstrptr) + 1;
-					registers[i].files[j] = malloc(curlen);
-					memcpy(registers[i].files[j], curstrptr, curlen);
-					curstrptr += curlen;
-				}
+				regs_sync_import_register_critical(i);
 			}
 		}
 		seen_generation = shmem->generation;
@@ -819,6 +1063,43 @@ regs_sync_from_shared_memory(void)
 	regs_sync_leave_critical_section();
 }
 
+/* Replaces contents of a register with its copy from shared memory. */
+static void
+regs_sync_import_register_critical(size_t reg_id)
+{
+	reg_t *const reg = &registers[reg_id];
+	const reg_metadata_t *const meta = &shmem->reg_metadata[reg_id];
+
+	free_string_array(reg->files, reg->nfiles);
+
+	reg->nfiles = meta->num_entries;
+	reg->files = reallocarray(NULL, reg->nfiles, sizeof(char *));
+
+	int i;
+	const char *curstrptr = shmem_raw + meta->offset;
+	for(i = 0; i < reg->nfiles; ++i)
+	{
+		size_t curlen = strlen(curstrptr) + 1;
+		reg->files[i] = malloc(curlen);
+		memcpy(reg->files[i], curstrptr, curlen);
+		curstrptr += curlen;
+	}
+	reg->sorted = 1;
+	reindex_reg(reg);
+
+	seen_reg_generations[reg_id] = meta->generation;
+	/* Imported contents overrule local changes. */
+	dirty_regs &= ~(1U << reg_id);
+}
+
+/* Reads generation of shared data without locking.  Returns the generation. */
+static unsigned int
+regs_sync_peek_generation(void)
+{
+	__sync_synchronize();
+	return *(volatile unsigned int *)&shmem->generation;
+}
+
 TSTATIC int
 regs_sync_enabled(void)
 {
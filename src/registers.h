@@ -30,13 +30,19 @@
 /* Name of the "black hole" register. */
 #define BLACKHOLE_REG_NAME '_'
 
+struct hmap_t;
+
 /* Holds register data. */
 typedef struct reg_t
 {
 	int name;     /* Name of the register. */
 	int nfiles;   /* Number of files in the register. */
-	char **files; /* List of full canonicalized paths that is sorted and
-	                 deduplicated according to case-sensitivity of the system. */
+	char **files; /* List of full canonicalized paths that is deduplicated
+	                 according to case-sensitivity of the system and sorted in
+	                 the same way when obtained via regs_find(). */
+
+	struct hmap_t *index; /* Maps paths to their positions in files. */
+	int sorted;           /* Whether files are known to be sorted. */
 }
 reg_t;
 
@@ -54,8 +60,8 @@ void regs_init(void);
  * Returns non-zero if it exists, otherwise zero is returned. */
 int regs_exists(int reg_name);
 
-/* Retrieves register structure by register name.  Returns the structure or NULL
- * if register name is incorrect. */
+/* Retrieves register structure by register name with its list of files
+ * sorted.  Returns the structure or NULL if register name is incorrect. */
 const reg_t * regs_find(int reg_name);
 
 /* Appends path to the file to register specified by name.  Might fail for
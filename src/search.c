@@ -22,16 +22,22 @@
 #include <regex.h> /* regmatch_t regexec() regfree() */
 
 #include <assert.h> /* assert() */
+#include <ctype.h> /* tolower() */
+#include <stddef.h> /* NULL size_t */
 #include <stdio.h> /* snprintf() */
-#include <string.h>
+#include <stdlib.h> /* free() */
+#include <string.h> /* memcpy() strchr() strlen() strstr() */
 
 #include "cfg/config.h"
 #include "compat/fs_limits.h"
+#include "compat/pthread.h"
+#include "compat/reallocarray.h"
 #include "engine/mode.h"
 #include "modes/modes.h"
 #include "ui/fileview.h"
 #include "ui/statusbar.h"
 #include "ui/ui.h"
+#include "utils/macros.h"
 #include "utils/path.h"
 #include "utils/regexp.h"
 #include "utils/str.h"
@@ -40,7 +46,42 @@
 #include "flist_sel.h"
 #include "status.h"
 
+/* Parameters of parallel search. */
+enum
+{
+	MIN_ENTRIES_PER_THREAD = 8192, /* Lists shorter than this aren't split. */
+	MAX_SEARCH_THREADS = 4,        /* Maximum number of threads to use. */
+};
+
+/* Matching of a range of entries against a pattern. */
+typedef struct
+{
+	view_t *view;          /* View whose entries are matched. */
+	const char *pattern;   /* Pattern to match. */
+	int cflags;            /* Flags for compiling the pattern. */
+	const char *literal;   /* Text that all matches contain or NULL. */
+	int literal_only;      /* Whether pattern is the literal and nothing else. */
+	int from;              /* First entry of the range. */
+	int to;                /* Entry past the last one of the range. */
+	int done;              /* Whether the range was processed. */
+}
+match_job_t;
+
+static int find_indexed_match(view_t *view, int backward, int count);
+static int search_index_is_valid(const view_t *view);
+static int build_search_index(view_t *view);
 static int find_match(view_t *view, int start, int backward);
+static void match_entries(view_t *view, const regex_t *re, const char pattern[],
+		int cflags);
+static void * match_range_thread(void *arg);
+static void match_range(match_job_t *job, const regex_t *re);
+static void match_entry(const match_job_t *job, const regex_t *re,
+		dir_entry_t *entry);
+static const char * find_literal(const char str[], const char literal[],
+		int icase);
+static int get_required_literal(const char pattern[], int icase, char buf[],
+		size_t buf_len, int *whole);
+static const char * skip_bracket_expr(const char expr[]);
 
 int
 search_find(view_t *view, const char pattern[], int backward,
@@ -123,6 +164,15 @@ find_search_match(view_t *view, int backward, int count)
 {
 	assert(count > 0 && "Zero searches.");
 
+	if(view->matches > 0)
+	{
+		const int i = find_indexed_match(view, backward, count);
+		if(i != -2)
+		{
+			return i;
+		}
+	}
+
 	int c, i = view->list_pos;
 	for(c = 0; c < count; ++c)
  	{
@@ -147,6 +197,136 @@ find_search_match(view_t *view, int backward, int count)
 	return i;
 }
 
+/* Looks for a count's search match in specified direction from current cursor
+ * position by means of index of matches.  Returns index of a match, -1 if no
+ * matches were found or -2 if there is no index. */
+static int
+find_indexed_match(view_t *view, int backward, int count)
+{
+	if(!search_index_is_valid(view) && build_search_index(view) != 0)
+	{
+		return -2;
+	}
+
+	const search_index_t *const index = &view->search_index;
+	if(index->count == 0)
+	{
+		return -1;
+	}
+
+	/* Find number of matches that are located before the cursor. */
+	int l = 0;
+	int u = index->count;
+	while(l < u)
+	{
+		const int m = l + (u - l)/2;
+		if(index->pos[m] < view->list_pos)
+		{
+			l = m + 1;
+		}
+		else
+		{
+			u = m;
+		}
+	}
+
+	int target;
+	if(backward)
+	{
+		target = l - count;
+	}
+	else
+	{
+		/* Skip match under the cursor. */
+		if(l < index->count && index->pos[l] == view->list_pos)
+		{
+			++l;
+		}
+		target = l + count - 1;
+	}
+
+	if(target < 0 || target >= index->count)
+	{
+		if(!cfg.wrap_scan)
+		{
+			return -1;
+		}
+		target %= index->count;
+		if(target < 0)
+		{
+			target += index->count;
+		}
+	}
+
+	const int pos = index->pos[target];
+	if(view->dir_entry[pos].search_match != target + 1)
+	{
+		/* The list was changed in a way that wasn't tracked, rebuild index. */
+		if(build_search_index(view) != 0)
+		{
+			return -2;
+		}
+		return find_indexed_match(view, backward, count);
+	}
+	return pos;
+}
+
+/* Checks whether index of matches corresponds to current list of entries.
+ * Returns non-zero if so, otherwise zero is returned. */
+static int
+search_index_is_valid(const view_t *view)
+{
+	const search_index_t *const index = &view->search_index;
+	return index->pos != NULL
+	    && index->entries == view->dir_entry
+	    && index->nentries == view->list_rows;
+}
+
+/* Builds index of matches out of search marks of entries renumbering them along
+ * the way.  Returns zero on success, otherwise non-zero is returned. */
+static int
+build_search_index(view_t *view)
+{
+	search_index_t *const index = &view->search_index;
+
+	int *pos = reallocarray(NULL, MAX(view->list_rows, 1), sizeof(*pos));
+	if(pos == NULL)
+	{
+		invalidate_search_index(view);
+		return 1;
+	}
+
+	int i;
+	int count = 0;
+	for(i = 0; i < view->list_rows; ++i)
+	{
+		if(view->dir_entry[i].search_match)
+		{
+			pos[count++] = i;
+			view->dir_entry[i].search_match = count;
+		}
+	}
+
+	free(index->pos);
+	index->pos = pos;
+	index->count = count;
+	index->entries = view->dir_entry;
+	index->nentries = view->list_rows;
+	view->matches = count;
+	return 0;
+}
+
+void
+invalidate_search_index(view_t *view)
+{
+	search_index_t *const index = &view->search_index;
+	free(index->pos);
+	index->pos = NULL;
+	index->count = 0;
+	index->entries = NULL;
+	index->nentries = 0;
+}
+
 /* Looks for a search match in specified direction from given start position.
  * Starting position is not included in searched range.  Returns index of a
  * match, or -1 if no matches were found. */
@@ -194,7 +374,6 @@ search_pattern(view_t *view, const char pattern[], int stash_selection,
 		int select_matches)
 {
 	int cflags;
-	int nmatches = 0;
 	regex_t re;
 	int err = 0;
 	view_t *other;
@@ -216,65 +395,388 @@ search_pattern(view_t *view, const char pattern[], int stash_selection,
 	}
 
 	cflags = get_regexp_cflags(pattern);
-	if((err = regexp_compile(&re, pattern, cflags)) == 0)
+	if((err = regexp_compile(&re, pattern, cflags)) != 0)
+	{
+		regfree(&re);
+		return err;
+	}
+
+	match_entries(view, &re, pattern, cflags);
+	regfree(&re);
+
+	/* Number matches and collect them into an index. */
+	if(build_search_index(view) != 0)
 	{
 		int i;
+		int nmatches = 0;
 		for(i = 0; i < view->list_rows; ++i)
 		{
-			regmatch_t matches[1];
-			dir_entry_t *const entry = &view->dir_entry[i];
-			const char *name = entry->name;
-			char *free_this = NULL;
-
-			if(is_parent_dir(name))
+			if(view->dir_entry[i].search_match)
 			{
-				continue;
+				view->dir_entry[i].search_match = ++nmatches;
 			}
+		}
+		view->matches = nmatches;
+	}
 
-			if(fentry_is_dir(entry))
+	if(select_matches)
+	{
+		int i;
+		for(i = 0; i < view->list_rows; ++i)
+		{
+			if(view->dir_entry[i].search_match)
 			{
-				free_this = format_str("%s/", name);
-				name = free_this;
+				view->dir_entry[i].selected = 1;
+				++view->selected_files;
 			}
+		}
+	}
+
+	other = (view == &lwin) ? &rwin : &lwin;
+	if(other->matches != 0 && strcmp(other->last_search, pattern) != 0)
+	{
+		other->last_search[0] = '\0';
+		ui_view_reset_search_highlight(other);
+	}
+	copy_str(view->last_search, sizeof(view->last_search), pattern);
+
+	return err;
+}
+
+/* Marks entries of the view that match the pattern splitting the work among
+ * several threads for long lists. */
+static void
+match_entries(view_t *view, const regex_t *re, const char pattern[],
+		int cflags)
+{
+	char literal[NAME_MAX + 1];
+	int literal_only;
+	const int has_literal = get_required_literal(pattern, cflags & REG_ICASE,
+			literal, sizeof(literal), &literal_only);
+
+	const match_job_t job_proto = {
+		.view = view,
+		.pattern = pattern,
+		.cflags = cflags,
+		.literal = has_literal ? literal : NULL,
+		.literal_only = has_literal && literal_only,
+	};
+
+	const int nthreads = MIN(MAX_SEARCH_THREADS,
+			1 + view->list_rows/MIN_ENTRIES_PER_THREAD);
+
+	match_job_t jobs[MAX_SEARCH_THREADS];
+	pthread_t ids[MAX_SEARCH_THREADS];
+	int started[MAX_SEARCH_THREADS];
+
+	int i;
+	for(i = 0; i < nthreads; ++i)
+	{
+		jobs[i] = job_proto;
+		jobs[i].from = (int)((long long)view->list_rows*i/nthreads);
+		jobs[i].to = (int)((long long)view->list_rows*(i + 1)/nthreads);
+
+		/* The first range is processed by this thread. */
+		started[i] = (i != 0)
+		          && pthread_create(&ids[i], NULL, &match_range_thread,
+		                            &jobs[i]) == 0;
+	}
+
+	match_range(&jobs[0], re);
 
-			if(regexec(&re, name, 1, matches, 0) != 0)
+	for(i = 1; i < nthreads; ++i)
+	{
+		if(started[i])
+		{
+			(void)pthread_join(ids[i], NULL);
+		}
+		if(!jobs[i].done)
+		{
+			match_range(&jobs[i], re);
+		}
+	}
+}
+
+/* Entry point of a thread that matches a range of entries.  Returns NULL. */
+static void *
+match_range_thread(void *arg)
+{
+	block_all_thread_signals();
+
+	/* Compiled pattern can't be shared as regexec() might serialize calls that
+	 * use the same object. */
+	match_job_t *const job = arg;
+	regex_t re;
+	if(regexp_compile(&re, job->pattern, job->cflags) == 0)
+	{
+		match_range(job, &re);
+	}
+	regfree(&re);
+	return NULL;
+}
+
+/* Marks entries of a range that match the pattern. */
+static void
+match_range(match_job_t *job, const regex_t *re)
+{
+	int i;
+	for(i = job->from; i < job->to; ++i)
+	{
+		match_entry(job, re, &job->view->dir_entry[i]);
+	}
+	job->done = 1;
+}
+
+/* Marks the entry if it matches the pattern and records position of the
+ * match. */
+static void
+match_entry(const match_job_t *job, const regex_t *re, dir_entry_t *entry)
+{
+	char buf[NAME_MAX + 2];
+	const char *name = entry->name;
+	char *free_this = NULL;
+
+	if(is_parent_dir(name))
+	{
+		return;
+	}
+
+	if(fentry_is_dir(entry))
+	{
+		const size_t len = strlen(name);
+		if(len + 2 <= sizeof(buf))
+		{
+			memcpy(buf, name, len);
+			buf[len] = '/';
+			buf[len + 1] = '\0';
+			name = buf;
+		}
+		else
+		{
+			free_this = format_str("%s/", name);
+			name = free_this;
+		}
+	}
+
+	int so, eo;
+	const char *hit = NULL;
+	if(job->literal != NULL)
+	{
+		hit = find_literal(name, job->literal, job->cflags & REG_ICASE);
+		if(hit == NULL)
+		{
+			free(free_this);
+			return;
+		}
+	}
+
+	if(job->literal_only)
+	{
+		so = hit - name;
+		eo = so + strlen(job->literal);
+	}
+	else
+	{
+		regmatch_t matches[1];
+		if(regexec(re, name, 1, matches, 0) != 0)
+		{
+			free(free_this);
+			return;
+		}
+		so = matches[0].rm_so;
+		eo = matches[0].rm_eo;
+	}
+
+	/* Actual number is assigned once all entries are processed. */
+	entry->search_match = 1;
+	entry->match_left = so + escape_unreadableo(name, so);
+	entry->match_right = eo + escape_unreadableo(name, eo);
+
+	free(free_this);
+}
+
+/* Looks for the first occurrence of the literal in a string.  Returns pointer
+ * to the occurrence or NULL. */
+static const char *
+find_literal(const char str[], const char literal[], int icase)
+{
+	if(!icase)
+	{
+		return strstr(str, literal);
+	}
+
+	/* Literal consists of ASCII characters in this case. */
+	for(; *str != '\0'; ++str)
+	{
+		size_t i = 0U;
+		while(literal[i] != '\0' &&
+				tolower((unsigned char)str[i]) == tolower((unsigned char)literal[i]))
+		{
+			++i;
+		}
+		if(literal[i] == '\0')
+		{
+			return str;
+		}
+	}
+	return NULL;
+}
+
+/* Finds the longest piece of literal text outside of groups of extended regular
+ * expression that every match of the pattern must contain.  When matching is
+ * case insensitive, only ASCII characters are considered to be literal.  Sets
+ * *whole to non-zero if the pattern consists solely of the literal.  Returns
+ * non-zero if such piece was found and put into the buffer, otherwise zero is
+ * returned. */
+static int
+get_required_literal(const char pattern[], int icase, char buf[],
+		size_t buf_len, int *whole)
+{
+	const char *best = NULL, *run = NULL;
+	size_t best_len = 0U, run_len = 0U;
+	int depth = 0;
+	int literal_only = 1;
+
+	const char *p = pattern;
+	while(1)
+	{
+		const char c = *p;
+		int ends_run = 1;
+
+		switch(c)
+		{
+			case '\0':
+				break;
+			case '|':
+				/* Nothing is required with alternatives. */
+				return 0;
+
+			case '*':
+			case '?':
+			case '{':
+				/* Previous character is optional. */
+				while(run_len > 0U && (run[run_len - 1U] & 0xc0) == 0x80)
+				{
+					--run_len;
+				}
+				if(run_len > 0U)
+				{
+					--run_len;
+				}
+
+				if(c == '{' && strchr(p, '}') != NULL)
+				{
+					p = strchr(p, '}');
+				}
+				++p;
+				break;
+
+			case '(':
+				++depth;
+				++p;
+				break;
+			case ')':
+				depth -= (depth > 0);
+				++p;
+				break;
+			case '[':
+				p = skip_bracket_expr(p);
+				break;
+			case '\\':
+				p += (p[1] == '\0') ? 1 : 2;
+				break;
+			case '.':
+			case '^':
+			case '$':
+			case '+':
+			case '}':
+				++p;
+				break;
+
+			default:
+				if(depth == 0 && (!icase || (unsigned char)c < 0x80))
+				{
+					if(run_len == 0U)
+					{
+						run = p;
+					}
+					++run_len;
+					ends_run = 0;
+				}
+				++p;
+				break;
+		}
+
+		if(ends_run)
+		{
+			if(c != '\0' || run_len != (size_t)(p - pattern))
 			{
-				free(free_this);
-				continue;
+				literal_only = 0;
 			}
-
-			entry->search_match = nmatches + 1;
-			entry->match_left = matches[0].rm_so;
-			entry->match_left += escape_unreadableo(name, matches[0].rm_so);
-			entry->match_right = matches[0].rm_eo;
-			entry->match_right += escape_unreadableo(name, matches[0].rm_eo);
-			if(select_matches)
+			if(run_len > best_len)
 			{
-				entry->selected = 1;
-				++view->selected_files;
+				best = run;
+				best_len = run_len;
 			}
-			++nmatches;
+			run_len = 0U;
+		}
 
-			free(free_this);
+		if(c == '\0')
+		{
+			break;
 		}
-		regfree(&re);
 	}
-	else
+
+	if(best_len == 0U)
 	{
-		regfree(&re);
-		return err;
+		return 0;
 	}
 
-	other = (view == &lwin) ? &rwin : &lwin;
-	if(other->matches != 0 && strcmp(other->last_search, pattern) != 0)
+	if(best_len >= buf_len)
 	{
-		other->last_search[0] = '\0';
-		ui_view_reset_search_highlight(other);
+		/* Prefix of required text is required as well. */
+		best_len = buf_len - 1U;
+		literal_only = 0;
 	}
-	view->matches = nmatches;
-	copy_str(view->last_search, sizeof(view->last_search), pattern);
 
-	return err;
+	memcpy(buf, best, best_len);
+	buf[best_len] = '\0';
+	*whole = literal_only;
+	return 1;
+}
+
+/* Skips bracket expression of a regular expression.  Returns pointer to the
+ * first character past the expression. */
+static const char *
+skip_bracket_expr(const char expr[])
+{
+	const char *p = expr + 1;
+	if(*p == '^')
+	{
+		++p;
+	}
+	if(*p == ']')
+	{
+		++p;
+	}
+
+	while(*p != '\0' && *p != ']')
+	{
+		if(p[0] == '[' && (p[1] == ':' || p[1] == '.' || p[1] == '='))
+		{
+			const char delim = p[1];
+			p += 2;
+			while(*p != '\0' && !(p[0] == delim && p[1] == ']'))
+			{
+				++p;
+			}
+			p += (*p == '\0') ? 0 : 2;
+			continue;
+		}
+		++p;
+	}
+
+	return (*p == ']') ? (p + 1) : p;
 }
 
 int
@@ -381,6 +883,7 @@ reset_search_results(view_t *view)
 		view->dir_entry[i].search_match = 0;
 	}
 	view->matches = 0;
+	invalidate_search_index(view);
 }
 
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
@@ -86,6 +86,10 @@ void print_search_fail_msg(const struct view_t *view, int backward);
 /* Resets information about last search match. */
 void reset_search_results(struct view_t *view);
 
+/* Drops index of search matches, which must be done when list of files is
+ * reordered. */
+void invalidate_search_index(struct view_t *view);
+
 /* Prints the search messages for the n or N commands. */
 void print_search_next_msg(const struct view_t *view, int backward);
 
@@ -43,6 +43,7 @@
 #include "utils/utils.h"
 #include "filelist.h"
 #include "filtering.h"
+#include "search.h"
 #include "status.h"
 #include "types.h"
 
@@ -154,6 +155,8 @@ sort_view(view_t *v)
 		return;
 	}
 
+	invalidate_search_index(v);
+
 	/* Tree sorting works fine for flat list, but requires a bit more
 	 * resources, so skip it if we can. */
 	if(!custom_view || !cv_tree(v->custom.type))
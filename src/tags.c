@@ -722,6 +722,12 @@ const char *tags[] = {
 	"vifm-l_VifmEntry.selected",
 	"vifm-l_VifmEntry.size",
 	"vifm-l_VifmEntry.type",
+	"vifm-l_VifmFsOp",
+	"vifm-l_VifmFsOp:cancel()",
+	"vifm-l_VifmFsOp:errors()",
+	"vifm-l_VifmFsOp:isrunning()",
+	"vifm-l_VifmFsOp:progress()",
+	"vifm-l_VifmFsOp:succeeded()",
 	"vifm-l_VifmJob",
 	"vifm-l_VifmJob:errors()",
 	"vifm-l_VifmJob:exitcode()",
@@ -777,6 +783,7 @@ const char *tags[] = {
 	"vifm-l_vifm.fs.mv()",
 	"vifm-l_vifm.fs.rm()",
 	"vifm-l_vifm.fs.rmdir()",
+	"vifm-l_vifm.fs.startop()",
 	"vifm-l_vifm.input()",
 	"vifm-l_vifm.keys",
 	"vifm-l_vifm.keys.add()",
@@ -41,6 +41,7 @@
 #include "../utils/fsddata.h"
 #include "../utils/macros.h"
 #include "../utils/matchers.h"
+#include "../utils/matchers_index.h"
 #include "../utils/str.h"
 #include "../utils/string_array.h"
 #include "../utils/utils.h"
@@ -535,6 +536,8 @@ static void restore_primary_cs(const col_scheme_t *cs);
 static void reset_to_default_cs(col_scheme_t *cs);
 static void free_cs_highlights(col_scheme_t *cs);
 static file_hi_t * clone_file_highlights(const col_scheme_t *from);
+static void rebuild_file_hi_index(col_scheme_t *cs);
+static void drop_file_hi_index(col_scheme_t *cs);
 static col_attr_t * clone_column_highlights(const col_scheme_t *from);
 static void reset_cs_colors(col_scheme_t *cs);
 static int source_cs(const char name[]);
@@ -941,6 +944,8 @@ cs_assign(col_scheme_t *to, const col_scheme_t *from)
 	*to = *from;
 	to->file_hi = clone_file_highlights(from);
 	to->column_hi = clone_column_highlights(from);
+	to->file_hi_index = NULL;
+	rebuild_file_hi_index(to);
 }
 
 /* Resets color scheme to default builtin values. */
@@ -969,6 +974,7 @@ free_cs_highlights(col_scheme_t *cs)
 	free(cs->file_hi);
 	cs->file_hi = NULL;
 	cs->file_hi_count = 0;
+	drop_file_hi_index(cs);
 
 	free(cs->column_hi);
 	cs->column_hi = NULL;
@@ -994,6 +1000,38 @@ clone_file_highlights(const col_scheme_t *from)
 	return file_hi;
 }
 
+/* Recreates index of file highlights of the color scheme from scratch. */
+static void
+rebuild_file_hi_index(col_scheme_t *cs)
+{
+	drop_file_hi_index(cs);
+
+	cs->file_hi_index = matchers_index_create();
+	if(cs->file_hi_index == NULL)
+	{
+		return;
+	}
+
+	int i;
+	for(i = 0; i < cs->file_hi_count; ++i)
+	{
+		if(matchers_index_add(cs->file_hi_index, &cs->file_hi[i].matchers, 1) != 0)
+		{
+			drop_file_hi_index(cs);
+			break;
+		}
+	}
+}
+
+/* Frees index of file highlights of the color scheme, after which lookups fall
+ * back to trying highlights one by one. */
+static void
+drop_file_hi_index(col_scheme_t *cs)
+{
+	matchers_index_free(cs->file_hi_index);
+	cs->file_hi_index = NULL;
+}
+
 /* Clones column highlight array of the *from color scheme and returns it. */
 static col_attr_t *
 clone_column_highlights(const col_scheme_t *from)
@@ -1352,6 +1390,16 @@ cs_add_file_hi(struct matchers_t *matchers, const col_attr_t *hi)
 	file_hi->hi = *hi;
 
 	++cs->file_hi_count;
+
+	if(cs->file_hi_count == 1)
+	{
+		rebuild_file_hi_index(cs);
+	}
+	else if(cs->file_hi_index != NULL &&
+			matchers_index_add(cs->file_hi_index, &file_hi->matchers, 1) != 0)
+	{
+		drop_file_hi_index(cs);
+	}
 }
 
 const col_attr_t *
@@ -1369,18 +1417,29 @@ cs_get_file_hi(const col_scheme_t *cs, const char fname[], int *hi_hint)
 	}
 
 	int i;
-	for(i = 0; i < cs->file_hi_count; ++i)
+	if(cs->file_hi_index != NULL)
 	{
-		const file_hi_t *const file_hi = &cs->file_hi[i];
-		if(matchers_match(file_hi->matchers, fname))
+		i = matchers_index_find(cs->file_hi_index, fname, 0);
+	}
+	else
+	{
+		for(i = 0; i < cs->file_hi_count; ++i)
 		{
-			*hi_hint = i;
-			return &file_hi->hi;
+			if(matchers_match(cs->file_hi[i].matchers, fname))
+			{
+				break;
+			}
 		}
 	}
 
-	*hi_hint = INT_MAX;
-	return NULL;
+	if(i < 0 || i >= cs->file_hi_count)
+	{
+		*hi_hint = INT_MAX;
+		return NULL;
+	}
+
+	*hi_hint = i;
+	return &cs->file_hi[i].hi;
 }
 
 int
@@ -1397,6 +1456,7 @@ cs_del_file_hi(const char matchers_expr[])
 			memmove(&cs->file_hi[i], &cs->file_hi[i + 1],
 					sizeof(*cs->file_hi)*((cs->file_hi_count - 1) - i));
 			--cs->file_hi_count;
+			rebuild_file_hi_index(cs);
 			return 1;
 		}
 	}
@@ -41,6 +41,7 @@ typedef enum
 }
 ColorSchemeState;
 
+struct matchers_index_t;
 struct matchers_t;
 
 /* Single file highlight description. */
@@ -61,6 +62,8 @@ typedef struct
 
 	file_hi_t *file_hi; /* List of file highlight preferences. */
 	int file_hi_count;  /* Number of file highlight definitions. */
+	struct matchers_index_t *file_hi_index; /* Index of file_hi for lookups or
+	                                           NULL if it's missing. */
 
 	col_attr_t *column_hi; /* List of column highlight preferences.
 	                          Unused entries are filled with 0xff. */
@@ -30,11 +30,14 @@
 
 #include <assert.h> /* assert() */
 #include <stddef.h> /* NULL size_t */
-#include <stdlib.h> /* abs() malloc() */
-#include <string.h> /* memset() strlen() */
+#include <stdint.h> /* uint64_t */
+#include <stdlib.h> /* abs() calloc() free() malloc() */
+#include <string.h> /* memcmp() memcpy() memset() strcmp() strlen() */
 
 #include "../cfg/config.h"
 #include "../compat/pthread.h"
+#include "../compat/reallocarray.h"
+#include "../int/file_magic.h"
 #include "../lua/vlua.h"
 #include "../utils/fs.h"
 #include "../utils/macros.h"
@@ -44,6 +47,7 @@
 #include "../utils/test_helpers.h"
 #include "../utils/utf8.h"
 #include "../utils/utils.h"
+#include "../utils/xxhash.h"
 #include "../filelist.h"
 #include "../flist_hist.h"
 #include "../flist_pos.h"
@@ -58,6 +62,68 @@
 /* Mark for a cursor position of inactive pane. */
 #define INACTIVE_CURSOR_MARK "*"
 
+/* Part of state of a cell that affects its appearance and is compared
+ * bitwise. */
+typedef struct
+{
+	dir_entry_t entry;      /* Copy of the entry with pointers reset. */
+	dcache_result_t size;   /* Cached size of a directory. */
+	dcache_result_t nitems; /* Cached number of items of a directory. */
+	int line_pos;           /* Position of the entry in the list. */
+	int current;            /* Cursor position for relative numbers or whether
+	                           entry is under the cursor otherwise. */
+}
+cell_key_t;
+
+/* State of a cell as of the moment it was drawn. */
+typedef struct
+{
+	cell_key_t key; /* Bitwise comparable part of the state. */
+	char *name;     /* Copy of entry's name. */
+	char *origin;   /* Copy of entry's origin. */
+	int valid;      /* Whether the state can be compared against. */
+}
+cell_state_t;
+
+/* Parameters of a view which affect appearance of all of its cells.  Compared
+ * bitwise. */
+typedef struct
+{
+	int epoch;                /* Value of frame_epoch. */
+	int option_changes;       /* Value of get_option_changes(). */
+	const col_scheme_t *cs;   /* Color scheme of the view. */
+	uint64_t cs_hash;         /* Hash of color scheme's contents. */
+	const void *file_hi;      /* File highlights of the color scheme. */
+	int file_hi_count;        /* Number of file highlights. */
+	const columns_t *columns; /* Columns used for drawing. */
+	int is_current;           /* Whether this is the current view. */
+	int transposed;           /* Whether view is transposed ls-like one. */
+	int top_line;             /* Position of the first visible entry. */
+	int window_rows;          /* Height of the view. */
+	int window_cols;          /* Width of the view. */
+	int window_cells;         /* Number of fully visible cells. */
+	int ncells;               /* Number of drawn cells. */
+	int col_count;            /* Number of columns. */
+	int col_width;            /* Width of a column. */
+	int num_width;            /* Width of line numbers. */
+	int rel_pos;              /* Position of cursor for relative numbers. */
+	int matches;              /* Number of search matches. */
+	int on_slow_fs;           /* Whether file system is marked as slow. */
+}
+frame_key_t;
+
+/* What was drawn in a window of a view last time. */
+struct frame_t
+{
+	frame_key_t key;     /* Parameters of the view. */
+	char *dir;           /* Location of the view. */
+	cell_state_t *cells; /* States of drawn cells. */
+	int ncells;          /* Number of elements in cells array. */
+	uint64_t *lines;     /* Hashes of contents of lines of the window. */
+	int nlines;          /* Number of elements in lines array. */
+	int valid;           /* Whether state of the window matches the frame. */
+};
+
 /**
  * View layouts
  * ------------
@@ -116,8 +182,22 @@ static void consider_scroll_bind(view_t *view);
 static cchar_t prepare_inactive_color(view_t *view, dir_entry_t *entry,
 		int line_color);
 static void redraw_cell(view_t *view, int top, int cursor, int is_current);
-static void compute_and_draw_cell(column_data_t *cdt, int cell,
+static int compute_and_draw_cell(column_data_t *cdt, int cell,
 		size_t col_count, size_t col_width);
+TSTATIC int frame_begin(view_t *view, size_t col_count, size_t col_width,
+		int ncells);
+TSTATIC void frame_end(view_t *view);
+static int frame_is_supported(const view_t *view);
+static int frame_lines_match(const view_t *view);
+TSTATIC int frame_cell_changed(const view_t *view, int cell,
+		const column_data_t *cdt);
+TSTATIC void frame_cell_drawn(view_t *view, int top, int cell,
+		const column_data_t *cdt, int is_volatile);
+TSTATIC void frame_cell_overdrawn(view_t *view, int cell, int line);
+static void frame_update_line(view_t *view, int line);
+static void fill_cell_key(const column_data_t *cdt, cell_key_t *key);
+static uint64_t hash_cs(const col_scheme_t *cs);
+static uint64_t hash_window_line(WINDOW *win, int line);
 static void column_line_print(const char buf[], int offset, AlignType align,
 		const char full_column[], const format_info_t *info);
 static void column_line_match(const char full_column[],
@@ -174,7 +254,7 @@ static size_t calculate_columns_count(view_t *view);
 static int has_extra_tls_col(const view_t *view, int col_width);
 static preview_area_t get_miller_preview_area(view_t *view);
 static size_t get_max_filename_width(const view_t *view);
-static size_t get_filename_width(const view_t *view, int i);
+static size_t get_filename_width(const view_t *view, dir_entry_t *entry);
 static size_t get_filetype_decoration_width(const dir_entry_t *entry);
 static int cache_cursor_pos(view_t *view);
 static void invalidate_cursor_pos_cache(view_t *view);
@@ -182,6 +262,9 @@ static void position_hardware_cursor(view_t *view);
 static int move_curr_line(view_t *view);
 static void reset_view_columns(view_t *view);
 
+/* Changing this value makes all existing frames outdated. */
+static int frame_epoch;
+
 void
 fview_setup(void)
 {
@@ -296,6 +379,35 @@ fview_reset_cs(view_t *view)
 	}
 }
 
+void
+fview_free_frame(view_t *view)
+{
+	struct frame_t *const frame = view->frame;
+	if(frame == NULL)
+	{
+		return;
+	}
+
+	int i;
+	for(i = 0; i < frame->ncells; ++i)
+	{
+		free(frame->cells[i].name);
+		free(frame->cells[i].origin);
+	}
+	free(frame->cells);
+	free(frame->lines);
+	free(frame->dir);
+	free(frame);
+
+	view->frame = NULL;
+}
+
+void
+fview_invalidate_frames(void)
+{
+	++frame_epoch;
+}
+
 void
 draw_dir_list(view_t *view)
 {
@@ -332,16 +444,24 @@ draw_dir_list_only(view_t *view)
 
 	view->top_line = calculate_top_position(view, view->top_line);
 
-	ui_view_erase(view, 0);
-
-	draw_left_column(view);
-
 	visible_cells = view->window_cells;
 	if(has_extra_tls_col(view, col_width))
 	{
 		visible_cells += view->window_rows;
 	}
 
+	/* When the window still displays what was drawn last time, draw only cells
+	 * that have changed since then. */
+	const int ncells = MAX(0, MIN(visible_cells,
+				view->list_rows - view->top_line));
+	const int damage_only = frame_begin(view, col_count, col_width, ncells);
+	if(!damage_only)
+	{
+		ui_view_erase(view, 0);
+	}
+
+	draw_left_column(view);
+
 	for(x = view->top_line, cell = 0;
 			x < view->list_rows && cell < visible_cells;
 			++x, ++cell)
@@ -353,11 +473,20 @@ draw_dir_list_only(view_t *view)
 			.current_pos = view->list_pos,
 		};
 
-		compute_and_draw_cell(&cdt, cell, col_count, col_width);
+		if(damage_only && !frame_cell_changed(view, cell, &cdt))
+		{
+			continue;
+		}
+
+		const int is_volatile = compute_and_draw_cell(&cdt, cell, col_count,
+				col_width);
+		frame_cell_drawn(view, view->top_line, cell, &cdt, is_volatile);
 	}
 
 	draw_right_column(view);
 
+	frame_end(view);
+
 	view->curr_line = view->list_pos - view->top_line;
 
 	if(view == curr_view)
@@ -987,6 +1116,7 @@ fview_draw_inactive_cursor(view_t *view)
 	checked_wmove(view->win, line, column);
 
 	wprinta(view->win, INACTIVE_CURSOR_MARK, &line_attrs, 0);
+	frame_cell_overdrawn(view, view->curr_line, line);
 	ui_view_win_changed(view);
 }
 
@@ -1032,16 +1162,20 @@ redraw_cell(view_t *view, int top, int cursor, int is_current)
 		.line_pos = pos,
 		.current_pos = is_current ? view->list_pos : -1,
 	};
-	compute_and_draw_cell(&cdt, cursor, col_count, col_width);
+	const int is_volatile = compute_and_draw_cell(&cdt, cursor, col_count,
+			col_width);
+	frame_cell_drawn(view, top, cursor, &cdt, is_volatile);
 }
 
 /* Fills in fields of cdt based on passed in arguments and
- * view/entry/line_pos/current_pos fields of cdt.  Then draws the cell. */
-static void
+ * view/entry/line_pos/current_pos fields of cdt.  Then draws the cell.  Returns
+ * non-zero if drawn data can change without changes of the entry. */
+static int
 compute_and_draw_cell(column_data_t *cdt, int cell, size_t col_count,
 		size_t col_width)
 {
 	size_t prefix_len = 0U;
+	int is_volatile = 0;
 
 	const int col = fpos_get_col(cdt->view, cell);
 
@@ -1051,6 +1185,7 @@ compute_and_draw_cell(column_data_t *cdt, int cell, size_t col_count,
 	cdt->number_width = cdt->view->real_num_width;
 	cdt->total_width = ui_view_main_padded(cdt->view);
 	cdt->prefix_len = &prefix_len;
+	cdt->is_volatile = &is_volatile;
 	cdt->is_main = 1;
 
 	int lpadding = 0, rpadding = 0;
@@ -1082,6 +1217,321 @@ compute_and_draw_cell(column_data_t *cdt, int cell, size_t col_count,
 	draw_cell(columns, cdt, lpadding, col_width - lpadding - rpadding, rpadding);
 
 	cdt->prefix_len = NULL;
+	cdt->is_volatile = NULL;
+	return is_volatile;
+}
+
+/* Prepares frame of the view for drawing of the file list.  Returns non-zero
+ * if the window still displays contents described by the frame and only cells
+ * that have changed need to be drawn. */
+TSTATIC int
+frame_begin(view_t *view, size_t col_count, size_t col_width, int ncells)
+{
+	struct frame_t *frame = view->frame;
+
+	if(!frame_is_supported(view))
+	{
+		if(frame != NULL)
+		{
+			frame->valid = 0;
+		}
+		return 0;
+	}
+
+	if(frame == NULL)
+	{
+		frame = calloc(1, sizeof(*frame));
+		if(frame == NULL)
+		{
+			return 0;
+		}
+		view->frame = frame;
+	}
+
+	const col_scheme_t *const cs = ui_view_get_cs(view);
+
+	frame_key_t key;
+	/* Zero padding to be able to compare structures bitwise. */
+	memset(&key, 0, sizeof(key));
+	key.epoch = frame_epoch;
+	key.option_changes = get_option_changes();
+	key.cs = cs;
+	key.cs_hash = hash_cs(cs);
+	key.file_hi = cs->file_hi;
+	key.file_hi_count = cs->file_hi_count;
+	key.columns = get_view_columns(view, 0);
+	key.is_current = (view == curr_view);
+	key.transposed = fview_is_transposed(view);
+	key.top_line = view->top_line;
+	key.window_rows = view->window_rows;
+	key.window_cols = view->window_cols;
+	key.window_cells = view->window_cells;
+	key.ncells = ncells;
+	key.col_count = col_count;
+	key.col_width = col_width;
+	key.num_width = view->real_num_width;
+	key.rel_pos = (view->num_type & NT_REL) ? view->list_pos : -1;
+	key.matches = view->matches;
+	key.on_slow_fs = view->on_slow_fs;
+
+	const char *const dir = flist_get_dir(view);
+	const int reusable = frame->valid
+	                  && memcmp(&key, &frame->key, sizeof(key)) == 0
+	                  && strcmp(frame->dir, dir) == 0
+	                  && frame_lines_match(view);
+
+	/* The window is about to be changed. */
+	frame->valid = 0;
+
+	if(reusable)
+	{
+		return 1;
+	}
+
+	memcpy(&frame->key, &key, sizeof(key));
+	if(replace_string(&frame->dir, dir) != 0)
+	{
+		return 0;
+	}
+
+	int i;
+	for(i = ncells; i < frame->ncells; ++i)
+	{
+		update_string(&frame->cells[i].name, NULL);
+		update_string(&frame->cells[i].origin, NULL);
+	}
+
+	if(ncells > frame->ncells)
+	{
+		void *cells = reallocarray(frame->cells, ncells, sizeof(*frame->cells));
+		if(cells == NULL)
+		{
+			return 0;
+		}
+		frame->cells = cells;
+		memset(&frame->cells[frame->ncells], 0,
+				sizeof(*frame->cells)*(ncells - frame->ncells));
+	}
+	frame->ncells = ncells;
+
+	for(i = 0; i < ncells; ++i)
+	{
+		frame->cells[i].valid = 0;
+	}
+
+	return 0;
+}
+
+/* Finishes drawing of the file list by recording current contents of the
+ * window in the frame. */
+TSTATIC void
+frame_end(view_t *view)
+{
+	struct frame_t *const frame = view->frame;
+	if(frame == NULL || !frame_is_supported(view) ||
+			frame->ncells != frame->key.ncells)
+	{
+		return;
+	}
+
+	const int nlines = getmaxy(view->win);
+	if(nlines != frame->nlines)
+	{
+		void *lines = reallocarray(frame->lines, nlines, sizeof(*frame->lines));
+		if(lines == NULL && nlines != 0)
+		{
+			return;
+		}
+		frame->lines = lines;
+		frame->nlines = nlines;
+	}
+
+	int i;
+	for(i = 0; i < nlines; ++i)
+	{
+		frame->lines[i] = hash_window_line(view->win, i);
+	}
+
+	frame->valid = 1;
+}
+
+/* Checks whether drawing of the view can be done incrementally.  Side columns
+ * and tree prefixes depend on more than one entry, so such views are always
+ * redrawn in full.  Returns non-zero if so. */
+static int
+frame_is_supported(const view_t *view)
+{
+	return ui_view_left_reserved(view) == 0
+	    && ui_view_right_reserved(view) == 0
+	    && !cv_tree(view->custom.type)
+	    && !cv_compare(view->custom.type);
+}
+
+/* Checks whether the window wasn't changed since it was drawn (e.g., by
+ * quick view or a suggestion box).  Returns non-zero if so. */
+static int
+frame_lines_match(const view_t *view)
+{
+	const struct frame_t *const frame = view->frame;
+	if(frame->nlines != getmaxy(view->win))
+	{
+		return 0;
+	}
+
+	int i;
+	for(i = 0; i < frame->nlines; ++i)
+	{
+		if(frame->lines[i] != hash_window_line(view->win, i))
+		{
+			return 0;
+		}
+	}
+	return 1;
+}
+
+/* Checks whether the cell needs to be drawn because something it displays has
+ * changed.  Returns non-zero if so. */
+TSTATIC int
+frame_cell_changed(const view_t *view, int cell, const column_data_t *cdt)
+{
+	const cell_state_t *const state = &view->frame->cells[cell];
+	if(!state->valid)
+	{
+		return 1;
+	}
+
+	cell_key_t key;
+	fill_cell_key(cdt, &key);
+
+	return memcmp(&key, &state->key, sizeof(key)) != 0
+	    || strcmp(state->name, cdt->entry->name) != 0
+	    || strcmp(state->origin, cdt->entry->origin) != 0;
+}
+
+/* Records state of a cell that has just been drawn.  top is the position of
+ * the first visible entry assumed during drawing. */
+TSTATIC void
+frame_cell_drawn(view_t *view, int top, int cell, const column_data_t *cdt,
+		int is_volatile)
+{
+	struct frame_t *const frame = view->frame;
+	if(frame == NULL || cell >= frame->ncells)
+	{
+		return;
+	}
+
+	if(top != frame->key.top_line)
+	{
+		frame->valid = 0;
+		return;
+	}
+
+	const dir_entry_t *const entry = cdt->entry;
+	cell_state_t *const state = &frame->cells[cell];
+
+	/* Appearance of symbolic links depends on their targets.  Unknown highlight
+	 * means that it wasn't resolved yet. */
+	state->valid = !is_volatile
+	            && entry->type != FT_LINK
+	            && entry->hi_num != -1
+	            && replace_string(&state->name, entry->name) == 0
+	            && replace_string(&state->origin, entry->origin) == 0;
+	if(state->valid)
+	{
+		fill_cell_key(cdt, &state->key);
+	}
+
+	/* Drawing outside of draw_dir_list_only() keeps the frame up to date. */
+	if(frame->valid)
+	{
+		frame_update_line(view, fpos_get_line(view, cell));
+	}
+}
+
+/* Accounts for drawing something over a cell after it was drawn. */
+TSTATIC void
+frame_cell_overdrawn(view_t *view, int cell, int line)
+{
+	struct frame_t *const frame = view->frame;
+	if(frame == NULL || !frame->valid)
+	{
+		return;
+	}
+
+	if(cell >= 0 && cell < frame->ncells)
+	{
+		frame->cells[cell].valid = 0;
+	}
+	frame_update_line(view, line);
+}
+
+/* Updates hash of the line of the window after drawing on it. */
+static void
+frame_update_line(view_t *view, int line)
+{
+	struct frame_t *const frame = view->frame;
+	if(line >= 0 && line < frame->nlines)
+	{
+		frame->lines[line] = hash_window_line(view->win, line);
+	}
+	else
+	{
+		frame->valid = 0;
+	}
+}
+
+/* Collects state of the cell, which affects its appearance. */
+static void
+fill_cell_key(const column_data_t *cdt, cell_key_t *key)
+{
+	const dir_entry_t *const entry = cdt->entry;
+
+	/* Zero padding to be able to compare structures bitwise. */
+	memset(key, 0, sizeof(*key));
+
+	memcpy(&key->entry, entry, sizeof(key->entry));
+	/* Strings are compared separately and other fields don't affect drawing, but
+	 * can change often. */
+	key->entry.name = NULL;
+	key->entry.origin = NULL;
+	key->entry.tag = 0;
+	key->entry.link = 0;
+
+	key->line_pos = cdt->line_pos;
+	key->current = (cdt->view->num_type & NT_REL)
+	             ? cdt->current_pos
+	             : (cdt->line_pos == cdt->current_pos);
+
+	if(fentry_is_dir(entry))
+	{
+		dcache_get_of(entry, &key->size, &key->nitems);
+	}
+}
+
+/* Computes hash of the color scheme.  Returns the hash. */
+static uint64_t
+hash_cs(const col_scheme_t *cs)
+{
+	uint64_t hash = XXH3_64bits(cs->color, sizeof(cs->color));
+	hash = XXH3_64bits_withSeed(cs->pair, sizeof(cs->pair), hash);
+	return XXH3_64bits_withSeed(cs->column_hi,
+			sizeof(*cs->column_hi)*cs->column_hi_count, hash);
+}
+
+/* Computes hash of contents of a line of the window.  Returns the hash. */
+static uint64_t
+hash_window_line(WINDOW *win, int line)
+{
+	const int width = getmaxx(win);
+	cchar_t chars[width + 1];
+	memset(chars, 0, sizeof(chars));
+
+	int y, x;
+	getyx(win, y, x);
+	(void)mvwin_wchnstr(win, line, 0, chars, width);
+	wmove(win, y, x);
+
+	return XXH3_64bits(chars, sizeof(chars[0])*width);
 }
 
 void
@@ -1180,6 +1630,12 @@ column_line_print(const char buf[], int offset, AlignType align,
 	view_t *view = cdt->view;
 	dir_entry_t *entry = cdt->entry;
 
+	/* Values of columns defined by Lua can't be tracked. */
+	if(info->real_id >= SK_TOTAL && cdt->is_volatile != NULL)
+	{
+		*cdt->is_volatile = 1;
+	}
+
 	const int numbers_visible = (offset == 0 && cdt->number_width > 0);
 	const int padding = (cfg.extra_padding != 0);
 
@@ -1479,7 +1935,17 @@ mix_in_file_name_hi(const view_t *view, dir_entry_t *entry, col_attr_t *col)
 {
 	const col_scheme_t *const cs = ui_view_get_cs(view);
 	char *const typed_fname = get_typed_entry_fpath(entry);
+
+	/* Don't wait for mime-types, the entry is redrawn once they are known. */
+	mimetype_defer_begin();
 	const col_attr_t *color = cs_get_file_hi(cs, typed_fname, &entry->hi_num);
+	if(mimetype_defer_end())
+	{
+		/* Result might change with types, so neither cache nor use it. */
+		entry->hi_num = -1;
+		color = NULL;
+	}
+
 	free(typed_fname);
 	if(color != NULL)
 	{
@@ -1979,6 +2445,29 @@ fview_decors_updated(view_t *view)
 	view->max_filename_width = 0;
 }
 
+void
+fview_entry_removed(view_t *view, dir_entry_t *entry)
+{
+	/* Maximum can only decrease if the entry was the widest one. */
+	if(view->max_filename_width != 0 &&
+			get_filename_width(view, entry) >= view->max_filename_width)
+	{
+		view->max_filename_width = 0;
+	}
+	entry->name_width = 0;
+}
+
+void
+fview_entry_added(view_t *view, dir_entry_t *entry)
+{
+	entry->name_width = 0;
+	if(view->max_filename_width != 0)
+	{
+		view->max_filename_width =
+			MAX(view->max_filename_width, get_filename_width(view, entry));
+	}
+}
+
 /* Evaluates number of columns in the view.  Returns the number. */
 static size_t
 calculate_columns_count(view_t *view)
@@ -2001,7 +2490,7 @@ get_max_filename_width(const view_t *view)
 	int i;
 	for(i = 0; i < view->list_rows; ++i)
 	{
-		const size_t name_len = get_filename_width(view, i);
+		const size_t name_len = get_filename_width(view, &view->dir_entry[i]);
 		if(name_len > max_len)
 		{
 			max_len = name_len;
@@ -2010,25 +2499,27 @@ get_max_filename_width(const view_t *view)
 	return max_len;
 }
 
-/* Gets filename width (length in character positions on the screen) of ith
- * entry of the view.  Returns the width. */
+/* Gets filename width (length in character positions on the screen) of an
+ * entry of the view.  Width of the name is cached in the entry.  Returns the
+ * width. */
 static size_t
-get_filename_width(const view_t *view, int i)
+get_filename_width(const view_t *view, dir_entry_t *entry)
 {
-	const dir_entry_t *const entry = &view->dir_entry[i];
-	size_t name_len;
-	if(flist_custom_active(view))
-	{
-		char name[NAME_MAX + 1];
-		/* XXX: should this be formatted name?. */
-		get_short_path_of(view, entry, NF_NONE, 0, sizeof(name), name);
-		name_len = utf8_strsw(name);
-	}
-	else
+	if(entry->name_width == 0)
 	{
-		name_len = utf8_strsw(entry->name);
+		if(flist_custom_active(view))
+		{
+			char name[NAME_MAX + 1];
+			/* XXX: should this be formatted name?. */
+			get_short_path_of(view, entry, NF_NONE, 0, sizeof(name), name);
+			entry->name_width = utf8_strsw(name);
+		}
+		else
+		{
+			entry->name_width = utf8_strsw(entry->name);
+		}
 	}
-	return name_len + get_filetype_decoration_width(entry);
+	return entry->name_width + get_filetype_decoration_width(entry);
 }
 
 /* Retrieves additional number of characters which are needed to display names
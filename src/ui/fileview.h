@@ -55,6 +55,8 @@ typedef struct
 	                     * A pointer to allow changing value in const struct.
 	                     * Should be zero first time, then auto reset. */
 	int is_main;        /* Whether this is main file list. */
+	int *is_volatile;   /* Set to non-zero if drawn data can change without
+	                     * changes of the entry.  Can be NULL. */
 
 	int custom_match;   /* Whether the keys below have meaningful values. */
 	int match_from;     /* Start offset of the match. */
@@ -76,6 +78,12 @@ void fview_reset(struct view_t *view);
 /* Resets view state with regard to color schemes. */
 void fview_reset_cs(struct view_t *view);
 
+/* Frees description of what was drawn in the view last time. */
+void fview_free_frame(struct view_t *view);
+
+/* Makes next redraw of every view draw all of its cells. */
+void fview_invalidate_frames(void);
+
 /* Appearance related functions. */
 
 /* Redraws directory list and puts inactive mark for the other view. */
@@ -162,6 +170,14 @@ void fview_list_updated(struct view_t *view);
  * decorations of files change. */
 void fview_decors_updated(struct view_t *view);
 
+/* Callback-like function which triggers some view-specific updates before the
+ * entry is removed from the list or its name or origin changes. */
+void fview_entry_removed(struct view_t *view, struct dir_entry_t *entry);
+
+/* Callback-like function which triggers some view-specific updates after the
+ * entry is added to the list or its name or origin changes. */
+void fview_entry_added(struct view_t *view, struct dir_entry_t *entry);
+
 /* Callback-like function which triggers some view-specific updates after cursor
  * position in the list changed. */
 void fview_position_updated(struct view_t *view);
@@ -174,6 +190,14 @@ TSTATIC_DEFS(
 	struct format_info_t;
 	void format_name(void *data, size_t buf_len, char buf[],
 		const struct format_info_t *info);
+	int frame_begin(struct view_t *view, size_t col_count, size_t col_width,
+		int ncells);
+	void frame_end(struct view_t *view);
+	int frame_cell_changed(const struct view_t *view, int cell,
+		const column_data_t *cdt);
+	void frame_cell_drawn(struct view_t *view, int top, int cell,
+		const column_data_t *cdt, int is_volatile);
+	void frame_cell_overdrawn(struct view_t *view, int cell, int line);
 )
 
 #endif /* VIFM__UI__FILEVIEW_H__ */
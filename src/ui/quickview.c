@@ -61,6 +61,10 @@
 /* Maximum number of lines used for preview. */
 enum { MAX_PREVIEW_LINES = 256 };
 
+/* Number of entries to prefetch previews of in the direction of movement and
+ * in the opposite direction. */
+enum { PREFETCH_AHEAD = 3, PREFETCH_BEHIND = 1 };
+
 /* Cached information about a single file's preview. */
 typedef struct
 {
@@ -101,6 +105,9 @@ static void update_cache(quickview_cache_t *cache, const char path[],
 		const char viewer[], ViewerKind kind, const preview_area_t *parea,
 		int max_lines);
 static strlist_t get_lines(const quickview_cache_t *cache);
+static void prefetch_neighbours(view_t *view, const preview_area_t *parea);
+static void prefetch_entry(view_t *view, int pos, const preview_area_t *parea);
+static int get_max_lines(const char path[], const view_t *view);
 static void print_tree_stats(tree_print_state_t *s);
 static int print_dir_tree(tree_print_state_t *s, const char path[], int last);
 static void collect_subtree_stats(tree_print_state_t *s, const char path[]);
@@ -220,6 +227,7 @@ qv_draw(view_t *view)
 			.h = ui_qv_height(other_view),
 		};
 		(void)view_entry(curr, &parea, &qv_cache);
+		prefetch_neighbours(view, &parea);
 	}
 
 	refresh_view_win(other_view);
@@ -335,8 +343,7 @@ view_file(const char path[], const preview_area_t *parea,
 		return clear_cmd;
 	}
 
-	int max_lines = is_dir(path) ? ui_qv_height(parea->view)
-	                             : MAX_PREVIEW_LINES;
+	int max_lines = get_max_lines(path, parea->view);
 
 	/* If graphics will be displayed, clear the window and wait a bit to let
 	 * terminal emulator do actual refresh (at least some of them need this). */
@@ -451,6 +458,97 @@ get_lines(const quickview_cache_t *cache)
 	return lines;
 }
 
+/* Starts producing previews of entries around the current one in the
+ * direction of cursor movement, so they are ready by the time cursor gets
+ * there. */
+static void
+prefetch_neighbours(view_t *view, const preview_area_t *parea)
+{
+	static const view_t *last_view;
+	static int last_pos;
+
+	const int forward = (view != last_view || view->list_pos >= last_pos);
+	last_view = view;
+	last_pos = view->list_pos;
+
+	const int step = (forward ? 1 : -1);
+
+	vcache_prefetch_begin();
+
+	/* Closer entries come first to be picked up before reaching the limit on
+	 * number of prefetches. */
+	int i;
+	for(i = 1; i <= PREFETCH_AHEAD; ++i)
+	{
+		prefetch_entry(view, view->list_pos + step*i, parea);
+		if(i <= PREFETCH_BEHIND)
+		{
+			prefetch_entry(view, view->list_pos - step*i, parea);
+		}
+	}
+
+	vcache_prefetch_end();
+}
+
+/* Initiates preview of the specified entry of the view if it's produced by an
+ * external textual viewer. */
+static void
+prefetch_entry(view_t *view, int pos, const preview_area_t *parea)
+{
+	if(pos < 0 || pos >= view->list_rows)
+	{
+		return;
+	}
+
+	const dir_entry_t *entry = &view->dir_entry[pos];
+	if(fentry_is_fake(entry) || (entry->type != FT_REG && entry->type != FT_DIR))
+	{
+		return;
+	}
+
+	char path[PATH_MAX + 1];
+	qv_get_path_to_explore(entry, path, sizeof(path));
+
+	const char *viewer = qv_get_viewer(path);
+	if(viewer == NULL || ft_viewer_kind(viewer) != VK_TEXTUAL)
+	{
+		return;
+	}
+
+	view_t *curr = curr_view;
+	curr_view = view;
+	curr_stats.preview_hint = parea;
+
+	/* Macros are expanded for the current entry, so temporarily make the
+	 * prefetched one current. */
+	const int list_pos = view->list_pos;
+	view->list_pos = pos;
+
+	MacroFlags flags = MF_NONE;
+	char *expanded = qv_expand_viewer(view, viewer, &flags);
+
+	view->list_pos = list_pos;
+
+	if(!ma_flags_present(flags, MF_PIPE_FILE_LIST) &&
+			!ma_flags_present(flags, MF_PIPE_FILE_LIST_Z))
+	{
+		(void)vcache_prefetch(path, expanded, flags,
+				get_max_lines(path, parea->view));
+	}
+	free(expanded);
+
+	curr_stats.preview_hint = NULL;
+	curr_view = curr;
+}
+
+/* Computes number of lines to request from a viewer for a preview.  Returns
+ * the number. */
+static int
+get_max_lines(const char path[], const view_t *view)
+{
+	return is_dir(path) ? ui_qv_height(view) : MAX_PREVIEW_LINES;
+}
+
 FILE *
 qv_view_dir(const char path[], int max_lines)
 {
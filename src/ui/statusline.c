@@ -24,8 +24,9 @@
 #include <assert.h> /* assert() */
 #include <ctype.h> /* isdigit() */
 #include <stddef.h> /* NULL size_t */
-#include <stdlib.h> /* free() */
-#include <string.h> /* strcat() strdup() strlen() */
+#include <stdint.h> /* uint64_t */
+#include <stdlib.h> /* calloc() free() */
+#include <string.h> /* strcat() strcmp() strdup() strlen() */
 #include <time.h> /* time() */
 #include <unistd.h>
 
@@ -35,9 +36,11 @@
 #include "../engine/mode.h"
 #include "../engine/parsing.h"
 #include "../engine/var.h"
+#include "../engine/variables.h"
 #include "../lua/vlua.h"
 #include "../modes/modes.h"
 #include "../utils/fs.h"
+#include "../utils/darray.h"
 #include "../utils/log.h"
 #include "../utils/macros.h"
 #include "../utils/path.h"
@@ -46,18 +49,110 @@
 #include "../utils/test_helpers.h"
 #include "../utils/utf8.h"
 #include "../utils/utils.h"
+#include "../utils/xxhash.h"
 #include "../background.h"
 #include "../filelist.h"
+#include "../opt_handlers.h"
 #include "color_scheme.h"
 #include "colored_line.h"
+#include "tabs.h"
 #include "ui.h"
 
+/* Number of seconds during which values derived from file-system state are
+ * reused. */
+#define FS_TTL 2
+
+/* Number of seconds during which results of expressions and Lua handlers are
+ * reused. */
+#define EXPR_TTL 1
+
+/* Inputs that values of macros can depend on. */
+enum
+{
+	DEP_ENTRY     = 1 << 0, /* Current entry. */
+	DEP_DIR       = 1 << 1, /* Current directory. */
+	DEP_POS       = 1 << 2, /* Position of cursor and size of the list. */
+	DEP_SELECTION = 1 << 3, /* Selection. */
+	DEP_STATE     = 1 << 4, /* Options, variables, layout and the other view. */
+
+	/* Anything that is tracked. */
+	DEP_ANY = DEP_ENTRY | DEP_DIR | DEP_POS | DEP_SELECTION | DEP_STATE
+};
+
+/* Type of a part of compiled format. */
+typedef enum
+{
+	FPT_TEXT,     /* Literal text. */
+	FPT_EXPANDER, /* Place where the line is split to fill the width (%=). */
+	FPT_MACRO,    /* Macro including %{...} expression and %N* color. */
+	FPT_OPT,      /* Optional part (%[...%]). */
+}
+fmt_part_type_t;
+
+struct fmt_t;
+
+/* Element of compiled format. */
+typedef struct
+{
+	fmt_part_type_t type; /* Type of the part. */
+	char macro;           /* Macro character. */
+	char *text;           /* Literal text or expression. */
+	size_t width;         /* Minimal width of expanded macro. */
+	int left_align;       /* Whether expanded macro is aligned to the left. */
+	struct fmt_t *opt;    /* Contents of optional part. */
+
+	char *value;          /* Value of macro computed previously or NULL. */
+	uint64_t inputs;      /* Fingerprint of inputs of the value. */
+	time_t computed_at;   /* When the value was computed. */
+}
+fmt_part_t;
+
+/* Format string with its macros parsed in advance. */
+typedef struct fmt_t
+{
+	fmt_part_t *parts;         /* List of parts. */
+	DA_INSTANCE_FIELD(parts);  /* Declarations to enable use of DA_* on parts. */
+	int closed;                /* Whether optional part is terminated by %]. */
+	int users;                 /* Number of expansions that use the format. */
+}
+fmt_t;
+
+/* Entry of the cache of compiled formats. */
+typedef struct
+{
+	char *format; /* Format string. */
+	char *macros; /* Macros recognized in the format. */
+	fmt_t *fmt;   /* Compiled format. */
+}
+compiled_fmt_t;
+
+/* Description of when value of a macro can be reused. */
+typedef struct
+{
+	char macro; /* Macro character. */
+	int deps;   /* Combination of DEP_* flags. */
+	int ttl;    /* Lifetime of the value in seconds or zero if unlimited. */
+}
+cache_policy_t;
+
 static void split_and_print_status_line(view_t *view, int width);
 static void update_stat_window_old(view_t *view, int lazy_redraw);
 static void refresh_window(WINDOW *win, int lazily);
 TSTATIC cline_t expand_status_line_macros(view_t *view, const char format[]);
-static cline_t parse_view_macros(view_t *view, const char **format,
-		const char macros[], int opt);
+static cline_t parse_view_macros(view_t *view, const char format[],
+		const char macros[]);
+static fmt_t * get_compiled_fmt(const char format[], const char macros[],
+		int *cached);
+static fmt_t * compile_fmt(const char **format, const char macros[], int opt);
+static int add_text_part(fmt_t *fmt, char **text, size_t *text_len);
+static int add_part(fmt_t *fmt, const fmt_part_t *part);
+static void free_fmt(fmt_t *fmt);
+static cline_t eval_fmt(view_t *view, fmt_t *fmt, int opt);
+static int get_macro_value(view_t *view, const dir_entry_t *curr,
+		fmt_part_t *part, char buf[], size_t buf_len);
+static int expand_macro(view_t *view, const dir_entry_t *curr,
+		const fmt_part_t *part, char buf[], size_t buf_len);
+static uint64_t get_inputs_fingerprint(view_t *view, int deps);
 static int expand_num(char buf[], size_t buf_len, int val);
 static const char * get_tip(void);
 static char * extract_unescaping_closing_brace(const char from[],
@@ -76,6 +171,29 @@ static char ** take_job_descr_snapshot(void);
 /* List of macros that are expanded in the status line. */
 static const char STATUS_LINE_MACROS[] = "tTfacAugsEdD-xlLoPSz%[]{*";
 
+/* Macros whose values are reused while their inputs stay the same.  Other
+ * macros are cheap to compute. */
+static const cache_policy_t cache_policies[] = {
+	{ 'a', DEP_DIR,   FS_TTL },
+	{ 'c', DEP_DIR,   FS_TTL },
+	{ 'T', DEP_ENTRY, FS_TTL },
+	{ '{', DEP_ANY,   EXPR_TTL },
+};
+
+/* Recently used formats in compiled form. */
+static compiled_fmt_t compiled_fmts[8];
+/* Index of the next element of compiled_fmts to be replaced. */
+static int next_compiled_fmt;
+
+/* Last result of Lua handler of status line. */
+static struct
+{
+	char *format;       /* Format produced by the handler or NULL. */
+	uint64_t inputs;    /* Fingerprint of inputs of the handler. */
+	time_t computed_at; /* When the handler was called. */
+}
+lua_status_line;
+
 /* Number of background jobs. */
 static size_t nbar_jobs;
 /* Array of jobs. */
@@ -261,7 +379,7 @@ expand_status_line_macros(view_t *view, const char format[])
 		return cline_make();
 	}
 
-	return parse_view_macros(view, &format, STATUS_LINE_MACROS, 0);
+	return parse_view_macros(view, format, STATUS_LINE_MACROS);
 }
 
 /* Expands possibly limited set of view macros.  Returns newly allocated string,
@@ -269,308 +387,378 @@ expand_status_line_macros(view_t *view, const char format[])
 char *
 expand_view_macros(view_t *view, const char format[], const char macros[])
 {
-	cline_t result = parse_view_macros(view, &format, macros, 0);
+	cline_t result = parse_view_macros(view, format, macros);
 	free(result.attrs);
 	return result.line;
 }
 
-/* Expands macros in the *format string advancing the pointer as it goes.  The
- * opt represents conditional expression state, should be zero for non-recursive
- * calls.  Returns colored line. */
+/* Expands macros in the format string.  Returns colored line. */
 static cline_t
-parse_view_macros(view_t *view, const char **format, const char macros[],
-		int opt)
+parse_view_macros(view_t *view, const char format[], const char macros[])
 {
-	/* Mind that find_view_macro() needs to be in sync with this function. */
+	if(get_current_entry(view) == NULL)
+	{
+		return cline_make();
+	}
 
-	const dir_entry_t *const curr = get_current_entry(view);
-	cline_t result = cline_make();
-	char c;
-	int nexpansions = 0;
-	int has_expander = 0;
+	int cached;
+	fmt_t *const fmt = get_compiled_fmt(format, macros, &cached);
+	if(fmt == NULL)
+	{
+		return cline_make();
+	}
 
-	if(curr == NULL)
+	/* Evaluation can cause nested expansion, which shouldn't free this format
+	 * while it's in use. */
+	++fmt->users;
+	cline_t result = eval_fmt(view, fmt, /*opt=*/0);
+	--fmt->users;
+
+	if(!cached)
 	{
-		return result;
+		free_fmt(fmt);
+	}
+	return result;
+}
+
+/* Looks up compiled version of the format in the cache compiling and caching
+ * it if necessary.  Sets *cached to zero if the result isn't in the cache and
+ * must be freed by the caller.  Returns compiled format or NULL on error. */
+static fmt_t *
+get_compiled_fmt(const char format[], const char macros[], int *cached)
+{
+	int i;
+	for(i = 0; i < (int)ARRAY_LEN(compiled_fmts); ++i)
+	{
+		compiled_fmt_t *const entry = &compiled_fmts[i];
+		if(entry->fmt != NULL && strcmp(entry->format, format) == 0 &&
+				strcmp(entry->macros, macros) == 0)
+		{
+			*cached = 1;
+			return entry->fmt;
+		}
+	}
+
+	const char *input = format;
+	fmt_t *const fmt = compile_fmt(&input, macros, /*opt=*/0);
+	if(fmt == NULL)
+	{
+		return NULL;
+	}
+
+	/* Replace the oldest entry that isn't being used. */
+	for(i = 0; i < (int)ARRAY_LEN(compiled_fmts); ++i)
+	{
+		compiled_fmt_t *const entry = &compiled_fmts[next_compiled_fmt];
+		next_compiled_fmt = (next_compiled_fmt + 1)%ARRAY_LEN(compiled_fmts);
+
+		if(entry->fmt != NULL && entry->fmt->users != 0)
+		{
+			continue;
+		}
+
+		char *const format_copy = strdup(format);
+		char *const macros_copy = strdup(macros);
+		if(format_copy == NULL || macros_copy == NULL)
+		{
+			free(format_copy);
+			free(macros_copy);
+			break;
+		}
+
+		free(entry->format);
+		free(entry->macros);
+		free_fmt(entry->fmt);
+		entry->format = format_copy;
+		entry->macros = macros_copy;
+		entry->fmt = fmt;
+
+		*cached = 1;
+		return fmt;
+	}
+
+	*cached = 0;
+	return fmt;
+}
+
+/* Parses macros in the *format string advancing the pointer as it goes.  The
+ * opt represents conditional expression state, should be zero for non-recursive
+ * calls.  Returns compiled format or NULL on error. */
+static fmt_t *
+compile_fmt(const char **format, const char macros[], int opt)
+{
+	/* Mind that find_view_macro() needs to be in sync with this function. */
+
+	fmt_t *const fmt = calloc(1, sizeof(*fmt));
+	if(fmt == NULL)
+	{
+		return NULL;
 	}
 
+	char *text = NULL;
+	size_t text_len = 0U;
+	int has_expander = 0;
+	char c;
+
 	while((c = **format) != '\0')
 	{
-		size_t width = 0;
-		int left_align = 0;
-		char buf[PATH_MAX + 1];
 		const char *const next = ++*format;
-		int skip, ok;
 
 		if(c != '%' ||
 				(!char_is_one_of(macros, *next) && !isdigit(*next) &&
 				 (*next != '=' || has_expander)))
 		{
-			if(strappendch(&result.line, &result.line_len, c) != 0)
+			if(strappendch(&text, &text_len, c) != 0)
 			{
-				break;
+				goto fail;
 			}
 			continue;
 		}
 
 		if(*next == '=')
 		{
-			(void)cline_sync(&result, 0);
-
-			if(strappend(&result.line, &result.line_len, "%=") != 0 ||
-					strappendch(&result.attrs, &result.attrs_len, '=') != 0)
+			const fmt_part_t part = { .type = FPT_EXPANDER };
+			if(add_text_part(fmt, &text, &text_len) != 0 ||
+					add_part(fmt, &part) != 0)
 			{
-				break;
+				goto fail;
 			}
 			++*format;
 			has_expander = 1;
 			continue;
 		}
 
+		fmt_part_t part = { .type = FPT_MACRO };
+
 		if(*next == '-')
 		{
-			left_align = 1;
+			part.left_align = 1;
 			++*format;
 		}
 
 		while(isdigit(**format))
 		{
-			width = width*10 + *(*format)++ - '0';
+			part.width = part.width*10 + *(*format)++ - '0';
 		}
 		c = *(*format)++;
+		part.macro = c;
 
-		/* Query drive information at most once. */
-		uint64_t free_space;
-		uint64_t total_space;
-		int have_drive_info = 0;
-
-		skip = 0;
-		ok = 1;
-		buf[0] = '\0';
-		switch(c)
+		int ok = 1;
+		if(c == '[')
 		{
-			char path[PATH_MAX + 1];
-			char *escaped;
-
-			case 'a':
-				have_drive_info = have_drive_info ||
-					(get_drive_info(curr_view->curr_dir, &total_space, &free_space) == 0);
-				if(have_drive_info)
-				{
-					friendly_size_notation(free_space, sizeof(buf), buf);
-				}
-				break;
-			case 'c':
-				have_drive_info = have_drive_info ||
-					(get_drive_info(curr_view->curr_dir, &total_space, &free_space) == 0);
-				if(have_drive_info)
-				{
-					friendly_size_notation(total_space, sizeof(buf), buf);
-				}
-				break;
-			case 't':
-			case 'f':
-				if(c == 't')
-				{
-					format_entry_name(curr, NF_FULL, sizeof(path), path);
-				}
-				else
+			part.type = FPT_OPT;
+			part.opt = compile_fmt(format, macros, 1);
+			if(part.opt == NULL)
+			{
+				goto fail;
+			}
+		}
+		else if(c == ']')
+		{
+			if(opt)
+			{
+				if(add_text_part(fmt, &text, &text_len) != 0)
 				{
-					get_short_path_of(view, curr, NF_FULL, 0, sizeof(path), path);
+					goto fail;
 				}
-				escaped = escape_unreadable(path);
-				copy_str(buf, sizeof(buf), escaped);
-				free(escaped);
-				break;
-			case 'T':
-				if(curr->type == FT_LINK)
+				fmt->closed = 1;
+				return fmt;
+			}
+
+			LOG_INFO_MSG("Unmatched %%]");
+			ok = 0;
+		}
+		else if(c == '{')
+		{
+			/* Try to find matching closing bracket. */
+			const char *e = find_closing_brace(*format);
+
+			/* If there's no matching closing bracket, just add the opening one
+			 * literally. */
+			if(e == NULL)
+			{
+				ok = 0;
+			}
+			else
+			{
+				part.text = extract_unescaping_closing_brace(*format, e);
+				ok = (part.text != NULL);
+				if(ok)
 				{
-					char full_path[PATH_MAX + 1];
-					get_full_path_of(curr, sizeof(full_path), full_path);
-					if(get_link_target(full_path, buf, sizeof(buf)) != 0)
-					{
-						copy_str(buf, sizeof(buf), "Failed to resolve link");
-					}
+					*format = e + 1 /* closing bracket */;
 				}
-				break;
-			case 'A':
-#ifndef _WIN32
-				get_perm_string(buf, sizeof(buf), curr->mode);
-#else
-				copy_str(buf, sizeof(buf), attr_str_long(curr->attrs));
-#endif
-				break;
-			case 'o':
-#ifndef _WIN32
-				snprintf(buf, sizeof(buf), "%03o", curr->mode & 0777);
-#endif
-				break;
-			case 'u':
-				get_uid_string(curr, 0, sizeof(buf), buf);
-				break;
-			case 'g':
-				get_gid_string(curr, 0, sizeof(buf), buf);
-				break;
-			case 's':
-				friendly_size_notation(fentry_get_size(view, curr), sizeof(buf), buf);
-				break;
-			case 'E':
-				{
-					uint64_t size = 0U;
+			}
+		}
+		else if(!char_is_one_of("acftTAougsEd-xlLPS%zD*", c))
+		{
+			LOG_INFO_MSG("Unexpected %%-sequence: %%%c", c);
+			ok = 0;
+		}
 
-					typedef int (*iter_f)(view_t *view, dir_entry_t **entry);
-					/* No current element for visual mode, since it can contain truly
-					 * empty selection when cursor is on ../ directory. */
-					iter_f iter = vle_mode_is(VISUAL_MODE) ? &iter_selected_entries
-					                                       : &iter_selection_or_current;
+		if(!ok)
+		{
+			*format = next;
+			if(strappendch(&text, &text_len, '%') != 0)
+			{
+				goto fail;
+			}
+			continue;
+		}
 
-					dir_entry_t *entry = NULL;
-					while(iter(view, &entry))
-					{
-						size += fentry_get_size(view, entry);
-					}
+		if(add_text_part(fmt, &text, &text_len) != 0 || add_part(fmt, &part) != 0)
+		{
+			free(part.text);
+			free_fmt(part.opt);
+			goto fail;
+		}
+	}
 
-					friendly_size_notation(size, sizeof(buf), buf);
-				}
-				break;
-			case 'd':
-				{
-					struct tm *tm_ptr = localtime(&curr->mtime);
-					strftime(buf, sizeof(buf), cfg.time_format, tm_ptr);
-				}
-				break;
-			case '-':
-			case 'x':
-				skip = expand_num(buf, sizeof(buf), view->filtered);
-				break;
-			case 'l':
-				skip = expand_num(buf, sizeof(buf), view->list_pos + 1);
-				break;
-			case 'L':
-				skip = expand_num(buf, sizeof(buf), view->list_rows + view->filtered);
-				break;
-			case 'P':
-				format_position(buf, sizeof(buf), view->top_line, view->list_rows,
-						view->window_cells);
-				break;
-			case 'S':
-				skip = expand_num(buf, sizeof(buf), view->list_rows);
-				break;
-			case '%':
-				copy_str(buf, sizeof(buf), "%");
-				break;
-			case 'z':
-				copy_str(buf, sizeof(buf), get_tip());
-				break;
-			case 'D':
-				if(curr_stats.number_of_windows == 1)
-				{
-					view_t *const other = (view == curr_view) ? other_view : curr_view;
-					copy_str(buf, sizeof(buf), replace_home_part(other->curr_dir));
-				}
-				break;
-			case '[':
-				{
-					cline_t opt = parse_view_macros(view, format, macros, 1);
-					copy_str(buf, sizeof(buf), opt.line);
-					free(opt.line);
+	if(add_text_part(fmt, &text, &text_len) != 0)
+	{
+		goto fail;
+	}
+	return fmt;
 
-					cline_splice_attrs(&result, &opt);
-					break;
-				}
-			case ']':
-				if(opt)
-				{
-					if(nexpansions == 0)
-					{
-						cline_clear(&result);
-					}
-					cline_finish(&result);
-					return result;
-				}
+fail:
+	free(text);
+	free_fmt(fmt);
+	return NULL;
+}
 
-				LOG_INFO_MSG("Unmatched %%]");
-				ok = 0;
-				break;
-			case '{':
-				{
-					/* Try to find matching closing bracket. */
-					const char *e = find_closing_brace(*format);
-
-					/* If there's no matching closing bracket, just add the opening one
-					 * literally. */
-					if(e == NULL)
-					{
-						ok = 0;
-						break;
-					}
-
-					char *expr = extract_unescaping_closing_brace(*format, e);
-					if(expr == NULL)
-					{
-						ok = 0;
-						break;
-					}
-
-					/* Try to parse expr and convert the result to string on success. */
-					parsing_result_t result = vle_parser_eval(expr, /*interactive=*/0);
-
-					char *res_str = NULL;
-					if(result.error == PE_NO_ERROR)
-					{
-						res_str = var_to_str(result.value);
-					}
-
-					if(res_str != NULL)
-					{
-						copy_str(buf, sizeof(buf), res_str);
-					}
-					else
-					{
-						copy_str(buf, sizeof(buf), "<Invalid expr>");
-					}
-
-					var_free(result.value);
-					free(res_str);
-					free(expr);
+/* Turns accumulated literal text into a part of the format.  Returns zero on
+ * success, otherwise non-zero is returned. */
+static int
+add_text_part(fmt_t *fmt, char **text, size_t *text_len)
+{
+	if(*text == NULL)
+	{
+		return 0;
+	}
 
-					*format = e + 1 /* closing bracket */;
-				}
-				break;
-			case '*':
-				if(width > LAST_USER_COLOR)
-				{
-					snprintf(buf, sizeof(buf), "%%%d*", (int)width);
-					width = 0;
-					break;
-				}
-				cline_set_attr(&result, /*user_color=*/width);
-				width = 0;
-				break;
+	const fmt_part_t part = { .type = FPT_TEXT, .text = *text };
+	if(add_part(fmt, &part) != 0)
+	{
+		return 1;
+	}
 
-			default:
-				LOG_INFO_MSG("Unexpected %%-sequence: %%%c", c);
-				ok = 0;
-				break;
-		}
+	*text = NULL;
+	*text_len = 0U;
+	return 0;
+}
+
+/* Appends part to the format, which takes ownership of its data.  Returns zero
+ * on success, otherwise non-zero is returned. */
+static int
+add_part(fmt_t *fmt, const fmt_part_t *part)
+{
+	fmt_part_t *const new_part = DA_EXTEND(fmt->parts);
+	if(new_part == NULL)
+	{
+		return 1;
+	}
+
+	*new_part = *part;
+	DA_COMMIT(fmt->parts);
+	return 0;
+}
+
+/* Frees compiled format.  The parameter can be NULL. */
+static void
+free_fmt(fmt_t *fmt)
+{
+	if(fmt == NULL)
+	{
+		return;
+	}
+
+	size_t i;
+	for(i = 0U; i < DA_SIZE(fmt->parts); ++i)
+	{
+		free(fmt->parts[i].text);
+		free(fmt->parts[i].value);
+		free_fmt(fmt->parts[i].opt);
+	}
+	free(fmt->parts);
+	free(fmt);
+}
+
+/* Expands compiled format.  The opt flag is set for contents of %[...%].
+ * Returns colored line. */
+static cline_t
+eval_fmt(view_t *view, fmt_t *fmt, int opt)
+{
+	const dir_entry_t *const curr = get_current_entry(view);
+	cline_t result = cline_make();
+	int nexpansions = 0;
+
+	if(curr == NULL)
+	{
+		return result;
+	}
+
+	size_t i;
+	for(i = 0U; i < DA_SIZE(fmt->parts); ++i)
+	{
+		fmt_part_t *const part = &fmt->parts[i];
 
-		if(char_is_one_of("tTAugsEd", c) && fentry_is_fake(curr))
+		if(part->type == FPT_TEXT)
 		{
-			buf[0] = '\0';
+			if(strappend(&result.line, &result.line_len, part->text) != 0)
+			{
+				break;
+			}
+			continue;
 		}
 
-		if(!ok)
+		if(part->type == FPT_EXPANDER)
 		{
-			*format = next;
-			if(strappendch(&result.line, &result.line_len, '%') != 0)
+			(void)cline_sync(&result, 0);
+
+			if(strappend(&result.line, &result.line_len, "%=") != 0 ||
+					strappendch(&result.attrs, &result.attrs_len, '=') != 0)
 			{
 				break;
 			}
 			continue;
 		}
 
+		char buf[PATH_MAX + 1];
+		size_t width = part->width;
+		int skip = 0;
+
+		buf[0] = '\0';
+		if(part->type == FPT_OPT)
+		{
+			cline_t opt = eval_fmt(view, part->opt, 1);
+			copy_str(buf, sizeof(buf), opt.line);
+			free(opt.line);
+
+			cline_splice_attrs(&result, &opt);
+		}
+		else if(part->macro == '*')
+		{
+			if(width > LAST_USER_COLOR)
+			{
+				snprintf(buf, sizeof(buf), "%%%d*", (int)width);
+			}
+			else
+			{
+				cline_set_attr(&result, /*user_color=*/width);
+			}
+			width = 0;
+		}
+		else
+		{
+			skip = get_macro_value(view, curr, part, buf, sizeof(buf));
+		}
+
+		if(char_is_one_of("tTAugsEd", part->macro) && fentry_is_fake(curr))
+		{
+			buf[0] = '\0';
+		}
+
 		check_expanded_str(buf, skip, &nexpansions);
-		stralign(buf, width, ' ', left_align);
+		stralign(buf, width, ' ', part->left_align);
 
 		if(strappend(&result.line, &result.line_len, buf) != 0)
 		{
@@ -578,17 +766,284 @@ parse_view_macros(view_t *view, const char **format, const char macros[],
 		}
 	}
 
-	/* Unmatched %[. */
 	if(opt)
 	{
-		(void)strprepend(&result.line, &result.line_len, "%[");
-		(void)strprepend(&result.attrs, &result.attrs_len, "  ");
+		if(fmt->closed)
+		{
+			if(nexpansions == 0)
+			{
+				cline_clear(&result);
+			}
+		}
+		else
+		{
+			/* Unmatched %[. */
+			(void)strprepend(&result.line, &result.line_len, "%[");
+			(void)strprepend(&result.attrs, &result.attrs_len, "  ");
+		}
 	}
 
 	cline_finish(&result);
 	return result;
 }
 
+/* Retrieves value of a macro reusing previously computed one if inputs of the
+ * macro haven't changed.  Returns non-zero if numeric value is "empty". */
+static int
+get_macro_value(view_t *view, const dir_entry_t *curr, fmt_part_t *part,
+		char buf[], size_t buf_len)
+{
+	const cache_policy_t *policy = NULL;
+
+	size_t i;
+	for(i = 0U; i < ARRAY_LEN(cache_policies); ++i)
+	{
+		if(cache_policies[i].macro == part->macro)
+		{
+			policy = &cache_policies[i];
+			break;
+		}
+	}
+
+	if(policy == NULL)
+	{
+		return expand_macro(view, curr, part, buf, buf_len);
+	}
+
+	const uint64_t inputs = get_inputs_fingerprint(view, policy->deps);
+	const time_t now = time(NULL);
+
+	if(part->value != NULL && part->inputs == inputs &&
+			(policy->ttl == 0 || now - part->computed_at < policy->ttl))
+	{
+		copy_str(buf, buf_len, part->value);
+		return 0;
+	}
+
+	const int skip = expand_macro(view, curr, part, buf, buf_len);
+	if(replace_string(&part->value, buf) == 0)
+	{
+		part->inputs = inputs;
+		part->computed_at = now;
+	}
+	return skip;
+}
+
+/* Expands single macro into the buffer.  Returns non-zero if numeric value is
+ * "empty" (zero). */
+static int
+expand_macro(view_t *view, const dir_entry_t *curr, const fmt_part_t *part,
+		char buf[], size_t buf_len)
+{
+	uint64_t free_space;
+	uint64_t total_space;
+
+	switch(part->macro)
+	{
+		char path[PATH_MAX + 1];
+		char *escaped;
+
+		case 'a':
+			if(get_drive_info(curr_view->curr_dir, &total_space, &free_space) == 0)
+			{
+				friendly_size_notation(free_space, buf_len, buf);
+			}
+			break;
+		case 'c':
+			if(get_drive_info(curr_view->curr_dir, &total_space, &free_space) == 0)
+			{
+				friendly_size_notation(total_space, buf_len, buf);
+			}
+			break;
+		case 't':
+		case 'f':
+			if(part->macro == 't')
+			{
+				format_entry_name(curr, NF_FULL, sizeof(path), path);
+			}
+			else
+			{
+				get_short_path_of(view, curr, NF_FULL, 0, sizeof(path), path);
+			}
+			escaped = escape_unreadable(path);
+			copy_str(buf, buf_len, escaped);
+			free(escaped);
+			break;
+		case 'T':
+			if(curr->type == FT_LINK)
+			{
+				char full_path[PATH_MAX + 1];
+				get_full_path_of(curr, sizeof(full_path), full_path);
+				if(get_link_target(full_path, buf, buf_len) != 0)
+				{
+					copy_str(buf, buf_len, "Failed to resolve link");
+				}
+			}
+			break;
+		case 'A':
+#ifndef _WIN32
+			get_perm_string(buf, buf_len, curr->mode);
+#else
+			copy_str(buf, buf_len, attr_str_long(curr->attrs));
+#endif
+			break;
+		case 'o':
+#ifndef _WIN32
+			snprintf(buf, buf_len, "%03o", curr->mode & 0777);
+#endif
+			break;
+		case 'u':
+			get_uid_string(curr, 0, buf_len, buf);
+			break;
+		case 'g':
+			get_gid_string(curr, 0, buf_len, buf);
+			break;
+		case 's':
+			friendly_size_notation(fentry_get_size(view, curr), buf_len, buf);
+			break;
+		case 'E':
+			{
+				uint64_t size = 0U;
+
+				typedef int (*iter_f)(view_t *view, dir_entry_t **entry);
+				/* No current element for visual mode, since it can contain truly
+				 * empty selection when cursor is on ../ directory. */
+				iter_f iter = vle_mode_is(VISUAL_MODE) ? &iter_selected_entries
+				                                       : &iter_selection_or_current;
+
+				dir_entry_t *entry = NULL;
+				while(iter(view, &entry))
+				{
+					size += fentry_get_size(view, entry);
+				}
+
+				friendly_size_notation(size, buf_len, buf);
+			}
+			break;
+		case 'd':
+			{
+				struct tm *tm_ptr = localtime(&curr->mtime);
+				strftime(buf, buf_len, cfg.time_format, tm_ptr);
+			}
+			break;
+		case '-':
+		case 'x':
+			return expand_num(buf, buf_len, view->filtered);
+		case 'l':
+			return expand_num(buf, buf_len, view->list_pos + 1);
+		case 'L':
+			return expand_num(buf, buf_len, view->list_rows + view->filtered);
+		case 'P':
+			format_position(buf, buf_len, view->top_line, view->list_rows,
+					view->window_cells);
+			break;
+		case 'S':
+			return expand_num(buf, buf_len, view->list_rows);
+		case '%':
+			copy_str(buf, buf_len, "%");
+			break;
+		case 'z':
+			copy_str(buf, buf_len, get_tip());
+			break;
+		case 'D':
+			if(curr_stats.number_of_windows == 1)
+			{
+				view_t *const other = (view == curr_view) ? other_view : curr_view;
+				copy_str(buf, buf_len, replace_home_part(other->curr_dir));
+			}
+			break;
+		case '{':
+			{
+				/* Try to parse expr and convert the result to string on success. */
+				parsing_result_t result = vle_parser_eval(part->text,
+						/*interactive=*/0);
+
+				char *res_str = NULL;
+				if(result.error == PE_NO_ERROR)
+				{
+					res_str = var_to_str(result.value);
+				}
+
+				if(res_str != NULL)
+				{
+					copy_str(buf, buf_len, res_str);
+				}
+				else
+				{
+					copy_str(buf, buf_len, "<Invalid expr>");
+				}
+
+				var_free(result.value);
+				free(res_str);
+			}
+			break;
+	}
+
+	return 0;
+}
+
+/* Computes fingerprint of the inputs specified by a combination of DEP_*
+ * flags.  Returns the fingerprint. */
+static uint64_t
+get_inputs_fingerprint(view_t *view, int deps)
+{
+	uint64_t hash = XXH3_64bits(&view, sizeof(view));
+
+	const dir_entry_t *const entry = get_current_entry(view);
+	if((deps & DEP_ENTRY) && entry != NULL)
+	{
+		hash = XXH3_64bits_withSeed(entry->name, strlen(entry->name), hash);
+		hash = XXH3_64bits_withSeed(entry->origin, strlen(entry->origin), hash);
+		hash = XXH3_64bits_withSeed(&entry->size, sizeof(entry->size), hash);
+		hash = XXH3_64bits_withSeed(&entry->mtime, sizeof(entry->mtime), hash);
+#ifndef _WIN32
+		hash = XXH3_64bits_withSeed(&entry->uid, sizeof(entry->uid), hash);
+		hash = XXH3_64bits_withSeed(&entry->gid, sizeof(entry->gid), hash);
+		hash = XXH3_64bits_withSeed(&entry->mode, sizeof(entry->mode), hash);
+#else
+		hash = XXH3_64bits_withSeed(&entry->attrs, sizeof(entry->attrs), hash);
+#endif
+		const int type = entry->type;
+		hash = XXH3_64bits_withSeed(&type, sizeof(type), hash);
+	}
+
+	if(deps & DEP_DIR)
+	{
+		hash = XXH3_64bits_withSeed(view->curr_dir, strlen(view->curr_dir), hash);
+		hash = XXH3_64bits_withSeed(curr_view->curr_dir,
+				strlen(curr_view->curr_dir), hash);
+	}
+
+	if(deps & DEP_POS)
+	{
+		const int pos[] = {
+			view->list_pos, view->top_line, view->list_rows, view->filtered,
+			view->window_cells
+		};
+		hash = XXH3_64bits_withSeed(pos, sizeof(pos), hash);
+	}
+
+	if(deps & DEP_SELECTION)
+	{
+		const int selection[] = { view->selected_files, vle_mode_get() };
+		hash = XXH3_64bits_withSeed(selection, sizeof(selection), hash);
+	}
+
+	if(deps & DEP_STATE)
+	{
+		const int state[] = {
+			get_option_changes(), get_variable_changes(),
+			curr_stats.number_of_windows,
+			tabs_current(view), (view == curr_view)
+		};
+		hash = XXH3_64bits_withSeed(state, sizeof(state), hash);
+		hash = XXH3_64bits_withSeed(other_view->curr_dir,
+				strlen(other_view->curr_dir), hash);
+	}
+
+	return hash;
+}
+
 /* Prints number into the buffer.  Returns non-zero if numeric value is
  * "empty" (zero). */
 static int
@@ -749,21 +1204,42 @@ ui_stat_height(void)
 static char *
 fetch_status_line(view_t *view, int width)
 {
-	if(vlua_handler_cmd(curr_stats.vlua, cfg.status_line))
+	if(!vlua_handler_cmd(curr_stats.vlua, cfg.status_line))
+	{
+		return strdup(cfg.status_line);
+	}
+
+	/* Handler can look at anything, so treat it like an expression. */
+	uint64_t inputs = get_inputs_fingerprint(view, DEP_ANY);
+	inputs = XXH3_64bits_withSeed(&width, sizeof(width), inputs);
+	const time_t now = time(NULL);
+
+	if(lua_status_line.format == NULL || lua_status_line.inputs != inputs ||
+			now - lua_status_line.computed_at >= EXPR_TTL)
 	{
-		return vlua_make_status_line(curr_stats.vlua, cfg.status_line, view, width);
+		char *const format = vlua_make_status_line(curr_stats.vlua,
+				cfg.status_line, view, width);
+		if(format == NULL)
+		{
+			return NULL;
+		}
+
+		free(lua_status_line.format);
+		lua_status_line.format = format;
+		lua_status_line.inputs = inputs;
+		lua_status_line.computed_at = now;
 	}
 
-	return strdup(cfg.status_line);
+	return strdup(lua_status_line.format);
 }
 
-/* strstr() for format line.  Basically parse_view_macros() in dry mode.
+/* strstr() for format line.  Basically compile_fmt() in dry mode.
  * Returns position of a particular macro or NULL.  *format is updated to keep
  * the state between successive calls. */
 TSTATIC char *
 find_view_macro(const char **format, const char macros[], char macro, int opt)
 {
-	/* Mind that parse_view_macros() needs to be in sync with this function. */
+	/* Mind that compile_fmt() needs to be in sync with this function. */
 
 	char c;
 	while((c = **format) != '\0')
@@ -1022,9 +1022,15 @@ static void
 update_views(int reload)
 {
 	if(reload)
+	{
+		/* Full update shouldn't rely on what was drawn before. */
+		fview_invalidate_frames();
 		reload_lists();
+	}
 	else
+	{
 		redraw_lists();
+	}
 }
 
 /* Reloads file lists for both views. */
@@ -249,6 +249,8 @@ struct dir_entry_t
 	                     INT_MAX signifies absence of a match. */
 	int name_dec_num; /* File decoration parameters cache (initially -1).  The
 	                     value is shifted by one, 0 means no type decoration. */
+	int name_width;   /* Cached screen width of the name as shown in ls-like
+	                     view without decorations.  Zero means unknown. */
 
 	int child_count; /* Number of child entries (all, not just direct). */
 	int child_pos;   /* Position of this entry in among children of its parent.
@@ -355,6 +357,15 @@ struct local_filter_t
 	int *poshist;
 	/* Number of elements in the poshist field. */
 	size_t poshist_len;
+
+	/* Positions in the unfiltered array of entries that passed the last
+	 * filtering.  Used to narrow the next filtering down when the filter is
+	 * being refined. */
+	int *passed;
+	/* Number of elements in the passed field. */
+	size_t passed_count;
+	/* Whether contents of the passed field correspond to the filter. */
+	int passed_valid;
 };
 
 /* Cached file list coupled with a watcher. */
@@ -368,6 +379,16 @@ cached_entries_t;
 
 /* Enable forward declaration of view_t. */
 typedef struct view_t view_t;
+/* Index of matches of a search in a view. */
+typedef struct
+{
+	int *pos;                   /* Positions of matches in ascending order. */
+	int count;                  /* Number of elements in pos. */
+	const dir_entry_t *entries; /* List of entries the index was built for. */
+	int nentries;               /* Length of that list. */
+}
+search_index_t;
+
 /* State of a pane. */
 struct view_t
 {
@@ -404,6 +425,8 @@ struct view_t
 
 	/* Number of files that match current search pattern. */
 	int matches;
+	/* Positions of files that match current search pattern. */
+	search_index_t search_index;
 	/* Last used search pattern, empty if none. */
 	char last_search[NAME_MAX + 1];
 
@@ -506,6 +529,10 @@ struct view_t
 	int location_changed; /* Whether location was recently changed. */
 
 	int displays_graphics; /* Whether window of the view contains graphics. */
+
+	/* Description of what was drawn in the window of the view last time, which
+	 * is used to skip drawing of cells that didn't change.  Can be NULL. */
+	struct frame_t *frame;
 };
 
 /* Id number to use on creation of new view_t. */
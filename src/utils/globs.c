@@ -18,11 +18,510 @@
 
 #include "globs.h"
 
+#include <ctype.h> /* isspace() */
+#include <stddef.h> /* NULL wchar_t */
 #include <stdlib.h> /* free() realloc() */
 #include <stdio.h> /* sprintf() */
-#include <string.h> /* strdup() */
+#include <string.h> /* strchr() strdup() strncmp() strstr() */
+#include <wctype.h> /* iswctype() towlower() towupper() wctype() wctype_t */
 
 #include "str.h"
+#include "utf8.h"
+
+/* Result of matching.  Values other than GM_MATCH and GM_NOMATCH tell outer
+ * asterisks that consuming more characters won't help them. */
+typedef enum
+{
+	GM_NOMATCH,           /* No match, but outer asterisks can try further. */
+	GM_MATCH,             /* The string matches. */
+	GM_ABORT_ALL,         /* End of string was reached, no point in trying. */
+	GM_ABORT_TO_STARSTAR, /* Only double asterisk could consume the slash. */
+}
+GlobMatch;
+
+/* Result of matching a character against a bracket expression. */
+typedef enum
+{
+	CM_NOMATCH, /* The character isn't matched. */
+	CM_MATCH,   /* The character is matched. */
+	CM_INVALID, /* The expression is malformed. */
+}
+ClassMatch;
+
+static const char * check_glob(const char glob[], int list);
+static int match_glob(const char glob[], const char str[], int extended,
+		int list);
+static GlobMatch match_here(const char pat[], const char str[], int extended,
+		int list);
+static GlobMatch match_star(const char pat[], const char str[], int extended,
+		int list);
+static GlobMatch match_dirs(const char pat[], const char str[], int list);
+static int match_tail(const char pat[], const char str[], int list);
+static int get_plain_char(const char pat[], int list);
+static ClassMatch match_class(const char **pat, wchar_t c, int list);
+static int at_glob_end(const char pat[], int list);
+static const char * skip_glob(const char pat[], int list);
+static wchar_t read_pat_char(const char **pat, int list);
+static wchar_t read_str_char(const char **str);
+static wchar_t fold_case(wchar_t c);
+
+int
+globs_match(const char globs[], const char str[])
+{
+	const char *glob = globs;
+	while(*glob != '\0')
+	{
+		while(isspace((unsigned char)*glob))
+		{
+			++glob;
+		}
+
+		if(!at_glob_end(glob, 1) && match_glob(glob, str, 0, 1))
+		{
+			return 1;
+		}
+
+		glob = skip_glob(glob, 1);
+	}
+	return 0;
+}
+
+int
+glob_matches(const char glob[], const char str[], int extended)
+{
+	return match_glob(glob, str, extended, 0);
+}
+
+const char *
+globs_check(const char globs[])
+{
+	const char *glob = globs;
+	while(*glob != '\0')
+	{
+		const char *const error = check_glob(glob, 1);
+		if(error != NULL)
+		{
+			return error;
+		}
+		glob = skip_glob(glob, 1);
+	}
+	return NULL;
+}
+
+const char *
+glob_check(const char glob[])
+{
+	return check_glob(glob, 0);
+}
+
+/* Checks single glob, which can be an element of a list.  Returns NULL if it's
+ * well-formed, otherwise a string describing the problem is returned. */
+static const char *
+check_glob(const char glob[], int list)
+{
+	while(!at_glob_end(glob, list))
+	{
+		if(glob[0] == '\\' && !at_glob_end(glob + 1, list))
+		{
+			++glob;
+		}
+		else if(glob[0] == '[')
+		{
+			++glob;
+			if(match_class(&glob, L'\0', list) == CM_INVALID)
+			{
+				return "Malformed bracket expression";
+			}
+			continue;
+		}
+		(void)read_pat_char(&glob, list);
+	}
+	return NULL;
+}
+
+/* Matches string against single glob, which can be an element of a list.
+ * Returns non-zero on match, otherwise zero is returned. */
+static int
+match_glob(const char glob[], const char str[], int extended, int list)
+{
+	if(!extended && glob[0] == '*')
+	{
+		/* Leading asterisk must consume at least one character that isn't a
+		 * dot. */
+		if(str[0] == '\0' || str[0] == '.')
+		{
+			return 0;
+		}
+		(void)read_str_char(&str);
+	}
+
+	return (match_here(glob, str, extended, list) == GM_MATCH);
+}
+
+/* Matches rest of the string against rest of the pattern.  Returns result of
+ * the matching. */
+static GlobMatch
+match_here(const char pat[], const char str[], int extended, int list)
+{
+	while(!at_glob_end(pat, list))
+	{
+		if(pat[0] == '*')
+		{
+			return match_star(pat, str, extended, list);
+		}
+
+		if(extended && strncmp(pat, "/**/", 4) == 0)
+		{
+			return match_dirs(pat + 4, str, list);
+		}
+
+		if(str[0] == '\0')
+		{
+			return GM_ABORT_ALL;
+		}
+
+		const wchar_t c = read_str_char(&str);
+
+		if(pat[0] == '?')
+		{
+			++pat;
+			continue;
+		}
+
+		if(pat[0] == '[')
+		{
+			const char *class = pat + 1;
+			const ClassMatch m = match_class(&class, c, list);
+			if(m != CM_INVALID)
+			{
+				if(m == CM_NOMATCH)
+				{
+					return GM_NOMATCH;
+				}
+				pat = class;
+				continue;
+			}
+			/* Malformed bracket expression is matched literally. */
+		}
+		else if(pat[0] == '\\' && !at_glob_end(pat + 1, list))
+		{
+			++pat;
+		}
+
+		if(fold_case(read_pat_char(&pat, list)) != c)
+		{
+			return GM_NOMATCH;
+		}
+	}
+
+	return (str[0] == '\0' ? GM_MATCH : GM_NOMATCH);
+}
+
+/* Matches a sequence of asterisks at the start of the pattern and the rest of
+ * it against the string.  Returns result of the matching. */
+static GlobMatch
+match_star(const char pat[], const char str[], int extended, int list)
+{
+	/* Non-extended asterisk and extended double asterisk match slashes. */
+	int match_slash = !extended;
+	++pat;
+	if(extended && pat[0] == '*')
+	{
+		match_slash = 1;
+		++pat;
+	}
+
+	if(at_glob_end(pat, list))
+	{
+		if(!match_slash && strchr(str, '/') != NULL)
+		{
+			return GM_ABORT_TO_STARSTAR;
+		}
+		return GM_MATCH;
+	}
+
+	if(match_slash)
+	{
+		const int m = match_tail(pat, str, list);
+		if(m >= 0)
+		{
+			return (m ? GM_MATCH : GM_NOMATCH);
+		}
+	}
+
+	/* Positions at which next literal character doesn't match are skipped.  Only
+	 * ASCII characters of the string are checked as that's sufficient. */
+	const int next = get_plain_char(pat, list);
+
+	while(1)
+	{
+		if(next != -1 && (unsigned char)str[0] < 0x80 && str[0] != '\0' &&
+				fold_case((unsigned char)str[0]) != next)
+		{
+			if(!match_slash && str[0] == '/')
+			{
+				return GM_ABORT_TO_STARSTAR;
+			}
+			++str;
+			continue;
+		}
+
+		const GlobMatch m = match_here(pat, str, extended, list);
+		if(m != GM_NOMATCH)
+		{
+			if(match_slash || m != GM_ABORT_TO_STARSTAR)
+			{
+				return m;
+			}
+		}
+		else if(!match_slash && str[0] == '/')
+		{
+			return GM_ABORT_TO_STARSTAR;
+		}
+
+		if(str[0] == '\0')
+		{
+			return GM_ABORT_ALL;
+		}
+		(void)read_str_char(&str);
+	}
+}
+
+/* Matches the string against double asterisk surrounded by slashes, which
+ * matches a single slash, any path between two slashes or end of the string,
+ * followed by the rest of the pattern.  Returns result of the matching. */
+static GlobMatch
+match_dirs(const char pat[], const char str[], int list)
+{
+	if(str[0] == '\0')
+	{
+		return match_here(pat, str, 1, list) == GM_MATCH ? GM_MATCH : GM_NOMATCH;
+	}
+
+	if(str[0] != '/')
+	{
+		return GM_NOMATCH;
+	}
+
+	const char *slash = str;
+	while(slash != NULL)
+	{
+		if(match_here(pat, slash + 1, 1, list) == GM_MATCH)
+		{
+			return GM_MATCH;
+		}
+		slash = strchr(slash + 1, '/');
+	}
+	return GM_NOMATCH;
+}
+
+/* Matches the string against the rest of the pattern if it consists of
+ * ordinary ASCII characters, in which case it must match tail of the string.
+ * Returns non-zero on match, zero on mismatch and -1 if the pattern doesn't
+ * qualify or the tail contains non-ASCII characters. */
+static int
+match_tail(const char pat[], const char str[], int list)
+{
+	size_t pat_len = 0U;
+	while(!at_glob_end(pat + pat_len, list))
+	{
+		if(get_plain_char(pat + pat_len, list) == -1)
+		{
+			return -1;
+		}
+		++pat_len;
+	}
+
+	const size_t str_len = strlen(str);
+	if(str_len < pat_len)
+	{
+		return 0;
+	}
+
+	const char *const tail = str + (str_len - pat_len);
+	size_t i;
+	for(i = 0U; i < pat_len; ++i)
+	{
+		if((unsigned char)tail[i] >= 0x80)
+		{
+			return -1;
+		}
+	}
+
+	for(i = 0U; i < pat_len; ++i)
+	{
+		if(fold_case((unsigned char)tail[i]) != fold_case((unsigned char)pat[i]))
+		{
+			return 0;
+		}
+	}
+	return 1;
+}
+
+/* Checks whether the pattern starts with an ASCII character that is matched
+ * literally (commas are excluded for simplicity).  Returns the character
+ * folded to lower case or -1. */
+static int
+get_plain_char(const char pat[], int list)
+{
+	const unsigned char c = pat[0];
+	if(c == '\0' || c >= 0x80 || char_is_one_of("*?[\\,/", c))
+	{
+		return -1;
+	}
+	return fold_case(c);
+}
+
+/* Matches a character (folded to lower case) against bracket expression that
+ * starts right after "[" at *pat and advances *pat past the closing "]".
+ * Returns result of the matching. */
+static ClassMatch
+match_class(const char **pat, wchar_t c, int list)
+{
+	const char *p = *pat;
+	const wchar_t upper = (c < 0x80)
+	                    ? ((c >= 'a' && c <= 'z') ? c - 'a' + 'A' : c)
+	                    : towupper(c);
+
+	int negated = 0;
+	if(p[0] == '!' || p[0] == '^')
+	{
+		negated = 1;
+		++p;
+	}
+
+	int matched = 0;
+	int first = 1;
+	while(first || p[0] != ']')
+	{
+		if(at_glob_end(p, list))
+		{
+			return CM_INVALID;
+		}
+		first = 0;
+
+		if(p[0] == '[' && p[1] == ':')
+		{
+			const char *const end = strstr(p + 2, ":]");
+			char name[16];
+			if(end == NULL || (size_t)(end - (p + 2)) >= sizeof(name))
+			{
+				return CM_INVALID;
+			}
+			copy_str(name, end - (p + 2) + 1, p + 2);
+
+			const wctype_t type = wctype(name);
+			if(type == 0)
+			{
+				return CM_INVALID;
+			}
+			matched |= iswctype(c, type) || iswctype(upper, type);
+			p = end + 2;
+			continue;
+		}
+
+		if(p[0] == '\\' && !at_glob_end(p + 1, list))
+		{
+			++p;
+		}
+		const wchar_t from = read_pat_char(&p, list);
+		wchar_t to = from;
+		if(p[0] == '-' && p[1] != ']' && !at_glob_end(p + 1, list))
+		{
+			++p;
+			if(p[0] == '\\' && !at_glob_end(p + 1, list))
+			{
+				++p;
+			}
+			to = read_pat_char(&p, list);
+			if(to < from)
+			{
+				return CM_INVALID;
+			}
+		}
+
+		if(from == to)
+		{
+			matched |= (fold_case(from) == c);
+		}
+		else
+		{
+			matched |= (c >= from && c <= to) || (upper >= from && upper <= to);
+		}
+	}
+
+	*pat = p + 1;
+	return (matched ^ negated) ? CM_MATCH : CM_NOMATCH;
+}
+
+/* Checks whether pattern reached end of the glob.  In a list single comma
+ * terminates a glob while double comma is a literal comma.  Returns non-zero if
+ * so, otherwise zero is returned. */
+static int
+at_glob_end(const char pat[], int list)
+{
+	return pat[0] == '\0' || (list && pat[0] == ',' && pat[1] != ',');
+}
+
+/* Skips current glob of a list and a comma that follows it.  Returns pointer
+ * to the next glob. */
+static const char *
+skip_glob(const char pat[], int list)
+{
+	while(!at_glob_end(pat, list))
+	{
+		pat += (list && pat[0] == ',') ? 2 : 1;
+	}
+	return (pat[0] == ',' ? pat + 1 : pat);
+}
+
+/* Reads single character of the pattern and advances the pointer.  Returns the
+ * character as is (unlike read_str_char()). */
+static wchar_t
+read_pat_char(const char **pat, int list)
+{
+	const char *p = *pat;
+	if((unsigned char)p[0] < 0x80)
+	{
+		*pat += (list && p[0] == ',') ? 2 : 1;
+		return (unsigned char)p[0];
+	}
+
+	int len;
+	const wchar_t c = utf8_first_char(p, &len);
+	*pat += len;
+	return c;
+}
+
+/* Reads single character of the string and advances the pointer.  Returns the
+ * character folded to lower case. */
+static wchar_t
+read_str_char(const char **str)
+{
+	const char *s = *str;
+	if((unsigned char)s[0] < 0x80)
+	{
+		*str += 1;
+		return fold_case((unsigned char)s[0]);
+	}
+
+	int len;
+	const wchar_t c = utf8_first_char(s, &len);
+	*str += len;
+	return fold_case(c);
+}
+
+/* Folds character to lower case using a shortcut for ASCII.  Returns folded
+ * character. */
+static wchar_t
+fold_case(wchar_t c)
+{
+	if(c < 0x80)
+	{
+		return (c >= 'A' && c <= 'Z') ? c - 'A' + 'a' : c;
+	}
+	return towlower(c);
+}
 
 char *
 globs_to_regex(const char globs[])
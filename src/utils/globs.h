@@ -19,13 +19,43 @@
 #ifndef VIFM__UTILS__GLOBS_H__
 #define VIFM__UTILS__GLOBS_H__
 
-/* Implements globs by converting them into regular expressions.  They are
- * treated as case insensitive.
+/* Implements globs.  They are treated as case insensitive.
+ *
+ * Globs are matched directly without any allocations.  Supported syntax:
+ *  - "?" matches any single character;
+ *  - "*" matches any sequence of characters;
+ *  - "[...]" matches one character listed in brackets, which can contain
+ *    ranges ("a-z") and character classes ("[:alpha:]"), "!" or "^" after "["
+ *    inverts the match;
+ *  - "\" makes following character be matched literally.
  *
  * "*" at the beginning of a non-extended glob doesn't match empty string (e.g.
- * "*doc" should match "doc", but it won't).  This is a limitation of turning
- * list of globs into single regular expression.  Extended glob will match even
- * ".", which should be cut off somewhere else. */
+ * "*doc" should match "doc", but it won't) nor a leading dot.  This mimics
+ * limitation of turning list of globs into single regular expression, which is
+ * kept for compatibility.  Extended glob will match even ".", which should be
+ * cut off somewhere else.
+ *
+ * Conversion of globs into regular expressions is also available. */
+
+/* Matches string against comma-separated list of globs (",," stands for a
+ * literal comma, leading whitespace of globs is ignored).  Returns non-zero if
+ * any of the globs matches, otherwise zero is returned. */
+int globs_match(const char globs[], const char str[]);
+
+/* Matches string against the glob.  Extended mode makes asterisk not match
+ * slash, double asterisk match anything and double asterisk surrounded by
+ * slashes match any number of directories.  Returns non-zero on match,
+ * otherwise zero is returned. */
+int glob_matches(const char glob[], const char str[], int extended);
+
+/* Checks whether comma-separated list of globs is well-formed.  Returns NULL if
+ * so, otherwise a statically allocated string describing the problem is
+ * returned. */
+const char * globs_check(const char globs[]);
+
+/* Checks whether the glob is well-formed.  Returns NULL if so, otherwise a
+ * statically allocated string describing the problem is returned. */
+const char * glob_check(const char glob[]);
 
 /* Converts comma-separated list of globs into equivalent regular expression.
  * Returns pointer to a newly allocated string, which should be freed by the
@@ -20,12 +20,14 @@
 
 #include <stddef.h> /* NULL */
 #include <stdlib.h> /* calloc() free() */
-#include <string.h> /* memmove() */
+#include <string.h> /* strdup() */
 #include <time.h> /* time_t */
 
 #include "../compat/reallocarray.h"
+#include "hmap.h"
 #include "macros.h"
 
+static int relocate(hist_t *hist, int allocated);
 static int move_to_first_position(hist_t *hist, const char item[],
 		time_t timestamp);
 static int insert_at_first_position(hist_t *hist, const char item[],
@@ -39,16 +41,28 @@ hist_init(hist_t *hist, int capacity)
 		capacity = 0;
 	}
 
+	hist->first = 0;
 	hist->size = 0;
 	hist->capacity = 0;
+	hist->allocated = 0;
+
+	hist->index = hmap_create();
+	if(hist->index == NULL)
+	{
+		hist->items = NULL;
+		return 1;
+	}
 
 	hist->items = calloc(capacity, sizeof(*hist->items));
 	if(hist->items == NULL)
 	{
+		hmap_free(hist->index);
+		hist->index = NULL;
 		return 1;
 	}
 
 	hist->capacity = capacity;
+	hist->allocated = capacity;
 	return 0;
 }
 
@@ -58,11 +72,15 @@ hist_reset(hist_t *hist)
 	int i;
 	for(i = 0; i < hist->size; ++i)
 	{
-		free(hist->items[i].text);
+		free(hist_get(hist, i)->text);
 	}
 	free(hist->items);
+	hmap_free(hist->index);
 
 	hist->items = NULL;
+	hist->index = NULL;
+	hist->first = 0;
+	hist->allocated = 0;
 	hist->size = 0;
 	hist->capacity = 0;
 }
@@ -86,12 +104,32 @@ hist_resize(hist_t *hist, int new_capacity)
 	int i;
 	for(i = new_capacity; i < hist->size; ++i)
 	{
-		free(hist->items[i].text);
+		hist_item_t *const item = hist_get(hist, i);
+		(void)hmap_remove(hist->index, item->text);
+		free(item->text);
 	}
-
-	hist->items = reallocarray(hist->items, new_capacity, sizeof(*hist->items));
 	hist->size = MIN(hist->size, new_capacity);
-	hist->capacity = new_capacity;
+
+	/* Growing by small steps (as happens on loading state) reallocates the
+	 * buffer only once in a while. */
+	if(new_capacity > hist->allocated)
+	{
+		(void)relocate(hist, MAX(new_capacity, hist->allocated*2));
+	}
+	else if(new_capacity < hist->allocated/2)
+	{
+		/* Spare slots are kept unless there are too many of them, otherwise the
+		 * step after growing would shrink the buffer back. */
+		(void)relocate(hist, new_capacity);
+	}
+
+	hist->capacity = MIN(new_capacity, hist->allocated);
+}
+
+hist_item_t *
+hist_get(const hist_t *hist, int pos)
+{
+	return &hist->items[(hist->first + pos)%hist->allocated];
 }
 
 int
@@ -107,30 +145,75 @@ hist_add(hist_t *hist, const char item[], time_t timestamp)
 	return 0;
 }
 
+/* Moves items into a new buffer of specified size, which must be enough to
+ * hold all of them, and makes the first item be at the start of the buffer.
+ * Returns zero on success or non-zero on failure, in which case the history is
+ * left unchanged. */
+static int
+relocate(hist_t *hist, int allocated)
+{
+	hmap_t *const index = (hist->index == NULL ? hmap_create() : hist->index);
+	hist_item_t *const items = reallocarray(NULL, allocated, sizeof(*items));
+	if(index == NULL || items == NULL)
+	{
+		if(index != hist->index)
+		{
+			hmap_free(index);
+		}
+		free(items);
+		return 1;
+	}
+
+	int i;
+	for(i = 0; i < hist->size; ++i)
+	{
+		items[i] = *hist_get(hist, i);
+		/* Existing keys are replaced without allocating memory. */
+		(void)hmap_set(index, items[i].text, &items[i]);
+	}
+
+	free(hist->items);
+	hist->items = items;
+	hist->index = index;
+	hist->first = 0;
+	hist->allocated = allocated;
+	return 0;
+}
+
 /* Moves item to the first position.  Returns zero on success or non-zero when
  * item wasn't found in the history. */
 static int
 move_to_first_position(hist_t *hist, const char item[], time_t timestamp)
 {
-	if(hist->size > 0 && strcmp(hist->items[0].text, item) == 0)
+	void *data;
+	if(hmap_get(hist->index, item, &data) != 0)
+	{
+		return 1;
+	}
+
+	const int slot = (hist_item_t *)data - hist->items;
+	const int pos = (slot - hist->first + hist->allocated)%hist->allocated;
+	if(pos == 0)
 	{
 		return 0;
 	}
 
+	hist_item_t moved = hist->items[slot];
+	moved.timestamp = timestamp;
+
+	/* Only items that precede the moved one need to be shifted. */
 	int i;
-	for(i = 1; i < hist->size; ++i)
+	for(i = pos; i > 0; --i)
 	{
-		if(strcmp(hist->items[i].text, item) == 0)
-		{
-			hist_item_t item = hist->items[i];
-			item.timestamp = timestamp;
-			memmove(hist->items + 1, hist->items, sizeof(*hist->items)*i);
-			hist->items[0] = item;
-			return 0;
-		}
+		hist_item_t *const dst = hist_get(hist, i);
+		*dst = *hist_get(hist, i - 1);
+		(void)hmap_set(hist->index, dst->text, dst);
 	}
 
-	return 1;
+	hist_item_t *const first = hist_get(hist, 0);
+	*first = moved;
+	(void)hmap_set(hist->index, first->text, first);
+	return 0;
 }
 
 /* Inserts item at the first position.  Returns zero on success or non-zero on
@@ -146,17 +229,24 @@ insert_at_first_position(hist_t *hist, const char item[], time_t timestamp)
 
 	if(hist->size == hist->capacity)
 	{
-		free(hist->items[hist->size - 1].text);
+		hist_item_t *const last = hist_get(hist, hist->size - 1);
+		(void)hmap_remove(hist->index, last->text);
+		free(last->text);
+		--hist->size;
 	}
-	else
+
+	/* The slot is either free or is the one of the dropped last item. */
+	const int slot = (hist->first - 1 + hist->allocated)%hist->allocated;
+	if(hmap_set(hist->index, item_copy, &hist->items[slot]) != 0)
 	{
-		++hist->size;
+		free(item_copy);
+		return 1;
 	}
-	memmove(hist->items + 1, hist->items,
-			sizeof(*hist->items)*(hist->size - 1));
 
-	hist->items[0].text = item_copy;
-	hist->items[0].timestamp = timestamp;
+	hist->first = slot;
+	hist->items[slot].text = item_copy;
+	hist->items[slot].timestamp = timestamp;
+	++hist->size;
 	return 0;
 }
 
@@ -19,10 +19,15 @@
 #ifndef VIFM__UTILS__HIST_H__
 #define VIFM__UTILS__HIST_H__
 
-/* Generic implementation of history represented as list of strings. */
+/* Generic implementation of history represented as list of strings.  Items
+ * are kept in a ring buffer, so adding new one to the front doesn't move the
+ * rest, and are indexed by their text, so lookup of an existing item doesn't
+ * compare it with every item. */
 
 #include <time.h> /* time_t */
 
+struct hmap_t;
+
 /* Single entry of hist_t. */
 typedef struct
 {
@@ -31,12 +36,15 @@ typedef struct
 }
 hist_item_t;
 
-/* History object structure.  Doesn't store its length. */
+/* History object structure.  Items should be accessed via hist_get(). */
 typedef struct
 {
-	hist_item_t *items; /* List of history items.  Can be NULL for empty list. */
-	int size;           /* Current size of the list. */
-	int capacity;       /* Maximum size of the list. */
+	hist_item_t *items;   /* Ring buffer of items.  Can be NULL for empty list. */
+	int first;            /* Index of the first (the newest) item in buffer. */
+	int allocated;        /* Number of slots in the buffer (>= capacity). */
+	int size;             /* Current size of the list. */
+	int capacity;         /* Maximum size of the list. */
+	struct hmap_t *index; /* Maps text of items onto their slots. */
 }
 hist_t;
 
@@ -54,6 +62,11 @@ int hist_is_empty(const hist_t *hist);
 /* Changes maximum size of the history object. */
 void hist_resize(hist_t *hist, int new_capacity);
 
+/* Retrieves item of the history by its position, the first item is the newest
+ * one.  Returns pointer to the item, which is valid until the history is
+ * changed. */
+hist_item_t * hist_get(const hist_t *hist, int pos);
+
 /* Adds new item to the front of the history, thus it becomes its first
  * element.  If item is already present in history list, it's moved.  Returns
  * zero when item is added/moved or rejected, on failure non-zero is
@@ -0,0 +1,250 @@
+/* vifm
+ * Copyright (C) 2026 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "hmap.h"
+
+#include <stdlib.h> /* calloc() free() malloc() */
+#include <string.h> /* memcpy() strcmp() strlen() */
+
+/*
+ * This is a hash table with separate chaining.  Number of buckets is always a
+ * power of two and is doubled when average chain length exceeds one, so
+ * lookups, insertions and removals take constant time on average.
+ */
+
+/* Initial number of buckets. */
+#define INITIAL_BUCKETS 16U
+
+/* Single key-value pair. */
+typedef struct hmap_node_t
+{
+	struct hmap_node_t *next; /* Next node in the chain or NULL. */
+	size_t hash;              /* Cached hash of the key. */
+	void *data;               /* Data associated with the key. */
+	char key[];               /* Key of the node. */
+}
+hmap_node_t;
+
+/* Hash map itself. */
+struct hmap_t
+{
+	hmap_node_t **buckets; /* Heads of chains. */
+	size_t nbuckets;       /* Number of buckets (power of two). */
+	size_t size;           /* Number of elements. */
+};
+
+static hmap_node_t ** find_node(const hmap_t *hmap, const char key[],
+		size_t hash);
+static void grow(hmap_t *hmap);
+static size_t hash_str(const char str[]);
+
+hmap_t *
+hmap_create(void)
+{
+	hmap_t *const hmap = malloc(sizeof(*hmap));
+	if(hmap == NULL)
+	{
+		return NULL;
+	}
+
+	hmap->buckets = calloc(INITIAL_BUCKETS, sizeof(*hmap->buckets));
+	if(hmap->buckets == NULL)
+	{
+		free(hmap);
+		return NULL;
+	}
+
+	hmap->nbuckets = INITIAL_BUCKETS;
+	hmap->size = 0U;
+	return hmap;
+}
+
+void
+hmap_free(hmap_t *hmap)
+{
+	if(hmap != NULL)
+	{
+		hmap_clear(hmap);
+		free(hmap->buckets);
+		free(hmap);
+	}
+}
+
+void
+hmap_clear(hmap_t *hmap)
+{
+	size_t i;
+	for(i = 0U; i < hmap->nbuckets; ++i)
+	{
+		hmap_node_t *node = hmap->buckets[i];
+		while(node != NULL)
+		{
+			hmap_node_t *const next = node->next;
+			free(node);
+			node = next;
+		}
+		hmap->buckets[i] = NULL;
+	}
+	hmap->size = 0U;
+}
+
+size_t
+hmap_size(const hmap_t *hmap)
+{
+	return (hmap == NULL ? 0U : hmap->size);
+}
+
+int
+hmap_set(hmap_t *hmap, const char key[], void *data)
+{
+	const size_t hash = hash_str(key);
+
+	hmap_node_t **const link = find_node(hmap, key, hash);
+	if(*link != NULL)
+	{
+		(*link)->data = data;
+		return 0;
+	}
+
+	const size_t len = strlen(key);
+	hmap_node_t *const node = malloc(sizeof(*node) + len + 1U);
+	if(node == NULL)
+	{
+		return 1;
+	}
+
+	node->next = NULL;
+	node->hash = hash;
+	node->data = data;
+	memcpy(node->key, key, len + 1U);
+
+	/* find_node() returns address of the last link in a chain for absent
+	 * keys. */
+	*link = node;
+	++hmap->size;
+
+	if(hmap->size > hmap->nbuckets)
+	{
+		grow(hmap);
+	}
+	return 0;
+}
+
+int
+hmap_get(const hmap_t *hmap, const char key[], void **data)
+{
+	if(hmap == NULL)
+	{
+		return 1;
+	}
+
+	hmap_node_t *const node = *find_node(hmap, key, hash_str(key));
+	if(node == NULL)
+	{
+		return 1;
+	}
+
+	if(data != NULL)
+	{
+		*data = node->data;
+	}
+	return 0;
+}
+
+int
+hmap_remove(hmap_t *hmap, const char key[])
+{
+	hmap_node_t **const link = find_node(hmap, key, hash_str(key));
+	hmap_node_t *const node = *link;
+	if(node == NULL)
+	{
+		return 1;
+	}
+
+	*link = node->next;
+	free(node);
+	--hmap->size;
+	return 0;
+}
+
+/* Looks up a node by its key.  Returns pointer to the link that points to the
+ * node, which points to NULL if there is no such key. */
+static hmap_node_t **
+find_node(const hmap_t *hmap, const char key[], size_t hash)
+{
+	hmap_node_t **link = &hmap->buckets[hash & (hmap->nbuckets - 1U)];
+	while(*link != NULL)
+	{
+		if((*link)->hash == hash && strcmp((*link)->key, key) == 0)
+		{
+			break;
+		}
+		link = &(*link)->next;
+	}
+	return link;
+}
+
+/* Doubles number of buckets redistributing nodes among them.  Failure to
+ * allocate memory is ignored as the map remains functional. */
+static void
+grow(hmap_t *hmap)
+{
+	const size_t nbuckets = hmap->nbuckets*2U;
+	hmap_node_t **const buckets = calloc(nbuckets, sizeof(*buckets));
+	if(buckets == NULL)
+	{
+		return;
+	}
+
+	size_t i;
+	for(i = 0U; i < hmap->nbuckets; ++i)
+	{
+		hmap_node_t *node = hmap->buckets[i];
+		while(node != NULL)
+		{
+			hmap_node_t *const next = node->next;
+			hmap_node_t **const head = &buckets[node->hash & (nbuckets - 1U)];
+			node->next = *head;
+			*head = node;
+			node = next;
+		}
+	}
+
+	free(hmap->buckets);
+	hmap->buckets = buckets;
+	hmap->nbuckets = nbuckets;
+}
+
+/* Computes FNV-1a hash of a string.  Returns the hash. */
+static size_t
+hash_str(const char str[])
+{
+	size_t hash = (sizeof(size_t) > 4U) ? (size_t)14695981039346656037ULL
+	                                    : (size_t)2166136261UL;
+	const size_t prime = (sizeof(size_t) > 4U) ? (size_t)1099511628211ULL
+	                                           : (size_t)16777619UL;
+	while(*str != '\0')
+	{
+		hash ^= (unsigned char)*str++;
+		hash *= prime;
+	}
+	return hash;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -0,0 +1,59 @@
+/* vifm
+ * Copyright (C) 2026 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef VIFM__UTILS__HMAP_H__
+#define VIFM__UTILS__HMAP_H__
+
+#include <stddef.h> /* NULL size_t */
+
+/* Hash map from strings to pointers.  Unlike trie_t, it supports removal of
+ * elements.  Keys are copied, data is owned by the client. */
+
+/* Declaration of opaque hash map type. */
+typedef struct hmap_t hmap_t;
+
+/* Creates new empty hash map.  Returns NULL on error. */
+hmap_t * hmap_create(void);
+
+/* Frees memory allocated for the hash map.  Freeing of NULL is OK.  Data
+ * associated with keys isn't freed. */
+void hmap_free(hmap_t *hmap);
+
+/* Removes all elements of the hash map. */
+void hmap_clear(hmap_t *hmap);
+
+/* Retrieves number of elements in the hash map.  Returns the number. */
+size_t hmap_size(const hmap_t *hmap);
+
+/* Associates data with the key replacing previous association if there was
+ * one.  Returns non-zero on error, otherwise zero is returned. */
+int hmap_set(hmap_t *hmap, const char key[], void *data);
+
+/* Looks up data for the key.  hmap can be NULL, which is treated as an empty
+ * hash map.  Returns zero when found and sets *data (if data isn't NULL),
+ * otherwise returns non-zero. */
+int hmap_get(const hmap_t *hmap, const char key[], void **data);
+
+/* Removes the key from the hash map.  Returns zero if it was there, otherwise
+ * non-zero is returned. */
+int hmap_remove(hmap_t *hmap, const char key[]);
+
+#endif /* VIFM__UTILS__HMAP_H__ */
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
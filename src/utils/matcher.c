@@ -35,8 +35,8 @@
 typedef enum
 {
 	MT_REGEX, /* Regular expression. */
-	MT_GLOBS, /* List of globs (translated to regular expression). */
-	MT_MIME,  /* List of mime types (translated to regular expression). */
+	MT_GLOBS, /* List of globs. */
+	MT_MIME,  /* List of mime type globs. */
 }
 MType;
 
@@ -45,14 +45,14 @@ struct matcher_t
 {
 	char *expr;  /* User-entered pattern. */
 	char *undec; /* User-entered pattern with decoration stripped. */
-	char *raw;   /* Raw stripped value (regular expression). */
+	char *raw;   /* Raw stripped value (regular expression or globs). */
 	int cflags;  /* Regular expression compilation flags. */
 	MType type : 2;             /* Type of the matcher's pattern. */
 	unsigned int full_path : 1; /* Matches full path instead of just file name. */
 	unsigned int negated : 1;   /* Whether match is inverted. */
 	unsigned int fglobs : 1;    /* Whether this matcher is a special case of
 	                               globs ("faster" globs) that is optimized. */
-	regex_t regex; /* The expression in compiled form, unless matcher is empty. */
+	regex_t regex; /* The expression in compiled form, see uses_regex(). */
 };
 
 static matcher_t * alloc_matcher(matcher_t m, const char expr[], int cs_by_def,
@@ -66,6 +66,7 @@ static int parse_glob(matcher_t *m, int strip, char **error);
 static int is_fglobs(char expr[]);
 static int parse_re(matcher_t *m, int strip, int cs_by_def,
 		const char on_empty_re[], char **error);
+static int uses_regex(const matcher_t *matcher);
 static void free_matcher_items(matcher_t *matcher);
 static int fglobs_matches(const matcher_t *matcher, const char path[]);
 static int fglobs_includes(const matcher_t *matcher, const matcher_t *like);
@@ -235,9 +236,8 @@ compile_expr(matcher_t *m, int strip, int cs_by_def, const char on_empty_re[],
 			break;
 	}
 
-	if(m->fglobs || m->raw[0] == '\0')
+	if(!uses_regex(m))
 	{
-		/* This is a faster glob or an empty matcher and we don't compile "". */
 		return 0;
 	}
 
@@ -252,7 +252,7 @@ compile_expr(matcher_t *m, int strip, int cs_by_def, const char on_empty_re[],
 	return 0;
 }
 
-/* Replaces global with equivalent regexp and setups flags.  Returns zero on
+/* Strips decorations of globs and checks their correctness.  Returns zero on
  * success or non-zero on error with *error containing description of it. */
 static int
 parse_glob(matcher_t *m, int strip, char **error)
@@ -276,17 +276,13 @@ parse_glob(matcher_t *m, int strip, char **error)
 		return 0;
 	}
 
-	char *re = globs_to_regex(m->raw);
-	if(re == NULL)
+	const char *const globs_error = globs_check(m->raw);
+	if(globs_error != NULL)
 	{
-		replace_string(error, "Failed to convert globs into regexp.");
+		replace_string(error, globs_error);
 		return 1;
 	}
 
-	free(m->raw);
-	m->raw = re;
-
-	m->cflags = REG_EXTENDED | REG_ICASE;
 	return 0;
 }
 
@@ -384,8 +380,7 @@ matcher_clone(const matcher_t *matcher)
 		return NULL;
 	}
 
-	/* Don't compile regex for faster globs or empty matcher. */
-	if(!clone->fglobs && clone->raw[0] != '\0')
+	if(uses_regex(clone))
 	{
 		if(regexp_compile(&clone->regex, matcher->raw, matcher->cflags) != 0)
 		{
@@ -407,14 +402,22 @@ matcher_free(matcher_t *matcher)
 	}
 }
 
+/* Checks whether matcher has compiled regular expression, which is the case
+ * for non-empty regular expression matchers.  Returns non-zero if so, otherwise
+ * zero is returned. */
+static int
+uses_regex(const matcher_t *matcher)
+{
+	return (matcher->type == MT_REGEX && matcher->raw[0] != '\0');
+}
+
 /* Frees all resources allocated by the matcher, but not the matcher itself.
  * matcher can't be NULL. */
 static void
 free_matcher_items(matcher_t *matcher)
 {
-	if(!matcher->fglobs && matcher->raw != NULL && !matcher_is_empty(matcher))
+	if(matcher->raw != NULL && uses_regex(matcher))
 	{
-		/* Regex is compiled only for non-empty matchers of unoptimized patterns. */
 		regfree(&matcher->regex);
 	}
 	free(matcher->expr);
@@ -449,6 +452,11 @@ matcher_matches(const matcher_t *matcher, const char path[])
 		return fglobs_matches(matcher, path);
 	}
 
+	if(matcher->type != MT_REGEX)
+	{
+		return globs_match(matcher->raw, path)^matcher->negated;
+	}
+
 	return (regexec(&matcher->regex, path, 0, NULL, 0) == 0)^matcher->negated;
 }
 
@@ -541,7 +549,7 @@ matcher_includes(const matcher_t *matcher, const matcher_t *like)
 		return fglobs_includes(matcher, like);
 	}
 
-	return (matcher->cflags & REG_ICASE)
+	return (matcher->type != MT_REGEX || (matcher->cflags & REG_ICASE))
 	     ? (strcasestr(matcher->raw, like->raw) != NULL)
 	     : (strstr(matcher->raw, like->raw) != NULL);
 }
@@ -628,6 +636,17 @@ matcher_is_full_path(const matcher_t *matcher)
 	return matcher->full_path;
 }
 
+const char *
+matcher_get_fglobs(const matcher_t *matcher)
+{
+	if(matcher->type != MT_GLOBS || !matcher->fglobs || matcher->negated ||
+			matcher->full_path)
+	{
+		return NULL;
+	}
+	return matcher->raw;
+}
+
 TSTATIC int
 matcher_is_fast(const matcher_t *matcher)
 {
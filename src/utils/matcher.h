@@ -72,6 +72,11 @@ int matcher_includes(const matcher_t *matcher, const matcher_t *like);
  * otherwise zero is returned. */
 int matcher_is_full_path(const matcher_t *matcher);
 
+/* Retrieves globs of a matcher that consists of non-negated file name globs
+ * which are matched without regular expressions.  Returns comma-separated list
+ * of globs (",," stands for a literal comma) or NULL for other matchers. */
+const char * matcher_get_fglobs(const matcher_t *matcher);
+
 TSTATIC_DEFS(
 	int matcher_is_fast(const matcher_t *matcher);
 )
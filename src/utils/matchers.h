@@ -46,6 +46,10 @@ int matchers_match_dir(const matchers_t *matchers, const char path[]);
 /* Retrieves original matcher expression.  Returns the expression. */
 const char * matchers_get_expr(const matchers_t *matchers);
 
+/* Retrieves globs of matchers that consist of a single matcher for which
+ * matcher_get_fglobs() succeeds.  Returns the globs or NULL. */
+const char * matchers_get_fglobs(const matchers_t *matchers);
+
 /* Checks whether matchers matches at least superset of what like is matching.
  * Returns non-zero if so, otherwise zero is returned. */
 int matchers_includes(const matchers_t *matchers, const matchers_t *like);
@@ -0,0 +1,447 @@
+/* vifm
+ * Copyright (C) 2026 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "matchers_index.h"
+
+#include <ctype.h> /* tolower() */
+#include <limits.h> /* CHAR_BIT INT_MAX UCHAR_MAX */
+#include <stdint.h> /* uint64_t */
+#include <stdlib.h> /* calloc() free() */
+#include <string.h> /* memcpy() strchr() strdup() strlen() */
+
+#include "../compat/reallocarray.h"
+#include "hmap.h"
+#include "matchers.h"
+#include "path.h"
+#include "str.h"
+
+/*
+ * Globs of fast matchers (see matcher_get_fglobs()) are compared to file names
+ * case-insensitively and without regular expressions.  Three kinds of them are
+ * indexed here:
+ *
+ *  - "name"    matches the name as a whole and goes into literals table;
+ *  - "*suffix" matches tail of a name that doesn't start with a dot and goes
+ *              into suffixes table, a name is looked up by all its tails that
+ *              start with one of first characters of known suffixes;
+ *  - "prefix*" matches head of a name and goes into prefixes table, a name is
+ *              looked up by all its heads of known prefix lengths.
+ *
+ * A rule is indexed only if all of its globs are of these kinds, the rest of
+ * the rules is matched in order after the lookups, but only up to the best
+ * indexed match.
+ */
+
+/* Prefixes of this length and longer aren't indexed. */
+enum { MAX_PREFIX_LEN = 64 };
+
+/* Sorted list of ids of rules. */
+typedef struct
+{
+	int *ids;  /* The ids. */
+	int count; /* Number of ids. */
+}
+id_list_t;
+
+/* Single rule of the index. */
+typedef struct
+{
+	struct matchers_t **list; /* Disjunction of matchers. */
+	int count;                /* Number of matchers. */
+}
+rule_t;
+
+/* Index itself. */
+struct matchers_index_t
+{
+	rule_t *rules; /* All rules in order of addition. */
+	int nrules;    /* Number of rules. */
+
+	int *unindexed;  /* Ids of rules that are matched one by one. */
+	int nunindexed;  /* Number of such rules. */
+
+	hmap_t *literals; /* Maps lower-case names onto lists of ids. */
+	hmap_t *suffixes; /* Maps lower-case suffixes onto lists of ids. */
+	hmap_t *prefixes; /* Maps lower-case prefixes onto lists of ids. */
+
+	id_list_t **lists; /* All lists of ids for freeing. */
+	int nlists;        /* Number of lists. */
+
+	/* Bit set of first characters of suffixes ('\0' for an empty one). */
+	unsigned char suffix_starts[(UCHAR_MAX + 1)/CHAR_BIT];
+	uint64_t prefix_lens; /* Bit set of lengths of prefixes. */
+};
+
+static int is_indexable(const char globs[]);
+static int index_globs(matchers_index_t *index, const char globs[], int id);
+static int add_id(matchers_index_t *index, hmap_t *table, const char key[],
+		int id);
+static int find_in(const hmap_t *table, const char key[], int from, int best);
+static int rule_matches(const rule_t *rule, const char path[]);
+static void fold_case(char str[]);
+
+matchers_index_t *
+matchers_index_create(void)
+{
+	matchers_index_t *const index = calloc(1, sizeof(*index));
+	if(index == NULL)
+	{
+		return NULL;
+	}
+
+	index->literals = hmap_create();
+	index->suffixes = hmap_create();
+	index->prefixes = hmap_create();
+	if(index->literals == NULL || index->suffixes == NULL ||
+			index->prefixes == NULL)
+	{
+		matchers_index_free(index);
+		return NULL;
+	}
+
+	return index;
+}
+
+void
+matchers_index_free(matchers_index_t *index)
+{
+	if(index == NULL)
+	{
+		return;
+	}
+
+	int i;
+	for(i = 0; i < index->nrules; ++i)
+	{
+		free(index->rules[i].list);
+	}
+	free(index->rules);
+
+	for(i = 0; i < index->nlists; ++i)
+	{
+		free(index->lists[i]->ids);
+		free(index->lists[i]);
+	}
+	free(index->lists);
+
+	free(index->unindexed);
+	hmap_free(index->literals);
+	hmap_free(index->suffixes);
+	hmap_free(index->prefixes);
+	free(index);
+}
+
+int
+matchers_index_add(matchers_index_t *index, struct matchers_t *const list[],
+		int count)
+{
+	rule_t *const rules = reallocarray(index->rules, index->nrules + 1,
+			sizeof(*rules));
+	if(rules == NULL)
+	{
+		return 1;
+	}
+	index->rules = rules;
+
+	rule_t *const rule = &index->rules[index->nrules];
+	rule->list = reallocarray(NULL, count, sizeof(*rule->list));
+	if(rule->list == NULL && count != 0)
+	{
+		return 1;
+	}
+	if(count != 0)
+	{
+		memcpy(rule->list, list, sizeof(*rule->list)*count);
+	}
+	rule->count = count;
+
+	const int id = index->nrules++;
+
+	int indexable = (count > 0);
+	int i;
+	for(i = 0; i < count && indexable; ++i)
+	{
+		const char *const globs = matchers_get_fglobs(list[i]);
+		indexable = (globs != NULL && is_indexable(globs));
+	}
+
+	for(i = 0; i < count && indexable; ++i)
+	{
+		if(index_globs(index, matchers_get_fglobs(list[i]), id) != 0)
+		{
+			return 1;
+		}
+	}
+
+	if(!indexable)
+	{
+		int *const unindexed = reallocarray(index->unindexed,
+				index->nunindexed + 1, sizeof(*unindexed));
+		if(unindexed == NULL)
+		{
+			return 1;
+		}
+		index->unindexed = unindexed;
+		index->unindexed[index->nunindexed++] = id;
+	}
+
+	return 0;
+}
+
+int
+matchers_index_find(const matchers_index_t *index, const char path[],
+		int from)
+{
+	const char *const name = get_last_path_component(path);
+	const size_t len = strlen(name);
+
+	char buf[256];
+	char *const lower = (len < sizeof(buf) ? buf : strdup(name));
+	if(lower == NULL)
+	{
+		return -1;
+	}
+	if(lower == buf)
+	{
+		memcpy(buf, name, len + 1U);
+	}
+	fold_case(lower);
+
+	int best = find_in(index->literals, lower, from, INT_MAX);
+
+	if(lower[0] != '.')
+	{
+		size_t i;
+		for(i = 1U; i <= len; ++i)
+		{
+			const unsigned char c = lower[i];
+			if(index->suffix_starts[c/CHAR_BIT] & (1U << (c%CHAR_BIT)))
+			{
+				best = find_in(index->suffixes, &lower[i], from, best);
+			}
+		}
+	}
+
+	if(index->prefix_lens != 0U)
+	{
+		size_t i;
+		for(i = 1U; i <= len && i < MAX_PREFIX_LEN; ++i)
+		{
+			if(index->prefix_lens & ((uint64_t)1 << i))
+			{
+				const char c = lower[i];
+				lower[i] = '\0';
+				best = find_in(index->prefixes, lower, from, best);
+				lower[i] = c;
+			}
+		}
+	}
+
+	if(lower != buf)
+	{
+		free(lower);
+	}
+
+	int i;
+	for(i = 0; i < index->nunindexed; ++i)
+	{
+		const int id = index->unindexed[i];
+		if(id >= best)
+		{
+			break;
+		}
+		if(id >= from && rule_matches(&index->rules[id], path))
+		{
+			return id;
+		}
+	}
+
+	return (best == INT_MAX ? -1 : best);
+}
+
+/* Checks whether all globs of the list are of indexable kinds.  Returns
+ * non-zero if so, otherwise zero is returned. */
+static int
+is_indexable(const char globs[])
+{
+	char *const copy = strdup(globs);
+	if(copy == NULL)
+	{
+		return 0;
+	}
+
+	char *glob = copy, *state = NULL;
+	while((glob = split_and_get_dc(glob, &state)) != NULL)
+	{
+		const char *const asterisk = strchr(glob, '*');
+		if(asterisk == NULL || asterisk == glob)
+		{
+			continue;
+		}
+
+		const size_t pos = asterisk - glob;
+		if(asterisk[1] != '\0' || glob[pos - 1] == '\\' || pos >= MAX_PREFIX_LEN)
+		{
+			break;
+		}
+	}
+
+	free(copy);
+	return (glob == NULL);
+}
+
+/* Puts all globs of a list into the index under the id.  Returns zero on
+ * success, otherwise non-zero is returned. */
+static int
+index_globs(matchers_index_t *index, const char globs[], int id)
+{
+	char *const copy = strdup(globs);
+	if(copy == NULL)
+	{
+		return 1;
+	}
+
+	int error = 0;
+	char *glob = copy, *state = NULL;
+	while(!error && (glob = split_and_get_dc(glob, &state)) != NULL)
+	{
+		fold_case(glob);
+
+		char *const asterisk = strchr(glob, '*');
+		if(asterisk == NULL)
+		{
+			error = add_id(index, index->literals, glob, id);
+		}
+		else if(asterisk == glob)
+		{
+			const unsigned char c = glob[1];
+			index->suffix_starts[c/CHAR_BIT] |= 1U << (c%CHAR_BIT);
+			error = add_id(index, index->suffixes, glob + 1, id);
+		}
+		else
+		{
+			*asterisk = '\0';
+			index->prefix_lens |= (uint64_t)1 << (asterisk - glob);
+			error = add_id(index, index->prefixes, glob, id);
+		}
+	}
+
+	free(copy);
+	return error;
+}
+
+/* Appends id to the list associated with the key creating the list if
+ * necessary.  Returns zero on success, otherwise non-zero is returned. */
+static int
+add_id(matchers_index_t *index, hmap_t *table, const char key[], int id)
+{
+	void *data;
+	id_list_t *list;
+	if(hmap_get(table, key, &data) == 0)
+	{
+		list = data;
+		if(list->ids[list->count - 1] == id)
+		{
+			return 0;
+		}
+	}
+	else
+	{
+		id_list_t **const lists = reallocarray(index->lists, index->nlists + 1,
+				sizeof(*lists));
+		if(lists == NULL)
+		{
+			return 1;
+		}
+		index->lists = lists;
+
+		list = calloc(1, sizeof(*list));
+		if(list == NULL)
+		{
+			return 1;
+		}
+		if(hmap_set(table, key, list) != 0)
+		{
+			free(list);
+			return 1;
+		}
+		index->lists[index->nlists++] = list;
+	}
+
+	int *const ids = reallocarray(list->ids, list->count + 1, sizeof(*ids));
+	if(ids == NULL)
+	{
+		return 1;
+	}
+	list->ids = ids;
+	list->ids[list->count++] = id;
+	return 0;
+}
+
+/* Looks up the key and picks the smallest id in [from, best).  Returns the id
+ * or best if there is none. */
+static int
+find_in(const hmap_t *table, const char key[], int from, int best)
+{
+	void *data;
+	if(hmap_get(table, key, &data) != 0)
+	{
+		return best;
+	}
+
+	const id_list_t *const list = data;
+	int i;
+	for(i = 0; i < list->count && list->ids[i] < best; ++i)
+	{
+		if(list->ids[i] >= from)
+		{
+			return list->ids[i];
+		}
+	}
+	return best;
+}
+
+/* Checks whether any of matchers of the rule matches the path.  Returns
+ * non-zero if so, otherwise zero is returned. */
+static int
+rule_matches(const rule_t *rule, const char path[])
+{
+	int i;
+	for(i = 0; i < rule->count; ++i)
+	{
+		if(matchers_match(rule->list[i], path))
+		{
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/* Converts the string to lower case in place the same way strcasecmp() does
+ * on comparing fast globs. */
+static void
+fold_case(char str[])
+{
+	for(; *str != '\0'; ++str)
+	{
+		*str = tolower((unsigned char)*str);
+	}
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -0,0 +1,54 @@
+/* vifm
+ * Copyright (C) 2026 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef VIFM__UTILS__MATCHERS_INDEX_H__
+#define VIFM__UTILS__MATCHERS_INDEX_H__
+
+/* Index over an ordered list of rules each of which is a disjunction of
+ * matchers.  It answers "which is the first rule that matches this path"
+ * without trying every rule in turn: rules made of literal names, "*suffix"
+ * and "prefix*" globs are looked up in hash tables by parts of file name and
+ * only the rest of the rules is checked one by one. */
+
+struct matchers_t;
+
+/* Opaque index type. */
+typedef struct matchers_index_t matchers_index_t;
+
+/* Creates an empty index.  Returns the index or NULL on error. */
+matchers_index_t * matchers_index_create(void);
+
+/* Frees the index.  Matchers aren't freed.  index can be NULL. */
+void matchers_index_free(matchers_index_t *index);
+
+/* Appends a rule to the index, its id is the number of rules that were added
+ * before it.  The rule matches if any of the count matchers does.  The index
+ * doesn't own matchers, but they must outlive it.  Returns zero on success,
+ * otherwise non-zero is returned and the index must not be used anymore. */
+int matchers_index_add(matchers_index_t *index,
+		struct matchers_t *const list[], int count);
+
+/* Finds first rule with id not less than from that matches the path.  Returns
+ * id of the rule or -1 if there is no such rule. */
+int matchers_index_find(const matchers_index_t *index, const char path[],
+		int from);
+
+#endif /* VIFM__UTILS__MATCHERS_INDEX_H__ */
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -22,19 +22,28 @@
 #include <windows.h>
 #endif
 
+#ifdef __SSE2__
+#include <emmintrin.h> /* __m128i _mm_*() */
+#endif
+
 #include <assert.h> /* assert() */
 #include <stddef.h> /* size_t wchar_t */
 #include <stdlib.h> /* malloc() */
-#include <string.h> /* strlen() */
+#include <string.h> /* memcpy() strlen() */
 
 #include "../compat/reallocarray.h"
 #include "macros.h"
+#include "test_helpers.h"
 #include "utf8proc.h"
 #include "utils.h"
 
 static size_t guess_char_width(char c);
 static wchar_t utf8_char_to_wchar(const char str[], size_t char_width);
+static size_t strsw(const char str[], size_t len);
 static size_t chrsw(const char str[], size_t char_width);
+static size_t ascii_prefix_len(const char str[], size_t len);
+TSTATIC size_t ascii_prefix_len_by_words(const char str[], size_t len);
+static int is_printable_ascii(char c);
 
 size_t
 utf8_chrw(const char str[])
@@ -72,6 +81,14 @@ utf8_strsnlen(const char str[], size_t max_screen_width)
 
 	while(*str != '\0' && max_screen_width != 0)
 	{
+		if(is_printable_ascii(*str))
+		{
+			--max_screen_width;
+			++width;
+			++str;
+			continue;
+		}
+
 		size_t char_width = utf8_chrw(str);
 		size_t char_screen_width = chrsw(str, char_width);
 		if(char_screen_width > max_screen_width)
@@ -123,6 +140,17 @@ utf8_nstrsnlen(const char str[], size_t max_screen_width)
 	/* The loop includes composite characters. */
 	while(length_left != 0)
 	{
+		const size_t ascii_len =
+			MIN(ascii_prefix_len(str, length_left), max_screen_width);
+		if(ascii_len != 0)
+		{
+			length += ascii_len;
+			max_screen_width -= ascii_len;
+			str += ascii_len;
+			length_left -= ascii_len;
+			continue;
+		}
+
 		size_t char_screen_width;
 		const size_t char_width = utf8_chrw(str);
 		if(char_width > length_left)
@@ -169,30 +197,42 @@ utf8_char_to_wchar(const char str[], size_t char_width)
 size_t
 utf8_strsw(const char str[])
 {
-	size_t length = 0;
-	while(*str != '\0')
-	{
-		const size_t char_width = utf8_chrw(str);
-		const size_t char_screen_width = chrsw(str, char_width);
-		str += char_width;
-		length += char_screen_width;
-	}
-	return length;
+	return strsw(str, strlen(str));
 }
 
 size_t
 utf8_nstrsw(const char str[], int len)
 {
-	size_t sw = 0;
-	const char *p = str;
-	while(*p != '\0' && p - str < len)
+	int n = 0;
+	while(n < len && str[n] != '\0')
 	{
-		const size_t char_width = utf8_chrw(p);
-		const size_t char_screen_width = chrsw(p, char_width);
-		p += char_width;
-		sw += char_screen_width;
+		++n;
 	}
-	return sw;
+	return strsw(str, n);
+}
+
+/* Computes screen width of the first len bytes of a string, which must not
+ * contain null characters.  Character that crosses the limit is counted in
+ * full.  Returns the width. */
+static size_t
+strsw(const char str[], size_t len)
+{
+	const char *const end = str + len;
+	size_t width = 0;
+	while(str < end)
+	{
+		const size_t ascii_len = ascii_prefix_len(str, end - str);
+		width += ascii_len;
+		str += ascii_len;
+
+		while(str < end && !is_printable_ascii(*str))
+		{
+			const size_t char_width = utf8_chrw(str);
+			width += chrsw(str, char_width);
+			str += char_width;
+		}
+	}
+	return width;
 }
 
 size_t
@@ -225,6 +265,10 @@ utf8_strsw_with_tabs(const char str[], int tab_stops)
 size_t
 utf8_chrsw(const char str[])
 {
+	if(is_printable_ascii(str[0]))
+	{
+		return 1;
+	}
 	return chrsw(str, utf8_chrw(str));
 }
 
@@ -237,12 +281,94 @@ chrsw(const char str[], size_t char_width)
 	return (result == (size_t)-1) ? 1 : result;
 }
 
+/* Counts leading bytes of a string that are printable ASCII characters, each of
+ * which takes exactly one screen cell.  Examines at most len bytes, all of
+ * which must be readable.  Returns the count. */
+static size_t
+ascii_prefix_len(const char str[], size_t len)
+{
+#ifdef __SSE2__
+	size_t i = 0;
+
+	/* Signed comparison also rejects bytes with the highest bit set because they
+	 * are negative. */
+	const __m128i lower = _mm_set1_epi8(0x1f);
+	const __m128i upper = _mm_set1_epi8(0x7f);
+	for(; len - i >= 16; i += 16)
+	{
+		const __m128i block = _mm_loadu_si128((const __m128i *)(str + i));
+		const __m128i printable = _mm_and_si128(_mm_cmpgt_epi8(block, lower),
+				_mm_cmplt_epi8(block, upper));
+		if(_mm_movemask_epi8(printable) != 0xffff)
+		{
+			break;
+		}
+	}
+
+	while(i < len && is_printable_ascii(str[i]))
+	{
+		++i;
+	}
+	return i;
+#else
+	return ascii_prefix_len_by_words(str, len);
+#endif
+}
+
+/* Portable version of ascii_prefix_len(), which checks a machine word at a
+ * time.  It's compiled unconditionally to be testable on machines where SSE2
+ * version is used.  Returns the count. */
+TSTATIC size_t
+ascii_prefix_len_by_words(const char str[], size_t len)
+{
+	size_t i = 0;
+
+	/* Carries and borrows between bytes can cause false positives only next to a
+	 * byte that doesn't pass the check anyway. */
+	const size_t ones = (size_t)-1/0xff;
+	const size_t highs = ones*0x80;
+	for(; len - i >= sizeof(size_t); i += sizeof(size_t))
+	{
+		size_t word;
+		memcpy(&word, str + i, sizeof(word));
+
+		/* Bytes >= 0x80, bytes >= 0x7f and bytes < 0x20. */
+		const size_t bad = (word | (word + ones) | ((word - ones*0x20) & ~word))
+		                 & highs;
+		if(bad != 0)
+		{
+			break;
+		}
+	}
+
+	while(i < len && is_printable_ascii(str[i]))
+	{
+		++i;
+	}
+	return i;
+}
+
+/* Checks whether the byte is a printable ASCII character.  Returns non-zero if
+ * so, otherwise zero is returned. */
+static int
+is_printable_ascii(char c)
+{
+	return (unsigned char)(c - 0x20) < 0x5f;
+}
+
 size_t
 utf8_stro(const char str[])
 {
+	const char *const end = str + strlen(str);
 	size_t overhead = 0;
 	while(*str != '\0')
 	{
+		str += ascii_prefix_len(str, end - str);
+		if(*str == '\0')
+		{
+			break;
+		}
+
 		size_t char_width = utf8_chrw(str);
 		str += char_width;
 		overhead += char_width - 1;
@@ -253,9 +379,16 @@ utf8_stro(const char str[])
 size_t
 utf8_strso(const char str[])
 {
+	const char *const end = str + strlen(str);
 	size_t overhead = 0;
 	while(*str != '\0')
 	{
+		str += ascii_prefix_len(str, end - str);
+		if(*str == '\0')
+		{
+			break;
+		}
+
 		const size_t char_width = utf8_chrw(str);
 		const size_t char_screen_width = chrsw(str, char_width);
 		str += char_width;
@@ -21,6 +21,8 @@
 
 #include <stddef.h> /* size_t wchar_t */
 
+#include "test_helpers.h"
+
 /* Abbreviations:
  *  - "n"  -- "normal", excluding incomplete (broken) utf-8 sequences;
  *  - "sn" -- "screen number", screen width limit;
@@ -102,6 +104,10 @@ char * utf8_from_utf16(const wchar_t utf16[]);
 
 #endif
 
+TSTATIC_DEFS(
+	size_t ascii_prefix_len_by_words(const char str[], size_t len);
+)
+
 #endif /* VIFM__UTILS__UTF8_H__ */
 
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
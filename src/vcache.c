@@ -20,9 +20,10 @@
 
 #include <fcntl.h> /* F_GETFL F_SETFL O_NONBLOCK fcntl() */
 
-#include <stdio.h> /* FILE */
+#include <stdint.h> /* uint64_t */
+#include <stdio.h> /* EOF FILE SEEK_SET fgetc() fread() fseek() ftell() ungetc() */
 #include <stdlib.h> /* free() */
-#include <string.h> /* memmove() memset() strcmp() */
+#include <string.h> /* memcmp() strcpy() strlen() */
 #include <time.h> /* time_t time() */
 
 #include "cfg/config.h"
@@ -31,10 +32,11 @@
 #include "ui/cancellation.h"
 #include "ui/quickview.h"
 #include "ui/ui.h"
-#include "utils/darray.h"
 #include "utils/file_streams.h"
 #include "utils/filemon.h"
 #include "utils/fs.h"
+#include "utils/hmap.h"
+#include "utils/macros.h"
 #include "utils/path.h"
 #include "utils/selector.h"
 #include "utils/str.h"
@@ -43,6 +45,7 @@
 #include "background.h"
 #include "filetype.h"
 #include "status.h"
+#include "vcache_disk.h"
 
 /* Maximum number of seconds to wait for data. */
 enum { MAX_RUN_TIME_S = 60 };
@@ -50,9 +53,16 @@ enum { MAX_RUN_TIME_S = 60 };
 /* Maximum number of seconds to wait for process to cancel. */
 enum { MAX_KILL_DELAY_S = 2 };
 
+/* Maximum number of viewers running at the same time for prefetching. */
+enum { MAX_PREFETCH_JOBS = 2 };
+
 /* Cached output of a specific previewer for a specific file. */
 typedef struct vcache_entry_t
 {
+	struct vcache_entry_t *prev; /* Less recently used entry or NULL. */
+	struct vcache_entry_t *next; /* More recently used entry or NULL. */
+	char *key;                   /* Key of this entry in the index. */
+
 	char *path;        /* Full path to the file. */
 	char *viewer;      /* Viewer of the file. */
 	bg_job_t *job;     /* If not NULL, source of file contents. */
@@ -60,8 +70,12 @@ typedef struct vcache_entry_t
 	strlist_t lines;   /* Top lines of preview contents. */
 	time_t started_at; /* Since when we're waiting for the data. */
 	time_t kill_timer; /* Since when we're waiting for the job to die or zero. */
-	size_t size;       /* Size taken up by this entry (lower bound). */
+	size_t size;       /* Size taken up by this entry. */
 	int max_lines;     /* Number of lines requested. */
+	uint64_t offset;   /* Number of bytes of a regular file consumed by builtin
+	                      viewer. */
+	char tail[32];     /* Last bytes of the file before the offset. */
+	size_t tail_len;   /* Number of valid bytes in the tail field. */
 
 	/* Value of maxtreedepth for this entry. */
 	int max_tree_depth;
@@ -71,6 +85,12 @@ typedef struct vcache_entry_t
 	unsigned int truncated : 1;
 	/* Value of toptreestats for this entry. */
 	unsigned int top_tree_stats : 1;
+	/* Whether entry can be updated by reading only data appended to the file. */
+	unsigned int appendable : 1;
+	/* Whether entry was created ahead of time and wasn't looked up yet. */
+	unsigned int prefetch : 1;
+	/* Whether prefetching of this entry is no longer needed. */
+	unsigned int stale : 1;
 }
 vcache_entry_t;
 
@@ -78,18 +98,31 @@ TSTATIC size_t vcache_entry_size(void);
 static void wait_async_finish(vcache_entry_t *centry);
 static vcache_entry_t * find_cache_entry(const char full_path[],
 		const char viewer[], int max_lines);
-static vcache_entry_t * alloc_cache_entry(void);
+static int count_prefetches(void);
+static char * make_key(const char path[], const char viewer[]);
+static vcache_entry_t * alloc_cache_entry(const char path[],
+		const char viewer[]);
 static void compact_cache(void);
-static vcache_entry_t * new_cache_entry(void);
+static vcache_entry_t * new_cache_entry(const char path[], const char viewer[]);
+static void link_entry(vcache_entry_t *centry);
+static void unlink_entry(vcache_entry_t *centry);
+static void drop_entry(vcache_entry_t *centry);
 TSTATIC void vcache_reset(size_t max_size);
 static void free_cache_entry(vcache_entry_t *centry);
-static int is_cache_match(const vcache_entry_t *centry, const char path[],
-		const char viewer[]);
 static int is_cache_valid(const vcache_entry_t *centry, const char path[],
 		const char viewer[], int max_lines);
 static void update_cache_entry(vcache_entry_t *centry, const char path[],
 		const char viewer[], MacroFlags flags, int max_lines, const char **error);
+static vcache_entry_t * load_from_disk(vcache_entry_t *centry,
+		const char path[], const char viewer[], int max_lines);
+static void store_on_disk(const vcache_entry_t *centry);
+static int is_persistable(const char viewer[]);
+static int read_appended(vcache_entry_t *centry, const char path[],
+		int max_lines);
 static void update_sizes(vcache_entry_t *centry);
+static void update_sizes_from(vcache_entry_t *centry, int from,
+		size_t old_size);
+static size_t get_lines_size(const strlist_t *lines, int from);
 static int pull_async(vcache_entry_t *centry);
 static int read_async_output(vcache_entry_t *centry);
 static void cancel_job(vcache_entry_t *centry);
@@ -98,40 +131,60 @@ static int need_more_async_output(vcache_entry_t *centry);
 static strlist_t view_entry(vcache_entry_t *centry, MacroFlags flags,
 		const char **error);
 static strlist_t view_builtin(vcache_entry_t *centry, const char **error);
+static void remember_offset(vcache_entry_t *centry, FILE *fp);
 static strlist_t view_plugin(vcache_entry_t *centry, const char **error);
 static strlist_t view_external(vcache_entry_t *centry, MacroFlags flags,
 		const char **error);
 TSTATIC strlist_t read_lines(FILE *fp, int max_lines, int *complete);
 
-/* Cache of viewers' output.  Ordered from least to most recently used. */
-static vcache_entry_t **cache;
-/* Declarations to enable use of DA_* on cache. */
-static DA_INSTANCE(cache);
-/* Amount of memory taken up by the cache (lower bound). */
+/* Cache of viewers' output as a list ordered from least to most recently
+ * used. */
+static vcache_entry_t *lru_head, *lru_tail;
+/* Index of entries of the cache by their keys. */
+static hmap_t *cache_index;
+/* Amount of memory taken up by the cache. */
 static size_t cache_size;
 /* Maximum size of the cache. */
-static size_t max_cache_size = 3U*1024*1024;
+static size_t max_cache_size = VCACHE_DEF_MAX_SIZE;
+/* Statistics of cache usage. */
+static unsigned long long nhits, ndisk_hits, nmisses, nevictions;
 
 void
 vcache_finish(void)
 {
-	size_t i;
-	for(i = 0U; i < DA_SIZE(cache); ++i)
+	vcache_entry_t *centry;
+	for(centry = lru_head; centry != NULL; centry = centry->next)
 	{
-		if(cache[i]->job != NULL)
+		if(centry->job != NULL)
 		{
-			bg_job_cancel(cache[i]->job);
-			bg_job_terminate(cache[i]->job);
-			bg_job_decref(cache[i]->job);
-			cache[i]->job = NULL;
+			bg_job_cancel(centry->job);
+			bg_job_terminate(centry->job);
+			bg_job_decref(centry->job);
+			centry->job = NULL;
 		}
 	}
 }
 
-size_t
-vcache_size(void)
+vcache_stats_t
+vcache_get_stats(void)
 {
-	return cache_size;
+	vcache_stats_t stats = {
+		.size = cache_size,
+		.max_size = max_cache_size,
+		.entries = hmap_size(cache_index),
+		.hits = nhits,
+		.disk_hits = ndisk_hits,
+		.misses = nmisses,
+		.evictions = nevictions,
+	};
+	return stats;
+}
+
+void
+vcache_set_max_size(size_t max_size)
+{
+	max_cache_size = max_size;
+	compact_cache();
 }
 
 TSTATIC size_t
@@ -147,12 +200,12 @@ vcache_check(vcache_is_previewed_cb is_previewed)
 
 	/* TODO: consider doing this in a separate thread. */
 
-	size_t i;
-	for(i = 0U; i < DA_SIZE(cache); ++i)
+	vcache_entry_t *centry;
+	for(centry = lru_head; centry != NULL; centry = centry->next)
 	{
-		if(cache[i]->job != NULL)
+		if(centry->job != NULL)
 		{
-			changed |= (pull_async(cache[i]) && is_previewed(cache[i]->path));
+			changed |= (pull_async(centry) && is_previewed(centry->path));
 		}
 	}
 
@@ -167,7 +220,8 @@ vcache_lookup(const char full_path[], const char viewer[], MacroFlags flags,
 
 	/* Skip caching of data if we can't really cache it or when user doesn't want
 	 * it to be cached. */
-	if(kind == VK_GRAPHICAL || ma_flags_present(flags, MF_NO_CACHE))
+	if(kind == VK_GRAPHICAL || ma_flags_present(flags, MF_NO_CACHE) ||
+			max_cache_size == 0U)
 	{
 		static vcache_entry_t non_cache;
 		free_cache_entry(&non_cache);
@@ -183,14 +237,45 @@ vcache_lookup(const char full_path[], const char viewer[], MacroFlags flags,
 	}
 
 	vcache_entry_t *centry = find_cache_entry(full_path, viewer, max_lines);
+	if(centry != NULL)
+	{
+		/* The entry is actually needed now. */
+		centry->prefetch = 0;
+	}
+
 	if(centry != NULL && is_cache_valid(centry, full_path, viewer, max_lines))
 	{
+		++nhits;
 		return centry->lines;
 	}
 
+	if(centry != NULL && read_appended(centry, full_path, max_lines) >= 0)
+	{
+		++nhits;
+		return centry->lines;
+	}
+
+	/* Attaching to a viewer that's still running doesn't start a new one. */
+	if(centry != NULL && centry->job != NULL)
+	{
+		++nhits;
+	}
+	else
+	{
+		vcache_entry_t *loaded = load_from_disk(centry, full_path, viewer,
+				max_lines);
+		if(loaded != NULL)
+		{
+			++ndisk_hits;
+			return loaded->lines;
+		}
+
+		++nmisses;
+	}
+
 	if(centry == NULL)
 	{
-		centry = alloc_cache_entry();
+		centry = alloc_cache_entry(full_path, viewer);
 		if(centry == NULL)
 		{
 			*error = "Failed to allocate cache entry";
@@ -218,6 +303,104 @@ vcache_lookup(const char full_path[], const char viewer[], MacroFlags flags,
 	return centry->lines;
 }
 
+void
+vcache_prefetch_begin(void)
+{
+	vcache_entry_t *centry;
+	for(centry = lru_head; centry != NULL; centry = centry->next)
+	{
+		centry->stale = centry->prefetch;
+	}
+}
+
+int
+vcache_prefetch(const char full_path[], const char viewer[], MacroFlags flags,
+		int max_lines)
+{
+	/* Only external viewers run asynchronously. */
+	if(is_null_or_empty(viewer) || ma_flags_present(flags, MF_NO_CACHE) ||
+			vlua_handler_cmd(curr_stats.vlua, viewer))
+	{
+		return 0;
+	}
+
+	vcache_entry_t *centry = find_cache_entry(full_path, viewer, max_lines);
+	if(centry != NULL)
+	{
+		centry->stale = 0;
+		if(centry->job != NULL ||
+				is_cache_valid(centry, full_path, viewer, max_lines))
+		{
+			return 0;
+		}
+	}
+
+	if(load_from_disk(centry, full_path, viewer, max_lines) != NULL)
+	{
+		return 0;
+	}
+
+	/* Previewed file doesn't count towards the limit, which gives it
+	 * priority. */
+	if(count_prefetches() >= MAX_PREFETCH_JOBS)
+	{
+		return 0;
+	}
+
+	if(centry == NULL)
+	{
+		centry = alloc_cache_entry(full_path, viewer);
+		if(centry == NULL)
+		{
+			return 0;
+		}
+	}
+
+	const char *error;
+	update_cache_entry(centry, full_path, viewer, flags, max_lines, &error);
+
+	centry->prefetch = (centry->job != NULL);
+	centry->stale = 0;
+	return centry->prefetch;
+}
+
+void
+vcache_prefetch_end(void)
+{
+	vcache_entry_t *centry;
+	for(centry = lru_head; centry != NULL; centry = centry->next)
+	{
+		if(centry->stale && centry->job != NULL && centry->kill_timer == 0)
+		{
+			cancel_job(centry);
+		}
+		centry->stale = 0;
+	}
+}
+
+int
+vcache_extend(const char full_path[], int max_lines, strlist_t *lines)
+{
+	vcache_entry_t *centry = find_cache_entry(full_path, NULL, max_lines);
+	if(centry == NULL)
+	{
+		return -1;
+	}
+
+	if(is_cache_valid(centry, full_path, NULL, max_lines))
+	{
+		*lines = centry->lines;
+		return centry->lines.nitems;
+	}
+
+	const int intact = read_appended(centry, full_path, max_lines);
+	if(intact >= 0)
+	{
+		*lines = centry->lines;
+	}
+	return intact;
+}
+
 /* Waits for asynchronous job to be done. */
 static void
 wait_async_finish(vcache_entry_t *centry)
@@ -263,6 +446,12 @@ wait_async_finish(vcache_entry_t *centry)
 		centry->lines.nitems = add_to_string_array(&centry->lines.items,
 				centry->lines.nitems, "[cancelled]");
 	}
+	else
+	{
+		/* All output was read, so there is no need to run the viewer again. */
+		centry->complete = 1;
+		store_on_disk(centry);
+	}
 	ui_cancellation_pop();
 
 	bg_job_decref(centry->job);
@@ -274,28 +463,65 @@ wait_async_finish(vcache_entry_t *centry)
 static vcache_entry_t *
 find_cache_entry(const char full_path[], const char viewer[], int max_lines)
 {
-	size_t i;
-	for(i = 0U; i < DA_SIZE(cache); ++i)
+	char *key = make_key(full_path, viewer);
+
+	void *data;
+	vcache_entry_t *centry = NULL;
+	if(key != NULL && hmap_get(cache_index, key, &data) == 0)
 	{
-		if(is_cache_match(cache[i], full_path, viewer))
-		{
-			vcache_entry_t *centry = cache[i];
+		centry = data;
 
-			/* Make the most recently used entry the last one. */
-			memmove(cache + i, cache + i + 1,
-					sizeof(*cache)*(DA_SIZE(cache) - 1U - i));
-			cache[DA_SIZE(cache) - 1U] = centry;
+		/* Make the most recently used entry the last one. */
+		unlink_entry(centry);
+		link_entry(centry);
+	}
 
-			return centry;
-		}
+	free(key);
+	return centry;
+}
+
+/* Counts jobs started for prefetching that are still running.  Returns the
+ * number. */
+static int
+count_prefetches(void)
+{
+	int count = 0;
+	vcache_entry_t *centry;
+	for(centry = lru_head; centry != NULL; centry = centry->next)
+	{
+		count += (centry->prefetch && centry->job != NULL);
 	}
-	return NULL;
+	return count;
+}
+
+/* Makes key for an entry of the index.  Returns newly allocated string or
+ * NULL. */
+static char *
+make_key(const char path[], const char viewer[])
+{
+	/* Some additional space is allocated for adding slashes. */
+	char canonic[strlen(path) + 8];
+	canonicalize_path(path, canonic, sizeof(canonic));
+
+#ifdef _WIN32
+	/* Paths are case insensitive on Windows. */
+	char lowered[sizeof(canonic)];
+	if(str_to_lower(canonic, lowered, sizeof(lowered)) == 0)
+	{
+		strcpy(canonic, lowered);
+	}
+#endif
+
+	/* Length of viewer makes the key unambiguous. */
+	return (viewer == NULL)
+	     ? format_str("-:%s", canonic)
+	     : format_str("%d:%s%s", (int)strlen(viewer), viewer, canonic);
 }
 
 /* Allocates a zero-initialized cache entry.  When cache size limit is reached
  * older cache entries are reused.  Returns the entry or NULL. */
 static vcache_entry_t *
-alloc_cache_entry(void)
+alloc_cache_entry(const char path[], const char viewer[])
 {
 	if(max_cache_size == 0U)
 	{
@@ -303,74 +529,141 @@ alloc_cache_entry(void)
 	}
 
 	compact_cache();
-	return new_cache_entry();
+	return new_cache_entry(path, viewer);
 }
 
 /* Shrinks cache if its size is larger than the limit. */
 static void
 compact_cache(void)
 {
-	if(cache == NULL)
+	vcache_entry_t *centry = lru_head;
+	while(centry != NULL && cache_size >= max_cache_size)
 	{
-		return;
-	}
+		vcache_entry_t *next = centry->next;
 
-	size_t i;
-	size_t j = 0U;
-	for(i = 0U; i < DA_SIZE(cache) && cache_size >= max_cache_size; ++i)
-	{
-		vcache_entry_t *centry = cache[i];
 		if(centry->job != NULL)
 		{
-			cache[j++] = centry;
 			/* Give it a chance to finish gracefully. */
-			cancel_job(centry);
-			continue;
+			if(centry->kill_timer == 0)
+			{
+				cancel_job(centry);
+			}
+		}
+		else
+		{
+			drop_entry(centry);
+			++nevictions;
 		}
 
-		cache_size -= centry->size;
-		free_cache_entry(centry);
-		free(centry);
+		centry = next;
 	}
-
-	memmove(cache + j, cache + i, sizeof(*cache)*(DA_SIZE(cache) - i));
-	DA_REMOVE_AFTER(cache, cache + j + DA_SIZE(cache) - i);
 }
 
 /* Allocates a new cache entry unconditionally.  Returns the entry. */
 static vcache_entry_t *
-new_cache_entry(void)
+new_cache_entry(const char path[], const char viewer[])
 {
-	vcache_entry_t **centry = DA_EXTEND(cache);
+	if(cache_index == NULL)
+	{
+		cache_index = hmap_create();
+		if(cache_index == NULL)
+		{
+			return NULL;
+		}
+	}
+
+	vcache_entry_t *centry = calloc(1, sizeof(*centry));
 	if(centry == NULL)
 	{
 		return NULL;
 	}
 
-	*centry = calloc(1, sizeof(**centry));
-	if(*centry == NULL)
+	centry->key = make_key(path, viewer);
+	if(centry->key == NULL || hmap_set(cache_index, centry->key, centry) != 0)
 	{
+		free(centry->key);
+		free(centry);
 		return NULL;
 	}
 
-	DA_COMMIT(cache);
-	return *centry;
+	link_entry(centry);
+	update_sizes(centry);
+	return centry;
+}
+
+/* Appends entry to the end of the list of entries (makes it the most recently
+ * used one). */
+static void
+link_entry(vcache_entry_t *centry)
+{
+	centry->prev = lru_tail;
+	centry->next = NULL;
+
+	if(lru_tail == NULL)
+	{
+		lru_head = centry;
+	}
+	else
+	{
+		lru_tail->next = centry;
+	}
+	lru_tail = centry;
+}
+
+/* Excludes entry from the list of entries. */
+static void
+unlink_entry(vcache_entry_t *centry)
+{
+	if(centry->prev == NULL)
+	{
+		lru_head = centry->next;
+	}
+	else
+	{
+		centry->prev->next = centry->next;
+	}
+
+	if(centry->next == NULL)
+	{
+		lru_tail = centry->prev;
+	}
+	else
+	{
+		centry->next->prev = centry->prev;
+	}
+
+	centry->prev = NULL;
+	centry->next = NULL;
+}
+
+/* Removes entry from the cache and frees it. */
+static void
+drop_entry(vcache_entry_t *centry)
+{
+	unlink_entry(centry);
+	(void)hmap_remove(cache_index, centry->key);
+
+	cache_size -= centry->size;
+	free_cache_entry(centry);
+	free(centry->key);
+	free(centry);
 }
 
 /* Invalidates all cache entries and changes size limit. */
 TSTATIC void
 vcache_reset(size_t max_size)
 {
-	size_t i;
-	for(i = 0U; i < DA_SIZE(cache); ++i)
+	while(lru_head != NULL)
 	{
-		free_cache_entry(cache[i]);
-		free(cache[i]);
+		drop_entry(lru_head);
 	}
-	DA_REMOVE_ALL(cache);
 
 	max_cache_size = max_size;
 	cache_size = 0;
+	nhits = 0;
+	ndisk_hits = 0;
+	nmisses = 0;
+	nevictions = 0;
 }
 
 /* Frees resources of a cache entry. */
@@ -393,20 +686,6 @@ free_cache_entry(vcache_entry_t *centry)
 	}
 }
 
-/* Checks whether cache entry matches specified file and viewer.  Returns
- * non-zero if so, otherwise zero is returned. */
-static int
-is_cache_match(const vcache_entry_t *centry, const char path[],
-		const char viewer[])
-{
-	int same_viewer = (centry->viewer == NULL && viewer == NULL)
-	               || (centry->viewer != NULL && viewer != NULL &&
-	                   strcmp(centry->viewer, viewer) == 0);
-	return same_viewer
-	    && centry->path != NULL
-	    && paths_are_equal(centry->path, path);
-}
-
 /* Checks whether data in the cache entry is up to date with the file on disk
  * and contains enough lines.  Returns non-zero if so, otherwise zero is
  * returned. */
@@ -461,22 +740,244 @@ update_cache_entry(vcache_entry_t *centry, const char path[],
 	}
 }
 
+/* Populates cache entry from output of a viewer stored on disk.  centry can be
+ * NULL, in which case new entry is allocated.  Returns the entry on success or
+ * NULL if nothing suitable is stored. */
+static vcache_entry_t *
+load_from_disk(vcache_entry_t *centry, const char path[], const char viewer[],
+		int max_lines)
+{
+	if(!is_persistable(viewer))
+	{
+		return NULL;
+	}
+
+	strlist_t lines;
+	int complete;
+	if(vcache_disk_load(path, viewer, max_lines, &lines, &complete) != 0)
+	{
+		return NULL;
+	}
+
+	if(centry == NULL)
+	{
+		centry = alloc_cache_entry(path, viewer);
+		if(centry == NULL)
+		{
+			free_string_array(lines.items, lines.nitems);
+			return NULL;
+		}
+	}
+
+	(void)filemon_from_file(path, FMT_MODIFIED, &centry->filemon);
+	centry->max_lines = max_lines;
+	replace_string(&centry->path, path);
+	update_string(&centry->viewer, viewer);
+
+	free_string_array(centry->lines.items, centry->lines.nitems);
+	centry->lines = lines;
+	centry->complete = complete;
+	centry->truncated = 0;
+	centry->appendable = 0;
+
+	update_sizes(centry);
+	return centry;
+}
+
+/* Saves output of a viewer on disk if it's worth it and the file hasn't
+ * changed while the viewer was running. */
+static void
+store_on_disk(const vcache_entry_t *centry)
+{
+	if(centry->key == NULL || !is_persistable(centry->viewer) ||
+			(!centry->complete && centry->lines.nitems < centry->max_lines))
+	{
+		return;
+	}
+
+	filemon_t filemon;
+	(void)filemon_from_file(centry->path, FMT_MODIFIED, &filemon);
+	if(!filemon_equal(&filemon, &centry->filemon))
+	{
+		return;
+	}
+
+	vcache_disk_store(centry->path, centry->viewer, &centry->lines,
+			centry->complete);
+}
+
+/* Checks whether output of the viewer can be stored on disk.  Returns non-zero
+ * if so, otherwise zero is returned. */
+static int
+is_persistable(const char viewer[])
+{
+	/* Only external viewers are slow enough to be worth it. */
+	return vcache_disk_get_max_size() != 0U
+	    && !is_null_or_empty(viewer)
+	    && !vlua_handler_cmd(curr_stats.vlua, viewer);
+}
+
+/* Updates entry of builtin viewer of a regular file that has only grown since
+ * the last read by reading just the new data (think of "tail -F").  Returns
+ * number of leading lines that were left intact or -1 if the file wasn't
+ * appended to, in which case the entry is left unchanged. */
+static int
+read_appended(vcache_entry_t *centry, const char path[], int max_lines)
+{
+	if(!centry->appendable || !centry->complete || centry->job != NULL)
+	{
+		return -1;
+	}
+
+	filemon_t filemon;
+	if(filemon_from_file(path, FMT_MODIFIED, &filemon) != 0)
+	{
+		return -1;
+	}
+
+	/* Rotated files are replaced by a new file and truncated or rewritten ones
+	 * don't grow, in all cases old data isn't a prefix of the new one. */
+	if(filemon.dev != centry->filemon.dev ||
+			filemon.inode != centry->filemon.inode ||
+			get_file_size(path) <= centry->offset)
+	{
+		return -1;
+	}
+
+	/* Binary mode is important on Windows. */
+	FILE *fp = os_fopen(path, "rb");
+	if(fp == NULL)
+	{
+		return -1;
+	}
+
+	/* Guard against files that were rewritten with more data by checking that
+	 * the end of previously read data is still there. */
+	char tail[sizeof(centry->tail)];
+	if(fseek(fp, (long)(centry->offset - centry->tail_len), SEEK_SET) != 0 ||
+			fread(tail, 1, centry->tail_len, fp) != centry->tail_len ||
+			memcmp(tail, centry->tail, centry->tail_len) != 0)
+	{
+		fclose(fp);
+		return -1;
+	}
+
+	int glue_first_line = 0;
+	const int last_char = (centry->tail_len == 0U)
+	                    ? EOF
+	                    : (unsigned char)tail[centry->tail_len - 1U];
+	if(centry->offset == 0U)
+	{
+		skip_bom(fp);
+	}
+	else if(last_char == '\r')
+	{
+		/* Don't turn "\r\n" split between two reads into two line breaks. */
+		const int c = fgetc(fp);
+		if(c != '\n')
+		{
+			ungetc(c, fp);
+		}
+	}
+	else if(last_char != '\n')
+	{
+		glue_first_line = (centry->lines.nitems != 0);
+	}
+
+	const int intact = centry->lines.nitems - glue_first_line;
+	const size_t old_size = get_lines_size(&centry->lines, intact);
+
+	int at_eof = 0;
+	while(glue_first_line || centry->lines.nitems < max_lines)
+	{
+		char *const next_line = read_line(fp, NULL);
+		if(next_line == NULL)
+		{
+			at_eof = 1;
+			break;
+		}
+
+		if(glue_first_line)
+		{
+			char **last = &centry->lines.items[centry->lines.nitems - 1];
+			size_t last_len = strlen(*last);
+			strappend(last, &last_len, next_line);
+			free(next_line);
+			glue_first_line = 0;
+			continue;
+		}
+
+		const int old_len = centry->lines.nitems;
+		centry->lines.nitems = put_into_string_array(&centry->lines.items,
+				centry->lines.nitems, next_line);
+		if(centry->lines.nitems == old_len)
+		{
+			free(next_line);
+			break;
+		}
+	}
+
+	centry->complete = at_eof;
+	centry->max_lines = max_lines;
+	if(at_eof)
+	{
+		centry->filemon = filemon;
+		remember_offset(centry, fp);
+	}
+	/* Otherwise the entry doesn't match the file anymore and is reloaded once
+	 * more lines are needed. */
+	fclose(fp);
+
+	update_sizes_from(centry, intact, old_size);
+	return intact;
+}
+
 /* Computes size occupied by the entry updating total cache size too. */
 static void
 update_sizes(vcache_entry_t *centry)
 {
-	cache_size -= centry->size;
+	const size_t old_size = centry->size;
 
-	/* This isn't zero to make even empty preview result take up space. */
-	centry->size = sizeof(*centry);
+	centry->size = sizeof(*centry)
+	             + (centry->key == NULL ? 0U : strlen(centry->key) + 1U)
+	             + (centry->path == NULL ? 0U : strlen(centry->path) + 1U)
+	             + (centry->viewer == NULL ? 0U : strlen(centry->viewer) + 1U)
+	             + get_lines_size(&centry->lines, 0);
 
-	int i;
-	for(i = 0; i < centry->lines.nitems; ++i)
+	/* Entries outside of the cache don't count. */
+	if(centry->key != NULL)
 	{
-		centry->size += strlen(centry->lines.items[i]);
+		cache_size = cache_size - old_size + centry->size;
 	}
+}
 
-	cache_size += centry->size;
+/* Updates size occupied by the entry after lines starting with the specified
+ * one have changed.  old_size is size of those lines before the change. */
+static void
+update_sizes_from(vcache_entry_t *centry, int from, size_t old_size)
+{
+	const size_t new_size = get_lines_size(&centry->lines, from);
+
+	centry->size = centry->size - old_size + new_size;
+	/* Entries outside of the cache don't count. */
+	if(centry->key != NULL)
+	{
+		cache_size = cache_size - old_size + new_size;
+	}
+}
+
+/* Computes amount of memory taken up by lines starting with the specified
+ * one.  Returns the size. */
+static size_t
+get_lines_size(const strlist_t *lines, int from)
+{
+	size_t size = 0U;
+	int i;
+	for(i = from; i < lines->nitems; ++i)
+	{
+		size += sizeof(*lines->items) + strlen(lines->items[i]) + 1U;
+	}
+	return size;
 }
 
 /* Updates single entry backed by an asynchronous job.  Returns non-zero if
@@ -520,6 +1021,8 @@ pull_async(vcache_entry_t *centry)
 		bg_job_decref(centry->job);
 		centry->job = NULL;
 		changed = 1;
+
+		store_on_disk(centry);
 	}
 
 	return changed;
@@ -574,8 +1077,9 @@ read_async_output(vcache_entry_t *centry)
 	}
 
 	clearerr(centry->job->output);
-	centry->size += len;
-	cache_size += len;
+
+	const int from = centry->lines.nitems - (centry->truncated ? 1 : 0);
+	const size_t old_size = get_lines_size(&centry->lines, from);
 
 	int new_truncated = (len > 0)
 	                 && (piece[len - 1] != '\r' && piece[len - 1] != '\n');
@@ -600,6 +1104,8 @@ read_async_output(vcache_entry_t *centry)
 	}
 	free(lines);
 
+	update_sizes_from(centry, from, old_size);
+
 	centry->truncated = new_truncated;
 	return 1;
 }
@@ -669,6 +1175,7 @@ view_builtin(vcache_entry_t *centry, const char **error)
 	ui_cancellation_push_on();
 
 	int dir = is_dir(centry->path);
+	centry->appendable = 0;
 
 	FILE *fp = NULL;
 	if(dir)
@@ -689,6 +1196,10 @@ view_builtin(vcache_entry_t *centry, const char **error)
 		int complete;
 		lines = read_lines(fp, centry->max_lines, &complete);
 		centry->complete = complete;
+		if(!dir)
+		{
+			remember_offset(centry, fp);
+		}
 		fclose(fp);
 	}
 	else
@@ -701,6 +1212,27 @@ view_builtin(vcache_entry_t *centry, const char **error)
 	return lines;
 }
 
+/* Records position in a regular file up to which its contents was read along
+ * with data right before it for future reading of appended data. */
+static void
+remember_offset(vcache_entry_t *centry, FILE *fp)
+{
+	const long offset = ftell(fp);
+	centry->appendable = 0;
+	if(offset < 0)
+	{
+		return;
+	}
+
+	centry->offset = offset;
+	centry->tail_len = MIN(sizeof(centry->tail), (size_t)offset);
+	if(fseek(fp, offset - (long)centry->tail_len, SEEK_SET) == 0 &&
+			fread(centry->tail, 1, centry->tail_len, fp) == centry->tail_len)
+	{
+		centry->appendable = 1;
+	}
+}
+
 /* Calls a plugin to view a file.  *error is set to an error message on failure.
  * Returns output. */
 static strlist_t
@@ -37,6 +37,22 @@ enum
 	             number of lines. */
 };
 
+/* Default maximum size of the cache in bytes. */
+#define VCACHE_DEF_MAX_SIZE (3U*1024U*1024U)
+
+/* Statistics of the cache. */
+typedef struct
+{
+	size_t size;                  /* Amount of memory taken up by the cache. */
+	size_t max_size;              /* Maximum size of the cache. */
+	size_t entries;               /* Number of entries in the cache. */
+	unsigned long long hits;      /* Number of lookups served from the cache. */
+	unsigned long long disk_hits; /* Number of lookups served from disk. */
+	unsigned long long misses;    /* Number of lookups that had to run viewer. */
+	unsigned long long evictions; /* Number of entries evicted due to size. */
+}
+vcache_stats_t;
+
 /* Type of callback function to check if preview of specified path is visible.
  * Should return non-zero if so and zero otherwise. */
 typedef int (*vcache_is_previewed_cb)(const char path[]);
@@ -46,8 +62,11 @@ struct strlist_t;
 /* Kills all asynchronous viewers. */
 void vcache_finish(void);
 
-/* Retrieves size of the cache (lower bound).  Returns the size. */
-size_t vcache_size(void);
+/* Retrieves statistics of the cache.  Returns the statistics. */
+vcache_stats_t vcache_get_stats(void);
+
+/* Changes maximum size of the cache evicting entries if necessary. */
+void vcache_set_max_size(size_t max_size);
 
 /* Checks updates of asynchronous viewers.  Returns non-zero is screen needs to
  * be updated, otherwise zero is returned. */
@@ -61,6 +80,29 @@ struct strlist_t vcache_lookup(const char full_path[], const char viewer[],
 		MacroFlags flags, ViewerKind kind, int max_lines, int sync,
 		const char **error);
 
+/* Marks all entries being prefetched as no longer needed.  Prefetching of those
+ * that aren't requested again before vcache_prefetch_end() is cancelled. */
+void vcache_prefetch_begin(void);
+
+/* Starts external viewer in background to populate cache ahead of time unless
+ * its output is already cached, being produced or there are too many
+ * prefetches running.  Returns non-zero if new viewer was started, otherwise
+ * zero is returned. */
+int vcache_prefetch(const char full_path[], const char viewer[],
+		MacroFlags flags, int max_lines);
+
+/* Cancels prefetching of entries that weren't requested since the last call of
+ * vcache_prefetch_begin(). */
+void vcache_prefetch_end(void);
+
+/* Updates cached output of builtin viewer of a file by reading only data that
+ * was appended to it since the last lookup.  On success *lines is set to
+ * updated list of strings owned and managed by the unit.  Returns number of
+ * leading lines that were left unchanged or -1 if there is no suitable cache
+ * entry or the file wasn't just appended to. */
+int vcache_extend(const char full_path[], int max_lines,
+		struct strlist_t *lines);
+
 TSTATIC_DEFS(
 	struct strlist_t read_lines(FILE *fp, int max_lines, int *complete);
 	void vcache_reset(size_t max_size);
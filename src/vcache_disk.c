@@ -0,0 +1,408 @@
+/* vifm
+ * Copyright (C) 2026 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "vcache_disk.h"
+
+#include <sys/stat.h> /* S_IRUSR S_IRWXU S_IWUSR stat */
+#include <dirent.h> /* DIR dirent */
+#include <utime.h> /* utime() */
+
+#include <stdint.h> /* uint64_t */
+#include <stdio.h> /* FILE fclose() fprintf() remove() snprintf() sscanf() */
+#include <stdlib.h> /* free() qsort() */
+#include <string.h> /* memmove() strchr() strcmp() strdup() */
+#include <time.h> /* time() time_t */
+
+#include "cfg/config.h"
+#include "compat/fs_limits.h"
+#include "compat/os.h"
+#include "compat/reallocarray.h"
+#include "utils/fs.h"
+#include "utils/path.h"
+#include "utils/str.h"
+#include "utils/string_array.h"
+
+/* First line of every entry, should be changed along with the format. */
+#define FORMAT_ID "vifm-preview-cache 1"
+
+/* Number of lines of an entry that precede output of a viewer: format id,
+ * path, viewer, state of the file and "<number of lines> <completeness>". */
+enum { HEADER_LINES = 5 };
+
+/* Age in seconds after which a temporary file is considered to be left behind
+ * by an instance that died while writing it. */
+enum { STALE_TMP_FILE_AGE = 60*60 };
+
+/* Information about a file of the cache, which is needed for eviction. */
+typedef struct
+{
+	char *name;    /* Name of the file. */
+	time_t mtime;  /* Time of the last use. */
+	uint64_t size; /* Size of the file. */
+}
+file_info_t;
+
+static int is_enabled(void);
+static void get_entry_path(const char path[], const char viewer[], char buf[],
+		size_t buf_len);
+static uint64_t hash_key(const char path[], const char viewer[]);
+static int get_file_stamp(const char path[], char buf[], size_t buf_len);
+static int write_entry(const char entry_path[], const char path[],
+		const char viewer[], const char stamp[], const struct strlist_t *lines,
+		int complete);
+static void evict_entries(void);
+static int scan_cache_dir(file_info_t **infos, uint64_t *total);
+static int is_tmp_file_in_use(const char name[], time_t mtime, time_t now);
+static int by_mtime(const void *a, const void *b);
+TSTATIC void vcache_disk_reset(void);
+
+/* Limit on size of the cache in bytes. */
+static size_t max_cache_size;
+/* Size of files in cache directory as of last scan plus what was written after
+ * it. */
+static uint64_t cache_size;
+/* Whether value of cache_size is known. */
+static int cache_size_known;
+
+void
+vcache_disk_set_max_size(size_t max_size)
+{
+	max_cache_size = max_size;
+	if(max_cache_size != 0U && cache_size_known && cache_size > max_cache_size)
+	{
+		evict_entries();
+	}
+}
+
+size_t
+vcache_disk_get_max_size(void)
+{
+	return max_cache_size;
+}
+
+int
+vcache_disk_load(const char path[], const char viewer[], int max_lines,
+		strlist_t *lines, int *complete)
+{
+	if(!is_enabled())
+	{
+		return 1;
+	}
+
+	char stamp[128];
+	if(get_file_stamp(path, stamp, sizeof(stamp)) != 0)
+	{
+		return 1;
+	}
+
+	char entry_path[PATH_MAX + 1];
+	get_entry_path(path, viewer, entry_path, sizeof(entry_path));
+
+	int nlines;
+	char **file_lines = read_file_of_lines(entry_path, &nlines);
+	if(file_lines == NULL)
+	{
+		return 1;
+	}
+
+	int count, is_complete;
+	if(nlines < HEADER_LINES || strcmp(file_lines[0], FORMAT_ID) != 0 ||
+			strcmp(file_lines[1], path) != 0 || strcmp(file_lines[2], viewer) != 0 ||
+			strcmp(file_lines[3], stamp) != 0 ||
+			sscanf(file_lines[4], "%d %d", &count, &is_complete) != 2 ||
+			count != nlines - HEADER_LINES || (!is_complete && count < max_lines))
+	{
+		free_string_array(file_lines, nlines);
+		return 1;
+	}
+
+	free_strings(file_lines, HEADER_LINES);
+	memmove(file_lines, file_lines + HEADER_LINES, sizeof(*file_lines)*count);
+
+	lines->items = file_lines;
+	lines->nitems = count;
+	*complete = is_complete;
+
+	/* Modification time of an entry is the time of its last use. */
+	(void)utime(entry_path, NULL);
+	return 0;
+}
+
+void
+vcache_disk_store(const char path[], const char viewer[],
+		const strlist_t *lines, int complete)
+{
+	if(!is_enabled())
+	{
+		return;
+	}
+
+	char stamp[128];
+	if(get_file_stamp(path, stamp, sizeof(stamp)) != 0)
+	{
+		return;
+	}
+
+	if(make_path(cfg.preview_cache_dir, S_IRWXU) != 0)
+	{
+		return;
+	}
+
+	if(!cache_size_known)
+	{
+		/* Computes size of the cache as a side-effect. */
+		evict_entries();
+	}
+
+	char entry_path[PATH_MAX + 1];
+	get_entry_path(path, viewer, entry_path, sizeof(entry_path));
+
+	const uint64_t old_size = get_file_size(entry_path);
+	if(write_entry(entry_path, path, viewer, stamp, lines, complete) != 0)
+	{
+		return;
+	}
+
+	cache_size += get_file_size(entry_path);
+	cache_size = (cache_size > old_size ? cache_size - old_size : 0U);
+
+	if(cache_size > max_cache_size)
+	{
+		evict_entries();
+	}
+}
+
+/* Checks whether the cache is turned on.  Returns non-zero if so, otherwise
+ * zero is returned. */
+static int
+is_enabled(void)
+{
+	return (max_cache_size != 0U && cfg.preview_cache_dir[0] != '\0');
+}
+
+/* Forms path to an entry of the cache for the key. */
+static void
+get_entry_path(const char path[], const char viewer[], char buf[],
+		size_t buf_len)
+{
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx",
+			(unsigned long long)hash_key(path, viewer));
+	build_path(buf, buf_len, cfg.preview_cache_dir, name);
+}
+
+/* Computes 64-bit FNV-1a hash of path and viewer.  Returns the hash. */
+static uint64_t
+hash_key(const char path[], const char viewer[])
+{
+	uint64_t hash = 14695981039346656037ULL;
+
+	/* Terminating null character of path separates it from viewer. */
+	const char *p = path;
+	do
+	{
+		hash = (hash ^ (unsigned char)*p)*1099511628211ULL;
+	}
+	while(*p++ != '\0');
+
+	for(p = viewer; *p != '\0'; ++p)
+	{
+		hash = (hash ^ (unsigned char)*p)*1099511628211ULL;
+	}
+
+	return hash;
+}
+
+/* Formats state of a file which is used to detect its changes.  Returns zero
+ * on success, otherwise non-zero is returned. */
+static int
+get_file_stamp(const char path[], char buf[], size_t buf_len)
+{
+	struct stat st;
+	if(os_stat(path, &st) != 0)
+	{
+		return 1;
+	}
+
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+	const long nsec = st.st_mtim.tv_nsec;
+#else
+	const long nsec = 0;
+#endif
+
+	snprintf(buf, buf_len, "%llu %lld.%09ld %llu %llu",
+			(unsigned long long)st.st_size, (long long)st.st_mtime, nsec,
+			(unsigned long long)st.st_dev, (unsigned long long)st.st_ino);
+	return 0;
+}
+
+/* Writes an entry through a uniquely named temporary file, so that other
+ * instances never see it incomplete or write to the same file.  Returns zero on
+ * success, otherwise non-zero is returned. */
+static int
+write_entry(const char entry_path[], const char path[], const char viewer[],
+		const char stamp[], const strlist_t *lines, int complete)
+{
+	char tmp_path[PATH_MAX + 16];
+	snprintf(tmp_path, sizeof(tmp_path), "%s.XXXXXX", entry_path);
+
+	FILE *fp = make_tmp_file(tmp_path, S_IRUSR | S_IWUSR, /*auto_delete=*/0);
+	if(fp == NULL)
+	{
+		return 1;
+	}
+
+	fprintf(fp, "%s\n%s\n%s\n%s\n%d %d\n", FORMAT_ID, path, viewer, stamp,
+			lines->nitems, complete ? 1 : 0);
+	write_lines_to_file(fp, lines->items, lines->nitems);
+
+	if(fclose(fp) != 0 || os_rename(tmp_path, entry_path) != 0)
+	{
+		(void)remove(tmp_path);
+		return 1;
+	}
+
+	return 0;
+}
+
+/* Removes least recently used entries until the cache fits into its limit. */
+static void
+evict_entries(void)
+{
+	file_info_t *infos;
+	uint64_t total;
+	const int count = scan_cache_dir(&infos, &total);
+	if(count < 0)
+	{
+		return;
+	}
+
+	qsort(infos, count, sizeof(*infos), &by_mtime);
+
+	int i;
+	for(i = 0; i < count; ++i)
+	{
+		if(total > max_cache_size)
+		{
+			char full_path[PATH_MAX + 1];
+			build_path(full_path, sizeof(full_path), cfg.preview_cache_dir,
+					infos[i].name);
+			if(remove(full_path) == 0)
+			{
+				total -= infos[i].size;
+			}
+		}
+		free(infos[i].name);
+	}
+	free(infos);
+
+	cache_size = total;
+	cache_size_known = 1;
+}
+
+/* Lists files of the cache directory except for temporary files which might
+ * still be written by other instances.  *infos should be freed by the caller
+ * along with names.  Returns number of files or -1 on error. */
+static int
+scan_cache_dir(file_info_t **infos, uint64_t *total)
+{
+	DIR *dir = os_opendir(cfg.preview_cache_dir);
+	if(dir == NULL)
+	{
+		return -1;
+	}
+
+	*infos = NULL;
+	*total = 0U;
+
+	const time_t now = time(NULL);
+	int count = 0;
+	struct dirent *d;
+	while((d = os_readdir(dir)) != NULL)
+	{
+		if(is_builtin_dir(d->d_name))
+		{
+			continue;
+		}
+
+		char full_path[PATH_MAX + 1];
+		build_path(full_path, sizeof(full_path), cfg.preview_cache_dir,
+				d->d_name);
+
+		struct stat st;
+		if(os_stat(full_path, &st) != 0 ||
+				is_tmp_file_in_use(d->d_name, st.st_mtime, now))
+		{
+			continue;
+		}
+
+		file_info_t *new_infos = reallocarray(*infos, count + 1, sizeof(**infos));
+		if(new_infos == NULL)
+		{
+			continue;
+		}
+		*infos = new_infos;
+
+		char *name = strdup(d->d_name);
+		if(name == NULL)
+		{
+			continue;
+		}
+
+		(*infos)[count].name = name;
+		(*infos)[count].mtime = st.st_mtime;
+		(*infos)[count].size = st.st_size;
+		*total += st.st_size;
+		++count;
+	}
+	os_closedir(dir);
+
+	return count;
+}
+
+/* Checks whether a file of the cache directory is a temporary file of
+ * write_entry() which is recent enough to be still in use.  This instance
+ * removes its temporary files before returning from write_entry(), so they
+ * can only belong to other instances.  Returns non-zero if so, otherwise zero
+ * is returned. */
+static int
+is_tmp_file_in_use(const char name[], time_t mtime, time_t now)
+{
+	return strchr(name, '.') != NULL && now - mtime < STALE_TMP_FILE_AGE;
+}
+
+/* qsort() comparer that orders files from least to most recently used.
+ * Returns standard -1, 0, 1 for comparisons. */
+static int
+by_mtime(const void *a, const void *b)
+{
+	const file_info_t *const x = a;
+	const file_info_t *const y = b;
+	return (x->mtime > y->mtime) - (x->mtime < y->mtime);
+}
+
+TSTATIC void
+vcache_disk_reset(void)
+{
+	max_cache_size = 0U;
+	cache_size = 0U;
+	cache_size_known = 0;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -0,0 +1,59 @@
+/* vifm
+ * Copyright (C) 2026 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef VIFM__VCACHE_DISK_H__
+#define VIFM__VCACHE_DISK_H__
+
+/* This unit keeps output of external viewers on disk, so that it survives
+ * restarts.  Each entry is a file in cfg.preview_cache_dir named after a hash
+ * of path and viewer, which stores its key along with state of the previewed
+ * file and is considered stale once that file changes.  Least recently used
+ * entries are removed when total size of the directory exceeds the limit. */
+
+#include <stddef.h> /* size_t */
+
+#include "utils/test_helpers.h"
+
+struct strlist_t;
+
+/* Changes limit on size of the cache in bytes.  Zero disables the cache. */
+void vcache_disk_set_max_size(size_t max_size);
+
+/* Retrieves limit on size of the cache in bytes.  Returns the limit. */
+size_t vcache_disk_get_max_size(void);
+
+/* Looks up stored output of a viewer for a file, which must be either complete
+ * or have at least max_lines lines.  On success *lines is set to newly
+ * allocated list and *complete is set to completeness of the output.  Returns
+ * zero on success, otherwise non-zero is returned. */
+int vcache_disk_load(const char path[], const char viewer[], int max_lines,
+		struct strlist_t *lines, int *complete);
+
+/* Stores output of a viewer for the current state of a file evicting older
+ * entries if the limit is exceeded. */
+void vcache_disk_store(const char path[], const char viewer[],
+		const struct strlist_t *lines, int complete);
+
+TSTATIC_DEFS(
+	void vcache_disk_reset(void);
+)
+
+#endif /* VIFM__VCACHE_DISK_H__ */
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
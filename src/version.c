@@ -36,7 +36,7 @@ extern const char GIT_INFO[];
 int
 fill_version_info(char **list, int include_stats)
 {
-	const int LEN = 23;
+	const int LEN = 24;
 	int x = 0;
 
 	if(list == NULL)
@@ -109,8 +109,11 @@ fill_version_info(char **list, int include_stats)
 
 	if(include_stats)
 	{
-		char size[64];
-		(void)friendly_size_notation(vcache_size(), sizeof(size), size);
+		const vcache_stats_t vc_stats = vcache_get_stats();
+		char size[64], max_size[64];
+		(void)friendly_size_notation(vc_stats.size, sizeof(size), size);
+		(void)friendly_size_notation(vc_stats.max_size, sizeof(max_size),
+				max_size);
 
 		list[x++] = strdup("");
 #ifndef _WIN32
@@ -130,7 +133,11 @@ fill_version_info(char **list, int include_stats)
 				curr_stats.direct_color ? "yes" : "no");
 
 		list[x++] = strdup("");
-		list[x++] = format_str("Preview cache size: %s", size);
+		list[x++] = format_str("Preview cache size: %s of %s (%d entries)", size,
+				max_size, (int)vc_stats.entries);
+		list[x++] = format_str("Preview cache hits/disk hits/misses/evictions: "
+				"%llu/%llu/%llu/%llu", vc_stats.hits, vc_stats.disk_hits,
+				vc_stats.misses, vc_stats.evictions);
 		list[x++] = format_str("Color pairs in use: %d", colmgr_used_pairs());
 	}
 
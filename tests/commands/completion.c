@@ -1,5 +1,6 @@
 #include <stic.h>
 
+#include <sys/time.h> /* timeval utimes() */
 #include <unistd.h> /* chdir() rmdir() */
 
 #include <stddef.h> /* NULL */
@@ -27,6 +28,7 @@
 #include "../../src/utils/str.h"
 #include "../../src/bmarks.h"
 #include "../../src/builtin_functions.h"
+#include "../../src/cmd_completion.h"
 #include "../../src/cmd_core.h"
 #include "../../src/plugins.h"
 #include "../lua/asserts.h"
@@ -116,6 +118,8 @@ SETUP()
 
 TEARDOWN()
 {
+	complete_reset_cache();
+
 	cs_reset(&cfg.cs);
 	curr_stats.cs = NULL;
 
@@ -679,6 +683,105 @@ TEST(messages_is_completed)
 	ASSERT_COMPLETION(L"messages c c", L"messages c c");
 }
 
+#ifndef _WIN32
+
+TEST(changes_of_cached_directory_are_noticed)
+{
+	make_abs_path(curr_view->curr_dir, sizeof(curr_view->curr_dir), SANDBOX_PATH,
+			"", saved_cwd);
+	assert_success(chdir(curr_view->curr_dir));
+
+	create_dir("dir");
+	create_file("dir/abc");
+
+	/* Listing of recently changed directory isn't cached, so make it old. */
+	struct timeval tvs[2] = {};
+	assert_success(utimes("dir", tvs));
+	ASSERT_COMPLETION(L"edit dir/a", L"edit dir/abc");
+
+	remove_file("dir/abc");
+	create_file("dir/abd");
+	ASSERT_COMPLETION(L"edit dir/a", L"edit dir/abd");
+
+	remove_file("dir/abd");
+	remove_dir("dir");
+}
+
+TEST(cache_of_listings_can_be_reset)
+{
+	make_abs_path(curr_view->curr_dir, sizeof(curr_view->curr_dir), SANDBOX_PATH,
+			"", saved_cwd);
+	assert_success(chdir(curr_view->curr_dir));
+
+	create_dir("dir");
+	create_file("dir/abc");
+
+	struct timeval tvs[2] = {};
+	assert_success(utimes("dir", tvs));
+	ASSERT_COMPLETION(L"edit dir/a", L"edit dir/abc");
+
+	/* Restoring modification time hides the change from the cache. */
+	remove_file("dir/abc");
+	create_file("dir/abd");
+	assert_success(utimes("dir", tvs));
+
+	complete_reset_cache();
+	ASSERT_COMPLETION(L"edit dir/a", L"edit dir/abd");
+
+	remove_file("dir/abd");
+	remove_dir("dir");
+}
+
+TEST(cached_listing_is_matched_according_to_case_settings)
+{
+	make_abs_path(curr_view->curr_dir, sizeof(curr_view->curr_dir), SANDBOX_PATH,
+			"", saved_cwd);
+	assert_success(chdir(curr_view->curr_dir));
+
+	create_dir("dir");
+	create_file("dir/a");
+	create_file("dir/Ab");
+	create_file("dir/ab");
+	create_file("dir/abc");
+	create_dir("dir/abd");
+	create_file("dir/b");
+
+	struct timeval tvs[2] = {};
+	assert_success(utimes("dir", tvs));
+
+	int i;
+	for(i = 0; i < 2; ++i)
+	{
+		ASSERT_COMPLETION(L"edit dir/ab", L"edit dir/ab");
+		ASSERT_NEXT_MATCH("abc");
+		ASSERT_NEXT_MATCH("abd/");
+		ASSERT_NEXT_MATCH("ab");
+		ASSERT_NEXT_MATCH("ab");
+	}
+
+	cfg.case_override = CO_PATH_COMPL;
+	cfg.case_ignore = CO_PATH_COMPL;
+
+	ASSERT_COMPLETION(L"edit dir/ab", L"edit dir/Ab");
+	ASSERT_NEXT_MATCH("ab");
+	ASSERT_NEXT_MATCH("abc");
+	ASSERT_NEXT_MATCH("abd/");
+	ASSERT_NEXT_MATCH("ab");
+
+	cfg.case_override = 0;
+	cfg.case_ignore = 0;
+
+	remove_file("dir/a");
+	remove_file("dir/Ab");
+	remove_file("dir/ab");
+	remove_file("dir/abc");
+	remove_dir("dir/abd");
+	remove_file("dir/b");
+	remove_dir("dir");
+}
+
+#endif
+
 static void
 prepare_for_line_completion(const wchar_t str[])
 {
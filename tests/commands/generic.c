@@ -21,6 +21,7 @@
 #include "../../src/utils/fs.h"
 #include "../../src/utils/path.h"
 #include "../../src/utils/str.h"
+#include "../../src/cmd_completion.h"
 #include "../../src/cmd_core.h"
 #include "../../src/filelist.h"
 #include "../../src/ops.h"
@@ -229,6 +230,38 @@ TEST(bar_is_not_attributed_to_echo)
 	assert_true(called);
 }
 
+TEST(command_line_can_be_dispatched_repeatedly)
+{
+	int i;
+	for(i = 0; i < 3; ++i)
+	{
+		assert_success(cmds_dispatch("onearg a | onearg b", &lwin, CIT_COMMAND));
+		assert_string_equal("b", arg);
+		assert_success(cmds_dispatch("onearg c", &lwin, CIT_COMMAND));
+		assert_string_equal("c", arg);
+	}
+}
+
+TEST(changes_of_commands_affect_breaking_of_repeated_command_line)
+{
+	/* Commands with such an id take the rest of the line. */
+	static const cmd_add_t tail_cmd = {
+	  .name = "tailcmd", .abbr = NULL, .id = COM_WINDO, .descr = "descr",
+	  .flags = 0,
+	  .handler = &builtin_cmd, .min_args = 0, .max_args = NOT_DEF,
+	};
+
+	const char *const cmdline = "tailcmd | onearg b";
+
+	/* Unknown command is separated from the next one. */
+	(void)cmds_dispatch(cmdline, &lwin, CIT_COMMAND);
+	assert_string_equal("b", arg);
+
+	vle_cmds_add(&tail_cmd, 1);
+	assert_success(cmds_dispatch(cmdline, &lwin, CIT_COMMAND));
+	assert_string_equal("|", arg);
+}
+
 TEST(mixed_or_operator_and_bar)
 {
 	(void)cmds_dispatch("echo 1 || 0 | builtin", &lwin, CIT_COMMAND);
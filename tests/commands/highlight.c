@@ -506,6 +506,30 @@ TEST(records_can_be_removed)
 	assert_int_equal(0, cfg.cs.file_hi_count);
 }
 
+TEST(first_matching_record_wins_after_removal)
+{
+	assert_success(cmds_dispatch("highlight /^a/ ctermfg=red", &lwin,
+				CIT_COMMAND));
+	assert_success(cmds_dispatch("highlight {*.jpg} ctermfg=blue", &lwin,
+				CIT_COMMAND));
+	assert_success(cmds_dispatch("highlight {A*} ctermfg=green", &lwin,
+				CIT_COMMAND));
+
+	int hint = -1;
+	assert_int_equal(COLOR_RED, cs_get_file_hi(&cfg.cs, "a.jpg", &hint)->fg);
+	hint = -1;
+	assert_int_equal(COLOR_BLUE, cs_get_file_hi(&cfg.cs, "b.JPG", &hint)->fg);
+
+	assert_success(cmds_dispatch("highlight clear /^a/", &lwin, CIT_COMMAND));
+
+	hint = -1;
+	assert_int_equal(COLOR_BLUE, cs_get_file_hi(&cfg.cs, "a.jpg", &hint)->fg);
+	hint = -1;
+	assert_int_equal(COLOR_GREEN, cs_get_file_hi(&cfg.cs, "a.png", &hint)->fg);
+	hint = -1;
+	assert_null(cs_get_file_hi(&cfg.cs, "b.png", &hint));
+}
+
 TEST(incorrect_highlight_groups_are_not_added)
 {
 	const char *const COMMANDS = "highlight {*.jpg} ctersmfg=red";
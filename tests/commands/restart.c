@@ -78,8 +78,8 @@ TEST(history_works_after_restart)
 
 	assert_int_equal(10, curr_stats.cmd_hist.capacity);
 	assert_int_equal(2, curr_stats.cmd_hist.size);
-	assert_string_equal("cmd-2", curr_stats.cmd_hist.items[0].text);
-	assert_string_equal("cmd-1", curr_stats.cmd_hist.items[1].text);
+	assert_string_equal("cmd-2", hist_get(&curr_stats.cmd_hist, 0)->text);
+	assert_string_equal("cmd-1", hist_get(&curr_stats.cmd_hist, 1)->text);
 
 	assert_success(cmds_dispatch("restart", &lwin, CIT_COMMAND));
 	assert_int_equal(10, cfg.history_len);
@@ -88,7 +88,7 @@ TEST(history_works_after_restart)
 
 	assert_int_equal(10, curr_stats.cmd_hist.capacity);
 	assert_int_equal(1, curr_stats.cmd_hist.size);
-	assert_string_equal("cmd-3", curr_stats.cmd_hist.items[0].text);
+	assert_string_equal("cmd-3", hist_get(&curr_stats.cmd_hist, 0)->text);
 }
 
 TEST(restart_checks_its_parameter)
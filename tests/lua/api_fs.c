@@ -1,8 +1,12 @@
 #include <stic.h>
 
 #include "../../src/compat/fs_limits.h"
+#include "../../src/engine/var.h"
+#include "../../src/engine/variables.h"
 #include "../../src/lua/vlua.h"
 #include "../../src/utils/fs.h"
+#include "../../src/background.h"
+#include "../../src/fops_common.h"
 #include "../../src/status.h"
 
 #include <test-utils.h>
@@ -11,6 +15,7 @@
 
 static void cpmv_prepare(int is_mv);
 static void file_is_line(const char path[], const char line[]);
+static void wait_for_op(void);
 
 static vlua_t *vlua;
 static void (*rm_src_file)(const char path[]);
@@ -18,6 +23,7 @@ static void (*rm_src_dir)(const char path[]);
 
 SETUP()
 {
+	conf_setup();
 	vlua = vlua_init();
 	curr_stats.vlua = vlua;
 }
@@ -26,6 +32,8 @@ TEARDOWN()
 {
 	vlua_finish(vlua);
 	curr_stats.vlua = NULL;
+	wait_for_all_bg();
+	conf_teardown();
 
 	rm_src_file = NULL;
 	rm_src_dir = NULL;
@@ -269,6 +277,132 @@ TEST(fs_rmdir_file)
 	remove_file("file");
 }
 
+TEST(fs_startop_bad_args)
+{
+	BLUA_ENDS(vlua, ": `op` key is mandatory",
+			"vifm.fs.startop { from = 'file' }");
+	BLUA_ENDS(vlua, ": `from` key is mandatory",
+			"vifm.fs.startop { op = 'cp' }");
+	BLUA_ENDS(vlua, ": Unknown `op` value: ln",
+			"vifm.fs.startop { op = 'ln', from = 'file', to = 'target' }");
+	BLUA_ENDS(vlua, ": `to` key is mandatory for this operation",
+			"vifm.fs.startop { op = 'mv', from = 'file' }");
+	BLUA_ENDS(vlua, ": Unknown `onconflict` value: ask",
+			"vifm.fs.startop { op = 'cp', from = 'file', to = 'target',"
+			"                  onconflict = 'ask' }");
+	assert_null(bg_jobs);
+}
+
+TEST(fs_startop_cpmv, REPEAT(2))
+{
+	const char *op = (STIC_TEST_PARAM == 1 ? "'mv'" : "'cp'");
+	make_file("file", "abc");
+
+	char cmd[256];
+	snprintf(cmd, sizeof(cmd),
+			"op = vifm.fs.startop { op = %s, from = 'file', to = 'target',"
+			"                       onexit = function(op)"
+			"                         print(op:succeeded(), op:errors())"
+			"                       end }",
+			op);
+	GLUA_EQ(vlua, "", cmd);
+	wait_for_op();
+
+	assert_string_equal("true\t", ui_sb_last());
+	GLUA_EQ(vlua, "false", "print(op:isrunning())");
+	GLUA_EQ(vlua, "100", "print(op:progress())");
+	file_is_line("target", "abc");
+
+	if(STIC_TEST_PARAM == 0)
+	{
+		remove_file("file");
+	}
+	remove_file("target");
+}
+
+TEST(fs_startop_rm)
+{
+	create_dir("dir");
+	create_file("dir/file");
+
+	GLUA_EQ(vlua, "", "op = vifm.fs.startop { op = 'rm', from = 'dir' }");
+	wait_for_op();
+
+	GLUA_EQ(vlua, "true", "print(op:succeeded())");
+	assert_false(is_dir("dir"));
+}
+
+TEST(fs_startop_failure)
+{
+	create_file("file");
+	create_file("target");
+
+	GLUA_EQ(vlua, "",
+			"op = vifm.fs.startop { op = 'cp', from = 'file', to = 'target' }");
+	wait_for_op();
+
+	GLUA_EQ(vlua, "false", "print(op:succeeded())");
+
+	remove_file("file");
+	remove_file("target");
+}
+
+TEST(fs_startop_progress_is_reported)
+{
+	fops_init(NULL, NULL);
+	make_file("file", "abc");
+
+	GLUA_EQ(vlua, "",
+			"progress = {}"
+			"op = vifm.fs.startop { op = 'cp', from = 'file', to = 'target',"
+			"                       onprogress = function(op)"
+			"                         progress[#progress + 1] = op:progress()"
+			"                       end }");
+
+	wait_for_op();
+	GLUA_EQ(vlua, "100", "print(progress[#progress])");
+
+	remove_file("file");
+	remove_file("target");
+}
+
+TEST(fs_startop_cancel)
+{
+	create_file("file");
+
+	GLUA_EQ(vlua, "",
+			"op = vifm.fs.startop { op = 'cp', from = 'file', to = 'target' }");
+	GLUA_EQ(vlua, "true", "print(op:cancel())");
+	GLUA_EQ(vlua, "false", "print(op:cancel())");
+	wait_for_op();
+	GLUA_EQ(vlua, "false", "print(op:isrunning())");
+
+	remove_file("file");
+	(void)remove("target");
+}
+
+TEST(fs_startop_outlives_lua_state)
+{
+	make_file("file", "abc");
+
+	GLUA_EQ(vlua, "",
+			"vifm.fs.startop { op = 'cp', from = 'file', to = 'target',"
+			"                  onexit = function() print('called') end }");
+	bg_job_t *job = bg_jobs;
+
+	vlua_finish(vlua);
+	vlua = vlua_init();
+	curr_stats.vlua = vlua;
+
+	assert_int_equal(0, wait_for_job(job));
+	vlua_process_callbacks(vlua);
+	assert_string_equal("", ui_sb_last());
+	file_is_line("target", "abc");
+
+	remove_file("file");
+	remove_file("target");
+}
+
 static void
 cpmv_prepare(int is_mv)
 {
@@ -284,5 +418,18 @@ file_is_line(const char path[], const char line[])
 	file_is(path, lines, 1);
 }
 
+/* Waits for the most recently started background operation to finish and
+ * processes Lua callbacks. */
+static void
+wait_for_op(void)
+{
+	var_t var = var_from_int(0);
+	setvar("v:jobcount", var);
+	var_free(var);
+
+	assert_int_equal(0, wait_for_job(bg_jobs));
+	vlua_process_callbacks(vlua);
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 : */
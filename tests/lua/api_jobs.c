@@ -3,6 +3,7 @@
 #include <stdlib.h> /* free() getenv() */
 #include <string.h> /* strdup() */
 #include <time.h> /* time() */
+#include <unistd.h> /* usleep() */
 
 #include "../../src/compat/os.h"
 #include "../../src/engine/var.h"
@@ -279,6 +280,85 @@ TEST(vifmjob_onexit_bad)
 			ui_sb_last());
 }
 
+TEST(vifmjob_onoutput_bad_args)
+{
+	BLUA_ENDS(vlua, "`onoutput` requires \"r\" I/O mode",
+			"job = vifm.startjob { cmd = 'echo', iomode = 'w',"
+			"                      onoutput = function() end }");
+	BLUA_ENDS(vlua, "`outputlimit` must be positive",
+			"job = vifm.startjob { cmd = 'echo', outputlimit = 0,"
+			"                      onoutput = function() end }");
+}
+
+TEST(vifmjob_onoutput_receives_lines, IF(not_windows))
+{
+	var_t var = var_from_int(0);
+	setvar("v:jobcount", var);
+	var_free(var);
+
+	GLUA_EQ(vlua, "",
+			"lines = {}"
+			"info = { cmd = 'echo a; echo b; printf c',"
+			"         outputlimit = 1,"
+			"         onoutput = function(job, new)"
+			"           for _, line in ipairs(new) do"
+			"             lines[#lines + 1] = line "
+			"           end "
+			"         end,"
+			"         onexit = function(job) print(table.concat(lines, ',')) end }"
+			"job = vifm.startjob(info)");
+
+	int counter = 0;
+	while(bg_job_is_running(bg_jobs) && ++counter < 100)
+	{
+		vlua_process_callbacks(vlua);
+		usleep(5000);
+	}
+
+	assert_int_equal(0, wait_for_job(bg_jobs));
+	vlua_process_callbacks(vlua);
+
+	assert_string_equal("a,b,c", ui_sb_last());
+	BLUA_ENDS(vlua, "Output is consumed by `onoutput` handler",
+			"print(job:stdout())");
+}
+
+TEST(vifmjob_onoutput_receives_long_lines_in_pieces, IF(not_windows))
+{
+	var_t var = var_from_int(0);
+	setvar("v:jobcount", var);
+	var_free(var);
+
+	GLUA_EQ(vlua, "",
+			"lines = {}"
+			"info = { cmd = 'printf abcde',"
+			"         outputlimit = 2,"
+			"         onoutput = function(job, new)"
+			"           for _, line in ipairs(new) do"
+			"             lines[#lines + 1] = line "
+			"           end "
+			"         end,"
+			"         onexit = function(job) print(table.concat(lines, ',')) end }"
+			"job = vifm.startjob(info)");
+
+	assert_int_equal(0, wait_for_job(bg_jobs));
+	vlua_process_callbacks(vlua);
+
+	assert_string_equal("ab,cd,e", ui_sb_last());
+}
+
+TEST(vifmjob_wait_flushes_output, IF(not_windows))
+{
+	GLUA_EQ(vlua, "",
+			"count = 0 "
+			"info = { cmd = 'seq 1 100000',"
+			"         onoutput = function(job, new) count = count + #new end }"
+			"job = vifm.startjob(info)"
+			"job:wait()");
+	vlua_process_callbacks(vlua);
+	GLUA_EQ(vlua, "100000", "print(count)");
+}
+
 TEST(vifmjob_pid_works)
 {
 	GLUA_EQ(vlua, "", "job = vifm.startjob { cmd = 'echo' }");
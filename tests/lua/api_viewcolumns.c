@@ -1,11 +1,13 @@
 #include <stic.h>
 
-#include <string.h> /* memcpy() */
+#include <stdio.h> /* snprintf() */
+#include <string.h> /* memcpy() strdup() */
 
 #include "../../src/lua/vlua.h"
 #include "../../src/ui/column_view.h"
 #include "../../src/ui/fileview.h"
 #include "../../src/ui/ui.h"
+#include "../../src/utils/dynarray.h"
 #include "../../src/opt_handlers.h"
 
 #include <test-utils.h>
@@ -14,6 +16,8 @@
 
 static void column_line_print(const char buf[], int offset, AlignType align,
 		const char full_column[], const format_info_t *info);
+static void fill_view(int n);
+static void format_entry(int pos);
 
 enum { MAX_WIDTH = 40 };
 
@@ -175,6 +179,157 @@ TEST(symlinks, IF(not_windows))
 	remove_file(SANDBOX_PATH "/symlink");
 }
 
+TEST(bad_options)
+{
+	GLUA_EQ(vlua, "", "function handler() end");
+
+	BLUA_ENDS(vlua, ": `cacheable` value must be a boolean",
+			"print(vifm.addcolumntype{ name = 'Test', handler = handler,"
+			"                          cacheable = 1 })");
+	BLUA_ENDS(vlua, ": `batch` value must be a boolean",
+			"print(vifm.addcolumntype{ name = 'Test', handler = handler,"
+			"                          batch = 'yes' })");
+}
+
+TEST(cacheable_values_are_reused)
+{
+	opt_handlers_setup();
+	lwin.columns = columns_create();
+	curr_stats.vlua = vlua;
+
+	GLUA_EQ(vlua, "",
+			"calls = 0 "
+			"function handler(info)"
+			"  calls = calls + 1"
+			"  return { text = info.entry.name .. calls }"
+			"end");
+	GLUA_EQ(vlua, "true",
+			"print(vifm.addcolumntype { name = 'Test', handler = handler,"
+			"                           cacheable = true })");
+	process_set_args("viewcolumns=-10{Test}", 0, 1);
+	columns_set_line_print_func(&column_line_print);
+
+	fill_view(2);
+
+	format_entry(0);
+	assert_string_equal("file01    ", print_buffer);
+	format_entry(1);
+	assert_string_equal("file12    ", print_buffer);
+	format_entry(0);
+	assert_string_equal("file01    ", print_buffer);
+	GLUA_EQ(vlua, "2", "print(calls)");
+
+	/* Changed entry gets a new value. */
+	lwin.dir_entry[0].mtime = 10;
+	format_entry(0);
+	assert_string_equal("file03    ", print_buffer);
+	GLUA_EQ(vlua, "3", "print(calls)");
+
+	/* Reloading drops all values. */
+	vlua_viewcolumns_invalidate(vlua);
+	format_entry(1);
+	assert_string_equal("file14    ", print_buffer);
+	GLUA_EQ(vlua, "4", "print(calls)");
+
+	opt_handlers_teardown();
+	curr_stats.vlua = NULL;
+}
+
+TEST(batch_handler_gets_visible_entries)
+{
+	opt_handlers_setup();
+	lwin.columns = columns_create();
+	curr_stats.vlua = vlua;
+
+	GLUA_EQ(vlua, "",
+			"calls = 0 "
+			"sizes = '' "
+			"function handler(info)"
+			"  calls = calls + 1"
+			"  sizes = sizes .. #info.entries"
+			"  local result = {}"
+			"  for i, entry in ipairs(info.entries) do"
+			"    result[i] = { text = entry.name .. calls,"
+			"                  matchstart = 1, matchend = 2 }"
+			"  end"
+			"  return result "
+			"end");
+	GLUA_EQ(vlua, "true",
+			"print(vifm.addcolumntype { name = 'Test', handler = handler,"
+			"                           batch = true })");
+	process_set_args("viewcolumns=-10{Test}", 0, 1);
+	columns_set_line_print_func(&column_line_print);
+
+	fill_view(5);
+	lwin.window_cells = 3;
+
+	format_entry(0);
+	assert_string_equal("file01    ", print_buffer);
+	format_entry(1);
+	assert_string_equal("file11    ", print_buffer);
+	format_entry(2);
+	assert_string_equal("file21    ", print_buffer);
+	GLUA_EQ(vlua, "3", "print(sizes)");
+
+	/* Values are used only once. */
+	format_entry(1);
+	assert_string_equal("file12    ", print_buffer);
+	GLUA_EQ(vlua, "31", "print(sizes)");
+
+	/* Drawing from the top starts a new batch. */
+	lwin.top_line = 2;
+	format_entry(2);
+	assert_string_equal("file23    ", print_buffer);
+	format_entry(4);
+	assert_string_equal("file43    ", print_buffer);
+	GLUA_EQ(vlua, "313", "print(sizes)");
+
+	opt_handlers_teardown();
+	curr_stats.vlua = NULL;
+}
+
+TEST(cacheable_batches_skip_known_entries)
+{
+	opt_handlers_setup();
+	lwin.columns = columns_create();
+	curr_stats.vlua = vlua;
+
+	GLUA_EQ(vlua, "",
+			"sizes = '' "
+			"function handler(info)"
+			"  sizes = sizes .. #info.entries"
+			"  local result = {}"
+			"  for i, entry in ipairs(info.entries) do"
+			"    result[i] = { text = entry.name }"
+			"  end"
+			"  return result "
+			"end");
+	GLUA_EQ(vlua, "true",
+			"print(vifm.addcolumntype { name = 'Test', handler = handler,"
+			"                           batch = true, cacheable = true })");
+	process_set_args("viewcolumns=-10{Test}", 0, 1);
+	columns_set_line_print_func(&column_line_print);
+
+	fill_view(4);
+	lwin.window_cells = 2;
+
+	format_entry(0);
+	format_entry(1);
+	format_entry(0);
+	format_entry(1);
+	GLUA_EQ(vlua, "2", "print(sizes)");
+
+	lwin.top_line = 1;
+	format_entry(1);
+	assert_string_equal("file1     ", print_buffer);
+	format_entry(2);
+	assert_string_equal("file2     ", print_buffer);
+	GLUA_EQ(vlua, "21", "print(sizes)");
+
+	opt_handlers_teardown();
+	curr_stats.vlua = NULL;
+}
+
 static void
 column_line_print(const char buf[], int offset, AlignType align,
 		const char full_column[], const format_info_t *info)
@@ -182,5 +337,34 @@ column_line_print(const char buf[], int offset, AlignType align,
 	memcpy(print_buffer + offset, buf, strlen(buf));
 }
 
+/* Fills lwin with n files named after their position. */
+static void
+fill_view(int n)
+{
+	lwin.list_rows = n;
+	lwin.top_line = 0;
+	lwin.dir_entry = dynarray_cextend(NULL, n*sizeof(*lwin.dir_entry));
+
+	int i;
+	for(i = 0; i < n; ++i)
+	{
+		char name[32];
+		snprintf(name, sizeof(name), "file%d", i);
+		lwin.dir_entry[i].name = strdup(name);
+		lwin.dir_entry[i].origin = &lwin.curr_dir[0];
+	}
+}
+
+/* Formats line of lwin that corresponds to the entry at specified position. */
+static void
+format_entry(int pos)
+{
+	column_data_t cdt = {
+		.view = &lwin, .entry = &lwin.dir_entry[pos], .line_pos = pos
+	};
+	memset(print_buffer, '\0', sizeof(print_buffer));
+	columns_format_line(lwin.columns, &cdt, 10);
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 : */
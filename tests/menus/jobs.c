@@ -46,7 +46,7 @@ SETUP()
 
 	curr_stats.load_stage = -1;
 
-	assert_success(bg_execute("job", "", 0, 0, &task, (void *)locks));
+	assert_success(bg_execute("job", "", 0, 0, NULL, &task, (void *)locks));
 	wait_until_locked(&locks[0]);
 
 	assert_success(cmds_dispatch("jobs", &lwin, CIT_COMMAND));
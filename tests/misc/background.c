@@ -23,6 +23,17 @@
 static void on_job_exit(struct bg_job_t *job, void *data);
 static void task(bg_op_t *bg_op, void *arg);
 static void wait_until_locked(pthread_spinlock_t *lock);
+static bg_job_t * start_gated(int important, const char path[]);
+static void gated_task(bg_op_t *bg_op, void *arg);
+static void short_task(bg_op_t *bg_op, void *arg);
+static void wait_for_started(int count);
+static void open_gate(void);
+
+/* State shared with gated_task(). */
+static pthread_mutex_t gate_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t gate_cond = PTHREAD_COND_INITIALIZER;
+static int gate_open;
+static int gate_started;
 
 SETUP_ONCE()
 {
@@ -36,6 +47,8 @@ SETUP()
 	curr_view = &lwin;
 
 	conf_setup();
+
+	gate_open = 0;
 }
 
 TEARDOWN()
@@ -114,7 +127,7 @@ TEST(jobcount_variable_gets_updated)
 	assert_int_equal(0, var_to_int(getvar("v:jobcount")));
 	assert_false(stats_redraw_planned());
 
-	assert_success(bg_execute("", "", 0, 0, &task, (void *)locks));
+	assert_success(bg_execute("", "", 0, 0, NULL, &task, (void *)locks));
 
 	wait_until_locked(&locks[0]);
 	check_bg_jobs();
@@ -296,6 +309,150 @@ TEST(can_run_command_starting_with_a_dash, IF(not_windows))
 	remove_file(SANDBOX_PATH "/-script");
 }
 
+TEST(tasks_leave_a_worker_for_operations)
+{
+	bg_job_t *tasks[4];
+	int i;
+	for(i = 0; i < 4; ++i)
+	{
+		tasks[i] = start_gated(/*important=*/0, /*path=*/NULL);
+	}
+	wait_for_started(3);
+	assert_true(bg_job_is_queued(tasks[3]));
+
+	bg_job_t *op = start_gated(/*important=*/1, /*path=*/NULL);
+	wait_for_started(4);
+	assert_false(bg_job_is_queued(op));
+	assert_true(bg_job_is_queued(tasks[3]));
+
+	open_gate();
+	wait_for_all_bg();
+}
+
+TEST(operations_leave_a_worker_for_tasks)
+{
+	bg_job_t *op1 = start_gated(/*important=*/1, /*path=*/NULL);
+	bg_job_t *op2 = start_gated(/*important=*/1, /*path=*/NULL);
+	bg_job_t *op3 = start_gated(/*important=*/1, /*path=*/NULL);
+	bg_job_t *op4 = start_gated(/*important=*/1, /*path=*/NULL);
+	wait_for_started(3);
+	assert_true(bg_job_is_queued(op4));
+
+	bg_job_t *task = start_gated(/*important=*/0, /*path=*/NULL);
+	wait_for_started(4);
+
+	assert_false(bg_job_is_queued(op1));
+	assert_false(bg_job_is_queued(op2));
+	assert_false(bg_job_is_queued(op3));
+	assert_true(bg_job_is_queued(op4));
+	assert_false(bg_job_is_queued(task));
+
+	open_gate();
+	wait_for_all_bg();
+}
+
+TEST(operations_go_before_tasks)
+{
+	bg_job_t *op1 = start_gated(/*important=*/1, /*path=*/NULL);
+	bg_job_t *op2 = start_gated(/*important=*/1, /*path=*/NULL);
+	bg_job_t *task1 = start_gated(/*important=*/0, /*path=*/NULL);
+	assert_success(bg_execute("short", "", 0, /*important=*/0, /*path=*/NULL,
+				&short_task, NULL));
+	wait_for_started(3);
+
+	/* Both queues have jobs when the short task frees its worker. */
+	bg_job_t *task2 = start_gated(/*important=*/0, /*path=*/NULL);
+	bg_job_t *op3 = start_gated(/*important=*/1, /*path=*/NULL);
+	wait_for_started(4);
+
+	assert_false(bg_job_is_queued(op1));
+	assert_false(bg_job_is_queued(op2));
+	assert_false(bg_job_is_queued(op3));
+	assert_false(bg_job_is_queued(task1));
+	assert_true(bg_job_is_queued(task2));
+
+	open_gate();
+	wait_for_all_bg();
+}
+
+TEST(jobs_on_the_same_device_are_limited)
+{
+	bg_job_t *op1 = start_gated(/*important=*/1, SANDBOX_PATH);
+	bg_job_t *op2 = start_gated(/*important=*/1, SANDBOX_PATH);
+	bg_job_t *op3 = start_gated(/*important=*/1, SANDBOX_PATH);
+	bg_job_t *op4 = start_gated(/*important=*/1, /*path=*/NULL);
+	wait_for_started(3);
+
+	assert_false(bg_job_is_queued(op1));
+	assert_false(bg_job_is_queued(op2));
+	assert_true(bg_job_is_queued(op3));
+	assert_false(bg_job_is_queued(op4));
+
+	open_gate();
+	wait_for_all_bg();
+}
+
+/* Starts a job which doesn't finish until open_gate() is called.  Returns the
+ * job. */
+static bg_job_t *
+start_gated(int important, const char path[])
+{
+	assert_success(bg_execute("gated", "", 0, important, path, &gated_task,
+				NULL));
+	/* New jobs are added to the head of the list. */
+	return bg_jobs;
+}
+
+static void
+gated_task(bg_op_t *bg_op, void *arg)
+{
+	pthread_mutex_lock(&gate_lock);
+	++gate_started;
+	pthread_cond_broadcast(&gate_cond);
+	while(!gate_open)
+	{
+		pthread_cond_wait(&gate_cond, &gate_lock);
+	}
+	--gate_started;
+	pthread_mutex_unlock(&gate_lock);
+}
+
+/* Occupies a worker for a short while. */
+static void
+short_task(bg_op_t *bg_op, void *arg)
+{
+	usleep(100000);
+}
+
+/* Waits until specified number of gated tasks are running and gives the rest a
+ * chance to start. */
+static void
+wait_for_started(int count)
+{
+	pthread_mutex_lock(&gate_lock);
+	while(gate_started < count)
+	{
+		pthread_cond_wait(&gate_cond, &gate_lock);
+	}
+	pthread_mutex_unlock(&gate_lock);
+
+	usleep(20000);
+
+	pthread_mutex_lock(&gate_lock);
+	assert_int_equal(count, gate_started);
+	pthread_mutex_unlock(&gate_lock);
+}
+
+/* Lets all gated tasks finish including those that haven't started yet. */
+static void
+open_gate(void)
+{
+	pthread_mutex_lock(&gate_lock);
+	gate_open = 1;
+	pthread_cond_broadcast(&gate_cond);
+	pthread_mutex_unlock(&gate_lock);
+}
+
 static void
 task(bg_op_t *bg_op, void *arg)
 {
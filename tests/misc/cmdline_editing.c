@@ -587,7 +587,8 @@ TEST(ext_edited_prompt_is_saved_to_history, IF(not_windows))
 	restore_cwd(saved_cwd);
 
 	assert_int_equal(1, curr_stats.exprreg_hist.size);
-	assert_string_equal("'ext-edit'", curr_stats.exprreg_hist.items[0].text);
+	assert_string_equal("'ext-edit'",
+			hist_get(&curr_stats.exprreg_hist, 0)->text);
 
 	cfg_resize_histories(0);
 }
@@ -247,10 +247,14 @@ TEST(removed_files_disappear_in_both_views_on_reload)
 	check_compare_invariants(4);
 	assert_string_equal("same-content-different-name-1", rwin.dir_entry[0].name);
 
+	/* Pretend that width of the name is cached. */
+	lwin.dir_entry[0].name_width = 30;
+
 	assert_success(remove(SANDBOX_PATH "/same-content-different-name-2"));
 	load_dir_list(&lwin, 1);
 	check_compare_invariants(4);
 	assert_string_equal("", lwin.dir_entry[0].name);
+	assert_int_equal(0, lwin.dir_entry[0].name_width);
 
 	assert_success(remove(SANDBOX_PATH "/same-name-same-content"));
 	assert_success(remove(SANDBOX_PATH "/same-name-same-content-2"));
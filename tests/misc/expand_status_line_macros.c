@@ -1,12 +1,14 @@
 #include <stic.h>
 
+#include <stdio.h> /* remove() snprintf() */
 #include <stdlib.h> /* free() */
-#include <string.h> /* strchr() strcmp() */
+#include <string.h> /* strchr() strcmp() strcpy() */
 
 #include <test-utils.h>
 
 #include "../../src/cfg/config.h"
 #include "../../src/engine/parsing.h"
+#include "../../src/engine/variables.h"
 #include "../../src/ui/statusline.h"
 #include "../../src/ui/ui.h"
 #include "../../src/utils/dynarray.h"
@@ -407,5 +409,62 @@ TEST(wide_characters_do_not_break_highlighting, IF(utf8_locale))
 	                           "b    =    c ");
 }
 
+TEST(cached_values_are_updated_on_changes_of_inputs, IF(not_windows))
+{
+	assert_success(make_symlink("target1", SANDBOX_PATH "/link1"));
+	assert_success(make_symlink("target2", SANDBOX_PATH "/link2"));
+
+	strcpy(lwin.curr_dir, SANDBOX_PATH);
+	lwin.dir_entry[0].type = FT_LINK;
+
+	replace_string(&lwin.dir_entry[0].name, "link1");
+	ASSERT_EXPANDED_TO("%T", "target1");
+	replace_string(&lwin.dir_entry[0].name, "link2");
+	ASSERT_EXPANDED_TO("%T", "target2");
+
+	lwin.dir_entry[0].type = FT_REG;
+	ASSERT_EXPANDED_TO("%T", "");
+
+	assert_success(remove(SANDBOX_PATH "/link1"));
+	assert_success(remove(SANDBOX_PATH "/link2"));
+}
+
+TEST(cached_expressions_are_updated_on_changes_of_variables)
+{
+	init_variables();
+
+	assert_success(let_variables("g:var = 'a'"));
+	ASSERT_EXPANDED_TO("%{g:var}", "a");
+	assert_success(let_variables("g:var = 'b'"));
+	ASSERT_EXPANDED_TO("%{g:var}", "b");
+	assert_success(unlet_variables("g:var"));
+	ASSERT_EXPANDED_TO("%{g:var}", "<Invalid expr>");
+
+	assert_success(let_variables("$VAR = 'a'"));
+	ASSERT_EXPANDED_TO("%{$VAR}", "a");
+	assert_success(let_variables("$VAR .= 'b'"));
+	ASSERT_EXPANDED_TO("%{$VAR}", "ab");
+
+	clear_variables();
+	vle_parser_init(&env_get);
+}
+
+TEST(many_formats_are_expanded_correctly)
+{
+	int i;
+	for(i = 0; i < 3; ++i)
+	{
+		int j;
+		for(j = 0; j < 20; ++j)
+		{
+			char format[64];
+			snprintf(format, sizeof(format), "%%{%d}%%[%%{''}%%]", j);
+			char expected[64];
+			snprintf(expected, sizeof(expected), "%d", j);
+			ASSERT_EXPANDED_TO(format, expected);
+		}
+	}
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 filetype=c : */
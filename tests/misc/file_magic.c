@@ -2,17 +2,21 @@
 
 #include <unistd.h> /* unlink() */
 
-#include <stdio.h> /* fopen() fclose() */
-#include <string.h> /* strcmp() */
+#include <stdio.h> /* FILE fopen() fclose() fprintf() */
+#include <string.h> /* strchr() strcmp() strcpy() */
 
 #include <test-utils.h>
 
+#include "../../src/cfg/config.h"
 #include "../../src/compat/fs_limits.h"
 #include "../../src/compat/os.h"
+#include "../../src/ui/ui.h"
 #include "../../src/int/file_magic.h"
 #include "../../src/utils/env.h"
 #include "../../src/utils/fs.h"
 #include "../../src/utils/path.h"
+#include "../../src/utils/str.h"
+#include "../../src/utils/string_array.h"
 
 static void check_empty_file(const char fname[]);
 static int has_mime_type_detection_and_symlinks(void);
@@ -20,6 +24,12 @@ static int has_mime_type_detection_and_can_test_cache(void);
 static int has_mime_type_detection(void);
 static int has_no_mime_type_detection(void);
 
+TEARDOWN()
+{
+	cfg.mime_cache_file[0] = '\0';
+	file_magic_reset();
+}
+
 TEST(escaping_for_determining_mime_type, IF(has_mime_type_detection))
 {
 	check_empty_file(SANDBOX_PATH "/start'end");
@@ -84,6 +94,67 @@ TEST(empty_magic_handlers_on_no_mime_type_detection,
 	remove_file(SANDBOX_PATH "/file");
 }
 
+TEST(deferred_detection_happens_in_background, IF(has_mime_type_detection))
+{
+	view_setup(&lwin);
+	view_setup(&rwin);
+	copy_file(TEST_DATA_PATH "/read/very-long-line", SANDBOX_PATH "/file");
+
+	mimetype_defer_begin();
+	assert_null(get_mimetype(SANDBOX_PATH "/file", 0));
+	assert_true(mimetype_defer_end());
+
+	wait_for_bg();
+	assert_true(lwin.need_redraw);
+	assert_true(rwin.need_redraw);
+
+	mimetype_defer_begin();
+	assert_string_equal("text/plain", get_mimetype(SANDBOX_PATH "/file", 0));
+	assert_false(mimetype_defer_end());
+
+	remove_file(SANDBOX_PATH "/file");
+	view_teardown(&lwin);
+	view_teardown(&rwin);
+}
+
+TEST(detected_types_are_persisted_and_reused, IF(has_mime_type_detection))
+{
+	copy_file(TEST_DATA_PATH "/read/very-long-line", SANDBOX_PATH "/file");
+	file_magic_reset();
+	copy_str(cfg.mime_cache_file, sizeof(cfg.mime_cache_file),
+			SANDBOX_PATH "/mimetypes");
+
+	assert_string_equal("text/plain", get_mimetype(SANDBOX_PATH "/file", 0));
+
+	int nlines;
+	char **lines = read_file_of_lines(SANDBOX_PATH "/mimetypes", &nlines);
+	assert_int_equal(2, nlines);
+	assert_string_equal("vifm-mime-cache 1", lines[0]);
+	char *const tab = strchr(lines[1], '\t');
+	assert_non_null(tab);
+	assert_string_equal("text/plain", tab + 1);
+
+	/* Replace the type to see that it's used. */
+	strcpy(tab + 1, "very/special");
+	FILE *const fp = fopen(SANDBOX_PATH "/mimetypes", "w");
+	assert_non_null(fp);
+	fprintf(fp, "%s\n%s\n", lines[0], lines[1]);
+	fclose(fp);
+	free_string_array(lines, nlines);
+
+	file_magic_reset();
+	assert_string_equal("very/special", get_mimetype(SANDBOX_PATH "/file", 0));
+
+	/* Stored type is ignored once the file changes. */
+	file_magic_reset();
+	copy_file(TEST_DATA_PATH "/read/binary-data", SANDBOX_PATH "/file");
+	assert_false(strcmp("very/special", get_mimetype(SANDBOX_PATH "/file", 0)) ==
+			0);
+
+	remove_file(SANDBOX_PATH "/file");
+	remove_file(SANDBOX_PATH "/mimetypes");
+}
+
 static void
 check_empty_file(const char fname[])
 {
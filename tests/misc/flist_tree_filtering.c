@@ -220,6 +220,38 @@ TEST(nodes_are_reparented_on_filtering)
 	validate_tree(&lwin);
 }
 
+TEST(refined_filter_is_applied_to_previous_result)
+{
+	assert_success(load_tree(&lwin, TEST_DATA_PATH "/tree", cwd));
+	assert_int_equal(12, lwin.list_rows);
+
+	assert_int_equal(0, local_filter_set(&lwin, "file"));
+	assert_int_equal(5, lwin.list_rows);
+	validate_tree(&lwin);
+	assert_true(lwin.local_filter.passed_valid);
+	assert_int_equal(5, lwin.local_filter.passed_count);
+
+	assert_int_equal(0, local_filter_set(&lwin, "file2"));
+	assert_int_equal(1, lwin.list_rows);
+	validate_tree(&lwin);
+	assert_int_equal(1, lwin.local_filter.passed_count);
+
+	/* Removing characters makes filtering start anew. */
+	assert_int_equal(0, local_filter_set(&lwin, "file"));
+	assert_int_equal(5, lwin.list_rows);
+	validate_tree(&lwin);
+
+	/* So does appending characters that aren't literal. */
+	assert_int_equal(0, local_filter_set(&lwin, "file|dir5"));
+	assert_int_equal(6, lwin.list_rows);
+	validate_tree(&lwin);
+
+	local_filter_accept(&lwin, /*update_history=*/1);
+	assert_false(lwin.local_filter.passed_valid);
+	assert_int_equal(6, lwin.list_rows);
+	validate_tree(&lwin);
+}
+
 TEST(sorting_of_filtered_list_accounts_for_tree)
 {
 	assert_success(load_tree(&lwin, TEST_DATA_PATH "/tree", cwd));
@@ -1,11 +1,17 @@
 #include <stic.h>
 
+#include <unistd.h> /* getuid() symlink() unlink() */
+
 #include <stddef.h> /* NULL */
+#include <stdio.h> /* snprintf() */
 #include <stdlib.h> /* free() malloc() */
 #include <string.h> /* memset() strcmp() strdup() */
 
 #include <test-utils.h>
 
+#include "../../src/compat/fs_limits.h"
+#include "../../src/utils/macros.h"
+#include "../../src/utils/path.h"
 #include "../../src/utils/str.h"
 #include "../../src/utils/string_array.h"
 #include "../../src/background.h"
@@ -131,7 +137,7 @@ TEST(large_message_is_delivered, IF(enabled_and_not_in_wine))
 	ipc_t *const ipc1 = ipc_init(NAME, &test_ipc_args, &test_ipc_eval);
 	ipc_t *const ipc2 = ipc_init(NAME, &test_ipc_args2, &test_ipc_eval);
 
-	assert_success(bg_execute("", "", 0, 1, &other_instance, ipc2));
+	assert_success(bg_execute("", "", 0, 1, NULL, &other_instance, ipc2));
 
 	assert_success(ipc_send(ipc1, ipc_get_name(ipc2), data));
 	assert_false(ipc_check(ipc1));
@@ -157,7 +163,7 @@ TEST(expr_is_evaluated, IF(enabled_and_not_in_wine))
 	ipc_t *const ipc1 = ipc_init(NAME, &test_ipc_args, &test_ipc_eval);
 	ipc_t *const ipc2 = ipc_init(NAME, &test_ipc_args2, &test_ipc_eval);
 
-	assert_success(bg_execute("", "", 0, 1, &other_instance, ipc2));
+	assert_success(bg_execute("", "", 0, 1, NULL, &other_instance, ipc2));
 
 	result = ipc_eval(ipc1, ipc_get_name(ipc2), expr);
 	assert_false(ipc_check(ipc1));
@@ -184,7 +190,7 @@ TEST(eval_error_is_handled, IF(enabled_and_not_in_wine))
 	ipc_t *const ipc1 = ipc_init(NAME, &test_ipc_args, &test_ipc_eval);
 	ipc_t *const ipc2 = ipc_init(NAME, &test_ipc_args2, &test_ipc_eval_error);
 
-	assert_success(bg_execute("", "", 0, 1, &other_instance, ipc2));
+	assert_success(bg_execute("", "", 0, 1, NULL, &other_instance, ipc2));
 
 	result = ipc_eval(ipc1, ipc_get_name(ipc2), expr);
 	assert_false(ipc_check(ipc1));
@@ -213,13 +219,113 @@ TEST(checking_ipc_from_ipc_handler_is_noop, IF(enabled_and_not_windows))
 
 	recursive_ipc = ipc2;
 
+	/* Second message is pending while the first one is handled. */
 	assert_success(ipc_send(ipc1, ipc_get_name(ipc2), data));
 	assert_success(ipc_send(ipc1, ipc_get_name(ipc2), data));
 	assert_true(ipc_check(ipc2));
+	assert_false(ipc_check(ipc2));
+
+	ipc_free(ipc1);
+	ipc_free(ipc2);
+}
+
+TEST(messages_sent_together_are_processed_together,
+		IF(enabled_and_not_windows))
+{
+	char msg[] = "test message";
+	char *data[] = { msg, NULL };
+
+	ipc_t *const ipc1 = ipc_init(NAME, &test_ipc_args, &test_ipc_eval);
+	ipc_t *const ipc2 = ipc_init(NAME, &test_ipc_args2, &test_ipc_eval);
+
+	int i;
+	for(i = 0; i < 10; ++i)
+	{
+		assert_success(ipc_send(ipc1, ipc_get_name(ipc2), data));
+	}
+	assert_true(ipc_check(ipc2));
+	assert_false(ipc_check(ipc2));
+
+	ipc_free(ipc1);
+	ipc_free(ipc2);
+
+	assert_int_equal(20, nmessages2);
+	assert_string_equal(msg, message2);
+}
+
+TEST(many_exprs_are_evaluated, IF(enabled_and_not_in_wine))
+{
+	ipc_t *const ipc1 = ipc_init(NAME, &test_ipc_args, &test_ipc_eval);
+	ipc_t *const ipc2 = ipc_init(NAME, &test_ipc_args2, &test_ipc_eval);
+
+	int i;
+	for(i = 0; i < 100; ++i)
+	{
+		assert_success(bg_execute("", "", 0, 1, NULL, &other_instance, ipc2));
+
+		char *const result = ipc_eval(ipc1, ipc_get_name(ipc2),
+				"good expression");
+		assert_string_equal("good result", result);
+		free(result);
+
+		wait_for_bg();
+	}
+
+	ipc_free(ipc1);
+	ipc_free(ipc2);
+}
+
+TEST(pipe_is_used_for_instances_without_socket, IF(enabled_and_not_windows))
+{
+	char msg[] = "test message";
+	char *data[] = { msg, NULL };
+
+	ipc_t *const ipc1 = ipc_init(NAME, &test_ipc_args, &test_ipc_eval);
+	ipc_t *const ipc2 = ipc_init(NAME, &test_ipc_args2, &test_ipc_eval);
+
+	/* Pretend that second instance is of an older version. */
+	char sock_path[PATH_MAX + 1];
+	snprintf(sock_path, sizeof(sock_path), "%s/vifm-ipc-%s.sock", get_tmpdir(),
+			ipc_get_name(ipc2));
+	assert_success(unlink(sock_path));
+
+	assert_success(ipc_send(ipc1, ipc_get_name(ipc2), data));
 	assert_true(ipc_check(ipc2));
 
+	assert_success(bg_execute("", "", 0, 1, NULL, &other_instance, ipc2));
+	char *const result = ipc_eval(ipc1, ipc_get_name(ipc2), "good expression");
+	wait_for_bg();
+
 	ipc_free(ipc1);
 	ipc_free(ipc2);
+
+	assert_int_equal(2, nmessages2);
+	assert_string_equal(msg, message2);
+	assert_string_equal("good result", result);
+	free(result);
+}
+
+TEST(registry_is_not_followed_if_it_is_a_symlink, IF(enabled_and_not_windows))
+{
+	char registry[PATH_MAX + 1];
+	snprintf(registry, sizeof(registry), "%s/vifm-ipc.%lu.registry",
+			get_tmpdir(), (unsigned long)getuid());
+	(void)unlink(registry);
+
+	char target[PATH_MAX + 1];
+	make_abs_path(target, sizeof(target), SANDBOX_PATH, "target", NULL);
+	make_file(target, "not a registry");
+	assert_success(symlink(target, registry));
+
+	ipc_t *const ipc = ipc_init(NAME, &test_ipc_args, &test_ipc_eval);
+	assert_non_null(ipc);
+	ipc_free(ipc);
+
+	const char *lines[] = { "not a registry" };
+	file_is(target, lines, ARRAY_LEN(lines));
+
+	assert_success(unlink(registry));
+	assert_success(unlink(target));
 }
 
 TEST(no_send_to_self, IF(enabled_and_not_in_wine))
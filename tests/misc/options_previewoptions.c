@@ -0,0 +1,117 @@
+#include <stic.h>
+
+#include <test-utils.h>
+
+#include "../../src/cfg/config.h"
+#include "../../src/engine/options.h"
+#include "../../src/engine/text_buffer.h"
+#include "../../src/ui/column_view.h"
+#include "../../src/ui/ui.h"
+#include "../../src/cmd_core.h"
+#include "../../src/opt_handlers.h"
+#include "../../src/vcache.h"
+#include "../../src/vcache_disk.h"
+
+static void print_func(const char buf[], int offset, AlignType align,
+		const char full_column[], const format_info_t *info);
+
+SETUP()
+{
+	cmds_init();
+
+	view_setup(&lwin);
+	lwin.columns = columns_create();
+	curr_view = &lwin;
+
+	view_setup(&rwin);
+	rwin.columns = columns_create();
+	other_view = &rwin;
+
+	columns_setup_column(SK_BY_NAME);
+	columns_setup_column(SK_BY_SIZE);
+	columns_set_line_print_func(&print_func);
+
+	opt_handlers_setup();
+}
+
+TEARDOWN()
+{
+	assert_success(cmds_dispatch("set previewoptions=", &lwin, CIT_COMMAND));
+
+	opt_handlers_teardown();
+
+	vle_cmds_reset();
+
+	view_teardown(&lwin);
+	view_teardown(&rwin);
+
+	columns_teardown();
+}
+
+TEST(cachesize_sets_size_of_preview_cache)
+{
+	assert_success(cmds_dispatch("set previewoptions=cachesize:64", &lwin,
+				CIT_COMMAND));
+	assert_int_equal(64*1024, vcache_get_stats().max_size);
+
+	vle_tb_clear(vle_err);
+	assert_success(vle_opts_set("previewoptions?", OPT_GLOBAL));
+	assert_string_equal("  previewoptions=cachesize:64",
+			vle_tb_get_data(vle_err));
+
+	assert_success(cmds_dispatch("set previewoptions=", &lwin, CIT_COMMAND));
+	assert_int_equal(VCACHE_DEF_MAX_SIZE, vcache_get_stats().max_size);
+}
+
+TEST(cachesize_is_validated)
+{
+	assert_failure(cmds_dispatch("set previewoptions=cachesize:big", &lwin,
+				CIT_COMMAND));
+	assert_string_equal("Failed to parse \"cachesize\" value: big",
+			vle_tb_get_data(vle_err));
+
+	assert_failure(cmds_dispatch("set previewoptions=cachesize:-1", &lwin,
+				CIT_COMMAND));
+	assert_string_equal("\"cachesize\" can't be negative, got: -1",
+			vle_tb_get_data(vle_err));
+
+	assert_int_equal(VCACHE_DEF_MAX_SIZE, vcache_get_stats().max_size);
+}
+
+TEST(diskcache_sets_size_of_persistent_preview_cache)
+{
+	assert_int_equal(0, vcache_disk_get_max_size());
+
+	assert_success(cmds_dispatch("set previewoptions=diskcache:1024", &lwin,
+				CIT_COMMAND));
+	assert_int_equal(1024*1024, vcache_disk_get_max_size());
+
+	assert_failure(cmds_dispatch("set previewoptions=diskcache:-1", &lwin,
+				CIT_COMMAND));
+	assert_string_equal("\"diskcache\" can't be negative, got: -1",
+			vle_tb_get_data(vle_err));
+	assert_int_equal(1024*1024, vcache_disk_get_max_size());
+
+	assert_success(cmds_dispatch("set previewoptions=", &lwin, CIT_COMMAND));
+	assert_int_equal(0, vcache_disk_get_max_size());
+}
+
+TEST(all_numeric_values_are_displayed)
+{
+	assert_success(cmds_dispatch("set previewoptions=maxtreedepth:2,"
+				"graphicsdelay:10,cachesize:128,diskcache:256", &lwin, CIT_COMMAND));
+
+	vle_tb_clear(vle_err);
+	assert_success(vle_opts_set("previewoptions?", OPT_GLOBAL));
+	assert_string_equal("  previewoptions=maxtreedepth:2,graphicsdelay:10,"
+			"cachesize:128,diskcache:256", vle_tb_get_data(vle_err));
+}
+
+static void
+print_func(const char buf[], int offset, AlignType align,
+		const char full_column[], const format_info_t *info)
+{
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
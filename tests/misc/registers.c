@@ -130,6 +130,71 @@ TEST(registers_are_listed)
 	free_string_array(list, len);
 }
 
+TEST(appended_files_are_sorted_and_deduplicated)
+{
+	assert_success(regs_append('a', "c"));
+	assert_success(regs_append('a', "a"));
+	assert_success(regs_append('a', "b"));
+	assert_failure(regs_append('a', "a"));
+	assert_failure(regs_append('a', "c"));
+
+	const reg_t *reg = regs_find('a');
+	assert_int_equal(3, reg->nfiles);
+	assert_string_equal("a", reg->files[0]);
+	assert_string_equal("b", reg->files[1]);
+	assert_string_equal("c", reg->files[2]);
+
+	assert_failure(regs_append('a', "b"));
+	assert_success(regs_append('a', "0"));
+	assert_string_equal("0", regs_find('a')->files[0]);
+}
+
+TEST(regs_set_deduplicates_files)
+{
+	char a[] = "a", b[] = "b";
+	char *files[] = { b, a, b, a };
+	regs_set('a', files, /*nfiles=*/4);
+
+	const reg_t *reg = regs_find('a');
+	assert_int_equal(2, reg->nfiles);
+	assert_string_equal("a", reg->files[0]);
+	assert_string_equal("b", reg->files[1]);
+
+	assert_failure(regs_append('a', "a"));
+	assert_failure(regs_append('a', "b"));
+}
+
+TEST(renaming_keeps_registers_sorted)
+{
+	regs_append('a', "a");
+	regs_append('a', "b");
+	regs_append('a', "c");
+
+	regs_rename_contents("a", "d");
+
+	const reg_t *reg = regs_find('a');
+	assert_int_equal(3, reg->nfiles);
+	assert_string_equal("b", reg->files[0]);
+	assert_string_equal("c", reg->files[1]);
+	assert_string_equal("d", reg->files[2]);
+
+	assert_success(regs_append('a', "a"));
+	assert_failure(regs_append('a', "d"));
+}
+
+TEST(renaming_to_path_in_register_drops_old_path)
+{
+	regs_append('a', "a");
+	regs_append('a', "b");
+
+	regs_rename_contents("a", "b");
+
+	const reg_t *reg = regs_find('a');
+	assert_int_equal(1, reg->nfiles);
+	assert_string_equal("b", reg->files[0]);
+	assert_success(regs_append('a', "a"));
+}
+
 static void
 suggest_cb(const wchar_t text[], const wchar_t value[], const char d[])
 {
@@ -302,6 +302,43 @@ TEST(chg_halve_allocation, IF(not_wine))
 	check_is_initial(1, TEST_REGISTERS_MINUS_DEFG);
 }
 
+TEST(only_changed_registers_are_imported, IF(not_wine))
+{
+	/* Local change that isn't exported yet. */
+	send_query(0, "set,h,localh\n");
+
+	send_query(1, "set,d,newd,nd1,nd2\n");
+	sync_to_from(1);
+
+	check_register_contents(0, 'h', "h,1,localh,");
+
+	/* Restore initial value for other tests. */
+	send_query(0, "set,h,_initialh,ih1,ih2,ih3\n");
+	sync_to_from(0);
+	check_register_contents(1, 'h', "h,4,_initialh,ih1,ih2,ih3,");
+}
+
+TEST(export_does_not_overwrite_unchanged_registers, IF(not_wine))
+{
+	send_query(1, "set,i,fromone\n");
+	send_query(1, "sync_to\n");
+	receive_ack(1);
+
+	/* Instance 0 exports without importing change of register i first. */
+	send_query(0, "set,d,newd,nd1,nd2\n");
+	send_query(0, "sync_to\n");
+	receive_ack(0);
+
+	sync_from(1);
+	check_register_contents(1, 'i', "i,1,fromone,");
+	sync_from(0);
+	check_register_contents(0, 'i', "i,1,fromone,");
+
+	/* Restore initial value for other tests. */
+	send_query(1, "set,i,_initiali,ii1,ii2,ii3\n");
+	sync_to_from(1);
+}
+
 TEST(handover, IF(not_wine))
 {
 	/* Open third instance. */
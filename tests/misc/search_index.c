@@ -0,0 +1,220 @@
+#include <stic.h>
+
+#include <regex.h> /* regcomp() regexec() regfree() */
+
+#include <stdio.h> /* snprintf() */
+#include <string.h> /* strdup() */
+
+#include <test-utils.h>
+
+#include "../../src/cfg/config.h"
+#include "../../src/ui/ui.h"
+#include "../../src/utils/dynarray.h"
+#include "../../src/filelist.h"
+#include "../../src/search.h"
+
+static void fill_view(int n, const char *names[]);
+static void fill_view_with_numbers(int n);
+static void check_against_regexec(const char pattern[]);
+
+SETUP()
+{
+	view_setup(&lwin);
+	view_setup(&rwin);
+	cfg.wrap_scan = 1;
+	cfg.ignore_case = 0;
+	cfg.smart_case = 0;
+}
+
+TEARDOWN()
+{
+	view_teardown(&lwin);
+	view_teardown(&rwin);
+}
+
+TEST(literal_match_is_highlighted)
+{
+	const char *names[] = { "abcabc", "xABCx", "dir" };
+	fill_view(3, names);
+	lwin.dir_entry[2].type = FT_DIR;
+
+	search_pattern(&lwin, "bc", /*stash_selection=*/0, /*select_matches=*/0);
+	assert_int_equal(1, lwin.matches);
+	assert_int_equal(1, lwin.dir_entry[0].search_match);
+	assert_int_equal(1, lwin.dir_entry[0].match_left);
+	assert_int_equal(3, lwin.dir_entry[0].match_right);
+	assert_int_equal(0, lwin.dir_entry[1].search_match);
+
+	cfg.ignore_case = 1;
+	search_pattern(&lwin, "bc", /*stash_selection=*/0, /*select_matches=*/0);
+	assert_int_equal(2, lwin.matches);
+	assert_int_equal(2, lwin.dir_entry[1].search_match);
+	assert_int_equal(2, lwin.dir_entry[1].match_left);
+	assert_int_equal(4, lwin.dir_entry[1].match_right);
+
+	search_pattern(&lwin, "r/", /*stash_selection=*/0, /*select_matches=*/0);
+	assert_int_equal(1, lwin.matches);
+	assert_int_equal(1, lwin.dir_entry[2].search_match);
+}
+
+TEST(prefiltered_patterns_match_like_regexec)
+{
+	const char *names[] = {
+		"abc", "abd", "ac", "aXc", "bc", "b", "ab|cd", "a.c", "ab{2}",
+		"abbc", "xyz", "yz", "Abc", "[abc]", "a+c", "aab", "ba", "(ab)"
+	};
+	fill_view(ARRAY_LEN(names), names);
+
+	check_against_regexec("abc");
+	check_against_regexec("a.c");
+	check_against_regexec("ab*c");
+	check_against_regexec("ab?c");
+	check_against_regexec("ab+c");
+	check_against_regexec("ab{2}c");
+	check_against_regexec("ab{0,1}d");
+	check_against_regexec("a|b");
+	check_against_regexec("ab|cd");
+	check_against_regexec("(ab)*c");
+	check_against_regexec("(ab)c");
+	check_against_regexec("[abc]c");
+	check_against_regexec("[]a]b");
+	check_against_regexec("[[:alpha:]]b");
+	check_against_regexec("^ab");
+	check_against_regexec("c$");
+	check_against_regexec("x?yz");
+	check_against_regexec("a\\.c");
+	check_against_regexec("\\(ab");
+
+	cfg.ignore_case = 1;
+	check_against_regexec("abc");
+	check_against_regexec("a.C");
+}
+
+TEST(long_lists_are_searched_correctly)
+{
+	fill_view_with_numbers(30000);
+
+	check_against_regexec("7");
+	check_against_regexec("1.*7$");
+	check_against_regexec("^file2999");
+
+	search_pattern(&lwin, "999", /*stash_selection=*/0, /*select_matches=*/1);
+	assert_int_equal(57, lwin.matches);
+	assert_int_equal(57, lwin.selected_files);
+	assert_int_equal(1, lwin.dir_entry[999].search_match);
+	assert_int_equal(57, lwin.dir_entry[29999].search_match);
+}
+
+TEST(navigation_uses_counts_and_wraps)
+{
+	fill_view_with_numbers(30000);
+	search_pattern(&lwin, "999", /*stash_selection=*/0, /*select_matches=*/0);
+
+	lwin.list_pos = 0;
+	assert_int_equal(999, find_search_match(&lwin, /*backward=*/0, 1));
+	assert_int_equal(1999, find_search_match(&lwin, /*backward=*/0, 2));
+	assert_int_equal(29999, find_search_match(&lwin, /*backward=*/1, 1));
+	assert_int_equal(999, find_search_match(&lwin, /*backward=*/0, 58));
+
+	lwin.list_pos = 999;
+	assert_int_equal(1999, find_search_match(&lwin, /*backward=*/0, 1));
+	assert_int_equal(29999, find_search_match(&lwin, /*backward=*/1, 1));
+
+	lwin.list_pos = 29999;
+	assert_int_equal(999, find_search_match(&lwin, /*backward=*/0, 1));
+	assert_int_equal(29998, find_search_match(&lwin, /*backward=*/1, 1));
+
+	cfg.wrap_scan = 0;
+	assert_int_equal(-1, find_search_match(&lwin, /*backward=*/0, 1));
+	lwin.list_pos = 0;
+	assert_int_equal(-1, find_search_match(&lwin, /*backward=*/1, 1));
+	assert_int_equal(-1, find_search_match(&lwin, /*backward=*/0, 58));
+}
+
+TEST(untracked_reordering_is_detected)
+{
+	const char *names[] = { "a1", "b", "a2", "c", "a3" };
+	fill_view(ARRAY_LEN(names), names);
+	search_pattern(&lwin, "a", /*stash_selection=*/0, /*select_matches=*/0);
+
+	/* Swap "b" and "a2". */
+	dir_entry_t tmp = lwin.dir_entry[1];
+	lwin.dir_entry[1] = lwin.dir_entry[2];
+	lwin.dir_entry[2] = tmp;
+
+	lwin.list_pos = 0;
+	assert_int_equal(1, find_search_match(&lwin, /*backward=*/0, 1));
+	assert_int_equal(2, lwin.dir_entry[1].search_match);
+	assert_int_equal(4, find_search_match(&lwin, /*backward=*/0, 2));
+}
+
+/* Fills lwin with files of specified names. */
+static void
+fill_view(int n, const char *names[])
+{
+	lwin.list_rows = n;
+	lwin.dir_entry = dynarray_cextend(NULL, n*sizeof(*lwin.dir_entry));
+
+	int i;
+	for(i = 0; i < n; ++i)
+	{
+		lwin.dir_entry[i].name = strdup(names[i]);
+		lwin.dir_entry[i].origin = &lwin.curr_dir[0];
+		lwin.dir_entry[i].type = FT_REG;
+	}
+}
+
+/* Fills lwin with n files named after their position. */
+static void
+fill_view_with_numbers(int n)
+{
+	lwin.list_rows = n;
+	lwin.dir_entry = dynarray_cextend(NULL, n*sizeof(*lwin.dir_entry));
+
+	int i;
+	for(i = 0; i < n; ++i)
+	{
+		char name[32];
+		snprintf(name, sizeof(name), "file%d", i);
+		lwin.dir_entry[i].name = strdup(name);
+		lwin.dir_entry[i].origin = &lwin.curr_dir[0];
+		lwin.dir_entry[i].type = FT_REG;
+	}
+}
+
+/* Checks that search marks and highlights the same entries as regexec() on
+ * every entry would do. */
+static void
+check_against_regexec(const char pattern[])
+{
+	regex_t re;
+	const int cflags = REG_EXTENDED | (cfg.ignore_case ? REG_ICASE : 0);
+	assert_success(regcomp(&re, pattern, cflags));
+
+	assert_success(search_pattern(&lwin, pattern, /*stash_selection=*/0,
+				/*select_matches=*/0));
+
+	int i;
+	int nmatches = 0;
+	for(i = 0; i < lwin.list_rows; ++i)
+	{
+		const dir_entry_t *entry = &lwin.dir_entry[i];
+
+		regmatch_t match;
+		if(regexec(&re, entry->name, 1, &match, 0) != 0)
+		{
+			assert_int_equal(0, entry->search_match);
+			continue;
+		}
+
+		assert_int_equal(++nmatches, entry->search_match);
+		assert_int_equal(match.rm_so, entry->match_left);
+		assert_int_equal(match.rm_eo, entry->match_right);
+	}
+	assert_int_equal(nmatches, lwin.matches);
+
+	regfree(&re);
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -23,6 +23,7 @@ TEARDOWN_ONCE()
 TEARDOWN()
 {
 	(void)sessions_stop();
+	(void)remove(SANDBOX_PATH "/vifminfo.journal");
 	histories_init(0);
 	cfg.session_options = 0;
 	cfg.vifm_info = 0;
@@ -124,10 +125,10 @@ TEST(session_can_be_loaded)
 
 	assert_int_equal(2, curr_stats.cmd_hist.size);
 
-	assert_string_equal("command2", curr_stats.cmd_hist.items[0].text);
-	assert_int_equal(2, curr_stats.cmd_hist.items[0].timestamp);
-	assert_string_equal("command0", curr_stats.cmd_hist.items[1].text);
-	assert_int_equal(0, curr_stats.cmd_hist.items[1].timestamp);
+	assert_string_equal("command2", hist_get(&curr_stats.cmd_hist, 0)->text);
+	assert_int_equal(2, hist_get(&curr_stats.cmd_hist, 0)->timestamp);
+	assert_string_equal("command0", hist_get(&curr_stats.cmd_hist, 1)->text);
+	assert_int_equal(0, hist_get(&curr_stats.cmd_hist, 1)->timestamp);
 
 	remove_file(SANDBOX_PATH "/sessions/session.json");
 	remove_dir(SANDBOX_PATH "/sessions");
@@ -151,10 +152,10 @@ TEST(loading_nonexisting_session_just_loads_vifminfo)
 
 	assert_int_equal(2, curr_stats.cmd_hist.size);
 
-	assert_string_equal("command2", curr_stats.cmd_hist.items[0].text);
-	assert_int_equal(2, curr_stats.cmd_hist.items[0].timestamp);
-	assert_string_equal("command0", curr_stats.cmd_hist.items[1].text);
-	assert_int_equal(0, curr_stats.cmd_hist.items[1].timestamp);
+	assert_string_equal("command2", hist_get(&curr_stats.cmd_hist, 0)->text);
+	assert_int_equal(2, hist_get(&curr_stats.cmd_hist, 0)->timestamp);
+	assert_string_equal("command0", hist_get(&curr_stats.cmd_hist, 1)->text);
+	assert_int_equal(0, hist_get(&curr_stats.cmd_hist, 1)->timestamp);
 
 	remove_file(SANDBOX_PATH "/vifminfo.json");
 
@@ -185,14 +186,14 @@ TEST(session_is_merged_on_storing)
 
 	assert_int_equal(4, curr_stats.cmd_hist.size);
 
-	assert_string_equal("command3", curr_stats.cmd_hist.items[0].text);
-	assert_int_equal(3, curr_stats.cmd_hist.items[0].timestamp);
-	assert_string_equal("command2", curr_stats.cmd_hist.items[1].text);
-	assert_int_equal(2, curr_stats.cmd_hist.items[1].timestamp);
-	assert_string_equal("command1", curr_stats.cmd_hist.items[2].text);
-	assert_int_equal(1, curr_stats.cmd_hist.items[2].timestamp);
-	assert_string_equal("command0", curr_stats.cmd_hist.items[3].text);
-	assert_int_equal(0, curr_stats.cmd_hist.items[3].timestamp);
+	assert_string_equal("command3", hist_get(&curr_stats.cmd_hist, 0)->text);
+	assert_int_equal(3, hist_get(&curr_stats.cmd_hist, 0)->timestamp);
+	assert_string_equal("command2", hist_get(&curr_stats.cmd_hist, 1)->text);
+	assert_int_equal(2, hist_get(&curr_stats.cmd_hist, 1)->timestamp);
+	assert_string_equal("command1", hist_get(&curr_stats.cmd_hist, 2)->text);
+	assert_int_equal(1, hist_get(&curr_stats.cmd_hist, 2)->timestamp);
+	assert_string_equal("command0", hist_get(&curr_stats.cmd_hist, 3)->text);
+	assert_int_equal(0, hist_get(&curr_stats.cmd_hist, 3)->timestamp);
 
 	remove_file(SANDBOX_PATH "/sessions/session.json");
 	remove_dir(SANDBOX_PATH "/sessions");
@@ -254,14 +255,14 @@ TEST(session_histories_have_priority_over_vifminfo)
 
 	assert_int_equal(4, curr_stats.cmd_hist.size);
 
-	assert_string_equal("command2", curr_stats.cmd_hist.items[0].text);
-	assert_int_equal(2, curr_stats.cmd_hist.items[0].timestamp);
-	assert_string_equal("command0", curr_stats.cmd_hist.items[1].text);
-	assert_int_equal(0, curr_stats.cmd_hist.items[1].timestamp);
-	assert_string_equal("command3", curr_stats.cmd_hist.items[2].text);
-	assert_int_equal(3, curr_stats.cmd_hist.items[2].timestamp);
-	assert_string_equal("command1", curr_stats.cmd_hist.items[3].text);
-	assert_int_equal(1, curr_stats.cmd_hist.items[3].timestamp);
+	assert_string_equal("command2", hist_get(&curr_stats.cmd_hist, 0)->text);
+	assert_int_equal(2, hist_get(&curr_stats.cmd_hist, 0)->timestamp);
+	assert_string_equal("command0", hist_get(&curr_stats.cmd_hist, 1)->text);
+	assert_int_equal(0, hist_get(&curr_stats.cmd_hist, 1)->timestamp);
+	assert_string_equal("command3", hist_get(&curr_stats.cmd_hist, 2)->text);
+	assert_int_equal(3, hist_get(&curr_stats.cmd_hist, 2)->timestamp);
+	assert_string_equal("command1", hist_get(&curr_stats.cmd_hist, 3)->text);
+	assert_int_equal(1, hist_get(&curr_stats.cmd_hist, 3)->timestamp);
 
 	remove_file(SANDBOX_PATH "/sessions/session-a.json");
 	remove_file(SANDBOX_PATH "/sessions/session-b.json");
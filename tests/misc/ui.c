@@ -1,11 +1,13 @@
 #include <stic.h>
 
+#include <stdio.h> /* FILE fclose() fopen() */
 #include <stdlib.h> /* free() */
-#include <string.h> /* strcpy() strdup() */
+#include <string.h> /* strcat() strcpy() strdup() */
 
 #include <test-utils.h>
 
 #include "../../src/cfg/config.h"
+#include "../../src/compat/curses.h"
 #include "../../src/ui/color_scheme.h"
 #include "../../src/ui/colored_line.h"
 #include "../../src/ui/column_view.h"
@@ -13,14 +15,28 @@
 #include "../../src/ui/tabs.h"
 #include "../../src/ui/statusline.h"
 #include "../../src/ui/ui.h"
+#include "../../src/utils/dynarray.h"
+#include "../../src/utils/macros.h"
 #include "../../src/utils/str.h"
 #include "../../src/cmd_core.h"
 #include "../../src/filelist.h"
+#include "../../src/status.h"
 
 #include "utils.h"
 
 static void check_tab_title(const tab_info_t *tab_info, const char text[]);
 static char * identity(const char path[]);
+static void fill_entries(const char *names[], int count);
+static int is_not_named(view_t *view, const dir_entry_t *entry, void *arg);
+static int screen_available(void);
+static void start_screen(void);
+static void stop_screen(void);
+static const char * draw_frame(void);
+
+/* Screen for tests that draw on windows. */
+static SCREEN *screen;
+/* Streams of the screen. */
+static FILE *screen_in, *screen_out;
 
 SETUP_ONCE()
 {
@@ -570,6 +586,52 @@ TEST(mouse_map_tlsview)
 	assert_int_equal(FVM_NONE, fview_map_coordinates(&lwin, 6, 5));
 }
 
+TEST(lsview_name_widths_are_cached_and_updated_incrementally)
+{
+	const char *names[] = { "a", "bbbb", "cc" };
+	fill_entries(names, ARRAY_LEN(names));
+
+	lwin.window_rows = 2;
+	lwin.window_cols = 80;
+	lwin.ls_view = 1;
+	lwin.ls_transposed = 0;
+	lwin.ls_cols = 0;
+	lwin.miller_view = 0;
+	lwin.top_line = 0;
+	lwin.max_filename_width = 0;
+
+	(void)fview_map_coordinates(&lwin, 0, 0);
+	assert_int_equal(4, lwin.max_filename_width);
+	assert_int_equal(1, lwin.dir_entry[0].name_width);
+	assert_int_equal(4, lwin.dir_entry[1].name_width);
+	assert_int_equal(2, lwin.dir_entry[2].name_width);
+
+	/* Growing entry updates maximum in place. */
+	fentry_rename(&lwin, &lwin.dir_entry[2], "cccccc");
+	assert_int_equal(6, lwin.max_filename_width);
+	assert_int_equal(6, lwin.dir_entry[2].name_width);
+
+	/* Shrinking the widest entry requires recomputation. */
+	fentry_rename(&lwin, &lwin.dir_entry[2], "c");
+	assert_int_equal(0, lwin.max_filename_width);
+	(void)fview_map_coordinates(&lwin, 0, 0);
+	assert_int_equal(4, lwin.max_filename_width);
+
+	/* Removing narrower entry doesn't affect maximum. */
+	(void)zap_entries(&lwin, lwin.dir_entry, &lwin.list_rows, &is_not_named,
+			"a", 0, 0);
+	assert_int_equal(2, lwin.list_rows);
+	assert_int_equal(4, lwin.max_filename_width);
+
+	/* Removing the widest entry does. */
+	(void)zap_entries(&lwin, lwin.dir_entry, &lwin.list_rows, &is_not_named,
+			"bbbb", 0, 0);
+	assert_int_equal(1, lwin.list_rows);
+	assert_int_equal(0, lwin.max_filename_width);
+	(void)fview_map_coordinates(&lwin, 0, 0);
+	assert_int_equal(1, lwin.max_filename_width);
+}
+
 TEST(prefix_len_is_reset_by_column_line_print)
 {
 	curr_view = &lwin;
@@ -597,6 +659,100 @@ TEST(prefix_len_is_reset_by_column_line_print)
 	columns_teardown();
 }
 
+TEST(unchanged_cells_of_file_view_are_not_redrawn, IF(screen_available))
+{
+	start_screen();
+
+	assert_string_equal("full", draw_frame());
+	assert_string_equal("", draw_frame());
+	assert_string_equal("", draw_frame());
+
+	stop_screen();
+}
+
+TEST(only_changed_cells_of_file_view_are_redrawn, IF(screen_available))
+{
+	start_screen();
+	assert_string_equal("full", draw_frame());
+
+	lwin.dir_entry[1].selected = 1;
+	assert_string_equal("1", draw_frame());
+
+	/* Highlight group of a file got resolved anew (e.g., after :highlight). */
+	lwin.dir_entry[2].hi_num = 1;
+	assert_string_equal("2", draw_frame());
+
+	replace_string(&lwin.dir_entry[1].name, "bb");
+	assert_string_equal("1", draw_frame());
+
+	assert_string_equal("", draw_frame());
+
+	stop_screen();
+}
+
+TEST(calculated_size_of_directory_redraws_its_cell, IF(screen_available))
+{
+	update_string(&cfg.shell, "");
+	assert_success(stats_init(&cfg));
+
+	start_screen();
+	make_abs_path(lwin.curr_dir, sizeof(lwin.curr_dir), TEST_DATA_PATH, "",
+			NULL);
+	replace_string(&lwin.dir_entry[1].name, "read");
+	lwin.dir_entry[1].type = FT_DIR;
+	assert_string_equal("full", draw_frame());
+
+	assert_success(dcache_set_at(TEST_DATA_PATH "/read", 0, 12345,
+				DCACHE_UNKNOWN));
+	assert_string_equal("1", draw_frame());
+	assert_string_equal("", draw_frame());
+
+	stop_screen();
+	update_string(&cfg.shell, NULL);
+}
+
+TEST(changes_of_view_state_redraw_file_view_in_full, IF(screen_available))
+{
+	start_screen();
+	assert_string_equal("full", draw_frame());
+
+	/* Contents of color scheme changed (e.g., after :highlight). */
+	cfg.cs.color[WIN_COLOR].fg = 1;
+	assert_string_equal("full", draw_frame());
+
+	lwin.top_line = 1;
+	assert_string_equal("full", draw_frame());
+	lwin.top_line = 0;
+	assert_string_equal("full", draw_frame());
+
+	fview_invalidate_frames();
+	assert_string_equal("full", draw_frame());
+
+	assert_string_equal("", draw_frame());
+
+	stop_screen();
+}
+
+TEST(overdrawn_file_view_is_redrawn, IF(screen_available))
+{
+	start_screen();
+	assert_string_equal("full", draw_frame());
+
+	/* Inactive cursor is drawn via the frame and affects only its cell. */
+	mvwaddstr(lwin.win, 1, 0, "*");
+	frame_cell_overdrawn(&lwin, 1, 1);
+	assert_string_equal("1", draw_frame());
+
+	/* Something unknown drew over the view (e.g., quick view or a suggestion
+	 * box). */
+	mvwaddstr(lwin.win, 2, 0, "preview");
+	assert_string_equal("full", draw_frame());
+
+	assert_string_equal("", draw_frame());
+
+	stop_screen();
+}
+
 static void
 check_tab_title(const tab_info_t *tab_info, const char text[])
 {
@@ -614,5 +770,158 @@ identity(const char path[])
 	return (char *)path;
 }
 
+/* Replaces entries of the left view with files of specified names. */
+static void
+fill_entries(const char *names[], int count)
+{
+	lwin.list_rows = count;
+	lwin.dir_entry = dynarray_cextend(NULL, count*sizeof(*lwin.dir_entry));
+
+	int i;
+	for(i = 0; i < count; ++i)
+	{
+		lwin.dir_entry[i].name = strdup(names[i]);
+		lwin.dir_entry[i].origin = &lwin.curr_dir[0];
+		lwin.dir_entry[i].type = FT_REG;
+		lwin.dir_entry[i].hi_num = -1;
+		lwin.dir_entry[i].name_dec_num = -1;
+	}
+}
+
+/* zap_entries() filter that removes entry with the name passed in arg.
+ * Returns non-zero if entry is to be kept and zero otherwise. */
+static int
+is_not_named(view_t *view, const dir_entry_t *entry, void *arg)
+{
+	return (strcmp(entry->name, arg) != 0);
+}
+
+/* Checks whether curses screen can be created.  Returns non-zero if so. */
+static int
+screen_available(void)
+{
+	start_screen();
+	const int available = (screen != NULL);
+	stop_screen();
+	return available;
+}
+
+/* Creates screen and a window for the left view which is filled with a couple
+ * of files. */
+static void
+start_screen(void)
+{
+	screen_in = fopen("/dev/null", "r");
+	screen_out = fopen("/dev/null", "w");
+	if(screen_in == NULL || screen_out == NULL)
+	{
+		return;
+	}
+
+	screen = newterm("dumb", screen_out, screen_in);
+	if(screen == NULL)
+	{
+		return;
+	}
+
+	const char *names[] = { "a", "b", "c" };
+	fill_entries(names, ARRAY_LEN(names));
+
+	int i;
+	for(i = 0; i < lwin.list_rows; ++i)
+	{
+		lwin.dir_entry[i].hi_num = 0;
+	}
+
+	curr_view = &lwin;
+	other_view = &rwin;
+
+	lwin.window_rows = 3;
+	lwin.window_cols = 10;
+	lwin.window_cells = 3;
+	lwin.win = newwin(lwin.window_rows, lwin.window_cols, 0, 0);
+	assert_non_null(lwin.win);
+}
+
+/* Destroys what start_screen() has created. */
+static void
+stop_screen(void)
+{
+	if(screen != NULL)
+	{
+		delwin(lwin.win);
+		lwin.win = NULL;
+
+		endwin();
+		delscreen(screen);
+		screen = NULL;
+	}
+
+	if(screen_in != NULL)
+	{
+		fclose(screen_in);
+		screen_in = NULL;
+	}
+	if(screen_out != NULL)
+	{
+		fclose(screen_out);
+		screen_out = NULL;
+	}
+
+	curr_view = NULL;
+	other_view = NULL;
+}
+
+/* Draws the left view like draw_dir_list_only() does, but outputs just names
+ * of the files.  Returns "full" if the whole view was redrawn or a string of
+ * indexes of cells that were drawn. */
+static const char *
+draw_frame(void)
+{
+	static char drawn[16];
+
+	const int damage_only = frame_begin(&lwin, 1, lwin.window_cols,
+			lwin.list_rows - lwin.top_line);
+	if(damage_only)
+	{
+		drawn[0] = '\0';
+	}
+	else
+	{
+		werase(lwin.win);
+		strcpy(drawn, "full");
+	}
+
+	int cell;
+	for(cell = 0; cell < lwin.list_rows - lwin.top_line; ++cell)
+	{
+		const int pos = lwin.top_line + cell;
+		column_data_t cdt = {
+			.view = &lwin,
+			.entry = &lwin.dir_entry[pos],
+			.line_pos = pos,
+			.current_pos = lwin.list_pos,
+		};
+
+		if(damage_only)
+		{
+			if(!frame_cell_changed(&lwin, cell, &cdt))
+			{
+				continue;
+			}
+
+			const char cell_str[] = { '0' + cell, '\0' };
+			strcat(drawn, cell_str);
+		}
+
+		mvwaddstr(lwin.win, cell, 0, cdt.entry->name);
+		wclrtoeol(lwin.win);
+		frame_cell_drawn(&lwin, lwin.top_line, cell, &cdt, 0);
+	}
+
+	frame_end(&lwin);
+	return drawn;
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 filetype=c : */
@@ -3,6 +3,7 @@
 #include <sys/stat.h> /* chmod() */
 #include <unistd.h> /* usleep() */
 
+#include <stdio.h> /* FILE fclose() fopen() fputs() rename() snprintf() */
 #include <string.h> /* strlen() */
 
 #include <test-utils.h>
@@ -16,6 +17,7 @@
 #include "../../src/vcache.h"
 #include "../lua/asserts.h"
 
+static void append_to_file(const char path[], const char data[]);
 static int wait_for_cache(void);
 static int is_previewed(const char path[]);
 
@@ -218,13 +220,24 @@ TEST(multiple_files_data_is_cached)
 	assert_true(f2lines1.items[1] == f2lines2.items[1]);
 }
 
-TEST(failure_to_allocate_cache_entry_is_handled)
+TEST(zero_cache_size_disables_caching)
 {
 	vcache_reset(0);
+
 	strlist_t lines = vcache_lookup(TEST_DATA_PATH "/read/dos-line-endings", NULL,
 			MF_NONE, VK_TEXTUAL, 2, VC_SYNC, &error);
-	assert_string_equal("Failed to allocate cache entry", error);
-	assert_int_equal(0, lines.nitems);
+	assert_string_equal(NULL, error);
+	assert_int_equal(2, lines.nitems);
+
+	lines = vcache_lookup(TEST_DATA_PATH "/read/dos-line-endings", NULL,
+			MF_NONE, VK_TEXTUAL, 2, VC_SYNC, &error);
+	assert_string_equal(NULL, error);
+	assert_int_equal(2, lines.nitems);
+
+	assert_false(vcache_prefetch(TEST_DATA_PATH "/read/two-lines", "echo aaa",
+				MF_NONE, 10));
+
+	assert_int_equal(0, vcache_get_stats().entries);
 }
 
 TEST(cache_entries_are_reused)
@@ -258,6 +271,94 @@ TEST(cache_entries_are_reused)
 	assert_string_equal("first line", lines.items[0]);
 }
 
+TEST(lookups_are_counted)
+{
+	vcache_reset(10*1024);
+
+	strlist_t lines = vcache_lookup(TEST_DATA_PATH "/read/two-lines", NULL,
+			MF_NONE, VK_TEXTUAL, 10, VC_SYNC, &error);
+	assert_string_equal(NULL, error);
+	assert_int_equal(2, lines.nitems);
+	lines = vcache_lookup(TEST_DATA_PATH "/read/two-lines", NULL, MF_NONE,
+			VK_TEXTUAL, 10, VC_SYNC, &error);
+	assert_string_equal(NULL, error);
+	lines = vcache_lookup(TEST_DATA_PATH "/read/dos-line-endings", NULL,
+			MF_NONE, VK_TEXTUAL, 10, VC_SYNC, &error);
+	assert_string_equal(NULL, error);
+
+	const vcache_stats_t stats = vcache_get_stats();
+	assert_int_equal(2, stats.entries);
+	assert_int_equal(1, stats.hits);
+	assert_int_equal(2, stats.misses);
+	assert_int_equal(0, stats.evictions);
+	assert_true(stats.size > 2*vcache_entry_size());
+	assert_true(stats.size <= stats.max_size);
+}
+
+TEST(shrinking_cache_evicts_entries)
+{
+	vcache_reset(10*1024);
+
+	(void)vcache_lookup(TEST_DATA_PATH "/read/two-lines", NULL,
+			MF_NONE, VK_TEXTUAL, 10, VC_SYNC, &error);
+	assert_string_equal(NULL, error);
+	(void)vcache_lookup(TEST_DATA_PATH "/read/dos-line-endings", NULL,
+			MF_NONE, VK_TEXTUAL, 10, VC_SYNC, &error);
+	assert_string_equal(NULL, error);
+	assert_int_equal(2, vcache_get_stats().entries);
+
+	vcache_set_max_size(vcache_get_stats().size - 1);
+
+	vcache_stats_t stats = vcache_get_stats();
+	assert_int_equal(1, stats.entries);
+	assert_int_equal(1, stats.evictions);
+	assert_true(stats.size <= stats.max_size);
+
+	/* The most recently used entry survives. */
+	(void)vcache_lookup(TEST_DATA_PATH "/read/dos-line-endings", NULL,
+			MF_NONE, VK_TEXTUAL, 10, VC_SYNC, &error);
+	assert_string_equal(NULL, error);
+	assert_int_equal(1, vcache_get_stats().hits);
+
+	vcache_set_max_size(0);
+	stats = vcache_get_stats();
+	assert_int_equal(0, stats.entries);
+	assert_int_equal(0, stats.size);
+}
+
+TEST(many_entries_are_looked_up)
+{
+	int i;
+	vcache_reset(1024*1024);
+
+	for(i = 0; i < 40; ++i)
+	{
+		char viewer[32];
+		snprintf(viewer, sizeof(viewer), "echo %d", i);
+		strlist_t lines = vcache_lookup(TEST_DATA_PATH "/read/two-lines", viewer,
+				MF_NONE, VK_TEXTUAL, 10, VC_SYNC, &error);
+		assert_string_equal(NULL, error);
+		assert_int_equal(1, lines.nitems);
+	}
+
+	for(i = 0; i < 40; ++i)
+	{
+		char viewer[32], expected[32];
+		snprintf(viewer, sizeof(viewer), "echo %d", i);
+		snprintf(expected, sizeof(expected), "%d", i);
+		strlist_t lines = vcache_lookup(TEST_DATA_PATH "/read/two-lines", viewer,
+				MF_NONE, VK_TEXTUAL, 10, VC_SYNC, &error);
+		assert_string_equal(NULL, error);
+		assert_int_equal(1, lines.nitems);
+		assert_string_equal(expected, lines.items[0]);
+	}
+
+	const vcache_stats_t stats = vcache_get_stats();
+	assert_int_equal(40, stats.entries);
+	assert_int_equal(40, stats.hits);
+	assert_int_equal(40, stats.misses);
+}
+
 TEST(viewers_are_cached_independently)
 {
 	strlist_t lines1 = vcache_lookup(TEST_DATA_PATH "/read/two-lines", "echo aaa",
@@ -295,6 +396,192 @@ TEST(file_modification_is_detected)
 	remove_file(SANDBOX_PATH "/file");
 }
 
+TEST(appended_data_is_read_incrementally)
+{
+	make_file(SANDBOX_PATH "/file", "line1\nline2");
+
+	strlist_t lines = vcache_lookup(SANDBOX_PATH "/file", NULL, MF_NONE,
+			VK_TEXTUAL, 10, VC_SYNC, &error);
+	assert_string_equal(NULL, error);
+	assert_int_equal(2, lines.nitems);
+	char *first_line = lines.items[0];
+
+	append_to_file(SANDBOX_PATH "/file", "tail\nline3\n");
+
+	lines = vcache_lookup(SANDBOX_PATH "/file", NULL, MF_NONE, VK_TEXTUAL, 10,
+			VC_SYNC, &error);
+	assert_string_equal(NULL, error);
+	assert_int_equal(3, lines.nitems);
+	assert_true(lines.items[0] == first_line);
+	assert_string_equal("line1", lines.items[0]);
+	assert_string_equal("line2tail", lines.items[1]);
+	assert_string_equal("line3", lines.items[2]);
+
+	remove_file(SANDBOX_PATH "/file");
+}
+
+TEST(appending_respects_line_limit)
+{
+	make_file(SANDBOX_PATH "/file", "line1\n");
+
+	strlist_t lines = vcache_lookup(SANDBOX_PATH "/file", NULL, MF_NONE,
+			VK_TEXTUAL, 2, VC_SYNC, &error);
+	assert_string_equal(NULL, error);
+	assert_int_equal(1, lines.nitems);
+
+	append_to_file(SANDBOX_PATH "/file", "line2\nline3\n");
+
+	lines = vcache_lookup(SANDBOX_PATH "/file", NULL, MF_NONE, VK_TEXTUAL, 2,
+			VC_SYNC, &error);
+	assert_string_equal(NULL, error);
+	assert_int_equal(2, lines.nitems);
+	assert_string_equal("line1", lines.items[0]);
+	assert_string_equal("line2", lines.items[1]);
+
+	remove_file(SANDBOX_PATH "/file");
+}
+
+TEST(appended_data_beyond_line_limit_is_not_lost)
+{
+	make_file(SANDBOX_PATH "/file", "line1\nline2\n");
+
+	strlist_t lines = vcache_lookup(SANDBOX_PATH "/file", NULL, MF_NONE,
+			VK_TEXTUAL, 3, VC_SYNC, &error);
+	assert_string_equal(NULL, error);
+	assert_int_equal(2, lines.nitems);
+
+	append_to_file(SANDBOX_PATH "/file", "line3\n");
+
+	lines = vcache_lookup(SANDBOX_PATH "/file", NULL, MF_NONE, VK_TEXTUAL, 2,
+			VC_SYNC, &error);
+	assert_string_equal(NULL, error);
+	assert_int_equal(2, lines.nitems);
+
+	lines = vcache_lookup(SANDBOX_PATH "/file", NULL, MF_NONE, VK_TEXTUAL, 10,
+			VC_SYNC, &error);
+	assert_string_equal(NULL, error);
+	assert_int_equal(3, lines.nitems);
+	assert_string_equal("line3", lines.items[2]);
+
+	remove_file(SANDBOX_PATH "/file");
+}
+
+TEST(split_dos_line_ending_is_not_doubled_on_appending)
+{
+	make_file(SANDBOX_PATH "/file", "line1\r");
+
+	strlist_t lines = vcache_lookup(SANDBOX_PATH "/file", NULL, MF_NONE,
+			VK_TEXTUAL, 10, VC_SYNC, &error);
+	assert_string_equal(NULL, error);
+	assert_int_equal(1, lines.nitems);
+
+	append_to_file(SANDBOX_PATH "/file", "\nline2\r\n");
+
+	lines = vcache_lookup(SANDBOX_PATH "/file", NULL, MF_NONE, VK_TEXTUAL, 10,
+			VC_SYNC, &error);
+	assert_string_equal(NULL, error);
+	assert_int_equal(2, lines.nitems);
+	assert_string_equal("line1", lines.items[0]);
+	assert_string_equal("line2", lines.items[1]);
+
+	remove_file(SANDBOX_PATH "/file");
+}
+
+TEST(truncation_of_file_causes_full_reread)
+{
+	make_file(SANDBOX_PATH "/file", "line1\nline2\n");
+
+	strlist_t lines = vcache_lookup(SANDBOX_PATH "/file", NULL, MF_NONE,
+			VK_TEXTUAL, 10, VC_SYNC, &error);
+	assert_string_equal(NULL, error);
+	assert_int_equal(2, lines.nitems);
+
+	make_file(SANDBOX_PATH "/file", "new\n");
+	reset_timestamp(SANDBOX_PATH "/file");
+
+	lines = vcache_lookup(SANDBOX_PATH "/file", NULL, MF_NONE, VK_TEXTUAL, 10,
+			VC_SYNC, &error);
+	assert_string_equal(NULL, error);
+	assert_int_equal(1, lines.nitems);
+	assert_string_equal("new", lines.items[0]);
+
+	remove_file(SANDBOX_PATH "/file");
+}
+
+TEST(rewriting_file_with_more_data_causes_full_reread)
+{
+	make_file(SANDBOX_PATH "/file", "line1\n");
+
+	strlist_t lines = vcache_lookup(SANDBOX_PATH "/file", NULL, MF_NONE,
+			VK_TEXTUAL, 10, VC_SYNC, &error);
+	assert_string_equal(NULL, error);
+	assert_int_equal(1, lines.nitems);
+
+	make_file(SANDBOX_PATH "/file", "other1\nother2\n");
+	reset_timestamp(SANDBOX_PATH "/file");
+
+	lines = vcache_lookup(SANDBOX_PATH "/file", NULL, MF_NONE, VK_TEXTUAL, 10,
+			VC_SYNC, &error);
+	assert_string_equal(NULL, error);
+	assert_int_equal(2, lines.nitems);
+	assert_string_equal("other1", lines.items[0]);
+	assert_string_equal("other2", lines.items[1]);
+
+	remove_file(SANDBOX_PATH "/file");
+}
+
+TEST(extending_reports_number_of_intact_lines)
+{
+	strlist_t lines;
+	assert_int_equal(-1, vcache_extend(SANDBOX_PATH "/file", 10, &lines));
+
+	make_file(SANDBOX_PATH "/file", "line1\nline2");
+
+	lines = vcache_lookup(SANDBOX_PATH "/file", NULL, MF_NONE, VK_TEXTUAL, 10,
+			VC_SYNC, &error);
+	assert_string_equal(NULL, error);
+	assert_int_equal(2, lines.nitems);
+
+	assert_int_equal(2, vcache_extend(SANDBOX_PATH "/file", 10, &lines));
+	assert_int_equal(2, lines.nitems);
+
+	append_to_file(SANDBOX_PATH "/file", "\nline3\n");
+
+	assert_int_equal(1, vcache_extend(SANDBOX_PATH "/file", 10, &lines));
+	assert_int_equal(3, lines.nitems);
+	assert_string_equal("line2", lines.items[1]);
+	assert_string_equal("line3", lines.items[2]);
+
+	make_file(SANDBOX_PATH "/file", "line");
+	assert_int_equal(-1, vcache_extend(SANDBOX_PATH "/file", 10, &lines));
+
+	remove_file(SANDBOX_PATH "/file");
+}
+
+TEST(rotation_of_file_causes_full_reread)
+{
+	make_file(SANDBOX_PATH "/file", "line1\n");
+
+	strlist_t lines = vcache_lookup(SANDBOX_PATH "/file", NULL, MF_NONE,
+			VK_TEXTUAL, 10, VC_SYNC, &error);
+	assert_string_equal(NULL, error);
+	assert_int_equal(1, lines.nitems);
+
+	/* Keep the old file around to make sure its inode isn't reused. */
+	assert_success(rename(SANDBOX_PATH "/file", SANDBOX_PATH "/file.1"));
+	make_file(SANDBOX_PATH "/file", "other1\nother2\n");
+
+	lines = vcache_lookup(SANDBOX_PATH "/file", NULL, MF_NONE, VK_TEXTUAL, 10,
+			VC_SYNC, &error);
+	assert_string_equal(NULL, error);
+	assert_int_equal(2, lines.nitems);
+	assert_string_equal("other1", lines.items[0]);
+	assert_string_equal("other2", lines.items[1]);
+
+	remove_file(SANDBOX_PATH "/file");
+	remove_file(SANDBOX_PATH "/file.1");
+}
+
 TEST(graphics_is_not_cached)
 {
 	preview_area_t parea = { .view = curr_view };
@@ -403,6 +690,102 @@ TEST(kill_all_async_previews_on_exit, IF(not_windows))
 	wait_for_all_bg();
 }
 
+TEST(prefetching_populates_cache)
+{
+	assert_true(vcache_prefetch(TEST_DATA_PATH "/read/two-lines", "echo aaa",
+				MF_NONE, 10));
+	assert_false(vcache_prefetch(TEST_DATA_PATH "/read/two-lines", "echo aaa",
+				MF_NONE, 10));
+
+	assert_true(wait_for_cache());
+
+	assert_false(vcache_prefetch(TEST_DATA_PATH "/read/two-lines", "echo aaa",
+				MF_NONE, 10));
+
+	strlist_t lines = vcache_lookup(TEST_DATA_PATH "/read/two-lines",
+			"echo aaa", MF_NONE, VK_TEXTUAL, 10, VC_ASYNC, &error);
+	assert_string_equal(NULL, error);
+	assert_int_equal(1, lines.nitems);
+	assert_string_equal("aaa", lines.items[0]);
+}
+
+TEST(only_external_viewers_are_prefetched)
+{
+	assert_false(vcache_prefetch(TEST_DATA_PATH "/read/two-lines", NULL,
+				MF_NONE, 10));
+	assert_false(vcache_prefetch(TEST_DATA_PATH "/read/two-lines", "",
+				MF_NONE, 10));
+	assert_false(vcache_prefetch(TEST_DATA_PATH "/read/two-lines",
+				"#vifmtest#vcache", MF_NONE, 10));
+	assert_false(vcache_prefetch(TEST_DATA_PATH "/read/two-lines", "echo aaa",
+				MF_NO_CACHE, 10));
+}
+
+TEST(number_of_prefetches_is_limited, IF(not_windows))
+{
+	assert_true(vcache_prefetch(TEST_DATA_PATH "/read/two-lines", "sleep 10",
+				MF_NONE, 10));
+	assert_true(vcache_prefetch(TEST_DATA_PATH "/read/two-lines", "sleep 11",
+				MF_NONE, 10));
+	assert_false(vcache_prefetch(TEST_DATA_PATH "/read/two-lines", "sleep 12",
+				MF_NONE, 10));
+
+	/* Looked up entry doesn't count as a prefetch. */
+	strlist_t lines = vcache_lookup(TEST_DATA_PATH "/read/two-lines",
+			"sleep 10", MF_NONE, VK_TEXTUAL, 10, VC_ASYNC, &error);
+	assert_string_equal(NULL, error);
+	assert_int_equal(1, lines.nitems);
+	assert_string_equal("[...]", lines.items[0]);
+
+	assert_true(vcache_prefetch(TEST_DATA_PATH "/read/two-lines", "sleep 12",
+				MF_NONE, 10));
+
+	vcache_finish();
+	wait_for_all_bg();
+}
+
+TEST(stale_prefetches_are_cancelled, IF(not_windows))
+{
+	vcache_prefetch_begin();
+	assert_true(vcache_prefetch(TEST_DATA_PATH "/read/two-lines", "sleep 100",
+				MF_NONE, 10));
+	vcache_prefetch_end();
+
+	/* Requesting it again keeps it running. */
+	vcache_prefetch_begin();
+	assert_false(vcache_prefetch(TEST_DATA_PATH "/read/two-lines", "sleep 100",
+				MF_NONE, 10));
+	vcache_prefetch_end();
+	assert_false(vcache_check(&is_previewed));
+
+	vcache_prefetch_begin();
+	vcache_prefetch_end();
+
+	/* Viewer might ignore SIGINT, in which case it's killed after a delay. */
+	int i;
+	for(i = 0; i < 400 && !vcache_check(&is_previewed); ++i)
+	{
+		usleep(10000);
+	}
+	assert_true(i < 400);
+
+	wait_for_all_bg();
+}
+
+/* Appends data to a file making sure that its modification time changes. */
+static void
+append_to_file(const char path[], const char data[])
+{
+	FILE *fp = fopen(path, "ab");
+	assert_non_null(fp);
+	if(fp != NULL)
+	{
+		fputs(data, fp);
+		fclose(fp);
+	}
+	reset_timestamp(path);
+}
+
 static int
 wait_for_cache(void)
 {
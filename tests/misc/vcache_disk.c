@@ -0,0 +1,218 @@
+#include <stic.h>
+
+#include <dirent.h> /* DIR closedir() opendir() readdir() */
+
+#include <string.h> /* memset() */
+
+#include <test-utils.h>
+
+#include "../../src/cfg/config.h"
+#include "../../src/compat/fs_limits.h"
+#include "../../src/utils/fs.h"
+#include "../../src/utils/path.h"
+#include "../../src/utils/str.h"
+#include "../../src/utils/string_array.h"
+#include "../../src/vcache.h"
+#include "../../src/vcache_disk.h"
+
+#define VIEWER_A "echo a >> " SANDBOX_PATH "/log; echo out-a"
+#define VIEWER_B "echo b >> " SANDBOX_PATH "/log; echo out-b"
+
+static void lookup(const char viewer[], const char expected[]);
+static int count_entries(char last[], size_t last_len);
+
+static const char *error;
+
+SETUP()
+{
+	conf_setup();
+	copy_str(cfg.preview_cache_dir, sizeof(cfg.preview_cache_dir),
+			SANDBOX_PATH "/previews");
+
+	vcache_reset(1024*1024);
+	vcache_disk_set_max_size(1024*1024);
+
+	make_file(SANDBOX_PATH "/file", "data");
+}
+
+TEARDOWN()
+{
+	vcache_reset(VCACHE_DEF_MAX_SIZE);
+	vcache_disk_reset();
+	cfg.preview_cache_dir[0] = '\0';
+	conf_teardown();
+
+	char name[NAME_MAX + 1];
+	while(count_entries(name, sizeof(name)) > 0)
+	{
+		char path[PATH_MAX + 1];
+		build_path(path, sizeof(path), SANDBOX_PATH "/previews", name);
+		remove_file(path);
+	}
+	if(is_dir(SANDBOX_PATH "/previews"))
+	{
+		remove_dir(SANDBOX_PATH "/previews");
+	}
+
+	remove_file(SANDBOX_PATH "/file");
+	if(path_exists(SANDBOX_PATH "/log", NODEREF))
+	{
+		remove_file(SANDBOX_PATH "/log");
+	}
+}
+
+TEST(output_survives_restart, IF(not_windows))
+{
+	lookup(VIEWER_A, "out-a");
+	assert_int_equal(1, count_entries(NULL, 0));
+
+	/* Simulate restart by dropping in-memory cache. */
+	vcache_reset(1024*1024);
+
+	lookup(VIEWER_A, "out-a");
+	assert_int_equal(1, vcache_get_stats().disk_hits);
+	assert_int_equal(0, vcache_get_stats().misses);
+
+	const char *lines[] = { "a" };
+	file_is(SANDBOX_PATH "/log", lines, 1);
+}
+
+TEST(modified_file_is_viewed_again, IF(not_windows))
+{
+	lookup(VIEWER_A, "out-a");
+	vcache_reset(1024*1024);
+
+	make_file(SANDBOX_PATH "/file", "more data");
+
+	lookup(VIEWER_A, "out-a");
+	assert_int_equal(0, vcache_get_stats().disk_hits);
+	assert_int_equal(1, vcache_get_stats().misses);
+
+	const char *lines[] = { "a", "a" };
+	file_is(SANDBOX_PATH "/log", lines, 2);
+}
+
+TEST(viewers_are_stored_separately, IF(not_windows))
+{
+	lookup(VIEWER_A, "out-a");
+	lookup(VIEWER_B, "out-b");
+	assert_int_equal(2, count_entries(NULL, 0));
+
+	vcache_reset(1024*1024);
+
+	lookup(VIEWER_B, "out-b");
+	lookup(VIEWER_A, "out-a");
+	assert_int_equal(2, vcache_get_stats().disk_hits);
+
+	const char *lines[] = { "a", "b" };
+	file_is(SANDBOX_PATH "/log", lines, 2);
+}
+
+TEST(nothing_is_stored_by_default, IF(not_windows))
+{
+	vcache_disk_set_max_size(0);
+
+	lookup(VIEWER_A, "out-a");
+	assert_false(is_dir(SANDBOX_PATH "/previews"));
+}
+
+TEST(least_recently_used_entry_is_evicted, IF(not_windows))
+{
+	char name[NAME_MAX + 1];
+	char path[PATH_MAX + 1];
+
+	lookup(VIEWER_A, "out-a");
+	assert_int_equal(1, count_entries(name, sizeof(name)));
+
+	/* Make sure the entry is older than the next one. */
+	build_path(path, sizeof(path), SANDBOX_PATH "/previews", name);
+	reset_timestamp(path);
+
+	/* Room for about one and a half of entries. */
+	vcache_disk_set_max_size(get_file_size(path)*3/2);
+
+	lookup(VIEWER_B, "out-b");
+	assert_int_equal(1, count_entries(NULL, 0));
+
+	vcache_reset(1024*1024);
+
+	lookup(VIEWER_B, "out-b");
+	lookup(VIEWER_A, "out-a");
+	assert_int_equal(1, vcache_get_stats().disk_hits);
+	assert_int_equal(1, vcache_get_stats().misses);
+}
+
+TEST(temporary_files_of_other_instances_are_not_evicted, IF(not_windows))
+{
+	char name[NAME_MAX + 1];
+	char path[PATH_MAX + 1];
+
+	lookup(VIEWER_A, "out-a");
+	assert_int_equal(1, count_entries(name, sizeof(name)));
+	build_path(path, sizeof(path), SANDBOX_PATH "/previews", name);
+	reset_timestamp(path);
+
+	/* Room for about one and a half of entries. */
+	vcache_disk_set_max_size(get_file_size(path)*3/2);
+
+	/* Each of temporary files alone exceeds the limit.  One is being written
+	 * right now, the other one was left behind long ago. */
+	char big[1024];
+	memset(big, 'x', sizeof(big) - 1U);
+	big[sizeof(big) - 1U] = '\0';
+	make_file(SANDBOX_PATH "/previews/0000000000000000.AbCdEf", big);
+	make_file(SANDBOX_PATH "/previews/0000000000000000.GhIjKl", big);
+	reset_timestamp(SANDBOX_PATH "/previews/0000000000000000.GhIjKl");
+
+	lookup(VIEWER_B, "out-b");
+
+	assert_int_equal(2, count_entries(NULL, 0));
+	assert_true(path_exists(SANDBOX_PATH "/previews/0000000000000000.AbCdEf",
+				NODEREF));
+	assert_false(path_exists(SANDBOX_PATH "/previews/0000000000000000.GhIjKl",
+				NODEREF));
+	assert_false(path_exists(path, NODEREF));
+}
+
+/* Performs synchronous lookup and checks its result. */
+static void
+lookup(const char viewer[], const char expected[])
+{
+	strlist_t lines = vcache_lookup(SANDBOX_PATH "/file", viewer, MF_NONE,
+			VK_TEXTUAL, 10, VC_SYNC, &error);
+	assert_string_equal(NULL, error);
+	assert_int_equal(1, lines.nitems);
+	assert_string_equal(expected, lines.items[0]);
+}
+
+/* Counts files in the cache directory and stores name of the last one.
+ * Returns the count. */
+static int
+count_entries(char last[], size_t last_len)
+{
+	DIR *dir = opendir(SANDBOX_PATH "/previews");
+	if(dir == NULL)
+	{
+		return 0;
+	}
+
+	int count = 0;
+	struct dirent *d;
+	while((d = readdir(dir)) != NULL)
+	{
+		if(!is_builtin_dir(d->d_name))
+		{
+			if(last != NULL)
+			{
+				copy_str(last, last_len, d->d_name);
+			}
+			++count;
+		}
+	}
+	closedir(dir);
+
+	return count;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
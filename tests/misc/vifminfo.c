@@ -61,6 +61,8 @@ TEARDOWN()
 	view_teardown(&rwin);
 
 	cfg.vifm_info = 0;
+
+	(void)remove(SANDBOX_PATH "/vifminfo.journal");
 }
 
 TEST(view_sorting_is_read_from_vifminfo)
@@ -267,42 +269,42 @@ TEST(histories_are_merged_correctly)
 	assert_int_equal(3, curr_stats.filter_hist.size);
 	assert_int_equal(3, curr_stats.exprreg_hist.size);
 	assert_int_equal(3, curr_stats.menucmd_hist.size);
-	assert_string_equal("command2", curr_stats.cmd_hist.items[0].text);
-	assert_int_equal(2, curr_stats.cmd_hist.items[0].timestamp);
-	assert_string_equal("command1", curr_stats.cmd_hist.items[1].text);
-	assert_int_equal(1, curr_stats.cmd_hist.items[1].timestamp);
-	assert_string_equal("command0", curr_stats.cmd_hist.items[2].text);
-	assert_int_equal(0, curr_stats.cmd_hist.items[2].timestamp);
-	assert_string_equal("search2", curr_stats.search_hist.items[0].text);
-	assert_int_equal(2, curr_stats.search_hist.items[0].timestamp);
-	assert_string_equal("search1", curr_stats.search_hist.items[1].text);
-	assert_int_equal(1, curr_stats.search_hist.items[1].timestamp);
-	assert_string_equal("search0", curr_stats.search_hist.items[2].text);
-	assert_int_equal(0, curr_stats.search_hist.items[2].timestamp);
-	assert_string_equal("prompt2", curr_stats.prompt_hist.items[0].text);
-	assert_int_equal(2, curr_stats.prompt_hist.items[0].timestamp);
-	assert_string_equal("prompt1", curr_stats.prompt_hist.items[1].text);
-	assert_int_equal(1, curr_stats.prompt_hist.items[1].timestamp);
-	assert_string_equal("prompt0", curr_stats.prompt_hist.items[2].text);
-	assert_int_equal(0, curr_stats.prompt_hist.items[2].timestamp);
-	assert_string_equal("lfilter2", curr_stats.filter_hist.items[0].text);
-	assert_int_equal(2, curr_stats.filter_hist.items[0].timestamp);
-	assert_string_equal("lfilter1", curr_stats.filter_hist.items[1].text);
-	assert_int_equal(1, curr_stats.filter_hist.items[1].timestamp);
-	assert_string_equal("lfilter0", curr_stats.filter_hist.items[2].text);
-	assert_int_equal(0, curr_stats.filter_hist.items[2].timestamp);
-	assert_string_equal("exprreg2", curr_stats.exprreg_hist.items[0].text);
-	assert_int_equal(2, curr_stats.exprreg_hist.items[0].timestamp);
-	assert_string_equal("exprreg1", curr_stats.exprreg_hist.items[1].text);
-	assert_int_equal(1, curr_stats.exprreg_hist.items[1].timestamp);
-	assert_string_equal("exprreg0", curr_stats.exprreg_hist.items[2].text);
-	assert_int_equal(0, curr_stats.exprreg_hist.items[2].timestamp);
-	assert_string_equal("menucmd2", curr_stats.menucmd_hist.items[0].text);
-	assert_int_equal(2, curr_stats.menucmd_hist.items[0].timestamp);
-	assert_string_equal("menucmd1", curr_stats.menucmd_hist.items[1].text);
-	assert_int_equal(1, curr_stats.menucmd_hist.items[1].timestamp);
-	assert_string_equal("menucmd0", curr_stats.menucmd_hist.items[2].text);
-	assert_int_equal(0, curr_stats.menucmd_hist.items[2].timestamp);
+	assert_string_equal("command2", hist_get(&curr_stats.cmd_hist, 0)->text);
+	assert_int_equal(2, hist_get(&curr_stats.cmd_hist, 0)->timestamp);
+	assert_string_equal("command1", hist_get(&curr_stats.cmd_hist, 1)->text);
+	assert_int_equal(1, hist_get(&curr_stats.cmd_hist, 1)->timestamp);
+	assert_string_equal("command0", hist_get(&curr_stats.cmd_hist, 2)->text);
+	assert_int_equal(0, hist_get(&curr_stats.cmd_hist, 2)->timestamp);
+	assert_string_equal("search2", hist_get(&curr_stats.search_hist, 0)->text);
+	assert_int_equal(2, hist_get(&curr_stats.search_hist, 0)->timestamp);
+	assert_string_equal("search1", hist_get(&curr_stats.search_hist, 1)->text);
+	assert_int_equal(1, hist_get(&curr_stats.search_hist, 1)->timestamp);
+	assert_string_equal("search0", hist_get(&curr_stats.search_hist, 2)->text);
+	assert_int_equal(0, hist_get(&curr_stats.search_hist, 2)->timestamp);
+	assert_string_equal("prompt2", hist_get(&curr_stats.prompt_hist, 0)->text);
+	assert_int_equal(2, hist_get(&curr_stats.prompt_hist, 0)->timestamp);
+	assert_string_equal("prompt1", hist_get(&curr_stats.prompt_hist, 1)->text);
+	assert_int_equal(1, hist_get(&curr_stats.prompt_hist, 1)->timestamp);
+	assert_string_equal("prompt0", hist_get(&curr_stats.prompt_hist, 2)->text);
+	assert_int_equal(0, hist_get(&curr_stats.prompt_hist, 2)->timestamp);
+	assert_string_equal("lfilter2", hist_get(&curr_stats.filter_hist, 0)->text);
+	assert_int_equal(2, hist_get(&curr_stats.filter_hist, 0)->timestamp);
+	assert_string_equal("lfilter1", hist_get(&curr_stats.filter_hist, 1)->text);
+	assert_int_equal(1, hist_get(&curr_stats.filter_hist, 1)->timestamp);
+	assert_string_equal("lfilter0", hist_get(&curr_stats.filter_hist, 2)->text);
+	assert_int_equal(0, hist_get(&curr_stats.filter_hist, 2)->timestamp);
+	assert_string_equal("exprreg2", hist_get(&curr_stats.exprreg_hist, 0)->text);
+	assert_int_equal(2, hist_get(&curr_stats.exprreg_hist, 0)->timestamp);
+	assert_string_equal("exprreg1", hist_get(&curr_stats.exprreg_hist, 1)->text);
+	assert_int_equal(1, hist_get(&curr_stats.exprreg_hist, 1)->timestamp);
+	assert_string_equal("exprreg0", hist_get(&curr_stats.exprreg_hist, 2)->text);
+	assert_int_equal(0, hist_get(&curr_stats.exprreg_hist, 2)->timestamp);
+	assert_string_equal("menucmd2", hist_get(&curr_stats.menucmd_hist, 0)->text);
+	assert_int_equal(2, hist_get(&curr_stats.menucmd_hist, 0)->timestamp);
+	assert_string_equal("menucmd1", hist_get(&curr_stats.menucmd_hist, 1)->text);
+	assert_int_equal(1, hist_get(&curr_stats.menucmd_hist, 1)->timestamp);
+	assert_string_equal("menucmd0", hist_get(&curr_stats.menucmd_hist, 2)->text);
+	assert_int_equal(0, hist_get(&curr_stats.menucmd_hist, 2)->timestamp);
 
 	assert_success(remove(SANDBOX_PATH "/vifminfo.json"));
 }
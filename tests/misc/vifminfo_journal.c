@@ -0,0 +1,166 @@
+#include <stic.h>
+
+#include <stdio.h> /* remove() rename() snprintf() */
+
+#include <test-utils.h>
+
+#include "../../src/cfg/config.h"
+#include "../../src/cfg/info.h"
+#include "../../src/utils/fs.h"
+#include "../../src/utils/hist.h"
+#include "../../src/utils/parson.h"
+#include "../../src/utils/str.h"
+#include "../../src/utils/string_array.h"
+#include "../../src/status.h"
+
+static int count_stored_commands(void);
+
+static char *saved_locale;
+
+SETUP_ONCE()
+{
+	make_abs_path(cfg.config_dir, sizeof(cfg.config_dir), SANDBOX_PATH, "", NULL);
+	saved_locale = drop_locale();
+}
+
+TEARDOWN_ONCE()
+{
+	cfg.config_dir[0] = '\0';
+	restore_locale(saved_locale);
+}
+
+SETUP()
+{
+	cfg_resize_histories(10);
+	cfg.vifm_info = VINFO_CHISTORY;
+
+	/* Other fixtures can leave these behind. */
+	(void)remove(SANDBOX_PATH "/vifminfo.journal");
+	(void)remove(SANDBOX_PATH "/vifminfo.json");
+
+	hist_add(&curr_stats.cmd_hist, "command0", 0);
+	write_info_file();
+}
+
+TEARDOWN()
+{
+	cfg_resize_histories(0);
+	cfg.vifm_info = 0;
+
+	(void)remove(SANDBOX_PATH "/vifminfo.journal");
+	remove_file(SANDBOX_PATH "/vifminfo.json");
+}
+
+TEST(unchanged_state_is_not_written)
+{
+	write_info_file();
+	assert_false(path_exists(SANDBOX_PATH "/vifminfo.journal", NODEREF));
+}
+
+TEST(changes_are_appended_to_journal)
+{
+	hist_add(&curr_stats.cmd_hist, "command1", 1);
+	write_info_file();
+	hist_add(&curr_stats.cmd_hist, "command2", 2);
+	write_info_file();
+
+	assert_true(path_exists(SANDBOX_PATH "/vifminfo.journal", NODEREF));
+	assert_int_equal(1, count_stored_commands());
+
+	cfg_resize_histories(0);
+	cfg_resize_histories(10);
+	state_load(0);
+
+	assert_int_equal(3, curr_stats.cmd_hist.size);
+	assert_string_equal("command2", hist_get(&curr_stats.cmd_hist, 0)->text);
+	assert_string_equal("command1", hist_get(&curr_stats.cmd_hist, 1)->text);
+	assert_string_equal("command0", hist_get(&curr_stats.cmd_hist, 2)->text);
+}
+
+TEST(removals_are_journaled)
+{
+	cfg.vifm_info = 0;
+	write_info_file();
+
+	const char *lines[] = { "{\"cmd-hist\":null}" };
+	int nlines;
+	char **journal = read_file_of_lines(SANDBOX_PATH "/vifminfo.journal",
+			&nlines);
+	assert_int_equal(2, nlines);
+	assert_string_equal(lines[0], journal[1]);
+	free_string_array(journal, nlines);
+}
+
+TEST(journal_of_replaced_file_is_ignored)
+{
+	hist_add(&curr_stats.cmd_hist, "command1", 1);
+	write_info_file();
+
+	copy_file(SANDBOX_PATH "/vifminfo.json", SANDBOX_PATH "/copy");
+	assert_success(rename(SANDBOX_PATH "/copy", SANDBOX_PATH "/vifminfo.json"));
+
+	cfg_resize_histories(0);
+	cfg_resize_histories(10);
+	state_load(0);
+
+	assert_int_equal(1, curr_stats.cmd_hist.size);
+	assert_string_equal("command0", hist_get(&curr_stats.cmd_hist, 0)->text);
+}
+
+TEST(journal_is_merged_if_files_changed_elsewhere)
+{
+	hist_add(&curr_stats.cmd_hist, "command2", 2);
+	write_info_file();
+
+	cfg_resize_histories(0);
+	cfg_resize_histories(10);
+	hist_add(&curr_stats.cmd_hist, "command1", 1);
+
+	reset_timestamp(SANDBOX_PATH "/vifminfo.journal");
+	write_info_file();
+
+	assert_false(path_exists(SANDBOX_PATH "/vifminfo.journal", NODEREF));
+	assert_int_equal(3, count_stored_commands());
+}
+
+TEST(journal_is_compacted_eventually)
+{
+	int i;
+	for(i = 1; i <= 40; ++i)
+	{
+		char cmd[16];
+		snprintf(cmd, sizeof(cmd), "command%d", i);
+		hist_add(&curr_stats.cmd_hist, cmd, i);
+		write_info_file();
+	}
+
+	int nlines;
+	char **journal = read_file_of_lines(SANDBOX_PATH "/vifminfo.journal",
+			&nlines);
+	assert_int_equal(8, nlines);
+	free_string_array(journal, nlines);
+
+	cfg_resize_histories(0);
+	cfg_resize_histories(10);
+	state_load(0);
+
+	assert_int_equal(10, curr_stats.cmd_hist.size);
+	assert_string_equal("command40", hist_get(&curr_stats.cmd_hist, 0)->text);
+	assert_string_equal("command31", hist_get(&curr_stats.cmd_hist, 9)->text);
+}
+
+/* Counts entries of command-line history in vifminfo.json ignoring journal.
+ * Returns the number. */
+static int
+count_stored_commands(void)
+{
+	JSON_Value *value = json_parse_file(SANDBOX_PATH "/vifminfo.json");
+	assert_non_null(value);
+	JSON_Array *hist = json_object_get_array(json_object(value), "cmd-hist");
+	const int count = json_array_get_count(hist);
+	json_value_free(value);
+	return count;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -63,6 +63,7 @@ TEARDOWN()
 	tabs_only(&lwin);
 
 	assert_success(remove(SANDBOX_PATH "/vifminfo.json"));
+	(void)remove(SANDBOX_PATH "/vifminfo.journal");
 
 	cfg.vifm_info = 0;
 }
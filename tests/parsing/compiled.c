@@ -0,0 +1,198 @@
+#include <stic.h>
+
+#include <string.h> /* strlen() */
+
+#include "../../src/engine/functions.h"
+#include "../../src/engine/options.h"
+#include "../../src/engine/parsing.h"
+#include "../../src/engine/variables.h"
+#include "../../src/engine/var.h"
+#include "../../src/utils/macros.h"
+
+#include "asserts.h"
+
+static const char * getenv_value(const char name[]);
+static void dummy_handler(OPT_OP op, optval_t val);
+static var_t count_builtin(const call_info_t *call_info);
+static var_t nested_builtin(const call_info_t *call_info);
+
+static const char *sort_enum[][2] = {
+	{ "ext",  "descr" },
+	{ "name", "descr" },
+	{ "size", "descr" },
+};
+
+static const char *vifminfo_set[][2] = {
+	{ "options", "descr" },
+	{ "tui",     "descr" },
+	{ "cs",      "descr" },
+};
+
+static const char *env_value;
+static int ncalls;
+static int nesting;
+
+SETUP()
+{
+	static const function_t count_func = { "count", "descr", {0,0},
+		&count_builtin };
+	static const function_t nested_func = { "nested", "descr", {0,0},
+		&nested_builtin };
+	assert_success(function_register(&count_func));
+	assert_success(function_register(&nested_func));
+
+	init_variables();
+	vle_parser_init(&getenv_value);
+
+	static int option_changed;
+	optval_t val;
+
+	vle_opts_init(&option_changed, NULL);
+
+	val.int_val = 2;
+	vle_opts_add("tabstop", "ts", "descr", OPT_INT, OPT_GLOBAL, 0, NULL,
+			&dummy_handler, val);
+
+	val.enum_item = 1;
+	vle_opts_add("sort", "so", "descr", OPT_ENUM, OPT_GLOBAL,
+			ARRAY_LEN(sort_enum), sort_enum, &dummy_handler, val);
+
+	val.set_items = 0x5;
+	vle_opts_add("vifminfo", "", "descr", OPT_SET, OPT_GLOBAL,
+			ARRAY_LEN(vifminfo_set), vifminfo_set, &dummy_handler, val);
+
+	env_value = "env";
+	ncalls = 0;
+	nesting = 0;
+}
+
+TEARDOWN()
+{
+	vle_opts_reset();
+	clear_variables();
+	function_reset_all();
+}
+
+static const char *
+getenv_value(const char name[])
+{
+	return env_value;
+}
+
+static void
+dummy_handler(OPT_OP op, optval_t val)
+{
+}
+
+static var_t
+count_builtin(const call_info_t *call_info)
+{
+	return var_from_int(++ncalls);
+}
+
+static var_t
+nested_builtin(const call_info_t *call_info)
+{
+	if(nesting != 0)
+	{
+		return var_from_str("b");
+	}
+
+	++nesting;
+	parsing_result_t result = vle_parser_eval("'a' . nested()",
+			/*interactive=*/0);
+	--nesting;
+
+	return result.value;
+}
+
+TEST(reevaluation_sees_changes_of_references)
+{
+	optval_t val;
+
+	assert_success(let_variables("g:var = 'var'"));
+	ASSERT_OK("&ts . &sort . &vifminfo . g:var . $ENV",
+			"2nameoptions,csvarenv");
+
+	val.int_val = 4;
+	vle_opts_assign("tabstop", val, OPT_GLOBAL);
+	val.enum_item = 2;
+	vle_opts_assign("sort", val, OPT_GLOBAL);
+	val.set_items = 0x2;
+	vle_opts_assign("vifminfo", val, OPT_GLOBAL);
+	assert_success(let_variables("g:var = 'new'"));
+	env_value = "ENV";
+	ASSERT_OK("&ts . &sort . &vifminfo . g:var . $ENV", "4sizetuinewENV");
+}
+
+TEST(missing_reference_is_reported_as_by_parsing)
+{
+	assert_success(let_variables("g:var = 1"));
+	ASSERT_OK("1 . g:var", "11");
+
+	assert_success(unlet_variables("g:var"));
+	ASSERT_FAIL_AT("1 . g:var", "1 . g:var", PE_INVALID_EXPRESSION);
+	ASSERT_FAIL_AT("1 . g:var", "1 . g:var", PE_INVALID_EXPRESSION);
+
+	assert_success(let_variables("g:var = 2"));
+	ASSERT_OK("1 . g:var", "12");
+}
+
+TEST(functions_are_called_on_each_evaluation)
+{
+	ASSERT_OK("count() . count()", "12");
+	ASSERT_OK("count() . count()", "34");
+}
+
+TEST(laziness_is_preserved_on_reevaluation)
+{
+	ASSERT_OK("1 || count()", "1");
+	ASSERT_OK("1 || count()", "1");
+	ASSERT_OK("0 && count() && count()", "0");
+	ASSERT_OK("0 && count() && count()", "0");
+	assert_int_equal(0, ncalls);
+
+	ASSERT_OK("count() && 0 || count() == 2", "1");
+	ASSERT_OK("count() && 0 || count() == 2", "0");
+	assert_int_equal(4, ncalls);
+}
+
+TEST(removed_function_is_reported)
+{
+	ASSERT_OK("count()", "1");
+	function_reset_all();
+	ASSERT_FAIL("count()", PE_INVALID_EXPRESSION);
+}
+
+TEST(constant_parts_are_computed_correctly)
+{
+	ASSERT_OK("(1 + 2) . 'x' . -(3 - 1) . !0", "3x-21");
+	ASSERT_OK("(1 + 2) . 'x' . -(3 - 1) . !0", "3x-21");
+	ASSERT_OK("'a' < 'b' && (2 > 1 || count())", "1");
+	ASSERT_OK("'a' < 'b' && (2 > 1 || count())", "1");
+	assert_int_equal(0, ncalls);
+}
+
+TEST(same_expression_can_be_evaluated_recursively)
+{
+	ASSERT_OK("'a' . nested()", "aab");
+	ASSERT_OK("'a' . nested()", "aab");
+}
+
+TEST(position_info_is_the_same_on_reevaluation)
+{
+	int i;
+	for(i = 0; i < 2; ++i)
+	{
+		const char *const expr = "'a' ";
+		parsing_result_t result = vle_parser_eval(expr, /*interactive=*/0);
+		assert_int_equal(PE_NO_ERROR, result.error);
+		assert_true(result.ends_with_whitespace);
+		assert_true(result.last_position == expr + strlen(expr));
+		assert_true(result.last_parsed_char == expr + strlen(expr));
+		var_free(result.value);
+	}
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
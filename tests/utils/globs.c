@@ -0,0 +1,167 @@
+#include <stic.h>
+
+#include <regex.h> /* REG_EXTENDED REG_ICASE regcomp() regexec() regfree() */
+
+#include <stdio.h> /* printf() snprintf() */
+#include <stdlib.h> /* free() */
+#include <time.h> /* CLOCKS_PER_SEC clock() clock_t */
+
+#include <test-utils.h>
+
+#include "../../src/utils/globs.h"
+#include "../../src/utils/macros.h"
+
+SETUP_ONCE()
+{
+	try_enable_utf8_locale();
+}
+
+TEST(literals_are_matched_ignoring_case)
+{
+	assert_true(glob_matches("Makefile", "makefile", 0));
+	assert_true(glob_matches("makefile", "MAKEFILE", 0));
+	assert_false(glob_matches("makefile", "makefile.am", 0));
+	assert_false(glob_matches("makefile.am", "makefile", 0));
+}
+
+TEST(non_ascii_letters_are_matched_ignoring_case, IF(utf8_locale))
+{
+	assert_true(glob_matches("ЯБЛОКО.txt", "яблоко.TXT", 0));
+	assert_true(glob_matches("?блоко", "Яблоко", 0));
+	assert_false(glob_matches("??блоко", "Яблоко", 0));
+}
+
+TEST(question_mark_matches_single_character)
+{
+	assert_true(glob_matches("a?c", "abc", 0));
+	assert_true(glob_matches("a?c", "a/c", 0));
+	assert_false(glob_matches("a?c", "ac", 0));
+	assert_false(glob_matches("a?c", "abbc", 0));
+}
+
+TEST(asterisk_matches_any_sequence)
+{
+	assert_true(glob_matches("a*", "a", 0));
+	assert_true(glob_matches("a*c", "abbbc", 0));
+	assert_true(glob_matches("a*b*c", "a/b/c", 0));
+	assert_true(glob_matches("a*a*a*a*b", "aaaaaaaaaaaaaaaaaaaab", 0));
+	assert_false(glob_matches("a*a*a*a*b", "aaaaaaaaaaaaaaaaaaaaa", 0));
+}
+
+TEST(leading_asterisk_needs_character_that_is_not_a_dot)
+{
+	assert_true(glob_matches("*.c", "a.c", 0));
+	assert_false(glob_matches("*.c", ".c", 0));
+	assert_false(glob_matches("*.c", ".a.c", 0));
+	assert_false(glob_matches("*", "", 0));
+}
+
+TEST(bracket_expressions)
+{
+	assert_true(glob_matches("[abc]", "B", 0));
+	assert_false(glob_matches("[abc]", "d", 0));
+	assert_true(glob_matches("[!abc]", "d", 0));
+	assert_true(glob_matches("[^abc]", "d", 0));
+	assert_false(glob_matches("[!abc]", "a", 0));
+	assert_true(glob_matches("[a-c]x", "Bx", 0));
+	assert_true(glob_matches("[A-C]x", "bx", 0));
+	assert_true(glob_matches("[]]", "]", 0));
+	assert_true(glob_matches("[a-]", "-", 0));
+	assert_true(glob_matches("[[:digit:]]*", "1abc", 0));
+	assert_false(glob_matches("[[:digit:]]*", "abc", 0));
+	assert_true(glob_matches("[[:upper:]]", "a", 0));
+}
+
+TEST(backslash_escapes_special_characters)
+{
+	assert_true(glob_matches("a\\*", "a*", 0));
+	assert_false(glob_matches("a\\*", "ab", 0));
+	assert_true(glob_matches("\\[a]", "[a]", 0));
+	assert_true(glob_matches("a\\", "a\\", 0));
+}
+
+TEST(extended_asterisks)
+{
+	assert_true(glob_matches("/a/*", "/a/b", 1));
+	assert_false(glob_matches("/a/*", "/a/b/c", 1));
+	assert_true(glob_matches("/a/**", "/a/b/c", 1));
+	assert_true(glob_matches("*", ".a", 1));
+	assert_true(glob_matches("/a/**/b", "/a/b", 1));
+	assert_true(glob_matches("/a/**/b", "/a/x/y/b", 1));
+	assert_false(glob_matches("/a/**/b", "/a/xb", 1));
+	assert_true(glob_matches("/a/**/", "/a", 1));
+}
+
+TEST(list_of_globs)
+{
+	assert_true(globs_match("*.c,*.h", "a.h"));
+	assert_true(globs_match("*.c, *.h", "a.h"));
+	assert_false(globs_match("*.c,*.h", "a.cpp"));
+	assert_true(globs_match("a,,b", "a,b"));
+	assert_false(globs_match("a,,b", "a"));
+	assert_true(globs_match("[,,]", ","));
+	assert_false(globs_match("", ""));
+	assert_false(globs_match(" ,", " "));
+}
+
+TEST(malformed_globs_are_reported)
+{
+	assert_null(globs_check("*.[ch],[[:alpha:]]*"));
+	assert_non_null(globs_check("*.c,[ab"));
+	assert_non_null(globs_check("[a,b]"));
+	assert_non_null(globs_check("[z-a]"));
+	assert_non_null(globs_check("[[:nosuchclass:]]"));
+
+	assert_null(glob_check("[a,b]"));
+	assert_non_null(glob_check("[ab"));
+}
+
+TEST(native_matching_benchmark)
+{
+	enum { NNAMES = 20000 };
+	static const char *const exts[] = {
+		"c", "h", "cpp", "txt", "tar.gz", "bak", "jpg", "md",
+	};
+	static char names[NNAMES][32];
+	const char *const globs = "*.[ch],*.cpp,[Mm]akefile*,*~,?*.bak,*.tar.*";
+
+	int i;
+	for(i = 0; i < NNAMES; ++i)
+	{
+		snprintf(names[i], sizeof(names[i]), "%sFile_%d.%s", (i%7 == 0) ? "." : "",
+				i, exts[i%ARRAY_LEN(exts)]);
+	}
+
+	char *const re = globs_to_regex(globs);
+	regex_t regex;
+	assert_int_equal(0, regcomp(&regex, re, REG_EXTENDED | REG_ICASE));
+	free(re);
+
+	int regex_matches = 0;
+	const clock_t regex_start = clock();
+	for(i = 0; i < NNAMES; ++i)
+	{
+		regex_matches += (regexec(&regex, names[i], 0, NULL, 0) == 0);
+	}
+	const clock_t regex_time = clock() - regex_start;
+	regfree(&regex);
+
+	int native_matches = 0;
+	const clock_t native_start = clock();
+	for(i = 0; i < NNAMES; ++i)
+	{
+		native_matches += globs_match(globs, names[i]);
+	}
+	const clock_t native_time = clock() - native_start;
+
+	assert_true(native_matches > 0);
+	assert_int_equal(regex_matches, native_matches);
+
+	/* Timings are only reported, because they are too noisy to be checked on
+	 * loaded machines or under valgrind and sanitizers. */
+	printf("globs_match() on %d names: %.2f ms (regex: %.2f ms)\n", NNAMES,
+			1000.0*native_time/CLOCKS_PER_SEC, 1000.0*regex_time/CLOCKS_PER_SEC);
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -0,0 +1,183 @@
+#include <stic.h>
+
+#include <stdio.h> /* snprintf() */
+
+#include "../../src/utils/hist.h"
+
+static hist_t hist;
+
+SETUP()
+{
+	assert_success(hist_init(&hist, 3));
+}
+
+TEARDOWN()
+{
+	hist_reset(&hist);
+}
+
+TEST(items_are_added_to_the_front)
+{
+	assert_true(hist_is_empty(&hist));
+
+	assert_success(hist_add(&hist, "a", 1));
+	assert_success(hist_add(&hist, "b", 2));
+
+	assert_int_equal(2, hist.size);
+	assert_string_equal("b", hist_get(&hist, 0)->text);
+	assert_int_equal(2, hist_get(&hist, 0)->timestamp);
+	assert_string_equal("a", hist_get(&hist, 1)->text);
+	assert_int_equal(1, hist_get(&hist, 1)->timestamp);
+}
+
+TEST(empty_items_are_ignored)
+{
+	assert_success(hist_add(&hist, "", 1));
+	assert_true(hist_is_empty(&hist));
+}
+
+TEST(oldest_item_is_dropped_when_full)
+{
+	assert_success(hist_add(&hist, "a", 1));
+	assert_success(hist_add(&hist, "b", 2));
+	assert_success(hist_add(&hist, "c", 3));
+	assert_success(hist_add(&hist, "d", 4));
+	assert_success(hist_add(&hist, "e", 5));
+
+	assert_int_equal(3, hist.size);
+	assert_string_equal("e", hist_get(&hist, 0)->text);
+	assert_string_equal("d", hist_get(&hist, 1)->text);
+	assert_string_equal("c", hist_get(&hist, 2)->text);
+
+	/* Dropped item isn't found anymore. */
+	assert_success(hist_add(&hist, "a", 6));
+	assert_string_equal("a", hist_get(&hist, 0)->text);
+	assert_string_equal("e", hist_get(&hist, 1)->text);
+	assert_string_equal("d", hist_get(&hist, 2)->text);
+}
+
+TEST(existing_item_is_moved_to_the_front)
+{
+	assert_success(hist_add(&hist, "a", 1));
+	assert_success(hist_add(&hist, "b", 2));
+	assert_success(hist_add(&hist, "c", 3));
+	assert_success(hist_add(&hist, "a", 4));
+
+	assert_int_equal(3, hist.size);
+	assert_string_equal("a", hist_get(&hist, 0)->text);
+	assert_int_equal(4, hist_get(&hist, 0)->timestamp);
+	assert_string_equal("c", hist_get(&hist, 1)->text);
+	assert_string_equal("b", hist_get(&hist, 2)->text);
+
+	assert_success(hist_add(&hist, "b", 5));
+	assert_string_equal("b", hist_get(&hist, 0)->text);
+	assert_string_equal("a", hist_get(&hist, 1)->text);
+	assert_string_equal("c", hist_get(&hist, 2)->text);
+}
+
+TEST(re_adding_first_item_keeps_its_timestamp)
+{
+	assert_success(hist_add(&hist, "a", 1));
+	assert_success(hist_add(&hist, "a", 2));
+
+	assert_int_equal(1, hist.size);
+	assert_int_equal(1, hist_get(&hist, 0)->timestamp);
+}
+
+TEST(resizing_preserves_order)
+{
+	assert_success(hist_add(&hist, "a", 1));
+	assert_success(hist_add(&hist, "b", 2));
+	assert_success(hist_add(&hist, "c", 3));
+
+	hist_resize(&hist, 5);
+	assert_success(hist_add(&hist, "d", 4));
+	assert_int_equal(4, hist.size);
+	assert_string_equal("d", hist_get(&hist, 0)->text);
+	assert_string_equal("a", hist_get(&hist, 3)->text);
+
+	hist_resize(&hist, 2);
+	assert_int_equal(2, hist.size);
+	assert_string_equal("d", hist_get(&hist, 0)->text);
+	assert_string_equal("c", hist_get(&hist, 1)->text);
+
+	/* Truncated items aren't found anymore. */
+	assert_success(hist_add(&hist, "a", 5));
+	assert_string_equal("a", hist_get(&hist, 0)->text);
+	assert_string_equal("d", hist_get(&hist, 1)->text);
+
+	hist_resize(&hist, 0);
+	assert_true(hist_is_empty(&hist));
+	assert_success(hist_add(&hist, "a", 6));
+	assert_true(hist_is_empty(&hist));
+
+	hist_resize(&hist, 1);
+	assert_success(hist_add(&hist, "a", 7));
+	assert_string_equal("a", hist_get(&hist, 0)->text);
+}
+
+TEST(growing_by_one_keeps_all_items)
+{
+	int i;
+	for(i = 0; i < 100; ++i)
+	{
+		char text[16];
+		snprintf(text, sizeof(text), "%d", i);
+
+		if(hist.size == hist.capacity)
+		{
+			hist_resize(&hist, hist.capacity + 1);
+		}
+		assert_success(hist_add(&hist, text, i));
+	}
+
+	assert_int_equal(100, hist.size);
+	for(i = 0; i < 100; ++i)
+	{
+		char text[16];
+		snprintf(text, sizeof(text), "%d", 99 - i);
+		assert_string_equal(text, hist_get(&hist, i)->text);
+	}
+
+	assert_success(hist_add(&hist, "50", 100));
+	assert_string_equal("50", hist_get(&hist, 0)->text);
+	assert_string_equal("99", hist_get(&hist, 1)->text);
+	assert_string_equal("51", hist_get(&hist, 49)->text);
+	assert_string_equal("49", hist_get(&hist, 50)->text);
+	assert_int_equal(100, hist.size);
+}
+
+TEST(growing_by_one_rarely_reallocates)
+{
+	int nreallocs = 0;
+
+	int i;
+	for(i = 0; i < 1000; ++i)
+	{
+		const int allocated = hist.allocated;
+		hist_resize(&hist, hist.capacity + 1);
+		assert_int_equal(3 + i + 1, hist.capacity);
+		assert_true(hist.capacity <= hist.allocated);
+		if(hist.allocated != allocated)
+		{
+			++nreallocs;
+		}
+	}
+
+	assert_true(nreallocs <= 10);
+}
+
+TEST(shrinking_frees_memory)
+{
+	hist_resize(&hist, 100);
+	hist_resize(&hist, 90);
+	assert_int_equal(100, hist.allocated);
+	assert_int_equal(90, hist.capacity);
+
+	hist_resize(&hist, 10);
+	assert_int_equal(10, hist.allocated);
+	assert_int_equal(10, hist.capacity);
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -0,0 +1,157 @@
+#include <stic.h>
+
+#include <stddef.h> /* NULL */
+#include <stdio.h> /* snprintf() */
+
+#include "../../src/utils/hmap.h"
+
+TEST(freeing_null_hmap_is_ok)
+{
+	hmap_free(NULL);
+}
+
+TEST(null_hmap_is_empty)
+{
+	assert_failure(hmap_get(NULL, "key", NULL));
+}
+
+TEST(new_hmap_is_empty)
+{
+	hmap_t *const hmap = hmap_create();
+	assert_non_null(hmap);
+
+	assert_int_equal(0, hmap_size(hmap));
+	assert_failure(hmap_get(hmap, "", NULL));
+	assert_failure(hmap_get(hmap, "key", NULL));
+
+	hmap_free(hmap);
+}
+
+TEST(set_and_get)
+{
+	int a, b;
+	void *data;
+
+	hmap_t *const hmap = hmap_create();
+
+	assert_success(hmap_set(hmap, "a", &a));
+	assert_success(hmap_set(hmap, "b", &b));
+	assert_int_equal(2, hmap_size(hmap));
+
+	assert_success(hmap_get(hmap, "a", &data));
+	assert_true(data == &a);
+	assert_success(hmap_get(hmap, "b", &data));
+	assert_true(data == &b);
+	assert_success(hmap_get(hmap, "b", NULL));
+	assert_failure(hmap_get(hmap, "c", &data));
+
+	hmap_free(hmap);
+}
+
+TEST(set_replaces_data)
+{
+	int a, b;
+	void *data;
+
+	hmap_t *const hmap = hmap_create();
+
+	assert_success(hmap_set(hmap, "key", &a));
+	assert_success(hmap_set(hmap, "key", &b));
+	assert_int_equal(1, hmap_size(hmap));
+
+	assert_success(hmap_get(hmap, "key", &data));
+	assert_true(data == &b);
+
+	hmap_free(hmap);
+}
+
+TEST(remove_deletes_only_specified_key)
+{
+	int a, b;
+	void *data;
+
+	hmap_t *const hmap = hmap_create();
+
+	assert_success(hmap_set(hmap, "a", &a));
+	assert_success(hmap_set(hmap, "b", &b));
+
+	assert_success(hmap_remove(hmap, "a"));
+	assert_failure(hmap_remove(hmap, "a"));
+	assert_int_equal(1, hmap_size(hmap));
+
+	assert_failure(hmap_get(hmap, "a", &data));
+	assert_success(hmap_get(hmap, "b", &data));
+	assert_true(data == &b);
+
+	hmap_free(hmap);
+}
+
+TEST(clear_removes_everything)
+{
+	int a;
+
+	hmap_t *const hmap = hmap_create();
+
+	assert_success(hmap_set(hmap, "a", &a));
+	assert_success(hmap_set(hmap, "b", &a));
+	hmap_clear(hmap);
+	assert_int_equal(0, hmap_size(hmap));
+	assert_failure(hmap_get(hmap, "a", NULL));
+	assert_failure(hmap_get(hmap, "b", NULL));
+
+	assert_success(hmap_set(hmap, "a", &a));
+	assert_int_equal(1, hmap_size(hmap));
+
+	hmap_free(hmap);
+}
+
+TEST(growing_preserves_elements)
+{
+	enum { N = 1000 };
+	int items[N];
+	char key[16];
+	int i;
+	void *data;
+
+	hmap_t *const hmap = hmap_create();
+
+	for(i = 0; i < N; ++i)
+	{
+		snprintf(key, sizeof(key), "key%d", i);
+		assert_success(hmap_set(hmap, key, &items[i]));
+	}
+	assert_int_equal(N, hmap_size(hmap));
+
+	for(i = 0; i < N; ++i)
+	{
+		snprintf(key, sizeof(key), "key%d", i);
+		assert_success(hmap_get(hmap, key, &data));
+		assert_true(data == &items[i]);
+	}
+
+	for(i = 0; i < N; i += 2)
+	{
+		snprintf(key, sizeof(key), "key%d", i);
+		assert_success(hmap_remove(hmap, key));
+	}
+	assert_int_equal(N/2, hmap_size(hmap));
+
+	for(i = 0; i < N; ++i)
+	{
+		snprintf(key, sizeof(key), "key%d", i);
+		if(i%2 == 0)
+		{
+			assert_failure(hmap_get(hmap, key, &data));
+		}
+		else
+		{
+			assert_success(hmap_get(hmap, key, &data));
+			assert_true(data == &items[i]);
+		}
+	}
+
+	hmap_free(hmap);
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -0,0 +1,228 @@
+#include <stic.h>
+
+#include <stddef.h> /* NULL */
+
+#include "../../src/utils/macros.h"
+#include "../../src/utils/matchers.h"
+#include "../../src/utils/matchers_index.h"
+
+static void add(const char expr[]);
+static int find(const char path[]);
+static int find_linearly(const char path[], int from);
+
+static matchers_index_t *mi;
+static matchers_t *rules[16];
+static int nrules;
+
+SETUP()
+{
+	mi = matchers_index_create();
+	assert_non_null(mi);
+	nrules = 0;
+}
+
+TEARDOWN()
+{
+	matchers_index_free(mi);
+
+	int i;
+	for(i = 0; i < nrules; ++i)
+	{
+		matchers_free(rules[i]);
+	}
+}
+
+TEST(freeing_null_index_is_ok)
+{
+	matchers_index_free(NULL);
+}
+
+TEST(empty_index_matches_nothing)
+{
+	assert_int_equal(-1, find("file"));
+	assert_int_equal(-1, find(""));
+}
+
+TEST(literal_names_are_matched_ignoring_case)
+{
+	add("{Makefile,CMakeLists.txt}");
+
+	assert_int_equal(0, find("Makefile"));
+	assert_int_equal(0, find("makefile"));
+	assert_int_equal(0, find("dir/cmakelists.TXT"));
+	assert_int_equal(-1, find("Makefile.am"));
+	assert_int_equal(-1, find("GNUmakefile"));
+}
+
+TEST(suffixes_are_matched)
+{
+	add("{*.tar.gz}");
+	add("{*.gz,*~}");
+
+	assert_int_equal(0, find("archive.tar.gz"));
+	assert_int_equal(0, find("ARCHIVE.TAR.GZ"));
+	assert_int_equal(1, find("file.gz"));
+	assert_int_equal(1, find("file~"));
+	assert_int_equal(-1, find("file.tar"));
+}
+
+TEST(suffixes_do_not_match_dot_files)
+{
+	add("{*.c}");
+	add("{*}");
+
+	assert_int_equal(0, find("a.c"));
+	assert_int_equal(-1, find(".c"));
+	assert_int_equal(-1, find(".hidden.c"));
+	assert_int_equal(1, find("a"));
+	assert_int_equal(-1, find(".a"));
+}
+
+TEST(prefixes_are_matched)
+{
+	add("{README*}");
+
+	assert_int_equal(0, find("README"));
+	assert_int_equal(0, find("readme.md"));
+	assert_int_equal(-1, find("READ"));
+	assert_int_equal(-1, find("a-readme"));
+}
+
+TEST(directories_are_matched)
+{
+	add("{*/}");
+
+	assert_int_equal(0, find("dir/"));
+	assert_int_equal(0, find("/path/dir/"));
+	assert_int_equal(-1, find("file"));
+}
+
+TEST(double_comma_is_literal_comma)
+{
+	add("{a,,b}");
+
+	assert_int_equal(0, find("a,b"));
+	assert_int_equal(-1, find("a"));
+	assert_int_equal(-1, find("b"));
+}
+
+TEST(order_of_rules_is_preserved)
+{
+	add("/^a/");
+	add("{*.c}");
+	add("{[bc]*.cc}");
+
+	assert_int_equal(0, find("a.c"));
+	assert_int_equal(1, find("b.c"));
+	assert_int_equal(2, find("b.cc"));
+	assert_int_equal(-1, find("d.cc"));
+}
+
+TEST(all_matches_can_be_enumerated)
+{
+	add("{*.c}");
+	add("/^x/");
+	add("{x*}");
+	add("{*.h}");
+	add("{X.C}");
+
+	assert_int_equal(0, matchers_index_find(mi, "x.c", 0));
+	assert_int_equal(1, matchers_index_find(mi, "x.c", 1));
+	assert_int_equal(2, matchers_index_find(mi, "x.c", 2));
+	assert_int_equal(4, matchers_index_find(mi, "x.c", 3));
+	assert_int_equal(-1, matchers_index_find(mi, "x.c", 5));
+}
+
+TEST(negated_and_full_path_globs_are_not_indexed)
+{
+	add("!{*.c}");
+	add("{{/tmp/*.c}}");
+
+	assert_int_equal(0, find("a.h"));
+	assert_int_equal(1, find("/tmp/a.c"));
+	assert_int_equal(-1, find("/usr/a.c"));
+}
+
+TEST(group_of_matchers_is_a_disjunction)
+{
+	char *error;
+	matchers_t *group[2];
+	group[0] = matchers_alloc("{*.c}", 0, 1, "", &error);
+	assert_string_equal(NULL, error);
+	group[1] = matchers_alloc("/^Makefile$/", 0, 1, "", &error);
+	assert_string_equal(NULL, error);
+
+	assert_success(matchers_index_add(mi, group, ARRAY_LEN(group)));
+
+	assert_int_equal(0, find("a.c"));
+	assert_int_equal(0, find("Makefile"));
+	assert_int_equal(-1, find("a.h"));
+
+	matchers_free(group[0]);
+	matchers_free(group[1]);
+}
+
+TEST(index_agrees_with_trying_rules_in_turn)
+{
+	add("{*.jpg,*.png}");
+	add("{*.[ch]}");
+	add("/^\\./");
+	add("{*.JPG}");
+	add("{Makefile*}");
+	add("!{*.o}");
+	add("{*.tar.*}");
+	add("{*}");
+
+	const char *names[] = {
+		"a.jpg", "a.PNG", ".a.jpg", "x.c", "x.cc", ".vimrc", "Makefile.in",
+		"lib.o", "a.tar.xz", "a.tar", "noext", "dir/",
+	};
+
+	int i;
+	for(i = 0; i < (int)ARRAY_LEN(names); ++i)
+	{
+		int from;
+		for(from = 0; from <= nrules; ++from)
+		{
+			assert_int_equal(find_linearly(names[i], from),
+					matchers_index_find(mi, names[i], from));
+		}
+	}
+}
+
+/* Creates matchers and adds them to the mi as a rule. */
+static void
+add(const char expr[])
+{
+	char *error;
+	rules[nrules] = matchers_alloc(expr, 0, 1, "", &error);
+	assert_string_equal(NULL, error);
+	assert_success(matchers_index_add(mi, &rules[nrules], 1));
+	++nrules;
+}
+
+/* Looks up first matching rule.  Returns its id or -1. */
+static int
+find(const char path[])
+{
+	return matchers_index_find(mi, path, 0);
+}
+
+/* Looks up first matching rule starting at from without using the mi.
+ * Returns its id or -1. */
+static int
+find_linearly(const char path[], int from)
+{
+	int i;
+	for(i = from; i < nrules; ++i)
+	{
+		if(matchers_match(rules[i], path))
+		{
+			return i;
+		}
+	}
+	return -1;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
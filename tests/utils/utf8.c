@@ -1,14 +1,20 @@
 #include <stic.h>
 
 #include <stddef.h> /* size_t */
+#include <stdio.h> /* printf() snprintf() */
 #include <stdlib.h> /* free() */
-#include <string.h> /* strlen() */
+#include <string.h> /* memset() strcat() strlen() */
+#include <time.h> /* CLOCKS_PER_SEC clock() clock_t */
 #include <wchar.h>
 
 #include <test-utils.h>
 
+#include "../../src/utils/macros.h"
 #include "../../src/utils/str.h"
 #include "../../src/utils/utf8.h"
+#include "../../src/utils/utils.h"
+
+static size_t strsw_by_char(const char str[]);
 
 SETUP_ONCE()
 {
@@ -90,6 +96,117 @@ TEST(utf8_nstrsw_works, IF(utf8_locale))
 	}
 }
 
+TEST(ascii_blocks_are_measured_correctly)
+{
+	/* Non-ASCII and control characters at every position around block
+	 * boundaries. */
+	const char *const specials[] = { "\x01", "\x7f", "\t", "\xd1\x8f" };
+	char str[80];
+	size_t i, j;
+	for(i = 0; i < ARRAY_LEN(specials); ++i)
+	{
+		for(j = 0; j < 40; ++j)
+		{
+			memset(str, 'a', j);
+			str[j] = '\0';
+			strcat(str, specials[i]);
+			strcat(str, "bcdefghijklmnopqrstuvwxyz0123456789");
+
+			assert_int_equal(strsw_by_char(str), utf8_strsw(str));
+			assert_int_equal(strsw_by_char(str), utf8_nstrsw(str, 1000));
+			assert_int_equal(strlen(str) - utf8_strsw(str), utf8_strso(str));
+			assert_int_equal(j, utf8_nstrsnlen(str, j));
+			assert_int_equal(j, utf8_strsnlen(str, j));
+		}
+	}
+
+	assert_int_equal(0, utf8_strsw(""));
+	assert_int_equal(1, utf8_chrsw("~"));
+	assert_int_equal(1, utf8_chrsw("\x7f"));
+	assert_int_equal(2, utf8_chrsw("\x01"));
+	assert_int_equal(5, utf8_nstrsw("abcdefghijklmnopqrstuvwxyz", 5));
+}
+
+TEST(word_at_a_time_check_stops_at_first_unprintable_byte)
+{
+	/* The SSE2 version is what utf8_*() functions use on x86-64, so check the
+	 * portable one directly.  Every byte value is put at every position of a
+	 * couple of words to catch carries and borrows between bytes. */
+	char str[4*sizeof(size_t)];
+	size_t pos;
+	int c;
+	for(c = 0; c < 256; ++c)
+	{
+		const int printable = (c >= 0x20 && c < 0x7f);
+		for(pos = 0; pos < sizeof(str); ++pos)
+		{
+			memset(str, 'a', sizeof(str));
+			str[pos] = c;
+			assert_int_equal(printable ? sizeof(str) : pos,
+					ascii_prefix_len_by_words(str, sizeof(str)));
+			assert_int_equal(printable ? pos + 1 : pos,
+					ascii_prefix_len_by_words(str, pos + 1));
+		}
+	}
+
+	assert_int_equal(0, ascii_prefix_len_by_words("abc", 0));
+	assert_int_equal(3, ascii_prefix_len_by_words("abc", 3));
+	assert_int_equal(2, ascii_prefix_len_by_words("ab\xd1\x8f", 4));
+}
+
+TEST(ascii_fast_path_benchmark)
+{
+	enum { NNAMES = 20000 };
+	static char names[NNAMES][64];
+
+	int i;
+	for(i = 0; i < NNAMES; ++i)
+	{
+		snprintf(names[i], sizeof(names[i]), "some_file_name_number_%d.%s", i,
+				(i%10 == 0) ? "тхт" : "txt");
+	}
+
+	size_t by_char_width = 0;
+	const clock_t by_char_start = clock();
+	for(i = 0; i < NNAMES; ++i)
+	{
+		by_char_width += strsw_by_char(names[i]);
+	}
+	const clock_t by_char_time = clock() - by_char_start;
+
+	size_t width = 0;
+	const clock_t start = clock();
+	for(i = 0; i < NNAMES; ++i)
+	{
+		width += utf8_strsw(names[i]);
+	}
+	const clock_t time = clock() - start;
+
+	assert_int_equal(by_char_width, width);
+
+	/* Timings are only reported, because they are too noisy to be checked on
+	 * loaded machines or under valgrind and sanitizers. */
+	printf("utf8_strsw() of %d names: %.2f ms (per character: %.2f ms)\n", NNAMES,
+			1000.0*time/CLOCKS_PER_SEC, 1000.0*by_char_time/CLOCKS_PER_SEC);
+}
+
+/* Computes screen width of a string by looking at every character the way it
+ * was done before the fast path.  Returns the width. */
+static size_t
+strsw_by_char(const char str[])
+{
+	size_t width = 0;
+	while(*str != '\0')
+	{
+		int len;
+		const wchar_t wc = utf8_first_char(str, &len);
+		const size_t char_width = vifm_wcwidth(wc);
+		width += (char_width == (size_t)-1) ? 1 : char_width;
+		str += len;
+	}
+	return width;
+}
+
 #ifdef _WIN32
 
 TEST(utf16_roundtrip, IF(utf8_locale))